@@ -0,0 +1,308 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "AsymmetricCompare.h"
+#include "CSVReader.h"
+#include "KeyHash.h"
+#include "MainWindow.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <cstring>
+
+namespace
+{
+    bool isTrimSpace( char ch )
+    {
+        return ( ch == ' ' ) || ( ( ch >= '\t' ) && ( ch <= '\r' ) );
+    }
+}
+
+void CAsymmetricCompare::clear()
+{
+    fSmall.clear();
+    fKeyColumns.clear();
+    fKeyOptions.clear();
+    fSmallKeyCols.clear();
+    fLargeKeyCols.clear();
+    fFilter.clear();
+    fSmallIndex.clear();
+    fMatchCounts.clear();
+    fLargeDialect = CCSVDialect();
+    fLargeHeader.clear();
+    fLargeMerged.clear();
+    fNumLargeRows = 0;
+    fNumLargeMatched = 0;
+    fNumLargeIgnored = 0;
+    fNumRejected = 0;
+    fNumFalsePositives = 0;
+}
+
+// same canonical bytes SCSVTable::computeKey feeds the MD5, so equal keys always hash equal
+quint64 CAsymmetricCompare::keyHash( const QStringList & rowData, const std::vector< int > & keyCols, const std::vector< int > & options )
+{
+    QByteArray keyBytes;
+    for ( size_t ii = 0; ii < keyCols.size(); ++ii )
+        CKeyNormalizer::appendValue( rowData[ keyCols[ ii ] ], options[ ii ], keyBytes );
+    return NKeyHash::hash64( keyBytes.constData(), keyBytes.length() );
+}
+
+// Splits and hashes the key columns straight from the UTF-8 bytes. Lines getRow could
+// read differently (quotes, merged name columns, non-ASCII space at the ends) go to the slow path
+CAsymmetricCompare::EFastKey CAsymmetricCompare::fastKeyHash( const QByteArray & line, quint64 & hash )
+{
+    if ( !fLargeMerged.empty() )
+        return EFastKey::eSlowPath;
+
+    // a tab delimiter is not trimmed, as in CCSVDialect::trimmed
+    auto delimiter = fLargeDialect.delimiter();
+    auto data = line.constData();
+    int begin = 0;
+    int end = line.length();
+    while ( ( begin < end ) && isTrimSpace( data[ begin ] ) && ( data[ begin ] != delimiter ) )
+        ++begin;
+    while ( ( end > begin ) && isTrimSpace( data[ end - 1 ] ) && ( data[ end - 1 ] != delimiter ) )
+        --end;
+    if ( begin == end )
+        return EFastKey::eBlank;
+    if ( ( static_cast< unsigned char >( data[ begin ] ) >= 0x80 ) || ( static_cast< unsigned char >( data[ end - 1 ] ) >= 0x80 ) )
+        return EFastKey::eSlowPath;
+    if ( std::memchr( data + begin, fLargeDialect.quote(), end - begin ) || ( fLargeDialect.escape() && std::memchr( data + begin, fLargeDialect.escape(), end - begin ) ) )
+        return EFastKey::eSlowPath;
+
+    fFieldStarts.clear();
+    fFieldStarts.push_back( begin );
+    for ( auto pos = static_cast< const char * >( std::memchr( data + begin, delimiter, end - begin ) ); pos; pos = static_cast< const char * >( std::memchr( pos + 1, delimiter, data + end - pos - 1 ) ) )
+        fFieldStarts.push_back( static_cast< int >( pos - data ) + 1 );
+    fFieldStarts.push_back( end + 1 );
+
+    auto numFields = static_cast< int >( fFieldStarts.size() ) - 1;
+    if ( fLargeFilter.isActive() )
+    {
+        fFields.clear();
+        for ( int ii = 0; ii < numFields; ++ii )
+            fFields.push_back( { data + fFieldStarts[ ii ], fFieldStarts[ ii + 1 ] - fFieldStarts[ ii ] - 1 } );
+        if ( fLargeFilter.isIgnored( fFields ) )
+            return EFastKey::eIgnored;
+    }
+    if ( numFields != fLargeHeader.count() )
+        return EFastKey::eBadColumns;
+
+    fKeyBytes.clear();
+    for ( size_t ii = 0; ii < fLargeKeyCols.size(); ++ii )
+    {
+        auto col = fLargeKeyCols[ ii ];
+        CKeyNormalizer::appendValue( data + fFieldStarts[ col ], fFieldStarts[ col + 1 ] - fFieldStarts[ col ] - 1, fKeyOptions[ ii ], fKeyBytes );
+    }
+    hash = NKeyHash::hash64( fKeyBytes.constData(), fKeyBytes.length() );
+    return EFastKey::eHashed;
+}
+
+void CAsymmetricCompare::verify( const QStringList & rowData )
+{
+    auto pos = fSmallIndex.find( SCSVTable::computeKey( rowData, fLargeKeyCols, fKeyOptions ) );
+    if ( pos == fSmallIndex.end() )
+    {
+        fNumFalsePositives++;
+        return;
+    }
+    fMatchCounts[ ( *pos ).second ]++;
+    fNumLargeMatched++;
+}
+
+bool CAsymmetricCompare::compare( const QString & smallFile, const QString & largeFile, QString * errorMsg, const std::atomic< bool > * canceled )
+{
+    clear();
+    if ( !fSmall.load( smallFile, errorMsg, canceled ) )
+        return false;
+
+    CCSVReader reader;
+    if ( !reader.open( largeFile ) )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error opening file '%1'" ).arg( largeFile );
+        return false;
+    }
+    fLargeDialect = CCSVDialect::sniff( reader.peek( CCSVDialect::kSampleBytes ) );
+    reader.setLineEnd( fLargeDialect.lineEnd() );
+
+    QString firstLine;
+    QByteArray rawLine;
+    while ( firstLine.isEmpty() && reader.readLine( rawLine ) )
+        firstLine = fLargeDialect.trimmed( QString::fromUtf8( rawLine ) );
+    auto header = SFileData::getRow( firstLine, {}, fLargeDialect );
+    if ( !header.has_value() || !header.value().first || header.value().second.isEmpty() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Invalid format '%1' at Row: %2" ).arg( largeFile ).arg( 1 );
+        return false;
+    }
+    fLargeHeader = header.value().second;
+    fLargeFilter.bind( fLargeHeader );
+    std::map< int, QString > extraCols;
+    fLargeMerged = SFileData::computeMergedColumns( fLargeHeader, extraCols );
+
+    for ( int ii = 0; ii < fSmall.columnCount(); ++ii )
+    {
+        auto largeCol = fLargeHeader.indexOf( fSmall.fHeader[ ii ] );
+        if ( largeCol < 0 )
+            continue;
+        fKeyColumns << fSmall.fHeader[ ii ];
+        fSmallKeyCols.push_back( ii );
+        fLargeKeyCols.push_back( largeCol );
+    }
+    if ( fKeyColumns.isEmpty() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "The files do not share any columns" );
+        return false;
+    }
+
+    fKeyOptions = fNormalizer.columnOptions( fKeyColumns );
+    fFilter.init( fSmall.rowCount() );
+    fMatchCounts.assign( fSmall.rowCount(), 0 );
+    for ( int ii = 0; ii < fSmall.rowCount(); ++ii )
+    {
+        fSmallIndex.emplace( fSmall.computeKey( ii, fSmallKeyCols, fKeyOptions ), ii );
+        fFilter.insert( keyHash( fSmall.fRows[ ii ], fSmallKeyCols, fKeyOptions ) );
+    }
+
+    auto invalidColumns = [ errorMsg, largeFile ]( qint64 lineNum )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Invalid number of columns in file '%1' at Row: %2" ).arg( largeFile ).arg( lineNum + 1 );
+        return false;
+    };
+
+    qint64 lineNum = 0;
+    while ( reader.readLine( rawLine ) )
+    {
+        if ( canceled && *canceled )
+            return false;
+
+        quint64 hash = 0;
+        auto fastKey = fastKeyHash( rawLine, hash );
+        if ( fastKey == EFastKey::eBlank )
+            continue;
+
+        lineNum++;
+        if ( fastKey == EFastKey::eBadColumns )
+            return invalidColumns( lineNum );
+        if ( fastKey == EFastKey::eIgnored )
+        {
+            fNumLargeIgnored++;
+            continue;
+        }
+
+        fNumLargeRows++;
+        if ( ( fastKey == EFastKey::eHashed ) && !fFilter.mayContain( hash ) )
+        {
+            fNumRejected++;
+            continue;
+        }
+
+        if ( ( fastKey == EFastKey::eSlowPath ) && ( fLargeFilter.classify( rawLine, fLargeDialect ) == CRowFilter::eIgnored ) )
+        {
+            fNumLargeRows--;
+            fNumLargeIgnored++;
+            continue;
+        }
+
+        // probable hit, or a line the fast path could not split, parse it fully
+        auto currRow = SFileData::getRow( QString::fromUtf8( rawLine ), fLargeMerged, fLargeDialect );
+        if ( !currRow.has_value() )
+        {
+            fNumLargeRows--;
+            lineNum--;
+            continue;
+        }
+        if ( !currRow.value().first )
+        {
+            if ( errorMsg )
+                *errorMsg = QString( "Invalid format in file '%1' at Row: %2" ).arg( largeFile ).arg( lineNum + 1 );
+            return false;
+        }
+
+        auto && currRowData = currRow.value().second;
+        if ( currRowData.count() != fLargeHeader.count() )
+            return invalidColumns( lineNum );
+
+        if ( fastKey == EFastKey::eSlowPath )
+        {
+            if ( !fFilter.mayContain( keyHash( currRowData, fLargeKeyCols, fKeyOptions ) ) )
+            {
+                fNumRejected++;
+                continue;
+            }
+        }
+        verify( currRowData );
+    }
+    if ( reader.hasError() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error reading file '%1': %2" ).arg( largeFile ).arg( reader.errorString() );
+        return false;
+    }
+    return true;
+}
+
+int CAsymmetricCompare::numSmallMatched() const
+{
+    int retVal = 0;
+    for ( auto && ii : fMatchCounts )
+    {
+        if ( ii )
+            retVal++;
+    }
+    return retVal;
+}
+
+bool CAsymmetricCompare::save( const QString & fileName, QString * errorMsg ) const
+{
+    QFile file( fileName );
+    file.open( QFile::Text | QFile::Truncate | QFile::WriteOnly );
+    if ( !file.isOpen() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Could not open file '%1' for write" ).arg( fileName );
+        return false;
+    }
+
+    QTextStream ts( &file );
+    auto writeRow = [ &ts ]( QStringList rowData )
+    {
+        for ( auto && ii : rowData )
+            ii = QString( R"("%1")" ).arg( QString( ii ).replace( "\"", "\"\"" ) );
+        ts << rowData.join( "," ) << "\n";
+    };
+
+    writeRow( QStringList() << "No."
+                            << "Status" << fSmall.fHeader << "Matches" );
+    for ( int ii = 0; ii < fSmall.rowCount(); ++ii )
+    {
+        QStringList rowData;
+        for ( int jj = 0; jj < fSmall.columnCount(); ++jj )
+            rowData << fSmall.data( ii, jj );
+        writeRow( QStringList() << QString::number( ii + 1 ) << ( fMatchCounts[ ii ] ? "Both" : "LHS Only" ) << rowData << QString::number( fMatchCounts[ ii ] ) );
+    }
+    return true;
+}
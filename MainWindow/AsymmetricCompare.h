@@ -0,0 +1,97 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _ASYMMETRICCOMPARE_H
+#define _ASYMMETRICCOMPARE_H
+
+#include "CSVTable.h"
+#include "BloomFilter.h"
+#include "KeyNormalizer.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+// Compares a small watch list against a file too large to load. The small side is loaded and
+// indexed, the large side is streamed and only its key columns are split and hashed, rows whose
+// key misses the Bloom filter are dropped without being parsed
+class CAsymmetricCompare
+{
+public:
+    bool compare( const QString & smallFile, const QString & largeFile, QString * errorMsg = nullptr, const std::atomic< bool > * canceled = nullptr );
+    bool save( const QString & fileName, QString * errorMsg = nullptr ) const;
+    void clear();
+    void setKeyNormalizer( const CKeyNormalizer & normalizer ) { fNormalizer = normalizer; }
+    void setRowFilter( const CRowFilter & filter ) { fSmall.fRowFilter = filter; fLargeFilter = filter; }
+
+    const SCSVTable & smallTable() const { return fSmall; }
+    const QStringList & keyColumns() const { return fKeyColumns; }
+
+    int numSmallMatched() const;
+    qint64 numLargeRows() const { return fNumLargeRows; }
+    qint64 numLargeMatched() const { return fNumLargeMatched; }
+    qint64 numLargeIgnored() const { return fNumLargeIgnored; }
+    qint64 numFilterRejected() const { return fNumRejected; }
+    qint64 numFalsePositives() const { return fNumFalsePositives; }
+
+    static quint64 keyHash( const QStringList & rowData, const std::vector< int > & keyCols, const std::vector< int > & options );
+private:
+    enum class EFastKey
+    {
+        eBlank,
+        eIgnored,
+        eHashed,
+        eSlowPath,
+        eBadColumns
+    };
+    EFastKey fastKeyHash( const QByteArray & line, quint64 & hash );
+    void verify( const QStringList & rowData );
+
+    SCSVTable fSmall;
+    CKeyNormalizer fNormalizer;
+    QStringList fKeyColumns;
+    std::vector< int > fKeyOptions;
+    std::vector< int > fSmallKeyCols;
+    std::vector< int > fLargeKeyCols;
+    CBlockedBloomFilter fFilter;
+    std::unordered_map< QByteArray, int > fSmallIndex; // md5 -> small row
+    std::vector< int > fMatchCounts; // per small row
+
+    CCSVDialect fLargeDialect;
+    CRowFilter fLargeFilter;
+    QStringList fLargeHeader;
+    std::unordered_map< int, std::pair< int, int > > fLargeMerged;
+    std::vector< int > fFieldStarts; // scratch for the fast path
+    CRowFilter::TFields fFields; // views of the fast path fields for the row filter
+    QByteArray fKeyBytes;
+
+    qint64 fNumLargeRows{ 0 };
+    qint64 fNumLargeMatched{ 0 };
+    qint64 fNumLargeIgnored{ 0 };
+    qint64 fNumRejected{ 0 };
+    qint64 fNumFalsePositives{ 0 };
+};
+
+#endif
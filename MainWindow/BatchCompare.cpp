@@ -0,0 +1,685 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "BatchCompare.h"
+#include "AsymmetricCompare.h"
+#include "Benchmark.h"
+#include "ChunkFingerprints.h"
+#include "ColumnStatistics.h"
+#include "CompareDaemon.h"
+#include "CSVPatch.h"
+#include "MemoryAccounting.h"
+#include "CSVTable.h"
+#include "TableCompare.h"
+#include "WorkStealingPool.h"
+#include "MainWindow.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace
+{
+    struct SPairJob
+    {
+        SBatchPair fPair;
+        QString fResultFile;
+        QString fPatchFile; // empty when no patch is wanted
+        qint64 fSize{ 0 };
+
+        SCSVTable fLHS;
+        SCSVTable fRHS;
+        QString fLHSError;
+        QString fRHSError;
+        std::atomic< int > fNumParsed{ 0 };
+        CTableCompare fCompare;
+
+        bool fSkipIdentical{ false };
+        CChunkFingerprints fLHSChunks;
+        CChunkFingerprints fRHSChunks;
+        CChunkFingerprints::TRanges fLHSRanges;
+        CChunkFingerprints::TRanges fRHSRanges;
+        CChunkFingerprints::TRanges fSharedRanges; // of the LHS file
+        std::atomic< int > fNumFingerprinted{ 0 };
+        int fNumIdenticalRows{ 0 };
+        qint64 fSkippedBytes{ 0 };
+
+        QElapsedTimer fTimer;
+        QString fSummary;
+        QJsonObject fReport;
+        bool fWantStatistics{ false };
+        bool fAOK{ false };
+
+        void setError( const QString & msg )
+        {
+            fSummary = QString( "%1: ERROR %2" ).arg( fPair.fName ).arg( msg );
+            fReport[ "status" ] = "error";
+            fReport[ "error" ] = msg;
+        }
+
+        void fingerprint( bool lhs )
+        {
+            // a file that can not be fingerprinted is just parsed in full
+            if ( lhs )
+                fLHSChunks.compute( fPair.fLHSFile );
+            else
+                fRHSChunks.compute( fPair.fRHSFile );
+        }
+
+        // after both fingerprints, only the chunks not found in the other file get parsed
+        void matchChunks()
+        {
+            fNumIdenticalRows = CChunkFingerprints::match( fLHSChunks, fRHSChunks, fLHSRanges, fRHSRanges, &fSkippedBytes, &fSharedRanges );
+            fLHSChunks.clear();
+            fRHSChunks.clear();
+        }
+
+        void load( bool lhs )
+        {
+            auto && ranges = lhs ? fLHSRanges : fRHSRanges;
+            if ( lhs )
+                fLHS.load( fPair.fLHSFile, &fLHSError, nullptr, ranges.empty() ? nullptr : &ranges );
+            else
+                fRHS.load( fPair.fRHSFile, &fRHSError, nullptr, ranges.empty() ? nullptr : &ranges );
+        }
+
+        // the skipped rows only count as matched when none of their keys is on a parsed row, else both files are parsed in full
+        void checkSharedRows()
+        {
+            if ( ( fNumIdenticalRows == 0 ) || !fLHSError.isEmpty() || !fRHSError.isEmpty() )
+                return;
+
+            bool isolated = false;
+            if ( !fCompare.sharedRowsIsolated( fLHS, fRHS, fSharedRanges, isolated, &fLHSError ) || isolated )
+                return;
+
+            fNumIdenticalRows = 0;
+            fSkippedBytes = 0;
+            fLHSRanges.clear();
+            fRHSRanges.clear();
+            fSharedRanges.clear();
+            load( true );
+            if ( fLHSError.isEmpty() )
+                load( false );
+        }
+
+        void join()
+        {
+            checkSharedRows();
+            fReport[ "name" ] = fPair.fName;
+            fReport[ "lhsFile" ] = fPair.fLHSFile;
+            fReport[ "rhsFile" ] = fPair.fRHSFile;
+            if ( !fLHSError.isEmpty() || !fRHSError.isEmpty() )
+            {
+                setError( !fLHSError.isEmpty() ? fLHSError : fRHSError );
+            }
+            else if ( !fCompare.compare( fLHS, fRHS ) )
+            {
+                setError( "The files do not share any columns" );
+            }
+            else
+            {
+                QString msg;
+                fAOK = fCompare.save( fResultFile, &msg );
+                if ( !fAOK )
+                    setError( msg );
+                else
+                {
+                    fReport[ "status" ] = "ok";
+                    fReport[ "lhsRows" ] = fLHS.rowCount() + fNumIdenticalRows;
+                    fReport[ "rhsRows" ] = fRHS.rowCount() + fNumIdenticalRows;
+                    fReport[ "matched" ] = fCompare.numMatched() + fNumIdenticalRows;
+                    fReport[ "lhsOnly" ] = fCompare.numLHSOnly();
+                    fReport[ "rhsOnly" ] = fCompare.numRHSOnly();
+                    fReport[ "mergedRows" ] = fCompare.rowCount();
+                    fReport[ "timeMS" ] = fTimer.elapsed();
+                    fReport[ "result" ] = fResultFile;
+                    if ( fSkipIdentical )
+                    {
+                        fReport[ "identicalRows" ] = fNumIdenticalRows;
+                        fReport[ "skippedBytes" ] = fSkippedBytes;
+                    }
+                    if ( fWantStatistics )
+                    {
+                        CColumnStatistics stats;
+                        stats.compute( fLHS );
+                        fReport[ "lhsColumns" ] = stats.toJson();
+                        stats.compute( fRHS );
+                        fReport[ "rhsColumns" ] = stats.toJson();
+                    }
+                    QString patchSummary;
+                    if ( !fPatchFile.isEmpty() )
+                    {
+                        CCSVPatch::SStats stats;
+                        if ( !CCSVPatch::write( fLHS, fRHS, fPatchFile, &msg, &stats ) )
+                        {
+                            fAOK = false;
+                            setError( msg );
+                        }
+                        else
+                        {
+                            QJsonObject patch;
+                            patch[ "file" ] = fPatchFile;
+                            patch[ "bytes" ] = stats.fBytes;
+                            patch[ "copied" ] = stats.fCopied;
+                            patch[ "deleted" ] = stats.fDeleted;
+                            patch[ "updated" ] = stats.fUpdated;
+                            patch[ "inserted" ] = stats.fInserted;
+                            patch[ "changedCells" ] = stats.fChangedCells;
+                            fReport[ "patch" ] = patch;
+                            patchSummary = QString( " Patch=%1 (%2 bytes)" ).arg( fPatchFile ).arg( stats.fBytes );
+                        }
+                    }
+                    if ( fAOK )
+                        fSummary = QString( "%1: OK LHS Rows=%2 RHS Rows=%3 Matched=%4 LHS Only=%5 RHS Only=%6 Merged Rows=%7 Time=%8ms Result=%9" )
+                                       .arg( fPair.fName )
+                                       .arg( fLHS.rowCount() + fNumIdenticalRows )
+                                       .arg( fRHS.rowCount() + fNumIdenticalRows )
+                                       .arg( fCompare.numMatched() + fNumIdenticalRows )
+                                       .arg( fCompare.numLHSOnly() )
+                                       .arg( fCompare.numRHSOnly() )
+                                       .arg( fCompare.rowCount() )
+                                       .arg( fTimer.elapsed() )
+                                       .arg( fResultFile ) + patchSummary;
+                }
+            }
+            fCompare.clear();
+            fLHS.clear();
+            fRHS.clear();
+        }
+    };
+}
+
+bool CBatchCompare::isBatchMode( int argc, char ** argv )
+{
+    for ( int ii = 1; ii < argc; ++ii )
+    {
+        if ( qstrcmp( argv[ ii ], "--batch" ) == 0 )
+            return true;
+    }
+    return false;
+}
+
+int CBatchCompare::exec( const QStringList & args )
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription( "Compare pairs of CSV files without the GUI" );
+    parser.addHelpOption();
+    parser.addOption( { "batch", "Run in batch mode." } );
+    parser.addOption( { "lhs-dir", "Directory of LHS files, paired by name with the RHS directory.", "dir" } );
+    parser.addOption( { "rhs-dir", "Directory of RHS files.", "dir" } );
+    parser.addOption( { "manifest", "File listing one \"lhs,rhs\" pair per line, either side can be a glob or a ';' separated list of the shards of one table.", "file" } );
+    parser.addOption( { "output-dir", "Directory for the result files.", "dir", "." } );
+    parser.addOption( { "threads", "Number of worker threads (default one per core).", "num" } );
+    parser.addOption( { "skip-identical", "Batch mode only, the window always parses every row. Find the chunks both files share at the same place in their order, count their rows as matched and only compare the rest. "
+                          "When a key of those rows is also on a compared row, the pair is compared in full instead. The result file only holds the compared rows." } );
+    parser.addOption( { "report", "Write a JSON report of the results, the column statistics and the memory used by each subsystem.", "file" } );
+    parser.addOption( { "watchlist", "Small file whose rows are looked up in the --against file without loading it.", "file" } );
+    parser.addOption( { "against", "Large file streamed past the --watchlist keys.", "file" } );
+    parser.addOption( { "daemon", "Load and index this reference file once, then compare the files sent over the --socket.", "file" } );
+    parser.addOption( { "socket", "Local socket name of the daemon.", "name", "CompareCSV" } );
+    parser.addOption( { "submit", "Send this file to the daemon listening on --socket and print its reply, the result is written to the daemon's --output-dir.", "file" } );
+    parser.addOption( { "normalize", "Key normalization per column, e.g. \"Name=trim+casefold;Phone=numbers;*=truncate\". Options: trim, collapse, casefold, nopunct, numbers, dates, truncate; * sets the default.", "spec" } );
+    parser.addOption( { "row-filter", QString( "Ignore the rows where this expression holds, e.g. \"Amount < 0 or empty( [Account Id] )\". Columns are a name, a [name with spaces] or * for every field; the tests are = != < <= > >= in ( ... ) ~ !~ and empty( column ), combined with and, or and not. Empty ignores nothing, the default is %1" ).arg( CRowFilter::defaultExpression() ), "expression" } );
+    parser.addOption( { "patch", "Also write a binary patch per pair that rebuilds the RHS file from the LHS file." } );
+    parser.addOption( { "apply-patch", "Rebuild the RHS file from the --lhs file and this patch, written to --output-dir.", "file" } );
+    parser.addOption( { "lhs", "LHS file the --apply-patch patch was made from.", "file" } );
+    parser.addOption( { "benchmark", "Run the performance suite on generated files in --output-dir and print the throughput and peak memory per stage." } );
+    parser.addOption( { "benchmark-rows", "Number of rows the --benchmark files are generated with.", "num" } );
+    parser.addOption( { "baseline", "Baseline JSON the --benchmark results are checked against, fails when a stage is slower or uses more memory than --tolerance allows.", "file" } );
+    parser.addOption( { "write-baseline", "Write the --benchmark results to this baseline JSON.", "file" } );
+    parser.addOption( { "tolerance", "Percent a --benchmark stage may be slower or larger than its baseline.", "percent", QString::number( CBenchmark::kDefaultTolerance ) } );
+    parser.process( args );
+
+    QTextStream errStream( stderr );
+    CKeyNormalizer normalizer;
+    QString msg;
+    if ( parser.isSet( "normalize" ) && !normalizer.parse( parser.value( "normalize" ), &msg ) )
+    {
+        errStream << msg << Qt::endl;
+        return 1;
+    }
+    CRowFilter rowFilter;
+    if ( parser.isSet( "row-filter" ) && !rowFilter.parse( parser.value( "row-filter" ), &msg ) )
+    {
+        errStream << msg << Qt::endl;
+        return 1;
+    }
+
+    if ( parser.isSet( "submit" ) )
+    {
+        QJsonObject request;
+        request[ "id" ] = 1;
+        request[ "file" ] = QFileInfo( parser.value( "submit" ) ).absoluteFilePath();
+
+        QJsonObject reply;
+        auto aOK = CCompareDaemon::submit( parser.value( "socket" ), request, reply, &msg );
+        if ( !msg.isEmpty() )
+            errStream << msg << Qt::endl;
+        QTextStream( stdout ) << QJsonDocument( reply ).toJson( QJsonDocument::Indented );
+        return aOK ? 0 : 1;
+    }
+
+    if ( parser.isSet( "daemon" ) )
+    {
+        CCompareDaemon daemon;
+        daemon.setOutputDir( parser.value( "output-dir" ) );
+        daemon.setKeyNormalizer( normalizer );
+        daemon.setRowFilter( rowFilter );
+        if ( parser.isSet( "threads" ) )
+            daemon.setNumThreads( parser.value( "threads" ).toInt() );
+        if ( !daemon.start( parser.value( "daemon" ), parser.value( "socket" ), &msg ) )
+        {
+            errStream << msg << Qt::endl;
+            return 1;
+        }
+        QTextStream( stdout ) << QString( "Listening on '%1'" ).arg( daemon.serverName() ) << Qt::endl;
+        return QCoreApplication::exec();
+    }
+
+    if ( parser.isSet( "benchmark" ) )
+    {
+        CBenchmark benchmark;
+        benchmark.setWorkDir( QDir( parser.value( "output-dir" ) ).absoluteFilePath( "benchmark" ) );
+        if ( parser.isSet( "benchmark-rows" ) )
+            benchmark.setNumRows( parser.value( "benchmark-rows" ).toInt() );
+        benchmark.setTolerance( parser.value( "tolerance" ).toInt() );
+
+        QTextStream outStream( stdout );
+        if ( !benchmark.run( outStream, &msg ) || ( parser.isSet( "write-baseline" ) && !benchmark.writeBaseline( parser.value( "write-baseline" ), &msg ) ) )
+        {
+            errStream << msg << Qt::endl;
+            return 1;
+        }
+        if ( parser.isSet( "baseline" ) && !benchmark.checkBaseline( parser.value( "baseline" ), outStream, &msg ) )
+        {
+            if ( !msg.isEmpty() )
+                errStream << msg << Qt::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if ( parser.isSet( "watchlist" ) || parser.isSet( "against" ) )
+    {
+        if ( !parser.isSet( "watchlist" ) || !parser.isSet( "against" ) )
+        {
+            errStream << "--watchlist and --against must be used together" << Qt::endl;
+            return 1;
+        }
+        QTextStream outStream( stdout );
+        return runWatchlist( parser.value( "watchlist" ), parser.value( "against" ), parser.value( "output-dir" ), normalizer, rowFilter, outStream ) ? 0 : 1;
+    }
+
+    if ( parser.isSet( "apply-patch" ) || parser.isSet( "lhs" ) )
+    {
+        if ( !parser.isSet( "apply-patch" ) || !parser.isSet( "lhs" ) )
+        {
+            errStream << "--apply-patch and --lhs must be used together" << Qt::endl;
+            return 1;
+        }
+        QTextStream outStream( stdout );
+        return runApplyPatch( parser.value( "lhs" ), parser.value( "apply-patch" ), parser.value( "output-dir" ), outStream ) ? 0 : 1;
+    }
+
+    if ( parser.isSet( "patch" ) && parser.isSet( "skip-identical" ) )
+    {
+        errStream << "--patch needs every row parsed, it can not be used with --skip-identical" << Qt::endl;
+        return 1;
+    }
+
+    CBatchCompare batch;
+    batch.setKeyNormalizer( normalizer );
+    batch.setRowFilter( rowFilter );
+    if ( parser.isSet( "lhs-dir" ) || parser.isSet( "rhs-dir" ) )
+    {
+        if ( !batch.addDirectories( parser.value( "lhs-dir" ), parser.value( "rhs-dir" ), &msg ) )
+        {
+            errStream << msg << Qt::endl;
+            return 1;
+        }
+    }
+    if ( parser.isSet( "manifest" ) )
+    {
+        if ( !batch.addManifest( parser.value( "manifest" ), &msg ) )
+        {
+            errStream << msg << Qt::endl;
+            return 1;
+        }
+    }
+    if ( batch.pairs().empty() )
+    {
+        errStream << "No file pairs to compare" << Qt::endl;
+        return 1;
+    }
+
+    batch.setOutputDir( parser.value( "output-dir" ) );
+    if ( parser.isSet( "report" ) )
+        batch.setReportFile( parser.value( "report" ) );
+    batch.setSkipIdentical( parser.isSet( "skip-identical" ) );
+    batch.setWritePatch( parser.isSet( "patch" ) );
+    if ( parser.isSet( "threads" ) )
+        batch.setNumThreads( parser.value( "threads" ).toInt() );
+
+    QTextStream outStream( stdout );
+    return batch.run( outStream ) ? 0 : 1;
+}
+
+bool CBatchCompare::runWatchlist( const QString & smallFile, const QString & largeFile, const QString & outputDir, const CKeyNormalizer & normalizer, const CRowFilter & filter, QTextStream & summary )
+{
+    QDir().mkpath( outputDir );
+
+    QElapsedTimer timer;
+    timer.start();
+
+    auto name = QFileInfo( smallFile ).completeBaseName();
+    CAsymmetricCompare compare;
+    compare.setKeyNormalizer( normalizer );
+    compare.setRowFilter( filter );
+    QString msg;
+    if ( !compare.compare( smallFile, largeFile, &msg ) )
+    {
+        summary << QString( "%1: ERROR %2" ).arg( name ).arg( msg ) << Qt::endl;
+        return false;
+    }
+
+    auto resultFile = QDir( outputDir ).absoluteFilePath( name + ".watchlist.csv" );
+    if ( !compare.save( resultFile, &msg ) )
+    {
+        summary << QString( "%1: ERROR %2" ).arg( name ).arg( msg ) << Qt::endl;
+        return false;
+    }
+
+    summary << QString( "%1: OK Watchlist Rows=%2 Found=%3 Not Found=%4 Scanned Rows=%5 Matching Rows=%6 Filter Rejected=%7 False Positives=%8 Time=%9ms Result=%10" )
+                   .arg( name )
+                   .arg( compare.smallTable().rowCount() )
+                   .arg( compare.numSmallMatched() )
+                   .arg( compare.smallTable().rowCount() - compare.numSmallMatched() )
+                   .arg( compare.numLargeRows() )
+                   .arg( compare.numLargeMatched() )
+                   .arg( compare.numFilterRejected() )
+                   .arg( compare.numFalsePositives() )
+                   .arg( timer.elapsed() )
+                   .arg( resultFile )
+            << Qt::endl;
+    return true;
+}
+
+bool CBatchCompare::runApplyPatch( const QString & lhsFile, const QString & patchFile, const QString & outputDir, QTextStream & summary )
+{
+    QDir().mkpath( outputDir );
+
+    QElapsedTimer timer;
+    timer.start();
+
+    auto name = QFileInfo( patchFile ).completeBaseName();
+    SCSVTable lhs;
+    QString msg;
+    if ( !lhs.load( lhsFile, &msg ) )
+    {
+        summary << QString( "%1: ERROR %2" ).arg( name ).arg( msg ) << Qt::endl;
+        return false;
+    }
+
+    auto resultFile = QDir( outputDir ).absoluteFilePath( name + ".csv" );
+    CCSVPatch::SStats stats;
+    if ( !CCSVPatch::apply( lhs, patchFile, resultFile, &msg, &stats ) )
+    {
+        summary << QString( "%1: ERROR %2" ).arg( name ).arg( msg ) << Qt::endl;
+        return false;
+    }
+
+    summary << QString( "%1: OK Copied=%2 Deleted=%3 Updated=%4 Inserted=%5 Changed Cells=%6 Time=%7ms Result=%8" )
+                   .arg( name )
+                   .arg( stats.fCopied )
+                   .arg( stats.fDeleted )
+                   .arg( stats.fUpdated )
+                   .arg( stats.fInserted )
+                   .arg( stats.fChangedCells )
+                   .arg( timer.elapsed() )
+                   .arg( resultFile )
+            << Qt::endl;
+    return true;
+}
+
+bool CBatchCompare::addDirectories( const QString & lhsDir, const QString & rhsDir, QString * errorMsg )
+{
+    QDir lhs( lhsDir );
+    QDir rhs( rhsDir );
+    if ( lhsDir.isEmpty() || !lhs.exists() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "LHS directory '%1' does not exist" ).arg( lhsDir );
+        return false;
+    }
+    if ( rhsDir.isEmpty() || !rhs.exists() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "RHS directory '%1' does not exist" ).arg( rhsDir );
+        return false;
+    }
+
+    auto lhsFiles = lhs.entryInfoList( QStringList() << "*.csv" << "*.txt", QDir::Files, QDir::Name );
+    for ( auto && ii : lhsFiles )
+    {
+        QFileInfo rhsFile( rhs.absoluteFilePath( ii.fileName() ) );
+        if ( !rhsFile.exists() || !rhsFile.isFile() )
+            continue;
+        fPairs.push_back( { ii.completeBaseName(), ii.absoluteFilePath(), rhsFile.absoluteFilePath() } );
+    }
+    return true;
+}
+
+bool CBatchCompare::addManifest( const QString & manifest, QString * errorMsg )
+{
+    QFile fi( manifest );
+    fi.open( QFile::Text | QFile::ReadOnly );
+    if ( !fi.isOpen() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error opening file '%1'" ).arg( manifest );
+        return false;
+    }
+
+    auto baseDir = QFileInfo( manifest ).absoluteDir();
+    // either side can be a glob or ';' separated list of shards, each relative to the manifest
+    auto resolve = [ &baseDir ]( const QString & fileName )
+    {
+        QStringList retVal;
+        for ( auto && ii : fileName.split( ';', Qt::SkipEmptyParts ) )
+            retVal << baseDir.absoluteFilePath( ii.trimmed() );
+        return retVal.join( ';' );
+    };
+    QTextStream ts( &fi );
+    QString currLine;
+    int lineNum = 0;
+    while ( ts.readLineInto( &currLine ) )
+    {
+        lineNum++;
+        if ( currLine.trimmed().startsWith( "#" ) )
+            continue;
+        auto currRow = SFileData::getRow( currLine );
+        if ( !currRow.has_value() )
+            continue;
+        if ( !currRow.value().first || ( currRow.value().second.count() != 2 ) )
+        {
+            if ( errorMsg )
+                *errorMsg = QString( "Invalid format in file '%1' at Row: %2" ).arg( manifest ).arg( lineNum );
+            return false;
+        }
+        auto lhsFile = resolve( currRow.value().second[ 0 ] );
+        auto rhsFile = resolve( currRow.value().second[ 1 ] );
+        // a glob names the pair without its wildcards
+        auto name = QFileInfo( lhsFile.section( ';', 0, 0 ) ).completeBaseName().remove( QRegularExpression( R"([*?\[\]])" ) );
+        fPairs.push_back( { name, lhsFile, rhsFile } );
+    }
+    return true;
+}
+
+QString CBatchCompare::resultFile( const SBatchPair & pair ) const
+{
+    return QDir( fOutputDir ).absoluteFilePath( pair.fName + ".merged.csv" );
+}
+
+bool CBatchCompare::run( QTextStream & summary )
+{
+    QDir().mkpath( fOutputDir );
+
+    std::vector< std::unique_ptr< SPairJob > > jobs;
+    for ( auto && ii : fPairs )
+    {
+        auto job = std::make_unique< SPairJob >();
+        job->fPair = ii;
+        job->fResultFile = resultFile( ii );
+        if ( fWritePatch )
+            job->fPatchFile = QDir( fOutputDir ).absoluteFilePath( ii.fName + ".patch" );
+        job->fCompare.setKeyNormalizer( fNormalizer );
+        job->fLHS.fRowFilter = fRowFilter;
+        job->fRHS.fRowFilter = fRowFilter;
+        job->fLHSChunks.setRowFilter( fRowFilter );
+        job->fRHSChunks.setRowFilter( fRowFilter );
+        job->fWantStatistics = !fReportFile.isEmpty();
+        job->fSkipIdentical = fSkipIdentical;
+        job->fSize = QFileInfo( ii.fLHSFile ).size() + QFileInfo( ii.fRHSFile ).size();
+        jobs.emplace_back( std::move( job ) );
+    }
+
+    // largest first, so the long pairs are not the last ones started
+    std::vector< SPairJob * > schedule;
+    for ( auto && ii : jobs )
+        schedule.push_back( ii.get() );
+    std::stable_sort( schedule.begin(), schedule.end(), []( const SPairJob * lhs, const SPairJob * rhs ) { return lhs->fSize > rhs->fSize; } );
+
+    {
+        CWorkStealingPool pool( fNumThreads );
+        for ( auto && job : schedule )
+        {
+            if ( job->fSize <= fSplitSize )
+            {
+                pool.submit( [ job ]()
+                             {
+                                 job->fTimer.start();
+                                 if ( job->fSkipIdentical )
+                                 {
+                                     job->fingerprint( true );
+                                     job->fingerprint( false );
+                                     job->matchChunks();
+                                 }
+                                 job->load( true );
+                                 if ( job->fLHSError.isEmpty() )
+                                     job->load( false );
+                                 job->join();
+                             } );
+                continue;
+            }
+
+            job->fTimer.start();
+            auto parsed = [ job, &pool ]()
+            {
+                if ( ++job->fNumParsed == 2 )
+                    pool.submit( [ job ]() { job->join(); } );
+            };
+            auto parse = [ job, &pool, parsed ]()
+            {
+                pool.submit( [ job, parsed ]()
+                             {
+                                 job->load( true );
+                                 parsed();
+                             } );
+                pool.submit( [ job, parsed ]()
+                             {
+                                 job->load( false );
+                                 parsed();
+                             } );
+            };
+            if ( !job->fSkipIdentical )
+            {
+                parse();
+                continue;
+            }
+
+            // both sides are fingerprinted at once, the parse waits for the chunks to be matched
+            auto fingerprinted = [ job, parse ]()
+            {
+                if ( ++job->fNumFingerprinted == 2 )
+                {
+                    job->matchChunks();
+                    parse();
+                }
+            };
+            pool.submit( [ job, fingerprinted ]()
+                         {
+                             job->fingerprint( true );
+                             fingerprinted();
+                         } );
+            pool.submit( [ job, fingerprinted ]()
+                         {
+                             job->fingerprint( false );
+                             fingerprinted();
+                         } );
+        }
+        pool.wait();
+    }
+
+    QFile summaryFile( QDir( fOutputDir ).absoluteFilePath( "summary.txt" ) );
+    summaryFile.open( QFile::Text | QFile::Truncate | QFile::WriteOnly );
+    QTextStream summaryStream( &summaryFile );
+
+    bool aOK = true;
+    QJsonArray pairReports;
+    for ( auto && ii : jobs )
+    {
+        aOK = aOK && ii->fAOK;
+        summary << ii->fSummary << Qt::endl;
+        if ( summaryFile.isOpen() )
+            summaryStream << ii->fSummary << "\n";
+        pairReports.append( ii->fReport );
+    }
+
+    if ( !fReportFile.isEmpty() )
+    {
+        QJsonObject report;
+        report[ "pairs" ] = pairReports;
+        report[ "memory" ] = CMemoryAccounting::instance().toJson();
+
+        QFile reportFile( fReportFile );
+        reportFile.open( QFile::Truncate | QFile::WriteOnly );
+        if ( !reportFile.isOpen() )
+        {
+            summary << QString( "ERROR Could not open file '%1' for write" ).arg( fReportFile ) << Qt::endl;
+            return false;
+        }
+        reportFile.write( QJsonDocument( report ).toJson( QJsonDocument::Indented ) );
+    }
+    return aOK;
+}
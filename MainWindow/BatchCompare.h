@@ -0,0 +1,78 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _BATCHCOMPARE_H
+#define _BATCHCOMPARE_H
+
+#include "KeyNormalizer.h"
+#include "RowFilter.h"
+
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+class QTextStream;
+
+struct SBatchPair
+{
+    QString fName;
+    QString fLHSFile;
+    QString fRHSFile;
+};
+
+// Runs many LHS/RHS compares without the GUI, scheduled on a CWorkStealingPool
+class CBatchCompare
+{
+public:
+    static bool isBatchMode( int argc, char ** argv );
+    static int exec( const QStringList & args );
+    static bool runWatchlist( const QString & smallFile, const QString & largeFile, const QString & outputDir, const CKeyNormalizer & normalizer, const CRowFilter & filter, QTextStream & summary );
+    static bool runApplyPatch( const QString & lhsFile, const QString & patchFile, const QString & outputDir, QTextStream & summary );
+
+    bool addDirectories( const QString & lhsDir, const QString & rhsDir, QString * errorMsg );
+    bool addManifest( const QString & manifest, QString * errorMsg );
+    void setOutputDir( const QString & dir ) { fOutputDir = dir; }
+    void setNumThreads( int numThreads ) { fNumThreads = numThreads; }
+    void setKeyNormalizer( const CKeyNormalizer & normalizer ) { fNormalizer = normalizer; }
+    void setRowFilter( const CRowFilter & filter ) { fRowFilter = filter; }
+    void setReportFile( const QString & fileName ) { fReportFile = fileName; } // JSON, with the memory accounting
+    void setSkipIdentical( bool skip ) { fSkipIdentical = skip; } // chunks in the same order in both files are counted as matched rows, not parsed, unless their keys recur
+    void setWritePatch( bool writePatch ) { fWritePatch = writePatch; } // a CCSVPatch per pair next to the result file
+
+    const std::vector< SBatchPair > & pairs() const { return fPairs; }
+
+    bool run( QTextStream & summary );
+private:
+    QString resultFile( const SBatchPair & pair ) const;
+
+    std::vector< SBatchPair > fPairs;
+    QString fOutputDir;
+    QString fReportFile;
+    CKeyNormalizer fNormalizer;
+    CRowFilter fRowFilter;
+    int fNumThreads{ -1 };
+    bool fSkipIdentical{ false };
+    bool fWritePatch{ false };
+    qint64 fSplitSize{ 16 * 1024 * 1024 }; // pairs larger than this parse each side as its own task
+};
+
+#endif
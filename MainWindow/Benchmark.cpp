@@ -0,0 +1,390 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "Benchmark.h"
+#include "CSVPatch.h"
+#include "CSVTable.h"
+#include "KeyHash.h"
+#include "MemoryAccounting.h"
+#include "OrderedDiff.h"
+#include "TableCompare.h"
+#include "MainWindow.h"
+
+#include <QDate>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QTextStream>
+#include <algorithm>
+#include <random>
+
+#if defined( Q_OS_WIN )
+#include <windows.h>
+#include <psapi.h>
+#elif !defined( Q_OS_LINUX )
+#include <sys/resource.h>
+#endif
+
+qint64 CBenchmark::peakRSS()
+{
+#if defined( Q_OS_WIN )
+    PROCESS_MEMORY_COUNTERS counters;
+    if ( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) )
+        return static_cast< qint64 >( counters.PeakWorkingSetSize );
+    return 0;
+#elif defined( Q_OS_LINUX )
+    QFile status( "/proc/self/status" );
+    if ( !status.open( QFile::ReadOnly | QFile::Text ) )
+        return 0;
+    for ( auto && ii : QString::fromLatin1( status.readAll() ).split( '\n' ) )
+    {
+        if ( ii.startsWith( "VmHWM:" ) )
+            return ii.mid( 6 ).trimmed().split( ' ' ).front().toLongLong() * 1024;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+        return 0;
+#if defined( Q_OS_MACOS )
+    return static_cast< qint64 >( usage.ru_maxrss );
+#else
+    return static_cast< qint64 >( usage.ru_maxrss ) * 1024;
+#endif
+#endif
+}
+
+void CBenchmark::resetPeakRSS()
+{
+#if defined( Q_OS_LINUX )
+    // "5" resets VmHWM to the current RSS, since Linux 4.0
+    QFile clearRefs( "/proc/self/clear_refs" );
+    if ( clearRefs.open( QFile::WriteOnly ) )
+        clearRefs.write( "5" );
+#endif
+}
+
+bool CBenchmark::generate( QString * errorMsg )
+{
+    QDir().mkpath( fWorkDir );
+    fLHSFile = QDir( fWorkDir ).absoluteFilePath( "benchmark.lhs.csv" );
+    fRHSFile = QDir( fWorkDir ).absoluteFilePath( "benchmark.rhs.csv" );
+
+    static const char * kSyllables[] = { "an", "bel", "cor", "dan", "el", "fin", "gar", "hol", "is", "jo", "ka", "lin", "mar", "nor", "os", "per" };
+    static const char * kCities[] = { "Austin", "Berlin", "Cairo", "Denver", "Essen", "Fresno", "Genoa", "Houston", "Izmir", "Jena", "Kyoto", "Lima", "Madrid", "Nice", "Oslo", "Perth" };
+
+    // the same seed gives the same files on every machine, so the baselines stay comparable
+    std::mt19937_64 rng( kSeed );
+    auto makeRow = [ &rng ]( int id )
+    {
+        QByteArray name;
+        for ( int ii = 0, num = 2 + static_cast< int >( rng() % 3 ); ii < num; ++ii )
+            name += kSyllables[ rng() % 16 ];
+        name[ 0 ] = static_cast< char >( name[ 0 ] - 'a' + 'A' );
+
+        QByteArray retVal = QByteArray::number( id ) + "," + name + "," + kCities[ rng() % 16 ];
+        retVal += "," + QByteArray::number( static_cast< double >( rng() % 10000000 ) / 100.0, 'f', 2 );
+        retVal += "," + QDate( 2000, 1, 1 ).addDays( static_cast< qint64 >( rng() % 9000 ) ).toString( "yyyy-MM-dd" ).toLatin1();
+        retVal += "," + QByteArray::number( static_cast< qulonglong >( rng() ), 16 );
+        retVal += ( rng() % 4 == 0 ) ? ",\"late, resent\"\n" : ",\n";
+        return retVal;
+    };
+
+    std::vector< QByteArray > lhsRows;
+    lhsRows.reserve( fNumRows );
+    for ( int ii = 0; ii < fNumRows; ++ii )
+        lhsRows.push_back( makeRow( ii ) );
+
+    // about 1% deleted, 3% changed, 1% inserted and 0.5% moved by one row
+    std::vector< QByteArray > rhsRows;
+    rhsRows.reserve( fNumRows + fNumRows / 50 );
+    auto nextID = fNumRows;
+    for ( int ii = 0; ii < fNumRows; ++ii )
+    {
+        auto action = rng() % 1000;
+        if ( action < 10 )
+            continue;
+        rhsRows.push_back( ( action < 40 ) ? makeRow( ii ) : lhsRows[ ii ] );
+        if ( ( action >= 40 ) && ( action < 50 ) )
+            rhsRows.push_back( makeRow( nextID++ ) );
+        else if ( ( action >= 50 ) && ( action < 55 ) && ( rhsRows.size() > 1 ) )
+            std::swap( rhsRows[ rhsRows.size() - 1 ], rhsRows[ rhsRows.size() - 2 ] );
+    }
+
+    auto writeFile = [ errorMsg ]( const QString & fileName, const std::vector< QByteArray > & rows )
+    {
+        QFile file( fileName );
+        file.open( QFile::Truncate | QFile::WriteOnly );
+        if ( !file.isOpen() )
+        {
+            if ( errorMsg )
+                *errorMsg = QString( "Could not open file '%1' for write" ).arg( fileName );
+            return false;
+        }
+        QByteArray buffer = "Id,Name,City,Amount,Date,Code,Note\n";
+        for ( auto && ii : rows )
+        {
+            buffer += ii;
+            if ( buffer.size() < 1024 * 1024 )
+                continue;
+            file.write( buffer );
+            buffer.clear();
+        }
+        if ( ( file.write( buffer ) != buffer.size() ) || ( file.error() != QFile::NoError ) )
+        {
+            if ( errorMsg )
+                *errorMsg = QString( "Error writing file '%1'" ).arg( fileName );
+            return false;
+        }
+        return true;
+    };
+    return writeFile( fLHSFile, lhsRows ) && writeFile( fRHSFile, rhsRows );
+}
+
+template< typename T >
+bool CBenchmark::runStage( const QString & name, qint64 bytes, QTextStream & summary, QString * errorMsg, T && func )
+{
+    SStage stage;
+    stage.fName = name;
+    stage.fBytes = bytes;
+    for ( int ii = 0; ii < kRepeats; ++ii )
+    {
+        resetPeakRSS();
+        CMemoryAccounting::instance().resetPeaks();
+
+        QString msg;
+        QElapsedTimer timer;
+        timer.start();
+        if ( !func( &msg ) )
+        {
+            if ( errorMsg )
+                *errorMsg = QString( "Stage '%1' failed: %2" ).arg( name ).arg( msg );
+            return false;
+        }
+        auto elapsed = timer.nsecsElapsed();
+        if ( ( ii == 0 ) || ( elapsed < stage.fTimeNS ) )
+            stage.fTimeNS = elapsed;
+        stage.fPeakRSS = std::max( stage.fPeakRSS, peakRSS() );
+        stage.fPeakAccounted = std::max( stage.fPeakAccounted, CMemoryAccounting::instance().totalPeakBytes() );
+    }
+
+    summary << QString( "%1: %2 MB/s Time=%3ms Peak RSS=%4 Peak Accounted=%5" )
+                   .arg( name )
+                   .arg( stage.mbPerSec(), 0, 'f', 1 )
+                   .arg( stage.fTimeNS / 1000000 )
+                   .arg( CMemoryAccounting::formatBytes( stage.fPeakRSS ) )
+                   .arg( CMemoryAccounting::formatBytes( stage.fPeakAccounted ) )
+            << Qt::endl;
+    fStages.push_back( stage );
+    return true;
+}
+
+bool CBenchmark::run( QTextStream & summary, QString * errorMsg )
+{
+    fStages.clear();
+    if ( !generate( errorMsg ) )
+        return false;
+
+    auto lhsBytes = QFileInfo( fLHSFile ).size();
+    auto rhsBytes = QFileInfo( fRHSFile ).size();
+    summary << QString( "Benchmark: %1 rows, LHS %2, RHS %3, best of %4 runs per stage" )
+                   .arg( fNumRows )
+                   .arg( CMemoryAccounting::formatBytes( lhsBytes ) )
+                   .arg( CMemoryAccounting::formatBytes( rhsBytes ) )
+                   .arg( kRepeats )
+            << Qt::endl;
+
+    QStringList lhsLines;
+    {
+        QFile file( fLHSFile );
+        file.open( QFile::ReadOnly );
+        while ( !file.atEnd() )
+            lhsLines << QString::fromUtf8( file.readLine() );
+    }
+    auto aOK = runStage( "getRow", lhsBytes, summary, errorMsg,
+                         [ &lhsLines ]( QString * msg )
+                         {
+                             for ( auto && ii : lhsLines )
+                             {
+                                 auto currRow = SFileData::getRow( ii );
+                                 if ( currRow.has_value() && !currRow.value().first )
+                                 {
+                                     *msg = "Invalid row";
+                                     return false;
+                                 }
+                             }
+                             return true;
+                         } );
+    lhsLines.clear();
+    if ( !aOK )
+        return false;
+
+    SCSVTable lhs;
+    SCSVTable rhs;
+    if ( !runStage( "load", lhsBytes + rhsBytes, summary, errorMsg, [ this, &lhs, &rhs ]( QString * msg ) { return lhs.load( fLHSFile, msg ) && rhs.load( fRHSFile, msg ); } ) )
+        return false;
+
+    std::vector< int > lhsKeyCols;
+    std::vector< int > rhsKeyCols;
+    CTableCompare::findKeyColumns( lhs, rhs, &lhsKeyCols, &rhsKeyCols );
+    auto lhsKeyTypes = CTableCompare::keyTypes( lhs, lhsKeyCols, rhs, rhsKeyCols );
+    auto rhsKeyTypes = CTableCompare::keyTypes( rhs, rhsKeyCols, lhs, lhsKeyCols );
+    SKeyIndex lhsIndex;
+    if ( !runStage( "buildKeyIndex", lhsBytes, summary, errorMsg, [ &lhs, &lhsKeyCols, &lhsKeyTypes, &lhsIndex ]( QString * ) { return CTableCompare::buildKeyIndex( lhs, lhsKeyCols, {}, lhsIndex, nullptr, lhsKeyTypes ); } ) )
+        return false;
+
+    // the window's SFileData::mergeData needs its table models and a progress dialog, which the
+    // batch mode's QCoreApplication cannot create, so the stage times the headless join instead
+    CTableCompare compare;
+    auto merged = [ &lhs, &rhs, &lhsIndex, &compare ]( QString * msg )
+    {
+        if ( compare.compare( lhs, lhsIndex, rhs ) )
+            return true;
+        *msg = "The files do not share any columns";
+        return false;
+    };
+    if ( !runStage( "tableCompare", lhsBytes + rhsBytes, summary, errorMsg, merged ) )
+        return false;
+
+    auto mergedFile = QDir( fWorkDir ).absoluteFilePath( "benchmark.merged.csv" );
+    if ( !runStage( "saveMerged", lhsBytes + rhsBytes, summary, errorMsg, [ &compare, &mergedFile ]( QString * msg ) { return compare.save( mergedFile, msg ); } ) )
+        return false;
+    compare.clear();
+
+    std::vector< quint64 > lhsHashes;
+    for ( auto && ii : lhsIndex.fMD5s )
+        lhsHashes.push_back( NKeyHash::hash64( ii.constData(), ii.size() ) );
+    lhsIndex = SKeyIndex();
+    std::vector< quint64 > rhsHashes;
+    for ( int ii = 0; ii < rhs.rowCount(); ++ii )
+    {
+        auto key = rhs.computeKey( ii, rhsKeyCols, {}, rhsKeyTypes );
+        rhsHashes.push_back( NKeyHash::hash64( key.constData(), key.size() ) );
+    }
+    COrderedDiff diff;
+    if ( !runStage( "orderedDiff", lhsBytes + rhsBytes, summary, errorMsg, [ &lhsHashes, &rhsHashes, &diff ]( QString * ) { return diff.diff( lhsHashes, rhsHashes ); } ) )
+        return false;
+    diff.clear();
+
+    auto patchFile = QDir( fWorkDir ).absoluteFilePath( "benchmark.patch" );
+    if ( !runStage( "writePatch", lhsBytes + rhsBytes, summary, errorMsg, [ &lhs, &rhs, &patchFile ]( QString * msg ) { return CCSVPatch::write( lhs, rhs, patchFile, msg ); } ) )
+        return false;
+    auto patchedFile = QDir( fWorkDir ).absoluteFilePath( "benchmark.patched.csv" );
+    if ( !runStage( "applyPatch", lhsBytes + QFileInfo( patchFile ).size(), summary, errorMsg, [ &lhs, &patchFile, &patchedFile ]( QString * msg ) { return CCSVPatch::apply( lhs, patchFile, patchedFile, msg ); } ) )
+        return false;
+    return true;
+}
+
+QJsonObject CBenchmark::toJson() const
+{
+    QJsonObject stages;
+    for ( auto && ii : fStages )
+    {
+        QJsonObject stage;
+        stage[ "bytes" ] = ii.fBytes;
+        stage[ "timeMS" ] = ii.fTimeNS / 1000000.0;
+        stage[ "mbPerSec" ] = ii.mbPerSec();
+        stage[ "peakRSS" ] = ii.fPeakRSS;
+        stage[ "peakAccounted" ] = ii.fPeakAccounted;
+        stages[ ii.fName ] = stage;
+    }
+
+    QJsonObject retVal;
+    retVal[ "rows" ] = fNumRows;
+    retVal[ "repeats" ] = kRepeats;
+    retVal[ "stages" ] = stages;
+    return retVal;
+}
+
+bool CBenchmark::writeBaseline( const QString & fileName, QString * errorMsg ) const
+{
+    QFile file( fileName );
+    file.open( QFile::Truncate | QFile::WriteOnly );
+    if ( !file.isOpen() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Could not open file '%1' for write" ).arg( fileName );
+        return false;
+    }
+    file.write( QJsonDocument( toJson() ).toJson( QJsonDocument::Indented ) );
+    return true;
+}
+
+bool CBenchmark::checkBaseline( const QString & fileName, QTextStream & summary, QString * errorMsg ) const
+{
+    QFile file( fileName );
+    file.open( QFile::ReadOnly );
+    if ( !file.isOpen() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error opening file '%1'" ).arg( fileName );
+        return false;
+    }
+    auto baseline = QJsonDocument::fromJson( file.readAll() ).object();
+    if ( baseline[ "rows" ].toInt() != fNumRows )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "The baseline '%1' was recorded with %2 rows, not %3" ).arg( fileName ).arg( baseline[ "rows" ].toInt() ).arg( fNumRows );
+        return false;
+    }
+
+    // higher is better for the throughput, lower for the memory
+    auto percent = []( double value, double base ) { return ( base > 0 ) ? QString( "%1%2%" ).arg( ( value >= base ) ? QString( "+" ) : QString() ).arg( 100.0 * ( value - base ) / base, 0, 'f', 1 ) : QString( "n/a" ); };
+    auto baseStages = baseline[ "stages" ].toObject();
+    bool aOK = true;
+    summary << QString( "Baseline: %1, tolerance %2%" ).arg( fileName ).arg( fTolerance ) << Qt::endl;
+    for ( auto && ii : fStages )
+    {
+        if ( !baseStages.contains( ii.fName ) )
+        {
+            summary << QString( "%1: not in the baseline" ).arg( ii.fName ) << Qt::endl;
+            continue;
+        }
+        auto base = baseStages[ ii.fName ].toObject();
+        auto baseMBPerSec = base[ "mbPerSec" ].toDouble();
+        auto basePeakRSS = base[ "peakRSS" ].toDouble();
+        auto basePeakAccounted = base[ "peakAccounted" ].toDouble();
+
+        QStringList regressions;
+        if ( ( baseMBPerSec > 0 ) && ( ii.mbPerSec() < baseMBPerSec * ( 100 - fTolerance ) / 100.0 ) )
+            regressions << "throughput";
+        if ( ( basePeakRSS > 0 ) && ( ii.fPeakRSS > basePeakRSS * ( 100 + fTolerance ) / 100.0 ) )
+            regressions << "peak RSS";
+        if ( ( basePeakAccounted > 0 ) && ( ii.fPeakAccounted > basePeakAccounted * ( 100 + fTolerance ) / 100.0 ) )
+            regressions << "peak accounted";
+        aOK = aOK && regressions.isEmpty();
+
+        summary << QString( "%1: %2 MB/s (%3) Peak RSS=%4 (%5) Peak Accounted=%6 (%7) %8" )
+                       .arg( ii.fName )
+                       .arg( ii.mbPerSec(), 0, 'f', 1 )
+                       .arg( percent( ii.mbPerSec(), baseMBPerSec ) )
+                       .arg( CMemoryAccounting::formatBytes( ii.fPeakRSS ) )
+                       .arg( percent( ii.fPeakRSS, basePeakRSS ) )
+                       .arg( CMemoryAccounting::formatBytes( ii.fPeakAccounted ) )
+                       .arg( percent( ii.fPeakAccounted, basePeakAccounted ) )
+                       .arg( regressions.isEmpty() ? QString( "OK" ) : QString( "REGRESSED %1" ).arg( regressions.join( ", " ) ) )
+                << Qt::endl;
+    }
+    return aOK;
+}
@@ -0,0 +1,82 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _BENCHMARK_H
+#define _BENCHMARK_H
+
+#include <QJsonObject>
+#include <QString>
+#include <vector>
+
+class QTextStream;
+
+// Headless performance suite. Generates a seeded LHS/RHS pair, times each compare stage on it
+// and checks the throughput and peak memory per stage against a baseline written by an earlier run.
+// The stages are named for the code they time: SFileData::getRow, then the headless SCSVTable load,
+// buildKeyIndex and tableCompare. The window's computeMD5s and mergeData need its table models and
+// are not timed
+class CBenchmark
+{
+public:
+    struct SStage
+    {
+        QString fName;
+        qint64 fBytes{ 0 }; // input bytes the stage processes
+        qint64 fTimeNS{ 0 }; // best of kRepeats
+        qint64 fPeakRSS{ 0 }; // process high water mark while the stage ran, 0 when unknown
+        qint64 fPeakAccounted{ 0 }; // CMemoryAccounting peak while the stage ran
+
+        double mbPerSec() const { return ( fTimeNS > 0 ) ? ( fBytes / ( 1024.0 * 1024.0 ) ) / ( fTimeNS / 1.0e9 ) : 0.0; }
+    };
+
+    static constexpr int kDefaultRows = 200000;
+    static constexpr int kDefaultTolerance = 25; // percent slower or larger than the baseline that still passes
+    static constexpr int kRepeats = 3;
+    static constexpr quint64 kSeed = 0x5EEDC5F00D;
+
+    void setNumRows( int numRows ) { fNumRows = numRows; }
+    void setWorkDir( const QString & dir ) { fWorkDir = dir; }
+    void setTolerance( int percent ) { fTolerance = percent; }
+
+    bool run( QTextStream & summary, QString * errorMsg = nullptr );
+    const std::vector< SStage > & stages() const { return fStages; }
+
+    QJsonObject toJson() const;
+    bool writeBaseline( const QString & fileName, QString * errorMsg = nullptr ) const;
+    bool checkBaseline( const QString & fileName, QTextStream & summary, QString * errorMsg = nullptr ) const; // false when a stage regressed
+
+    static qint64 peakRSS();
+    static void resetPeakRSS(); // only where the OS allows it, the peak is process wide otherwise
+private:
+    bool generate( QString * errorMsg );
+    template< typename T >
+    bool runStage( const QString & name, qint64 bytes, QTextStream & summary, QString * errorMsg, T && func ); // func( QString * msg ) runs kRepeats times
+
+    int fNumRows{ kDefaultRows };
+    int fTolerance{ kDefaultTolerance };
+    QString fWorkDir;
+    QString fLHSFile;
+    QString fRHSFile;
+    std::vector< SStage > fStages;
+};
+
+#endif
@@ -0,0 +1,68 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "BloomFilter.h"
+
+#include <algorithm>
+
+void CBlockedBloomFilter::init( qint64 numKeys, int bitsPerKey )
+{
+    auto numBits = std::max< qint64 >( 1, numKeys ) * bitsPerKey;
+    fNumBlocks = static_cast< quint64 >( ( numBits + 511 ) / 512 );
+    fBlocks.assign( fNumBlocks, SBlock() );
+}
+
+void CBlockedBloomFilter::clear()
+{
+    fBlocks.clear();
+    fNumBlocks = 0;
+}
+
+void CBlockedBloomFilter::insert( quint64 hash )
+{
+    if ( !fNumBlocks )
+        return;
+    auto & bits = block( hash ).fWords;
+    auto h1 = static_cast< quint32 >( hash );
+    auto h2 = static_cast< quint32 >( ( hash * 0x9E3779B97F4A7C15ULL ) >> 32 ) | 1;
+    for ( int ii = 0; ii < kNumProbes; ++ii )
+    {
+        auto bit = ( h1 + ii * h2 ) & 511;
+        bits[ bit >> 6 ] |= 1ULL << ( bit & 63 );
+    }
+}
+
+bool CBlockedBloomFilter::mayContain( quint64 hash ) const
+{
+    if ( !fNumBlocks )
+        return false;
+    auto & bits = block( hash ).fWords;
+    auto h1 = static_cast< quint32 >( hash );
+    auto h2 = static_cast< quint32 >( ( hash * 0x9E3779B97F4A7C15ULL ) >> 32 ) | 1;
+    for ( int ii = 0; ii < kNumProbes; ++ii )
+    {
+        auto bit = ( h1 + ii * h2 ) & 511;
+        if ( !( bits[ bit >> 6 ] & ( 1ULL << ( bit & 63 ) ) ) )
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _BLOOMFILTER_H
+#define _BLOOMFILTER_H
+
+#include <QtGlobal>
+#include <vector>
+
+// Blocked Bloom filter, every key sets all of its bits inside one 512 bit (cache line) block,
+// so a lookup touches a single cache line
+class CBlockedBloomFilter
+{
+public:
+    void init( qint64 numKeys, int bitsPerKey = 12 );
+    void clear();
+
+    void insert( quint64 hash );
+    bool mayContain( quint64 hash ) const;
+private:
+    static const int kWordsPerBlock = 8;
+    static const int kNumProbes = 8;
+
+    // aligned, so no block straddles two cache lines; C++17 vector allocates over aligned types aligned
+    struct alignas( 64 ) SBlock
+    {
+        quint64 fWords[ kWordsPerBlock ];
+    };
+    static_assert( sizeof( SBlock ) == 64, "a block is one cache line" );
+
+    quint64 blockNum( quint64 hash ) const { return ( hash >> 32 ) % fNumBlocks; } // high bits pick the block, the probes come from the low bits
+    SBlock & block( quint64 hash ) { return fBlocks[ blockNum( hash ) ]; }
+    const SBlock & block( quint64 hash ) const { return fBlocks[ blockNum( hash ) ]; }
+
+    std::vector< SBlock > fBlocks;
+    quint64 fNumBlocks{ 0 };
+};
+
+#endif
@@ -0,0 +1,326 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "CSVDialect.h"
+
+#include <map>
+
+namespace
+{
+    // the characters as compile time constants, so the inner loop compares against immediates
+    template< char Delimiter, char Quote, char Escape >
+    struct SFixedChars
+    {
+        static constexpr ushort delimiter() { return static_cast< uchar >( Delimiter ); }
+        static constexpr ushort quote() { return static_cast< uchar >( Quote ); }
+        static constexpr ushort escape() { return static_cast< uchar >( Escape ); }
+    };
+
+    struct SRuntimeChars
+    {
+        ushort delimiter() const { return fDelimiter; }
+        ushort quote() const { return fQuote; }
+        ushort escape() const { return fEscape; }
+
+        ushort fDelimiter;
+        ushort fQuote;
+        ushort fEscape;
+    };
+
+    template< typename TChars >
+    QStringList splitLine( const QString & line, const TChars & chars )
+    {
+        QStringList retVal;
+        QString currColumn;
+        bool inQuote = false;
+        auto data = line.constData();
+        int len = line.length();
+        for ( int ii = 0; ii < len; )
+        {
+            auto curr = data[ ii ].unicode();
+            if ( chars.escape() && ( curr == chars.escape() ) && ( ii + 1 < len ) )
+            {
+                currColumn += data[ ii + 1 ];
+                ii += 2;
+                continue;
+            }
+            if ( curr == chars.quote() )
+            {
+                // a doubled quote inside a quoted field is one literal quote
+                if ( inQuote && ( ii + 1 < len ) && ( data[ ii + 1 ].unicode() == chars.quote() ) )
+                {
+                    currColumn += data[ ii ];
+                    ii += 2;
+                    continue;
+                }
+                if ( inQuote )
+                {
+                    for ( int jj = ii + 1; jj < len; ++jj )
+                    {
+                        if ( data[ jj ].unicode() == chars.delimiter() )
+                        {
+                            inQuote = false;
+                            break;
+                        }
+                        if ( !data[ jj ].isSpace() )
+                            break;
+                    }
+                }
+                else
+                    inQuote = true;
+                ++ii;
+                continue;
+            }
+            if ( !inQuote && ( curr == chars.delimiter() ) )
+            {
+                retVal << currColumn;
+                currColumn.clear();
+                ++ii;
+                continue;
+            }
+
+            // the run of field text up to the next character with a meaning
+            auto runEnd = ii + 1;
+            for ( ; runEnd < len; ++runEnd )
+            {
+                auto next = data[ runEnd ].unicode();
+                if ( ( next == chars.quote() ) || ( !inQuote && ( next == chars.delimiter() ) ) || ( chars.escape() && ( next == chars.escape() ) ) )
+                    break;
+            }
+            currColumn.append( data + ii, runEnd - ii );
+            ii = runEnd;
+        }
+        retVal << currColumn;
+        return retVal;
+    }
+
+    int countOutsideQuotes( const QByteArray & line, char delimiter, char quote, char escape = 0 )
+    {
+        int retVal = 0;
+        bool inQuote = false;
+        for ( int ii = 0; ii < line.size(); ++ii )
+        {
+            auto curr = line[ ii ];
+            if ( escape && ( curr == escape ) )
+                ++ii;
+            else if ( curr == quote )
+                inQuote = !inQuote;
+            else if ( !inQuote && ( curr == delimiter ) )
+                retVal++;
+        }
+        return retVal;
+    }
+
+    // a doubled quote inside a field, rather than an empty quoted field, and not behind a backslash
+    bool hasDoubledQuote( const QByteArray & line, char delimiter, char quote )
+    {
+        auto trimmed = line.trimmed();
+        for ( int ii = 1; ii + 2 < trimmed.size(); ++ii )
+        {
+            if ( ( trimmed[ ii ] != quote ) || ( trimmed[ ii + 1 ] != quote ) || ( trimmed[ ii - 1 ] == '\\' ) )
+                continue;
+            if ( ( trimmed[ ii - 1 ] != delimiter ) && ( trimmed[ ii + 2 ] != delimiter ) )
+                return true;
+            ++ii;
+        }
+        return false;
+    }
+}
+
+CCSVDialect::CCSVDialect( char delimiter, char quote, char escape, char lineEnd ) :
+    fDelimiter( delimiter ),
+    fQuote( quote ),
+    fEscape( escape ),
+    fLineEnd( lineEnd ),
+    fSplit( &splitGeneric )
+{
+    if ( ( quote != '"' ) || ( escape != 0 ) )
+        return;
+
+    switch ( delimiter )
+    {
+        case ',':
+            fSplit = &splitFixed< ',' >;
+            break;
+        case '\t':
+            fSplit = &splitFixed< '\t' >;
+            break;
+        case ';':
+            fSplit = &splitFixed< ';' >;
+            break;
+        case '|':
+            fSplit = &splitFixed< '|' >;
+            break;
+        default:
+            break;
+    }
+}
+
+template< char Delimiter >
+QStringList CCSVDialect::splitFixed( const QString & line, const CCSVDialect & /*dialect*/ )
+{
+    return splitLine( line, SFixedChars< Delimiter, '"', 0 >() );
+}
+
+QStringList CCSVDialect::splitGeneric( const QString & line, const CCSVDialect & dialect )
+{
+    return splitLine( line, SRuntimeChars{ static_cast< uchar >( dialect.fDelimiter ), static_cast< uchar >( dialect.fQuote ), static_cast< uchar >( dialect.fEscape ) } );
+}
+
+bool CCSVDialect::isSpecialized() const
+{
+    return fSplit != &splitGeneric;
+}
+
+QString CCSVDialect::name() const
+{
+    QString retVal;
+    switch ( fDelimiter )
+    {
+        case ',':
+            retVal = "CSV";
+            break;
+        case '\t':
+            retVal = "TSV";
+            break;
+        case ';':
+            retVal = "Semicolon separated";
+            break;
+        case '|':
+            retVal = "Pipe delimited";
+            break;
+        default:
+            retVal = QString( "'%1' delimited" ).arg( QLatin1Char( fDelimiter ) );
+            break;
+    }
+    if ( fQuote != '"' )
+        retVal += QString( ", quote %1" ).arg( QLatin1Char( fQuote ) );
+    if ( fEscape )
+        retVal += QString( ", escape %1" ).arg( QLatin1Char( fEscape ) );
+    if ( fLineEnd == '\r' )
+        retVal += ", CR line ends";
+    return retVal;
+}
+
+QString CCSVDialect::trimmed( const QString & line ) const
+{
+    auto delimiter = QLatin1Char( fDelimiter );
+    if ( !QChar( delimiter ).isSpace() )
+        return line.trimmed();
+
+    int begin = 0;
+    int end = line.length();
+    while ( ( begin < end ) && line[ begin ].isSpace() && ( line[ begin ] != delimiter ) )
+        ++begin;
+    while ( ( end > begin ) && line[ end - 1 ].isSpace() && ( line[ end - 1 ] != delimiter ) )
+        --end;
+    return line.mid( begin, end - begin );
+}
+
+CCSVDialect CCSVDialect::sniff( const QByteArray & sample )
+{
+    // a file with carriage returns and no newline at all uses CR alone as the line end
+    char lineEnd = ( !sample.contains( '\n' ) && sample.contains( '\r' ) ) ? '\r' : '\n';
+
+    auto rawLines = sample.split( lineEnd );
+    if ( ( sample.size() >= kSampleBytes ) && ( rawLines.size() > 1 ) )
+        rawLines.removeLast();
+    QList< QByteArray > lines;
+    for ( auto && ii : rawLines )
+    {
+        auto line = ii.trimmed();
+        if ( line.isEmpty() )
+            continue;
+        lines << ii;
+        if ( lines.size() == kSampleLines )
+            break;
+    }
+    if ( lines.isEmpty() )
+        return CCSVDialect( ',', '"', 0, lineEnd );
+
+    // the quote: double unless there are none and fields are wrapped in single quotes
+    char quote = '"';
+    if ( !sample.contains( '"' ) )
+    {
+        for ( auto && ii : lines )
+        {
+            auto line = ii.trimmed();
+            if ( ( line.size() > 1 ) && line.startsWith( '\'' ) && ( line.indexOf( '\'', 1 ) > 0 ) )
+            {
+                quote = '\'';
+                break;
+            }
+        }
+    }
+
+    // the delimiter: the candidate found the same number of times on the most lines, on a tie the one
+    // found more times per line
+    static const char kDelimiters[] = { ',', '\t', ';', '|' };
+    char delimiter = ',';
+    double bestScore = 0;
+    int bestCount = 0;
+    for ( auto && candidate : kDelimiters )
+    {
+        std::map< int, int > numLines; // count -> lines
+        for ( auto && ii : lines )
+            numLines[ countOutsideQuotes( ii, candidate, quote ) ]++;
+
+        int count = 0;
+        int frequency = 0;
+        for ( auto && ii : numLines )
+        {
+            if ( ii.second >= frequency )
+            {
+                count = ii.first;
+                frequency = ii.second;
+            }
+        }
+        if ( count == 0 )
+            continue;
+        auto score = static_cast< double >( frequency ) / lines.size();
+        if ( ( score > bestScore ) || ( ( score == bestScore ) && ( count > bestCount ) ) )
+        {
+            delimiter = candidate;
+            bestScore = score;
+            bestCount = count;
+        }
+    }
+
+    // a backslash in front of a quote escapes it, when every line with one splits into the same number
+    // of fields with the escape honored and no line doubles its quotes instead
+    char escape = 0;
+    char escapedQuote[] = { '\\', quote, 0 };
+    if ( sample.contains( escapedQuote ) )
+    {
+        escape = '\\';
+        for ( auto && ii : lines )
+        {
+            if ( hasDoubledQuote( ii, delimiter, quote ) || ( ii.contains( escapedQuote ) && ( countOutsideQuotes( ii, delimiter, quote, escape ) != bestCount ) ) )
+            {
+                escape = 0;
+                break;
+            }
+        }
+    }
+
+    return CCSVDialect( delimiter, quote, escape, lineEnd );
+}
@@ -0,0 +1,72 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CSVDIALECT_H
+#define _CSVDIALECT_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+// Delimiter, quote, escape and line end of a delimited text file, sniffed from its first lines.
+// Comma, tab, semicolon and pipe with double quotes and no escape split with the delimiter and quote
+// compiled in, any other combination uses the runtime configured splitter. The quote rules are the
+// ones getRow always had: a quote only closes a field when the next character past any spaces is
+// the delimiter, so a stray quote inside a field is dropped rather than ending it, and a doubled
+// quote inside a quoted field is a literal quote
+class CCSVDialect
+{
+public:
+    static constexpr int kSampleBytes = 64 * 1024;
+    static constexpr int kSampleLines = 100;
+
+    CCSVDialect() : CCSVDialect( ',', '"', 0 ) {} // plain CSV
+    CCSVDialect( char delimiter, char quote, char escape, char lineEnd = '\n' ); // escape 0 for none
+
+    static CCSVDialect sniff( const QByteArray & sample ); // the first bytes of the file as UTF-8, the last line may be cut
+
+    char delimiter() const { return fDelimiter; }
+    char quote() const { return fQuote; }
+    char escape() const { return fEscape; }
+    char lineEnd() const { return fLineEnd; } // '\n' also covers CRLF, '\r' is for files with only carriage returns
+    bool isSpecialized() const;
+    QString name() const;
+
+    bool operator==( const CCSVDialect & rhs ) const { return ( fDelimiter == rhs.fDelimiter ) && ( fQuote == rhs.fQuote ) && ( fEscape == rhs.fEscape ) && ( fLineEnd == rhs.fLineEnd ); }
+    bool operator!=( const CCSVDialect & rhs ) const { return !operator==( rhs ); }
+
+    QStringList split( const QString & line ) const { return fSplit( line, *this ); } // line already trimmed
+    QString trimmed( const QString & line ) const; // QString::trimmed, except a whitespace delimiter is kept
+private:
+    using TSplit = QStringList ( * )( const QString & line, const CCSVDialect & dialect );
+    template< char Delimiter >
+    static QStringList splitFixed( const QString & line, const CCSVDialect & dialect );
+    static QStringList splitGeneric( const QString & line, const CCSVDialect & dialect );
+
+    char fDelimiter{ ',' };
+    char fQuote{ '"' };
+    char fEscape{ 0 };
+    char fLineEnd{ '\n' };
+    TSplit fSplit{ nullptr };
+};
+
+#endif
@@ -0,0 +1,560 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "CSVPatch.h"
+#include "CSVTable.h"
+#include "KeyHash.h"
+#include "OrderedDiff.h"
+#include "TableCompare.h"
+
+#include <QFile>
+#include <cstring>
+#include <unordered_map>
+
+CCSVPatch::CCSVPatch( const SCSVTable & lhs, const std::vector< int > & lhsCols ) :
+    fLHS( lhs ),
+    fLHSCols( lhsCols )
+{
+}
+
+void CCSVPatch::appendVarint( QByteArray & buffer, quint64 value )
+{
+    while ( value >= 0x80 )
+    {
+        buffer.append( static_cast< char >( ( value & 0x7F ) | 0x80 ) );
+        value >>= 7;
+    }
+    buffer.append( static_cast< char >( value ) );
+}
+
+bool CCSVPatch::readVarint( const char *& pos, const char * end, quint64 & value )
+{
+    value = 0;
+    for ( int shift = 0; ( pos < end ) && ( shift < 64 ); shift += 7 )
+    {
+        auto curr = static_cast< quint8 >( *pos++ );
+        value |= static_cast< quint64 >( curr & 0x7F ) << shift;
+        if ( !( curr & 0x80 ) )
+            return true;
+    }
+    return false;
+}
+
+bool CCSVPatch::readString( const char *& pos, const char * end, QString & value )
+{
+    quint64 len;
+    if ( !readVarint( pos, end, len ) || ( len > static_cast< quint64 >( end - pos ) ) )
+        return false;
+    value = QString::fromUtf8( pos, static_cast< int >( len ) );
+    pos += len;
+    return true;
+}
+
+QString CCSVPatch::lhsCell( int row, int rhsCol ) const
+{
+    auto col = fLHSCols[ rhsCol ];
+    return ( col == -1 ) ? QString() : fLHS.data( row, col );
+}
+
+quint64 CCSVPatch::hashCell( quint64 hash, const QString & value )
+{
+    return NKeyHash::hash64( reinterpret_cast< const char * >( value.utf16() ), value.size() * 2, NKeyHash::mix64( hash ^ static_cast< quint64 >( value.size() ) ) );
+}
+
+quint64 CCSVPatch::lhsRowHash( int row ) const
+{
+    quint64 retVal = 0;
+    for ( int ii = 0; ii < static_cast< int >( fLHSCols.size() ); ++ii )
+        retVal = hashCell( retVal, lhsCell( row, ii ) );
+    return retVal;
+}
+
+quint64 CCSVPatch::rhsRowHash( const SCSVTable & rhs, int row )
+{
+    quint64 retVal = 0;
+    for ( int ii = 0; ii < rhs.columnCount(); ++ii )
+        retVal = hashCell( retVal, rhs.data( row, ii ) );
+    return retVal;
+}
+
+quint64 CCSVPatch::lhsFingerprint() const
+{
+    quint64 retVal = 0;
+    for ( int ii = 0; ii < fLHS.rowCount(); ++ii )
+        retVal = NKeyHash::mix64( retVal ^ lhsRowHash( ii ) );
+    return retVal;
+}
+
+bool CCSVPatch::sameRow( int lhsRow, const SCSVTable & rhs, int rhsRow ) const
+{
+    for ( int ii = 0; ii < rhs.columnCount(); ++ii )
+    {
+        if ( rhs.data( rhsRow, ii ) != lhsCell( lhsRow, ii ) )
+            return false;
+    }
+    return true;
+}
+
+void CCSVPatch::appendRow( qint64 lhsRow )
+{
+    appendVarint( fBuffer, zigzag( lhsRow - fNextLHS ) );
+}
+
+void CCSVPatch::appendString( const QString & value )
+{
+    auto utf8 = value.toUtf8();
+    appendVarint( fBuffer, utf8.size() );
+    fBuffer.append( utf8 );
+}
+
+void CCSVPatch::addRun( ERecord record, int lhsRow )
+{
+    if ( ( fRunCount != 0 ) && ( fRunRecord == record ) && ( fRunStart + fRunCount == lhsRow ) )
+    {
+        fRunCount++;
+        return;
+    }
+    flushRun();
+    fRunRecord = record;
+    fRunStart = lhsRow;
+    fRunCount = 1;
+}
+
+void CCSVPatch::flushRun()
+{
+    if ( fRunCount == 0 )
+        return;
+
+    fBuffer.append( static_cast< char >( fRunRecord ) );
+    appendRow( fRunStart );
+    appendVarint( fBuffer, fRunCount );
+    fNextLHS = fRunStart + fRunCount;
+    if ( fRunRecord == eCopy )
+        fStats.fCopied += fRunCount;
+    else
+        fStats.fDeleted += fRunCount;
+    fRunCount = 0;
+}
+
+void CCSVPatch::addUpdate( int lhsRow, const SCSVTable & rhs, int rhsRow )
+{
+    flushRun();
+
+    std::vector< int > changed;
+    for ( int ii = 0; ii < rhs.columnCount(); ++ii )
+    {
+        if ( rhs.data( rhsRow, ii ) != lhsCell( lhsRow, ii ) )
+            changed.push_back( ii );
+    }
+
+    fBuffer.append( static_cast< char >( eUpdate ) );
+    appendRow( lhsRow );
+    appendVarint( fBuffer, changed.size() );
+    int prevCol = -1;
+    for ( auto && ii : changed )
+    {
+        appendVarint( fBuffer, ii - prevCol - 1 );
+        appendString( rhs.data( rhsRow, ii ) );
+        prevCol = ii;
+    }
+    fNextLHS = lhsRow + 1;
+    fStats.fUpdated++;
+    fStats.fChangedCells += static_cast< int >( changed.size() );
+}
+
+void CCSVPatch::addInsert( const SCSVTable & rhs, int rhsRow )
+{
+    flushRun();
+
+    fBuffer.append( static_cast< char >( eInsert ) );
+    for ( int ii = 0; ii < rhs.columnCount(); ++ii )
+        appendString( rhs.data( rhsRow, ii ) );
+    fStats.fInserted++;
+}
+
+bool CCSVPatch::flush( bool force )
+{
+    if ( !force && ( fBuffer.size() < kFlushSize ) )
+        return true;
+    if ( fFile->write( fBuffer ) != fBuffer.size() )
+        return false;
+    fStats.fBytes += fBuffer.size();
+    fBuffer.truncate( 0 );
+    return true;
+}
+
+bool CCSVPatch::write( const SCSVTable & lhs, const SCSVTable & rhs, const QString & fileName, QString * errorMsg, SStats * stats )
+{
+    std::vector< int > lhsCols;
+    bool sharesColumns = false;
+    for ( int ii = 0; ii < rhs.columnCount(); ++ii )
+    {
+        lhsCols.push_back( lhs.findColumn( rhs.fHeader[ ii ] ) );
+        sharesColumns = sharesColumns || ( lhsCols.back() != -1 );
+    }
+    if ( !sharesColumns )
+    {
+        if ( errorMsg )
+            *errorMsg = "The files do not share any columns";
+        return false;
+    }
+
+    QFile file( fileName );
+    file.open( QFile::Truncate | QFile::WriteOnly );
+    if ( !file.isOpen() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Could not open file '%1' for write" ).arg( fileName );
+        return false;
+    }
+
+    CCSVPatch patch( lhs, lhsCols );
+    patch.fFile = &file;
+
+    // LHS rows are hashed in RHS column order, so unchanged rows hash the same on both sides
+    std::vector< quint64 > lhsHashes( lhs.rowCount() );
+    quint64 fingerprint = 0;
+    for ( int ii = 0; ii < lhs.rowCount(); ++ii )
+    {
+        lhsHashes[ ii ] = patch.lhsRowHash( ii );
+        fingerprint = NKeyHash::mix64( fingerprint ^ lhsHashes[ ii ] );
+    }
+    std::vector< quint64 > rhsHashes( rhs.rowCount() );
+    for ( int ii = 0; ii < rhs.rowCount(); ++ii )
+        rhsHashes[ ii ] = rhsRowHash( rhs, ii );
+
+    patch.fBuffer.append( kMagic, 4 );
+    appendVarint( patch.fBuffer, kVersion );
+    appendVarint( patch.fBuffer, lhs.columnCount() );
+    appendVarint( patch.fBuffer, lhs.rowCount() );
+    appendVarint( patch.fBuffer, fingerprint );
+    appendVarint( patch.fBuffer, rhs.columnCount() );
+    for ( int ii = 0; ii < rhs.columnCount(); ++ii )
+    {
+        patch.appendString( rhs.fHeader[ ii ] );
+        appendVarint( patch.fBuffer, lhsCols[ ii ] + 1 );
+    }
+
+    COrderedDiff diff;
+    diff.diff( lhsHashes, rhsHashes );
+    lhsHashes = std::vector< quint64 >();
+    rhsHashes = std::vector< quint64 >();
+
+    std::vector< int > lhsKeyCols;
+    std::vector< int > rhsKeyCols;
+    CTableCompare::findKeyColumns( lhs, rhs, &lhsKeyCols, &rhsKeyCols );
+
+    auto writeError = [ &file, &fileName, errorMsg ]()
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error writing file '%1'" ).arg( fileName );
+        file.remove();
+        return false;
+    };
+
+    auto && runs = diff.runs();
+    for ( size_t ii = 0; ii < runs.size(); )
+    {
+        if ( runs[ ii ].fOp == COrderedDiff::eEqual )
+        {
+            // equal hashes are checked cell by cell, a collision is written as an update
+            for ( int jj = 0; jj < runs[ ii ].fLength; ++jj )
+            {
+                auto lhsRow = runs[ ii ].fLHSStart + jj;
+                auto rhsRow = runs[ ii ].fRHSStart + jj;
+                if ( patch.sameRow( lhsRow, rhs, rhsRow ) )
+                    patch.addRun( eCopy, lhsRow );
+                else
+                    patch.addUpdate( lhsRow, rhs, rhsRow );
+            }
+            ++ii;
+            if ( !patch.flush( false ) )
+                return writeError();
+            continue;
+        }
+
+        // a hunk is the delete and insert runs between two equal runs, rows that moved are copied from where they were
+        std::vector< int > deleted;
+        std::vector< int > inserted;
+        for ( ; ( ii < runs.size() ) && ( runs[ ii ].fOp != COrderedDiff::eEqual ); ++ii )
+        {
+            for ( int jj = 0; jj < runs[ ii ].fLength; ++jj )
+            {
+                if ( runs[ ii ].fOp == COrderedDiff::eDelete )
+                {
+                    if ( diff.movedTo( runs[ ii ].fLHSStart + jj ) == -1 )
+                        deleted.push_back( runs[ ii ].fLHSStart + jj );
+                }
+                else
+                    inserted.push_back( runs[ ii ].fRHSStart + jj );
+            }
+        }
+
+        // rows are paired on the key first, what is left is paired by position
+        std::vector< int > paired( inserted.size(), -1 );
+        std::vector< bool > used( deleted.size(), false );
+        if ( !lhsKeyCols.empty() && !deleted.empty() )
+        {
+            std::unordered_map< QByteArray, size_t > keyToDeleted;
+            for ( size_t jj = 0; jj < deleted.size(); ++jj )
+                keyToDeleted.emplace( lhs.computeKey( deleted[ jj ], lhsKeyCols ), jj );
+            for ( size_t jj = 0; jj < inserted.size(); ++jj )
+            {
+                if ( diff.movedFrom( inserted[ jj ] ) != -1 )
+                    continue;
+                auto pos = keyToDeleted.find( rhs.computeKey( inserted[ jj ], rhsKeyCols ) );
+                if ( pos == keyToDeleted.end() )
+                    continue;
+                paired[ jj ] = deleted[ ( *pos ).second ];
+                used[ ( *pos ).second ] = true;
+                keyToDeleted.erase( pos );
+            }
+        }
+        size_t next = 0;
+        for ( size_t jj = 0; jj < inserted.size(); ++jj )
+        {
+            if ( ( paired[ jj ] != -1 ) || ( diff.movedFrom( inserted[ jj ] ) != -1 ) )
+                continue;
+            while ( ( next < deleted.size() ) && used[ next ] )
+                ++next;
+            if ( next == deleted.size() )
+                break;
+            paired[ jj ] = deleted[ next ];
+            used[ next++ ] = true;
+        }
+
+        for ( size_t jj = 0; jj < deleted.size(); ++jj )
+        {
+            if ( !used[ jj ] )
+                patch.addRun( eDelete, deleted[ jj ] );
+        }
+        for ( size_t jj = 0; jj < inserted.size(); ++jj )
+        {
+            auto lhsRow = diff.movedFrom( inserted[ jj ] );
+            if ( ( lhsRow != -1 ) && patch.sameRow( lhsRow, rhs, inserted[ jj ] ) )
+                patch.addRun( eCopy, lhsRow );
+            else if ( lhsRow != -1 )
+                patch.addUpdate( lhsRow, rhs, inserted[ jj ] );
+            else if ( paired[ jj ] != -1 )
+                patch.addUpdate( paired[ jj ], rhs, inserted[ jj ] );
+            else
+                patch.addInsert( rhs, inserted[ jj ] );
+        }
+        if ( !patch.flush( false ) )
+            return writeError();
+    }
+
+    patch.flushRun();
+    patch.fBuffer.append( static_cast< char >( eEnd ) );
+    if ( !patch.flush( true ) )
+        return writeError();
+    if ( stats )
+        *stats = patch.fStats;
+    return true;
+}
+
+bool CCSVPatch::apply( const SCSVTable & lhs, const QString & patchFile, const QString & outFile, QString * errorMsg, SStats * stats )
+{
+    QFile in( patchFile );
+    in.open( QFile::ReadOnly );
+    if ( !in.isOpen() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error opening file '%1'" ).arg( patchFile );
+        return false;
+    }
+
+    // the patch is read in place when it can be mapped
+    QByteArray contents;
+    const char * pos = ( in.size() > 0 ) ? reinterpret_cast< const char * >( in.map( 0, in.size() ) ) : nullptr;
+    const char * end = pos ? pos + in.size() : nullptr;
+    if ( !pos )
+    {
+        contents = in.readAll();
+        pos = contents.constData();
+        end = pos + contents.size();
+    }
+
+    QFile out( outFile );
+    auto invalid = [ &out, &patchFile, errorMsg ]( const QString & msg )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Invalid patch file '%1': %2" ).arg( patchFile ).arg( msg );
+        if ( out.isOpen() )
+            out.remove();
+        return false;
+    };
+
+    if ( ( end - pos < 4 ) || ( std::memcmp( pos, kMagic, 4 ) != 0 ) )
+        return invalid( "not a patch file" );
+    pos += 4;
+
+    quint64 version, lhsColumns, lhsRows, fingerprint, rhsColumns;
+    if ( !readVarint( pos, end, version ) || ( version != kVersion ) )
+        return invalid( "unsupported version" );
+    if ( !readVarint( pos, end, lhsColumns ) || !readVarint( pos, end, lhsRows ) || !readVarint( pos, end, fingerprint ) || !readVarint( pos, end, rhsColumns ) )
+        return invalid( "truncated header" );
+
+    QStringList rhsHeader;
+    std::vector< int > lhsCols;
+    for ( quint64 ii = 0; ii < rhsColumns; ++ii )
+    {
+        QString name;
+        quint64 lhsCol;
+        if ( !readString( pos, end, name ) || !readVarint( pos, end, lhsCol ) || ( lhsCol > lhsColumns ) )
+            return invalid( "truncated header" );
+        rhsHeader << name;
+        lhsCols.push_back( static_cast< int >( lhsCol ) - 1 );
+    }
+
+    CCSVPatch patch( lhs, lhsCols );
+    if ( ( lhsColumns != static_cast< quint64 >( lhs.columnCount() ) ) || ( lhsRows != static_cast< quint64 >( lhs.rowCount() ) ) || ( fingerprint != patch.lhsFingerprint() ) )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "The LHS file '%1' is not the file the patch '%2' was made from" ).arg( lhs.fFileName ).arg( patchFile );
+        return false;
+    }
+
+    out.open( QFile::Text | QFile::Truncate | QFile::WriteOnly );
+    if ( !out.isOpen() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Could not open file '%1' for write" ).arg( outFile );
+        return false;
+    }
+    patch.fFile = &out;
+
+    auto writeError = [ &out, &outFile, errorMsg ]()
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error writing file '%1'" ).arg( outFile );
+        out.remove();
+        return false;
+    };
+    auto appendCell = [ &patch ]( int col, const QString & value )
+    {
+        if ( col != 0 )
+            patch.fBuffer.append( ',' );
+        patch.fBuffer.append( '"' );
+        patch.fBuffer.append( value.toUtf8().replace( '"', "\"\"" ) );
+        patch.fBuffer.append( '"' );
+    };
+
+    for ( int ii = 0; ii < rhsHeader.count(); ++ii )
+        appendCell( ii, rhsHeader[ ii ] );
+    patch.fBuffer.append( '\n' );
+
+    auto numCols = static_cast< int >( rhsColumns );
+    QStringList rowData;
+    for ( ;; )
+    {
+        if ( pos == end )
+            return invalid( "missing end record" );
+        auto record = static_cast< ERecord >( *pos++ );
+        if ( record == eEnd )
+            break;
+
+        quint64 delta = 0;
+        if ( ( record != eInsert ) && !readVarint( pos, end, delta ) )
+            return invalid( "truncated record" );
+        auto lhsRow = patch.fNextLHS + unzigzag( delta );
+
+        switch ( record )
+        {
+            case eCopy:
+            case eDelete:
+            {
+                quint64 count;
+                if ( !readVarint( pos, end, count ) )
+                    return invalid( "truncated record" );
+                if ( ( lhsRow < 0 ) || ( lhsRow > lhs.rowCount() ) || ( count > static_cast< quint64 >( lhs.rowCount() - lhsRow ) ) )
+                    return invalid( "row out of range" );
+                if ( record == eCopy )
+                {
+                    for ( auto ii = lhsRow; ii < lhsRow + static_cast< qint64 >( count ); ++ii )
+                    {
+                        for ( int jj = 0; jj < numCols; ++jj )
+                            appendCell( jj, patch.lhsCell( static_cast< int >( ii ), jj ) );
+                        patch.fBuffer.append( '\n' );
+                    }
+                    patch.fStats.fCopied += static_cast< int >( count );
+                }
+                else
+                    patch.fStats.fDeleted += static_cast< int >( count );
+                patch.fNextLHS = lhsRow + static_cast< qint64 >( count );
+                break;
+            }
+            case eUpdate:
+            {
+                quint64 numCells;
+                if ( ( lhsRow < 0 ) || ( lhsRow >= lhs.rowCount() ) )
+                    return invalid( "row out of range" );
+                if ( !readVarint( pos, end, numCells ) )
+                    return invalid( "truncated record" );
+                rowData.clear();
+                for ( int jj = 0; jj < numCols; ++jj )
+                    rowData << patch.lhsCell( static_cast< int >( lhsRow ), jj );
+                qint64 col = -1;
+                for ( quint64 jj = 0; jj < numCells; ++jj )
+                {
+                    quint64 gap;
+                    if ( !readVarint( pos, end, gap ) )
+                        return invalid( "truncated record" );
+                    col += static_cast< qint64 >( gap ) + 1;
+                    if ( ( col >= numCols ) || !readString( pos, end, rowData[ static_cast< int >( col ) ] ) )
+                        return invalid( "bad cell" );
+                }
+                for ( int jj = 0; jj < numCols; ++jj )
+                    appendCell( jj, rowData[ jj ] );
+                patch.fBuffer.append( '\n' );
+                patch.fNextLHS = lhsRow + 1;
+                patch.fStats.fUpdated++;
+                patch.fStats.fChangedCells += static_cast< int >( numCells );
+                break;
+            }
+            case eInsert:
+            {
+                QString value;
+                for ( int jj = 0; jj < numCols; ++jj )
+                {
+                    if ( !readString( pos, end, value ) )
+                        return invalid( "bad cell" );
+                    appendCell( jj, value );
+                }
+                patch.fBuffer.append( '\n' );
+                patch.fStats.fInserted++;
+                break;
+            }
+            default:
+                return invalid( QString( "unknown record %1" ).arg( static_cast< int >( record ) ) );
+        }
+
+        if ( !patch.flush( false ) )
+            return writeError();
+    }
+
+    if ( !patch.flush( true ) )
+        return writeError();
+    if ( stats )
+        *stats = patch.fStats;
+    return true;
+}
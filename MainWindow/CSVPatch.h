@@ -0,0 +1,109 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CSVPATCH_H
+#define _CSVPATCH_H
+
+#include <QByteArray>
+#include <QString>
+#include <vector>
+
+struct SCSVTable;
+class QFile;
+
+// Compact binary delta that rebuilds the RHS file from the LHS file, only changed cells are stored.
+// Layout: magic, version, the LHS shape and fingerprint, the RHS header with the LHS column each
+// RHS column comes from, then varint coded records in RHS row order, terminated by eEnd.
+//   eCopy   - LHS row delta, count       the next RHS rows are these LHS rows unchanged
+//   eDelete - LHS row delta, count       LHS rows with no RHS row, not needed to apply the patch
+//   eUpdate - LHS row delta, cells       the next RHS row is this LHS row with the listed cells replaced
+//   eInsert - all cells                  the next RHS row is new
+// Row deltas are zigzag coded against the row after the last one referenced, so in order runs cost a byte.
+class CCSVPatch
+{
+public:
+    enum ERecord
+    {
+        eEnd,
+        eCopy,
+        eDelete,
+        eUpdate,
+        eInsert
+    };
+
+    struct SStats
+    {
+        int fCopied{ 0 };
+        int fDeleted{ 0 };
+        int fUpdated{ 0 };
+        int fInserted{ 0 };
+        int fChangedCells{ 0 };
+        qint64 fBytes{ 0 }; // written
+    };
+
+    static constexpr char kMagic[] = "CSVP";
+    static constexpr int kVersion = 1;
+    static constexpr int kFlushSize = 1024 * 1024;
+
+    // rows are aligned with COrderedDiff on whole row hashes, the rows of a changed hunk are paired on
+    // the key columns, then by position, and written as updates
+    static bool write( const SCSVTable & lhs, const SCSVTable & rhs, const QString & fileName, QString * errorMsg = nullptr, SStats * stats = nullptr );
+
+    // writes the RHS as a fully quoted CSV, the LHS must be the file the patch was made from
+    static bool apply( const SCSVTable & lhs, const QString & patchFile, const QString & outFile, QString * errorMsg = nullptr, SStats * stats = nullptr );
+
+    static void appendVarint( QByteArray & buffer, quint64 value );
+    static bool readVarint( const char *& pos, const char * end, quint64 & value );
+    static quint64 zigzag( qint64 value ) { return ( static_cast< quint64 >( value ) << 1 ) ^ static_cast< quint64 >( value >> 63 ); }
+    static qint64 unzigzag( quint64 value ) { return static_cast< qint64 >( value >> 1 ) ^ -static_cast< qint64 >( value & 1 ); }
+private:
+    CCSVPatch( const SCSVTable & lhs, const std::vector< int > & lhsCols );
+
+    QString lhsCell( int row, int rhsCol ) const;
+    quint64 lhsRowHash( int row ) const;
+    quint64 lhsFingerprint() const; // of the LHS cells the patch reads
+    static quint64 rhsRowHash( const SCSVTable & rhs, int row );
+    static quint64 hashCell( quint64 hash, const QString & value );
+    static bool readString( const char *& pos, const char * end, QString & value );
+
+    bool sameRow( int lhsRow, const SCSVTable & rhs, int rhsRow ) const;
+    void addRun( ERecord record, int lhsRow ); // eCopy or eDelete, extends the pending run when it follows it
+    void addUpdate( int lhsRow, const SCSVTable & rhs, int rhsRow );
+    void addInsert( const SCSVTable & rhs, int rhsRow );
+    void flushRun();
+    void appendRow( qint64 lhsRow );
+    void appendString( const QString & value );
+    bool flush( bool force );
+
+    const SCSVTable & fLHS;
+    std::vector< int > fLHSCols; // per RHS column, -1 when the LHS does not have it
+
+    QFile * fFile{ nullptr };
+    QByteArray fBuffer;
+    SStats fStats;
+    qint64 fNextLHS{ 0 };
+    ERecord fRunRecord{ eEnd };
+    int fRunStart{ 0 };
+    int fRunCount{ 0 };
+};
+
+#endif
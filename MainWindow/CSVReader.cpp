@@ -0,0 +1,483 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "CSVReader.h"
+#include "ReadAhead.h"
+
+#include <QTextCodec>
+#include <QTextDecoder>
+#include <algorithm>
+#include <cstring>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 2 ) )
+#include <emmintrin.h>
+#define CSV_HAS_SSE2
+#endif
+
+namespace
+{
+    const qint64 kBlockSize = 1024 * 1024;
+    const qint64 kMinReadAhead = 4 * kBlockSize; // shorter reads are done before a thread would start
+    const qint64 kSampleSize = 64 * 1024;
+
+    // number of leading pure ASCII bytes
+    qint64 asciiPrefix( const unsigned char * data, qint64 len )
+    {
+        qint64 pos = 0;
+#ifdef CSV_HAS_SSE2
+        for ( ; pos + 16 <= len; pos += 16 )
+        {
+            auto chunk = _mm_loadu_si128( reinterpret_cast< const __m128i * >( data + pos ) );
+            auto mask = _mm_movemask_epi8( chunk );
+            if ( mask != 0 )
+            {
+                for ( int ii = 0; ii < 16; ++ii )
+                {
+                    if ( mask & ( 1 << ii ) )
+                        return pos + ii;
+                }
+            }
+        }
+#else
+        for ( ; pos + 8 <= len; pos += 8 )
+        {
+            quint64 chunk;
+            std::memcpy( &chunk, data + pos, 8 );
+            if ( chunk & 0x8080808080808080ULL )
+                break;
+        }
+#endif
+        while ( ( pos < len ) && ( data[ pos ] < 0x80 ) )
+            ++pos;
+        return pos;
+    }
+}
+
+CCSVReader::CCSVReader()
+{
+}
+
+CCSVReader::~CCSVReader()
+{
+}
+
+bool CCSVReader::open( const QString & fileName )
+{
+    close();
+    fFile.setFileName( fileName );
+    if ( !fFile.open( QFile::ReadOnly ) )
+        return false;
+
+    auto sample = fFile.peek( kSampleSize );
+    fEncoding = detectEncoding( sample.constData(), sample.size(), &fBOMLength );
+    return rewind();
+}
+
+void CCSVReader::close()
+{
+    stopReadAhead();
+    if ( fFile.isOpen() )
+        fFile.close();
+    fDecoder.reset();
+    fBuffer.clear();
+    fBufferPos = 0;
+    fPartial.clear();
+    fEOF = false;
+    fBOMLength = 0;
+    fLinesRead = 0;
+}
+
+bool CCSVReader::rewind()
+{
+    stopReadAhead();
+    fBuffer.clear();
+    fBufferPos = 0;
+    fPartial.clear();
+    fEOF = false;
+    fEnd = -1;
+    fLinesRead = 0;
+
+    fDecoder.reset();
+    if ( fEncoding == EEncoding::eUTF16LE )
+        fDecoder.reset( QTextCodec::codecForName( "UTF-16LE" )->makeDecoder( QTextCodec::IgnoreHeader ) );
+    else if ( fEncoding == EEncoding::eUTF16BE )
+        fDecoder.reset( QTextCodec::codecForName( "UTF-16BE" )->makeDecoder( QTextCodec::IgnoreHeader ) );
+
+    return fFile.seek( fBOMLength );
+}
+
+bool CCSVReader::seek( qint64 begin, qint64 end )
+{
+    // only ASCII compatible bytes can be cut anywhere a line ends
+    if ( fDecoder )
+        return false;
+
+    stopReadAhead();
+    fBuffer.clear();
+    fBufferPos = 0;
+    fPartial.clear();
+    fEOF = false;
+    fEnd = end;
+    fLinesRead = 0;
+    return fFile.seek( std::max( begin, static_cast< qint64 >( fBOMLength ) ) );
+}
+
+qint64 CCSVReader::bufferBytes() const
+{
+    return fBuffer.capacity() + fPartial.capacity() + ( fReadAhead ? fReadAhead->bufferBytes() : 0 );
+}
+
+void CCSVReader::stopReadAhead()
+{
+    fReadAhead.reset();
+    fReadAheadChecked = false;
+    fReadError.clear();
+}
+
+QByteArray CCSVReader::readBlock()
+{
+    if ( !fReadAheadChecked )
+    {
+        fReadAheadChecked = true;
+        auto begin = fFile.pos();
+        auto end = ( fEnd < 0 ) ? fFile.size() : std::min( fEnd, fFile.size() );
+        if ( ( end - begin ) >= kMinReadAhead )
+        {
+            fReadAhead = std::make_unique< CReadAhead >( kBlockSize );
+            if ( !fReadAhead->start( fFile.fileName(), begin, fEnd ) )
+                fReadAhead.reset();
+        }
+    }
+    QByteArray retVal;
+    if ( fReadAhead )
+    {
+        retVal = fReadAhead->next();
+        if ( retVal.isEmpty() && fReadAhead->hasError() )
+            fReadError = fReadAhead->errorString();
+        return retVal;
+    }
+
+    auto toRead = ( fEnd < 0 ) ? kBlockSize : std::min( kBlockSize, fEnd - fFile.pos() );
+    if ( toRead <= 0 )
+        return retVal;
+    retVal = fFile.read( toRead );
+    if ( retVal.isEmpty() && ( fFile.error() != QFile::NoError ) )
+        fReadError = fFile.errorString();
+    return retVal;
+}
+
+bool CCSVReader::inputAtEnd() const
+{
+    return fReadAhead ? fReadAhead->atEnd() : fFile.atEnd();
+}
+
+bool CCSVReader::atEnd() const
+{
+    return fEOF && ( fBufferPos >= fBuffer.size() );
+}
+
+CCSVReader::EEncoding CCSVReader::detectEncoding( const char * data, qint64 len, int * bomLength )
+{
+    auto bytes = reinterpret_cast< const unsigned char * >( data );
+    int bom = 0;
+    auto retVal = EEncoding::eUTF8;
+    if ( ( len >= 3 ) && ( bytes[ 0 ] == 0xEF ) && ( bytes[ 1 ] == 0xBB ) && ( bytes[ 2 ] == 0xBF ) )
+        bom = 3;
+    else if ( ( len >= 2 ) && ( bytes[ 0 ] == 0xFF ) && ( bytes[ 1 ] == 0xFE ) )
+    {
+        bom = 2;
+        retVal = EEncoding::eUTF16LE;
+    }
+    else if ( ( len >= 2 ) && ( bytes[ 0 ] == 0xFE ) && ( bytes[ 1 ] == 0xFF ) )
+    {
+        bom = 2;
+        retVal = EEncoding::eUTF16BE;
+    }
+    else
+    {
+        // BOM-less UTF-16 text is mostly ASCII, so one byte of each pair is zero
+        qint64 evenZeros = 0;
+        qint64 oddZeros = 0;
+        for ( qint64 ii = 0; ii + 1 < len; ii += 2 )
+        {
+            evenZeros += ( bytes[ ii ] == 0 ) ? 1 : 0;
+            oddZeros += ( bytes[ ii + 1 ] == 0 ) ? 1 : 0;
+        }
+        auto numPairs = len / 2;
+        if ( numPairs && ( oddZeros > numPairs / 2 ) && ( evenZeros < numPairs / 16 ) )
+            retVal = EEncoding::eUTF16LE;
+        else if ( numPairs && ( evenZeros > numPairs / 2 ) && ( oddZeros < numPairs / 16 ) )
+            retVal = EEncoding::eUTF16BE;
+        else
+        {
+            // the sample may end in the middle of a multi-byte sequence
+            auto validLen = validUtf8Length( data, len );
+            if ( ( len - validLen ) >= 4 )
+                retVal = EEncoding::eLatin1;
+        }
+    }
+    if ( bomLength )
+        *bomLength = bom;
+    return retVal;
+}
+
+bool CCSVReader::isAscii( const char * data, qint64 len )
+{
+    return asciiPrefix( reinterpret_cast< const unsigned char * >( data ), len ) == len;
+}
+
+qint64 CCSVReader::validUtf8Length( const char * data, qint64 len )
+{
+    auto bytes = reinterpret_cast< const unsigned char * >( data );
+    qint64 pos = 0;
+    while ( pos < len )
+    {
+        pos += asciiPrefix( bytes + pos, len - pos );
+        if ( pos >= len )
+            break;
+
+        auto lead = bytes[ pos ];
+        int numCont = 0;
+        unsigned int minValue = 0;
+        unsigned int value = 0;
+        if ( ( lead & 0xE0 ) == 0xC0 )
+        {
+            numCont = 1;
+            minValue = 0x80;
+            value = lead & 0x1F;
+        }
+        else if ( ( lead & 0xF0 ) == 0xE0 )
+        {
+            numCont = 2;
+            minValue = 0x800;
+            value = lead & 0x0F;
+        }
+        else if ( ( lead & 0xF8 ) == 0xF0 )
+        {
+            numCont = 3;
+            minValue = 0x10000;
+            value = lead & 0x07;
+        }
+        else
+            return pos;
+
+        if ( pos + numCont >= len )
+            return pos;
+        for ( int ii = 1; ii <= numCont; ++ii )
+        {
+            auto curr = bytes[ pos + ii ];
+            if ( ( curr & 0xC0 ) != 0x80 )
+                return pos;
+            value = ( value << 6 ) | ( curr & 0x3F );
+        }
+        // overlong, surrogate or out of range
+        if ( ( value < minValue ) || ( value > 0x10FFFF ) || ( ( value >= 0xD800 ) && ( value <= 0xDFFF ) ) )
+            return pos;
+        pos += numCont + 1;
+    }
+    return pos;
+}
+
+void CCSVReader::appendLatin1AsUtf8( QByteArray & out, const char * data, qint64 len )
+{
+    auto bytes = reinterpret_cast< const unsigned char * >( data );
+    auto outPos = out.size();
+    out.resize( outPos + 2 * len ); // worst case, every byte needs two
+    auto outData = reinterpret_cast< unsigned char * >( out.data() );
+
+    qint64 pos = 0;
+    while ( pos < len )
+    {
+        // copy the ASCII runs as-is
+        auto ascii = asciiPrefix( bytes + pos, len - pos );
+        std::memcpy( outData + outPos, bytes + pos, ascii );
+        outPos += ascii;
+        pos += ascii;
+        for ( ; ( pos < len ) && ( bytes[ pos ] >= 0x80 ); ++pos )
+        {
+            outData[ outPos++ ] = static_cast< unsigned char >( 0xC0 | ( bytes[ pos ] >> 6 ) );
+            outData[ outPos++ ] = static_cast< unsigned char >( 0x80 | ( bytes[ pos ] & 0x3F ) );
+        }
+    }
+    out.resize( outPos );
+}
+
+void CCSVReader::appendDecoded( const QByteArray & raw )
+{
+    if ( fDecoder )
+    {
+        fBuffer += fDecoder->toUnicode( raw ).toUtf8();
+        return;
+    }
+    if ( fEncoding == EEncoding::eLatin1 )
+    {
+        appendLatin1AsUtf8( fBuffer, raw.constData(), raw.size() );
+        return;
+    }
+
+    auto block = fPartial + raw;
+    fPartial.clear();
+    auto validLen = validUtf8Length( block.constData(), block.size() );
+    if ( validLen == block.size() )
+    {
+        fBuffer += block;
+        return;
+    }
+
+    // keep a sequence split across blocks for the next read
+    auto lastLead = block.size() - 1;
+    while ( ( lastLead > validLen ) && ( ( static_cast< unsigned char >( block[ static_cast< int >( lastLead ) ] ) & 0xC0 ) == 0x80 ) )
+        --lastLead;
+    if ( !inputAtEnd() && ( lastLead >= block.size() - 3 ) && isValidUtf8( block.constData(), lastLead ) )
+    {
+        fBuffer += block.left( static_cast< int >( lastLead ) );
+        fPartial = block.mid( static_cast< int >( lastLead ) );
+        return;
+    }
+
+    // stray non UTF-8 bytes in a UTF-8 file, treat them as Latin-1
+    appendWithStrayLatin1( fBuffer, block.constData(), block.size() );
+}
+
+void CCSVReader::appendWithStrayLatin1( QByteArray & out, const char * data, qint64 len )
+{
+    qint64 pos = 0;
+    while ( pos < len )
+    {
+        auto valid = validUtf8Length( data + pos, len - pos );
+        out.append( data + pos, static_cast< int >( valid ) );
+        pos += valid;
+        if ( pos < len )
+        {
+            appendLatin1AsUtf8( out, data + pos, 1 );
+            pos++;
+        }
+    }
+}
+
+QByteArray CCSVReader::decodeLine( const QByteArray & raw, EEncoding encoding )
+{
+    // a newline is never part of a multi-byte sequence, so decoding line by line matches decoding by block
+    if ( encoding == EEncoding::eLatin1 )
+    {
+        QByteArray retVal;
+        appendLatin1AsUtf8( retVal, raw.constData(), raw.size() );
+        return retVal;
+    }
+    if ( isValidUtf8( raw.constData(), raw.size() ) )
+        return raw;
+
+    QByteArray retVal;
+    appendWithStrayLatin1( retVal, raw.constData(), raw.size() );
+    return retVal;
+}
+
+bool CCSVReader::fillBuffer()
+{
+    if ( fEOF )
+        return false;
+
+    fBuffer.remove( 0, fBufferPos );
+    fBufferPos = 0;
+
+    auto raw = readBlock();
+    if ( raw.isEmpty() )
+    {
+        fEOF = true;
+        if ( !fPartial.isEmpty() )
+        {
+            appendLatin1AsUtf8( fBuffer, fPartial.constData(), fPartial.size() );
+            fPartial.clear();
+        }
+        return !fBuffer.isEmpty();
+    }
+    appendDecoded( raw );
+    return true;
+}
+
+bool CCSVReader::readLine( QByteArray & line )
+{
+    while ( true )
+    {
+        auto start = fBuffer.constData() + fBufferPos;
+        auto remaining = fBuffer.size() - fBufferPos;
+        auto eol = remaining ? static_cast< const char * >( std::memchr( start, fLineEnd, remaining ) ) : nullptr;
+        if ( eol || ( fEOF && remaining ) )
+        {
+            auto len = eol ? static_cast< int >( eol - start ) : remaining;
+            auto lineLen = len;
+            if ( lineLen && ( fLineEnd == '\n' ) && ( start[ lineLen - 1 ] == '\r' ) )
+                --lineLen;
+            line = QByteArray( start, lineLen );
+            fBufferPos += len + ( eol ? 1 : 0 );
+            fLinesRead++;
+            return true;
+        }
+        if ( !fillBuffer() && ( fBufferPos >= fBuffer.size() ) )
+            return false;
+    }
+}
+
+QByteArray CCSVReader::peek( int maxBytes )
+{
+    while ( ( fBuffer.size() - fBufferPos < maxBytes ) && fillBuffer() )
+        ;
+    return fBuffer.mid( fBufferPos, maxBytes );
+}
+
+int CCSVReader::countLines( const std::function< bool( int lineNum ) > & progress )
+{
+    int retVal = 0;
+    if ( fDecoder )
+    {
+        QByteArray line;
+        while ( readLine( line ) )
+        {
+            if ( progress && ( ( retVal % 1000 ) == 0 ) && !progress( retVal ) )
+                return -1;
+            retVal++;
+        }
+    }
+    else
+    {
+        // ASCII compatible, count the line ends in the raw bytes without decoding anything
+        QByteArray raw;
+        char last = fLineEnd;
+        while ( !( raw = readBlock() ).isEmpty() )
+        {
+            auto data = raw.constData();
+            auto end = data + raw.size();
+            while ( auto eol = static_cast< const char * >( std::memchr( data, fLineEnd, end - data ) ) )
+            {
+                retVal++;
+                data = eol + 1;
+            }
+            last = raw[ raw.size() - 1 ];
+            if ( progress && !progress( retVal ) )
+                return -1;
+        }
+        if ( last != fLineEnd )
+            retVal++;
+    }
+    rewind();
+    return retVal;
+}
@@ -0,0 +1,98 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CSVREADER_H
+#define _CSVREADER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <functional>
+#include <memory>
+
+class QTextDecoder;
+class CReadAhead;
+
+// Reads a text file as raw bytes and hands out UTF-8 lines.
+// UTF-8 (and plain ASCII) input is passed through untouched, only Latin-1 and UTF-16 are transcoded
+class CCSVReader
+{
+public:
+    enum class EEncoding
+    {
+        eUTF8,
+        eLatin1,
+        eUTF16LE,
+        eUTF16BE
+    };
+
+    CCSVReader();
+    ~CCSVReader();
+
+    bool open( const QString & fileName );
+    void close();
+    bool rewind();
+    bool seek( qint64 begin, qint64 end = -1 ); // raw byte offsets, reads stop at end; not for UTF-16 files
+    bool atEnd() const;
+    bool hasError() const { return !fReadError.isEmpty(); } // a read failed, readLine returns false as at the end
+    QString errorString() const { return fReadError.isEmpty() ? fFile.errorString() : fReadError; }
+
+    EEncoding encoding() const { return fEncoding; }
+    qint64 bufferBytes() const;
+
+    bool readLine( QByteArray & line ); // without the line terminator
+    QByteArray peek( int maxBytes ); // the next decoded bytes, without reading past them
+    void setLineEnd( char lineEnd ) { fLineEnd = lineEnd; } // '\n' also strips a '\r' before it, '\r' for files with only carriage returns
+    int lineNumber() const { return fLinesRead - 1; } // of the last line read, counting from the start of the file or the last seek
+    int countLines( const std::function< bool( int lineNum ) > & progress = {} ); // progress returns false to cancel, -1 when canceled
+
+    static EEncoding detectEncoding( const char * data, qint64 len, int * bomLength = nullptr );
+    static qint64 validUtf8Length( const char * data, qint64 len ); // length of the valid prefix
+    static bool isValidUtf8( const char * data, qint64 len ) { return validUtf8Length( data, len ) == len; }
+    static bool isAscii( const char * data, qint64 len );
+    static void appendLatin1AsUtf8( QByteArray & out, const char * data, qint64 len );
+    static void appendWithStrayLatin1( QByteArray & out, const char * data, qint64 len ); // UTF-8 with any invalid bytes read as Latin-1
+    static QByteArray decodeLine( const QByteArray & raw, EEncoding encoding ); // one raw line as readLine returns it; not for UTF-16
+private:
+    QByteArray readBlock(); // from the read ahead thread once the read is long enough to need it
+    bool inputAtEnd() const;
+    void stopReadAhead();
+    bool fillBuffer();
+    void appendDecoded( const QByteArray & raw );
+
+    QFile fFile;
+    EEncoding fEncoding{ EEncoding::eUTF8 };
+    int fBOMLength{ 0 };
+    std::unique_ptr< QTextDecoder > fDecoder;
+    QByteArray fBuffer; // decoded UTF-8 not yet handed out
+    int fBufferPos{ 0 };
+    QByteArray fPartial; // incomplete UTF-8 sequence at the end of the last block
+    bool fEOF{ false };
+    qint64 fEnd{ -1 }; // raw offset the reads stop at, -1 for the end of the file
+    int fLinesRead{ 0 };
+    char fLineEnd{ '\n' };
+    std::unique_ptr< CReadAhead > fReadAhead;
+    bool fReadAheadChecked{ false }; // the read since the last seek was looked at for a read ahead
+    QString fReadError;
+};
+
+#endif
@@ -0,0 +1,440 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "CSVTable.h"
+#include "MainWindow.h"
+#include "CSVReader.h"
+#include "KeyHash.h"
+#include "KeyNormalizer.h"
+#include "MemoryAccounting.h"
+#include "WorkStealingPool.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+SCSVTable::~SCSVTable()
+{
+    CMemoryAccounting::instance().release( this );
+}
+
+void SCSVTable::clear()
+{
+    fFileName.clear();
+    fHeader.clear();
+    fDialect = CCSVDialect();
+    fExtraUnimportantCols.clear();
+    fRows.clear();
+    fShardRows.clear();
+    fIgnoredLines.clear();
+    fContentHash = 0;
+    fColumnTypes.clear();
+    fMergedInfo.clear();
+    CMemoryAccounting::instance().release( this );
+}
+
+qint64 SCSVTable::estimateBytes() const
+{
+    auto retVal = CMemoryAccounting::estimateBytes( fHeader ) + CMemoryAccounting::estimateBytes( fRows );
+    for ( auto && ii : fRows )
+        retVal += CMemoryAccounting::estimateBytes( ii ) - static_cast< qint64 >( sizeof( QStringList ) );
+    return retVal;
+}
+
+QString SCSVTable::data( int row, int col ) const
+{
+    QString retVal;
+    if ( ( row >= 0 ) && ( row < rowCount() ) && ( col >= 0 ) && ( col < fRows[ row ].count() ) )
+        retVal = fRows[ row ][ col ];
+    if ( retVal.isEmpty() )
+    {
+        auto pos = fExtraUnimportantCols.find( col );
+        if ( pos != fExtraUnimportantCols.end() )
+            retVal = ( *pos ).second;
+    }
+    return retVal;
+}
+
+QStringList SCSVTable::data( int row, const std::map< int, QString > & cols ) const
+{
+    QStringList retVal;
+    for ( auto && ii : cols )
+        retVal << data( row, ii.first );
+    return retVal;
+}
+
+QByteArray SCSVTable::computeKey( const QStringList & rowData, const std::vector< int > & keyCols, const std::vector< int > & options, const std::vector< CColumnType > & keyTypes )
+{
+    if ( keyTypes.empty() )
+        return CKeyNormalizer::computeKey( rowData, keyCols, options );
+
+    thread_local QStringList sKeyValues;
+    thread_local std::vector< int > sPositions;
+    sKeyValues.clear();
+    appendKeyValues( rowData, keyCols, keyTypes, sKeyValues );
+    while ( sPositions.size() < keyCols.size() )
+        sPositions.push_back( static_cast< int >( sPositions.size() ) );
+    sPositions.resize( keyCols.size() );
+    return CKeyNormalizer::computeKey( sKeyValues, sPositions, keyOptions( options, keyTypes ) );
+}
+
+void SCSVTable::appendKeyValues( const QStringList & rowData, const std::vector< int > & keyCols, const std::vector< CColumnType > & keyTypes, QStringList & keyValues )
+{
+    for ( size_t ii = 0; ii < keyCols.size(); ++ii )
+    {
+        auto value = rowData.value( keyCols[ ii ] );
+        keyValues << ( ( ( ii < keyTypes.size() ) && keyTypes[ ii ].isTyped() ) ? keyTypes[ ii ].keyText( value ) : value );
+    }
+}
+
+std::vector< int > SCSVTable::keyOptions( const std::vector< int > & options, const std::vector< CColumnType > & keyTypes )
+{
+    auto retVal = options;
+    if ( retVal.size() < keyTypes.size() )
+        retVal.resize( keyTypes.size(), CKeyNormalizer::kDefaultOptions );
+    for ( size_t ii = 0; ii < keyTypes.size(); ++ii )
+    {
+        if ( keyTypes[ ii ].isTyped() )
+            retVal[ ii ] = CKeyNormalizer::eNone;
+    }
+    return retVal;
+}
+
+std::vector< int > SCSVTable::sampledShards( int numShards )
+{
+    std::vector< int > retVal;
+    auto numSampled = std::min( numShards, kSampleShards );
+    for ( int ii = 0; ii < numSampled; ++ii )
+        retVal.push_back( static_cast< int >( static_cast< qint64 >( ii ) * numShards / numSampled ) );
+    return retVal;
+}
+
+void SCSVTable::inferColumnTypes( const std::vector< QStringList > & rows )
+{
+    auto numRows = std::min( static_cast< int >( rows.size() ), CColumnType::kSampleRows );
+    fColumnTypes.clear();
+    for ( int ii = 0; ii < columnCount(); ++ii )
+    {
+        std::vector< QString > sample;
+        sample.reserve( numRows );
+        for ( int jj = 0; jj < numRows; ++jj )
+            sample.push_back( rows[ jj ].value( ii ) );
+        fColumnTypes.push_back( CColumnType::infer( sample ) );
+    }
+}
+
+bool SCSVTable::sampleColumnTypes( const QString & fileName )
+{
+    CCSVReader reader;
+    if ( !reader.open( fileName ) )
+        return false;
+    reader.setLineEnd( fDialect.lineEnd() );
+
+    QByteArray rawLine;
+    while ( reader.readLine( rawLine ) && fDialect.trimmed( QString::fromUtf8( rawLine ) ).isEmpty() )
+        ;
+    std::vector< QStringList > sample;
+    QStringList rowData;
+    while ( ( static_cast< int >( sample.size() ) < CColumnType::kSampleRows ) && reader.readLine( rawLine ) )
+    {
+        if ( parseLine( rawLine, rowData ) == eRow )
+            sample.push_back( rowData );
+    }
+    inferColumnTypes( sample );
+    return !reader.hasError();
+}
+
+SCSVTable::ELine SCSVTable::parseLine( const QByteArray & rawLine, QStringList & rowData ) const
+{
+    // the row filter runs on the raw bytes, an ignored row is never parsed
+    auto rowType = fRowFilter.classify( rawLine, fDialect );
+    if ( rowType == CRowFilter::eBlank )
+        return eSkipped;
+    if ( rowType == CRowFilter::eIgnored )
+        return eIgnoredRow;
+
+    auto currRow = SFileData::getRow( QString::fromUtf8( rawLine ), fMergedInfo, fDialect );
+    if ( !currRow.has_value() )
+        return eSkipped;
+    if ( !currRow.value().first )
+        return eInvalid;
+    rowData = std::move( currRow.value().second );
+    return ( rowData.count() == fHeader.count() ) ? eRow : eBadColumnCount;
+}
+
+bool SCSVTable::rangeKeys( const TRanges & ranges, const std::vector< int > & keyCols, const std::vector< int > & options, const std::vector< CColumnType > & keyTypes, std::unordered_set< QByteArray > & keys, QString * errorMsg, const std::atomic< bool > * canceled ) const
+{
+    CCSVReader reader;
+    if ( !reader.open( fFileName ) )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error opening file '%1'" ).arg( fFileName );
+        return false;
+    }
+    reader.setLineEnd( fDialect.lineEnd() );
+
+    QByteArray rawLine;
+    QStringList rowData;
+    for ( auto && range : ranges )
+    {
+        if ( !reader.seek( range.first, range.second ) )
+        {
+            if ( errorMsg )
+                *errorMsg = QString( "Can not read parts of file '%1'" ).arg( fFileName );
+            return false;
+        }
+        while ( reader.readLine( rawLine ) )
+        {
+            if ( canceled && *canceled )
+                return false;
+            auto lineType = parseLine( rawLine, rowData );
+            if ( lineType == eRow )
+                keys.insert( computeKey( rowData, keyCols, options, keyTypes ) );
+            else if ( ( lineType == eInvalid ) || ( lineType == eBadColumnCount ) )
+            {
+                if ( errorMsg )
+                    *errorMsg = QString( "Invalid row in file '%1' at byte %2" ).arg( fFileName ).arg( range.first );
+                return false;
+            }
+        }
+    }
+    if ( reader.hasError() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error reading file '%1': %2" ).arg( fFileName ).arg( reader.errorString() );
+        return false;
+    }
+    return true;
+}
+
+QStringList SCSVTable::shardFiles( const QString & fileName )
+{
+    // an existing file is never a pattern, whatever its name holds
+    if ( fileName.isEmpty() || QFileInfo::exists( fileName ) )
+        return QStringList() << fileName;
+
+    QStringList retVal;
+    for ( auto && ii : fileName.split( ';', Qt::SkipEmptyParts ) )
+    {
+        auto part = ii.trimmed();
+        QFileInfo fi( part );
+        auto pattern = fi.fileName();
+        if ( !pattern.contains( '*' ) && !pattern.contains( '?' ) && !pattern.contains( '[' ) )
+        {
+            retVal << part;
+            continue;
+        }
+        // the exporters number the parts with leading zeros, so name order is part order
+        auto dir = fi.dir();
+        for ( auto && jj : dir.entryList( QStringList() << pattern, QDir::Files, QDir::Name ) )
+            retVal << dir.filePath( jj );
+    }
+    return retVal;
+}
+
+bool SCSVTable::loadShards( const QString & fileName, const QStringList & shards, QString * errorMsg, const std::atomic< bool > * canceled )
+{
+    // every shard is parsed into a table of its own, the rows are then moved over in shard order
+    std::vector< SCSVTable > parts( shards.count() );
+    std::vector< QString > errors( shards.count() );
+    auto aOK = CWorkStealingPool::shared().parallelFor( shards.count(),
+                                                        [ & ]( int shard )
+                                                        {
+                                                            parts[ shard ].fRowFilter = fRowFilter;
+                                                            return parts[ shard ].load( shards[ shard ], &errors[ shard ], canceled );
+                                                        } );
+    if ( canceled && *canceled )
+        return false;
+    if ( !aOK )
+    {
+        auto pos = std::find_if( errors.begin(), errors.end(), []( const QString & msg ) { return !msg.isEmpty(); } );
+        if ( errorMsg && ( pos != errors.end() ) )
+            *errorMsg = *pos;
+        return false;
+    }
+
+    auto && first = parts.front();
+    for ( int ii = 1; ii < shards.count(); ++ii )
+    {
+        if ( parts[ ii ].fHeader != first.fHeader )
+        {
+            if ( errorMsg )
+                *errorMsg = QString( "The header of shard '%1' does not match the header of '%2'" ).arg( shards[ ii ] ).arg( shards.front() );
+            return false;
+        }
+    }
+
+    fDialect = first.fDialect;
+    fHeader = first.fHeader;
+    fExtraUnimportantCols = first.fExtraUnimportantCols;
+    fMergedInfo = first.fMergedInfo;
+
+    // sampled across the shards, a column typed by the first shard alone may not parse in the others
+    std::vector< QStringList > sample;
+    auto sampled = sampledShards( shards.count() );
+    auto perShard = std::max( 1, CColumnType::kSampleRows / static_cast< int >( sampled.size() ) );
+    for ( auto && ii : sampled )
+    {
+        auto && rows = parts[ ii ].fRows;
+        sample.insert( sample.end(), rows.begin(), rows.begin() + std::min( perShard, static_cast< int >( rows.size() ) ) );
+    }
+    inferColumnTypes( sample );
+
+    size_t numRows = 0;
+    for ( auto && ii : parts )
+        numRows += ii.fRows.size();
+    fRows.reserve( numRows );
+
+    int lineBase = 0;
+    for ( auto && ii : parts )
+    {
+        fShardRows.push_back( rowCount() );
+        for ( auto && jj : ii.fIgnoredLines )
+            fIgnoredLines.push_back( lineBase + jj );
+        lineBase += ii.rowCount() + ii.numIgnoredRows();
+        std::move( ii.fRows.begin(), ii.fRows.end(), std::back_inserter( fRows ) );
+        fContentHash = NKeyHash::hash64( reinterpret_cast< const char * >( &ii.fContentHash ), sizeof( ii.fContentHash ), fContentHash );
+        ii.clear();
+    }
+    CMemoryAccounting::instance().setLive( CMemoryAccounting::eCellStore, this, estimateBytes() );
+    return true;
+}
+
+bool SCSVTable::load( const QString & fileName, QString * errorMsg, const std::atomic< bool > * canceled, const TRanges * ranges )
+{
+    clear();
+    fFileName = fileName;
+
+    auto shards = shardFiles( fileName );
+    if ( shards.count() > 1 )
+        return loadShards( fileName, shards, errorMsg, canceled );
+
+    if ( shards.isEmpty() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "No files match '%1'" ).arg( fileName );
+        return false;
+    }
+
+    CCSVReader reader;
+    if ( !reader.open( shards.front() ) )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error opening file '%1'" ).arg( fileName );
+        return false;
+    }
+    fDialect = CCSVDialect::sniff( reader.peek( CCSVDialect::kSampleBytes ) );
+    reader.setLineEnd( fDialect.lineEnd() );
+
+    size_t currRange = 0;
+    if ( ranges && !ranges->empty() && !reader.seek( ranges->front().first, ranges->front().second ) )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Can not read parts of file '%1'" ).arg( fileName );
+        return false;
+    }
+    // moves on to the next range at the end of each one
+    auto readLine = [ & ]( QByteArray & line )
+    {
+        while ( !reader.readLine( line ) )
+        {
+            if ( reader.hasError() || !ranges || ( ++currRange >= ranges->size() ) )
+                return false;
+            reader.seek( ( *ranges )[ currRange ].first, ( *ranges )[ currRange ].second );
+        }
+        return true;
+    };
+
+    QString firstLine;
+    QByteArray rawLine;
+    while ( firstLine.isEmpty() && readLine( rawLine ) )
+    {
+        fContentHash = NKeyHash::hash64( rawLine.constData(), rawLine.size(), fContentHash );
+        firstLine = fDialect.trimmed( QString::fromUtf8( rawLine ) );
+    }
+    auto header = SFileData::getRow( firstLine, {}, fDialect );
+    if ( !header.has_value() || !header.value().first || header.value().second.isEmpty() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Invalid format '%1' at Row: %2" ).arg( fileName ).arg( 1 );
+        return false;
+    }
+
+    fHeader = header.value().second;
+    fRowFilter.bind( fHeader );
+    fMergedInfo = SFileData::computeMergedColumns( fHeader, fExtraUnimportantCols );
+
+    int lineNum = 0;
+    QStringList currRowData;
+    while ( readLine( rawLine ) )
+    {
+        if ( canceled && *canceled )
+            return false;
+        fContentHash = NKeyHash::hash64( rawLine.constData(), rawLine.size(), fContentHash );
+
+        auto lineType = parseLine( rawLine, currRowData );
+        if ( lineType == eSkipped )
+            continue;
+        if ( lineType == eIgnoredRow )
+        {
+            fIgnoredLines.push_back( ++lineNum );
+            continue;
+        }
+        if ( lineType == eInvalid )
+        {
+            if ( errorMsg )
+                *errorMsg = QString( "Invalid format in file '%1' at Row: %2" ).arg( fileName ).arg( lineNum + 1 );
+            return false;
+        }
+
+        lineNum++;
+        if ( lineType == eBadColumnCount )
+        {
+            if ( errorMsg )
+                *errorMsg = QString( "Invalid number of columns in file '%1' at Row: %2" ).arg( fileName ).arg( lineNum + 1 );
+            return false;
+        }
+        fRows.emplace_back( std::move( currRowData ) );
+    }
+    if ( reader.hasError() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error reading file '%1': %2" ).arg( fileName ).arg( reader.errorString() );
+        return false;
+    }
+
+    // a partial load samples the file, its first rows may not be among the loaded ones
+    if ( !ranges || ranges->empty() )
+        inferColumnTypes( fRows );
+    else if ( !sampleColumnTypes( shards.front() ) )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error reading file '%1'" ).arg( fileName );
+        return false;
+    }
+
+    // the read buffers are gone once this returns, reporting them still records the peak
+    auto && accounting = CMemoryAccounting::instance();
+    accounting.setLive( CMemoryAccounting::eRawInput, this, reader.bufferBytes() );
+    accounting.setLive( CMemoryAccounting::eRawInput, this, 0 );
+    accounting.setLive( CMemoryAccounting::eCellStore, this, estimateBytes() );
+    return true;
+}
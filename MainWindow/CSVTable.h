@@ -0,0 +1,106 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CSVTABLE_H
+#define _CSVTABLE_H
+
+#include "CSVDialect.h"
+#include "ColumnType.h"
+#include "RowFilter.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Widget-free copy of a CSV file, loaded with the same rules as SFileData::loadFile
+// so it can be filled from worker threads.
+// The file name can also name shards, the parts of one logical table: a glob in the file name
+// part ( data/part-*.csv ) or a list separated by ';'. The shards are parsed concurrently, must
+// all have the same header, and their rows follow each other in shard order
+struct SCSVTable
+{
+    using TRanges = std::vector< std::pair< qint64, qint64 > >; // [ begin, end ) byte offsets
+
+    ~SCSVTable();
+
+    static QStringList shardFiles( const QString & fileName ); // in order, fileName itself when it is not a glob or list
+    static constexpr int kSampleShards = 16;
+    static std::vector< int > sampledShards( int numShards ); // spread evenly from the first, at most kSampleShards, for the type and size samples
+
+    // ranges limits the parse to those byte offsets, the first one must hold the header, single files only.
+    // The column types are still sampled from the first rows of the file, as a full load samples them
+    bool load( const QString & fileName, QString * errorMsg = nullptr, const std::atomic< bool > * canceled = nullptr, const TRanges * ranges = nullptr );
+    // the keys of the data rows in ranges of the loaded file, parsed as load parses them but not kept
+    bool rangeKeys( const TRanges & ranges, const std::vector< int > & keyCols, const std::vector< int > & options, const std::vector< CColumnType > & keyTypes, std::unordered_set< QByteArray > & keys, QString * errorMsg = nullptr, const std::atomic< bool > * canceled = nullptr ) const;
+    void clear();
+    qint64 estimateBytes() const;
+
+    int numShards() const { return std::max( 1, static_cast< int >( fShardRows.size() ) ); }
+    int shardBegin( int shard ) const { return fShardRows.empty() ? 0 : fShardRows[ shard ]; }
+    int shardEnd( int shard ) const { return ( shard + 1 < static_cast< int >( fShardRows.size() ) ) ? fShardRows[ shard + 1 ] : rowCount(); }
+    int numIgnoredRows() const { return static_cast< int >( fIgnoredLines.size() ); }
+    int rowCount() const { return static_cast< int >( fRows.size() ); }
+    int columnCount() const { return fHeader.count(); }
+    int findColumn( const QString & name ) const { return fHeader.indexOf( name ); }
+    QString data( int row, int col ) const;
+    QStringList data( int row, const std::map< int, QString > & cols ) const;
+    CColumnType columnType( int col ) const { return ( ( col >= 0 ) && ( col < static_cast< int >( fColumnTypes.size() ) ) ) ? fColumnTypes[ col ] : CColumnType(); }
+
+    // options and types per key column, see CKeyNormalizer. A typed key column matches on the value as in SFileData::keyText, 00123 and 123 are the same key
+    QByteArray computeKey( int row, const std::vector< int > & keyCols, const std::vector< int > & options = {}, const std::vector< CColumnType > & keyTypes = {} ) const { return computeKey( fRows[ row ], keyCols, options, keyTypes ); }
+    static QByteArray computeKey( const QStringList & rowData, const std::vector< int > & keyCols, const std::vector< int > & options = {}, const std::vector< CColumnType > & keyTypes = {} );
+    static void appendKeyValues( const QStringList & rowData, const std::vector< int > & keyCols, const std::vector< CColumnType > & keyTypes, QStringList & keyValues );
+    static std::vector< int > keyOptions( const std::vector< int > & options, const std::vector< CColumnType > & keyTypes ); // typed values are already canonical
+
+    QString fFileName;
+    CCSVDialect fDialect;
+    CRowFilter fRowFilter; // set before the load, clear keeps it
+    QStringList fHeader;
+    std::map< int, QString > fExtraUnimportantCols;
+    std::vector< QStringList > fRows;
+    std::vector< int > fShardRows;    // first row of each shard, empty for a single file
+    std::vector< int > fIgnoredLines; // data line of each row fRowFilter ignored, from 1
+    quint64 fContentHash{ 0 };        // of every line read, the header included
+    std::unordered_map< int, std::pair< int, int > > fMergedInfo; // the name columns merged into one, as in SFileData
+    std::vector< CColumnType > fColumnTypes; // per column, inferred from the first rows, of a stride of the shards when sharded, as SFileData does
+private:
+    enum ELine
+    {
+        eRow,
+        eSkipped, // blank or empty once trimmed
+        eIgnoredRow,
+        eInvalid,
+        eBadColumnCount
+    };
+    ELine parseLine( const QByteArray & rawLine, QStringList & rowData ) const;
+    void inferColumnTypes( const std::vector< QStringList > & rows );
+    bool sampleColumnTypes( const QString & fileName ); // from the first rows of the file, not of the loaded ranges
+    bool loadShards( const QString & fileName, const QStringList & shards, QString * errorMsg, const std::atomic< bool > * canceled );
+};
+
+#endif
@@ -0,0 +1,252 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ChunkFingerprints.h"
+#include "CSVDialect.h"
+#include "CSVReader.h"
+#include "KeyHash.h"
+#include "OrderedDiff.h"
+#include "ReadAhead.h"
+
+#include <QFile>
+#include <array>
+
+namespace
+{
+    const qint64 kBlockSize = 4 * 1024 * 1024;
+    const quint64 kCutMask = 0xFFFFULL << 48; // 16 bits, 64KB chunks on average
+    const quint64 kSecondSeed = 0x5851F42D4C957F2DULL;
+
+    // gear hash table, the rolling hash only depends on the last 64 bytes
+    const std::array< quint64, 256 > & gearTable()
+    {
+        static const auto sTable = []()
+        {
+            std::array< quint64, 256 > retVal;
+            for ( int ii = 0; ii < 256; ++ii )
+                retVal[ ii ] = NKeyHash::mix64( 0x9E3779B97F4A7C15ULL * ( ii + 1 ) );
+            return retVal;
+        }();
+        return sTable;
+    }
+
+}
+
+void CChunkFingerprints::clear()
+{
+    fChunks.clear();
+    fHeaderHash = 0;
+    fValid = false;
+}
+
+void CChunkFingerprints::addChunk( const QByteArray & data, qint64 offset, int numRows )
+{
+    SChunk chunk;
+    chunk.fOffset = offset;
+    chunk.fLength = data.size();
+    chunk.fHash = NKeyHash::hash64( data.constData(), data.size() );
+    chunk.fHash2 = NKeyHash::hash64( data.constData(), data.size(), kSecondSeed );
+    chunk.fNumRows = numRows;
+    fChunks.push_back( chunk );
+}
+
+bool CChunkFingerprints::compute( const QString & fileName, QString * errorMsg, const std::atomic< bool > * canceled )
+{
+    clear();
+
+    QFile file( fileName );
+    if ( !file.open( QFile::ReadOnly ) )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error opening file '%1'" ).arg( fileName );
+        return false;
+    }
+
+    auto sample = file.peek( 64 * 1024 );
+    auto encoding = CCSVReader::detectEncoding( sample.constData(), sample.size() );
+    if ( ( encoding == CCSVReader::EEncoding::eUTF16LE ) || ( encoding == CCSVReader::EEncoding::eUTF16BE ) )
+        return true; // nothing to skip, the file is parsed in full
+
+    // the chunks are cut on newlines
+    auto dialect = CCSVDialect::sniff( sample );
+    if ( dialect.lineEnd() != '\n' )
+        return true;
+
+    auto && gear = gearTable();
+    quint64 rolling = 0;
+    bool cutPending = false;
+    bool inHeader = true;
+
+    QByteArray chunk;
+    chunk.reserve( static_cast< int >( kMaxChunkSize ) );
+    qint64 chunkOffset = 0;
+    qint64 chunkBytes = 0; // including the line not yet added to chunk
+    int chunkRows = 0;
+    QByteArray partialLine; // a line split across two blocks
+
+    // the hashing overlaps the reads
+    CReadAhead readAhead( kBlockSize );
+    auto useReadAhead = readAhead.start( fileName, 0 );
+
+    QByteArray block;
+    while ( !( block = useReadAhead ? readAhead.next() : file.read( kBlockSize ) ).isEmpty() )
+    {
+        if ( canceled && *canceled )
+            return false;
+
+        auto data = block.constData();
+        qint64 lineStart = 0;
+        for ( qint64 ii = 0; ii < block.size(); ++ii )
+        {
+            auto ch = static_cast< unsigned char >( data[ ii ] );
+            rolling = ( rolling << 1 ) + gear[ ch ];
+            // only cut points past the minimum count, so the cuts depend on the content alone
+            if ( ( ++chunkBytes >= kMinChunkSize ) && ( ( rolling & kCutMask ) == 0 ) )
+                cutPending = true;
+            if ( ch != '\n' )
+                continue;
+
+            auto lineData = data + lineStart;
+            auto lineLen = ii + 1 - lineStart;
+            if ( !partialLine.isEmpty() )
+            {
+                partialLine.append( lineData, static_cast< int >( lineLen ) );
+                lineData = partialLine.constData();
+                lineLen = partialLine.size();
+            }
+            lineStart = ii + 1;
+            chunk.append( lineData, static_cast< int >( lineLen ) );
+            if ( inHeader )
+            {
+                // the header is the first non blank line, it is not a data row
+                auto trimmed = QByteArray( lineData, static_cast< int >( lineLen ) ).trimmed();
+                if ( !trimmed.isEmpty() )
+                {
+                    fHeaderHash = NKeyHash::hash64( trimmed.constData(), trimmed.size() );
+                    fRowFilter.bind( dialect.split( dialect.trimmed( QString::fromUtf8( trimmed ) ) ) );
+                    inHeader = false;
+                }
+            }
+            else if ( fRowFilter.classify( lineData, static_cast< int >( lineLen ), dialect ) == CRowFilter::eKept )
+                chunkRows++;
+            partialLine.clear();
+
+            if ( cutPending || ( chunk.size() >= kMaxChunkSize ) )
+            {
+                addChunk( chunk, chunkOffset, chunkRows );
+                chunkOffset += chunk.size();
+                chunk.resize( 0 ); // keeps the reserved capacity
+                chunkBytes = 0;
+                chunkRows = 0;
+                cutPending = false;
+            }
+        }
+        partialLine.append( data + lineStart, static_cast< int >( block.size() - lineStart ) );
+    }
+    if ( useReadAhead ? readAhead.hasError() : ( file.error() != QFile::NoError ) )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error reading file '%1': %2" ).arg( fileName ).arg( useReadAhead ? readAhead.errorString() : file.errorString() );
+        return false;
+    }
+
+    if ( !partialLine.isEmpty() )
+    {
+        chunk += partialLine;
+        if ( !inHeader && ( fRowFilter.classify( partialLine, dialect ) == CRowFilter::eKept ) )
+            chunkRows++;
+    }
+    if ( !chunk.isEmpty() )
+        addChunk( chunk, chunkOffset, chunkRows );
+
+    fValid = true;
+    return true;
+}
+
+int CChunkFingerprints::match( const CChunkFingerprints & lhs, const CChunkFingerprints & rhs, TRanges & lhsRanges, TRanges & rhsRanges, qint64 * skippedBytes, TRanges * sharedRanges )
+{
+    lhsRanges.clear();
+    rhsRanges.clear();
+    if ( sharedRanges )
+        sharedRanges->clear();
+    if ( skippedBytes )
+        *skippedBytes = 0;
+    // the rows only mean the same thing under the same header
+    if ( !lhs.isValid() || !rhs.isValid() || ( lhs.fHeaderHash != rhs.fHeaderHash ) || ( lhs.fChunks.size() < 2 ) || ( rhs.fChunks.size() < 2 ) )
+        return 0;
+
+    // only the chunks in the same order in both files pair up, a moved or repeated chunk is parsed
+    std::vector< quint64 > lhsHashes;
+    for ( size_t ii = 1; ii < lhs.fChunks.size(); ++ii )
+        lhsHashes.push_back( lhs.fChunks[ ii ].fHash );
+    std::vector< quint64 > rhsHashes;
+    for ( size_t ii = 1; ii < rhs.fChunks.size(); ++ii )
+        rhsHashes.push_back( rhs.fChunks[ ii ].fHash );
+    COrderedDiff diff;
+    if ( !diff.diff( lhsHashes, rhsHashes ) )
+        return 0;
+
+    std::vector< bool > lhsPaired( lhs.fChunks.size(), false );
+    std::vector< bool > rhsPaired( rhs.fChunks.size(), false );
+    int retVal = 0;
+    bool anyPaired = false;
+    for ( auto && run : diff.runs() )
+    {
+        if ( run.fOp != COrderedDiff::eEqual )
+            continue;
+        for ( int ii = 0; ii < run.fLength; ++ii )
+        {
+            auto && curr = lhs.fChunks[ run.fLHSStart + ii + 1 ];
+            auto && other = rhs.fChunks[ run.fRHSStart + ii + 1 ];
+            if ( ( other.fHash2 != curr.fHash2 ) || ( other.fLength != curr.fLength ) )
+                continue;
+            lhsPaired[ run.fLHSStart + ii + 1 ] = true;
+            rhsPaired[ run.fRHSStart + ii + 1 ] = true;
+            anyPaired = true;
+            retVal += curr.fNumRows;
+            if ( skippedBytes )
+                *skippedBytes += 2 * curr.fLength;
+        }
+    }
+    if ( !anyPaired )
+        return 0;
+
+    auto toRanges = []( const std::vector< SChunk > & chunks, const std::vector< bool > & paired, bool wantPaired, TRanges & ranges )
+    {
+        for ( size_t ii = 0; ii < chunks.size(); ++ii )
+        {
+            if ( paired[ ii ] != wantPaired )
+                continue;
+            auto begin = chunks[ ii ].fOffset;
+            auto end = begin + chunks[ ii ].fLength;
+            if ( !ranges.empty() && ( ranges.back().second == begin ) )
+                ranges.back().second = end;
+            else
+                ranges.emplace_back( begin, end );
+        }
+    };
+    toRanges( lhs.fChunks, lhsPaired, false, lhsRanges );
+    toRanges( rhs.fChunks, rhsPaired, false, rhsRanges );
+    if ( sharedRanges )
+        toRanges( lhs.fChunks, lhsPaired, true, *sharedRanges );
+    return retVal;
+}
@@ -0,0 +1,74 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CHUNKFINGERPRINTS_H
+#define _CHUNKFINGERPRINTS_H
+
+#include "RowFilter.h"
+
+#include <QString>
+#include <atomic>
+#include <vector>
+
+// Splits a file into content defined chunks that always end on a line boundary, so an
+// edit only changes the chunks around it, and fingerprints each one. Two snapshots of the
+// same export then share most of their chunks, and only the others need to be parsed.
+class CChunkFingerprints
+{
+public:
+    struct SChunk
+    {
+        qint64 fOffset{ 0 };
+        qint64 fLength{ 0 };
+        quint64 fHash{ 0 };
+        quint64 fHash2{ 0 }; // second seed, 128 bits in all
+        int fNumRows{ 0 };   // data rows, without the blank lines and the rows the row filter ignores
+    };
+    using TRanges = std::vector< std::pair< qint64, qint64 > >; // [ begin, end ) byte offsets
+
+    static constexpr qint64 kMinChunkSize = 16 * 1024;
+    static constexpr qint64 kMaxChunkSize = 1024 * 1024;
+
+    bool compute( const QString & fileName, QString * errorMsg = nullptr, const std::atomic< bool > * canceled = nullptr );
+    void clear();
+    void setRowFilter( const CRowFilter & filter ) { fRowFilter = filter; }
+
+    bool isValid() const { return fValid; } // false for UTF-16 files, their bytes can not be cut at a newline
+    const std::vector< SChunk > & chunks() const { return fChunks; }
+
+    // Pairs up the chunks found in both files in the same order, the runs an ordered diff of the
+    // chunk hashes finds equal, so a moved or repeated chunk is left to be parsed. The first chunk
+    // holds the header and is never paired.
+    // Returns the number of data rows in the paired chunks, they are the same rows in both files.
+    // The ranges are the unpaired chunks still to be parsed, empty when nothing was paired, the
+    // shared ranges are the paired chunks of the LHS file.
+    static int match( const CChunkFingerprints & lhs, const CChunkFingerprints & rhs, TRanges & lhsRanges, TRanges & rhsRanges, qint64 * skippedBytes = nullptr, TRanges * sharedRanges = nullptr );
+private:
+    void addChunk( const QByteArray & data, qint64 offset, int numRows );
+
+    CRowFilter fRowFilter;
+    std::vector< SChunk > fChunks;
+    quint64 fHeaderHash{ 0 };
+    bool fValid{ false };
+};
+
+#endif
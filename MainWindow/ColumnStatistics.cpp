@@ -0,0 +1,235 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ColumnStatistics.h"
+#include "CSVTable.h"
+#include "KeyHash.h"
+#include "WorkStealingPool.h"
+
+#include <QJsonObject>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void CHyperLogLog::add( quint64 hash )
+{
+    auto index = hash >> ( 64 - kBits );
+    auto rest = hash << kBits;
+    auto rank = static_cast< quint8 >( rest ? ( qCountLeadingZeroBits( rest ) + 1 ) : ( 64 - kBits + 1 ) );
+    fRegisters[ index ] = std::max( fRegisters[ index ], rank );
+}
+
+void CHyperLogLog::merge( const CHyperLogLog & other )
+{
+    for ( size_t ii = 0; ii < fRegisters.size(); ++ii )
+        fRegisters[ ii ] = std::max( fRegisters[ ii ], other.fRegisters[ ii ] );
+}
+
+double CHyperLogLog::estimate() const
+{
+    const double numRegisters = fRegisters.size();
+    double sum = 0;
+    int numZero = 0;
+    for ( auto && ii : fRegisters )
+    {
+        sum += std::ldexp( 1.0, -ii );
+        if ( !ii )
+            numZero++;
+    }
+
+    auto alpha = 0.7213 / ( 1.0 + 1.079 / numRegisters );
+    auto retVal = alpha * numRegisters * numRegisters / sum;
+    if ( ( retVal <= 2.5 * numRegisters ) && numZero )
+        retVal = numRegisters * std::log( numRegisters / numZero ); // linear counting for the small range
+    return retVal;
+}
+
+void CCountMinSketch::clear()
+{
+    fCounters.fill( 0 );
+    fTop.clear();
+}
+
+void CCountMinSketch::add( quint64 hash, const QString & value )
+{
+    auto h1 = static_cast< quint32 >( hash );
+    auto h2 = static_cast< quint32 >( hash >> 32 ) | 1;
+    quint32 count = std::numeric_limits< quint32 >::max();
+    for ( int ii = 0; ii < kDepth; ++ii )
+    {
+        auto && counter = fCounters[ ii * kWidth + ( ( h1 + ii * h2 ) % kWidth ) ];
+        counter++;
+        count = std::min( count, counter );
+    }
+
+    // the heavy hitters only change when the value is already one, or beats the smallest
+    auto pos = std::find_if( fTop.begin(), fTop.end(), [ hash ]( const SHeavyHitter & ii ) { return ii.fHash == hash; } );
+    if ( pos != fTop.end() )
+    {
+        ( *pos ).fCount = count;
+        return;
+    }
+    if ( static_cast< int >( fTop.size() ) < kTopK )
+    {
+        fTop.push_back( { hash, value, count } );
+        return;
+    }
+    auto smallest = std::min_element( fTop.begin(), fTop.end(), []( const SHeavyHitter & lhs, const SHeavyHitter & rhs ) { return lhs.fCount < rhs.fCount; } );
+    if ( count > ( *smallest ).fCount )
+        *smallest = { hash, value, count };
+}
+
+quint32 CCountMinSketch::estimate( quint64 hash ) const
+{
+    auto h1 = static_cast< quint32 >( hash );
+    auto h2 = static_cast< quint32 >( hash >> 32 ) | 1;
+    quint32 retVal = std::numeric_limits< quint32 >::max();
+    for ( int ii = 0; ii < kDepth; ++ii )
+        retVal = std::min( retVal, fCounters[ ii * kWidth + ( ( h1 + ii * h2 ) % kWidth ) ] );
+    return retVal;
+}
+
+std::vector< std::pair< QString, quint32 > > CCountMinSketch::topValues() const
+{
+    std::vector< std::pair< QString, quint32 > > retVal;
+    for ( auto && ii : fTop )
+        retVal.emplace_back( ii.fValue, ii.fCount );
+    std::sort( retVal.begin(), retVal.end(), []( const std::pair< QString, quint32 > & lhs, const std::pair< QString, quint32 > & rhs ) { return lhs.second > rhs.second; } );
+    return retVal;
+}
+
+void SColumnSketch::clear()
+{
+    fNumValues = 0;
+    fNumEmpty = 0;
+    fDistinct.clear();
+    fCounts.clear();
+}
+
+void SColumnSketch::add( const QString & value )
+{
+    fNumValues++;
+    if ( value.isEmpty() )
+    {
+        fNumEmpty++;
+        return;
+    }
+
+    auto hash = NKeyHash::hash64( reinterpret_cast< const char * >( value.constData() ), value.length() * static_cast< qint64 >( sizeof( QChar ) ) );
+    fDistinct.add( hash );
+    fCounts.add( hash, value );
+}
+
+qint64 SColumnSketch::distinctEstimate() const
+{
+    if ( fNumValues == fNumEmpty )
+        return 0;
+    // never more than the values seen
+    return std::min( fNumValues - fNumEmpty, static_cast< qint64 >( std::llround( fDistinct.estimate() ) ) );
+}
+
+void CColumnStatistics::clear()
+{
+    fColumns.clear();
+    fSketches.clear();
+    fSkipped.clear();
+}
+
+void CColumnStatistics::setColumns( const QStringList & columns )
+{
+    fColumns = columns;
+    fSketches.clear();
+    fSketches.resize( columns.count() );
+    fSkipped.clear();
+}
+
+void CColumnStatistics::setSkippedColumns( const std::set< int > & cols )
+{
+    fSkipped = cols;
+}
+
+void CColumnStatistics::addRow( const QStringList & rowData )
+{
+    auto numColumns = std::min( rowData.count(), static_cast< int >( fSketches.size() ) );
+    for ( int ii = 0; ii < numColumns; ++ii )
+    {
+        if ( fSkipped.empty() || !isSkipped( ii ) )
+            fSketches[ ii ].add( rowData[ ii ] );
+    }
+}
+
+void CColumnStatistics::compute( const SCSVTable & table )
+{
+    setColumns( table.fHeader );
+
+    CWorkStealingPool::shared().parallelFor( columnCount(),
+                                             [ & ]( int col )
+                                             {
+                                                 auto && sketch = fSketches[ col ];
+                                                 for ( int row = 0; row < table.rowCount(); ++row )
+                                                     sketch.add( table.data( row, col ) );
+                                                 return true;
+                                             } );
+}
+
+QString CColumnStatistics::formatTopValues( const SColumnSketch & sketch, int maxValues )
+{
+    QStringList retVal;
+    for ( auto && ii : sketch.fCounts.topValues() )
+    {
+        if ( retVal.count() >= maxValues )
+            break;
+        retVal << QString( "%1 (%2)" ).arg( ii.first ).arg( ii.second );
+    }
+    return retVal.join( ", " );
+}
+
+QJsonArray CColumnStatistics::toJson( const std::map< QString, qint64 > & changedValues ) const
+{
+    QJsonArray retVal;
+    for ( int ii = 0; ii < columnCount(); ++ii )
+    {
+        auto && sketch = fSketches[ ii ];
+        QJsonObject curr;
+        curr[ "column" ] = fColumns[ ii ];
+        curr[ "rows" ] = sketch.fNumValues;
+        curr[ "empty" ] = sketch.fNumEmpty;
+        curr[ "distinctEstimate" ] = sketch.distinctEstimate();
+
+        QJsonArray topValues;
+        for ( auto && jj : sketch.fCounts.topValues() )
+        {
+            QJsonObject value;
+            value[ "value" ] = jj.first;
+            value[ "count" ] = static_cast< qint64 >( jj.second );
+            topValues.append( value );
+        }
+        curr[ "topValues" ] = topValues;
+
+        auto pos = changedValues.find( fColumns[ ii ] );
+        if ( pos != changedValues.end() )
+            curr[ "changedInMatchedRows" ] = ( *pos ).second;
+        retVal.append( curr );
+    }
+    return retVal;
+}
@@ -0,0 +1,114 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _COLUMNSTATISTICS_H
+#define _COLUMNSTATISTICS_H
+
+#include <QJsonArray>
+#include <QString>
+#include <QStringList>
+#include <array>
+#include <map>
+#include <set>
+#include <vector>
+
+struct SCSVTable;
+
+// Distinct count estimate, 4096 one byte registers
+class CHyperLogLog
+{
+public:
+    void clear() { fRegisters.fill( 0 ); }
+    void add( quint64 hash );
+    void merge( const CHyperLogLog & other ); // the union of the two value sets
+    double estimate() const;
+private:
+    static constexpr int kBits = 12;
+    std::array< quint8, 1 << kBits > fRegisters{};
+};
+
+// Count-min sketch, 4 rows of 1024 counters, with the K heaviest values seen so far
+class CCountMinSketch
+{
+public:
+    static constexpr int kTopK = 10;
+
+    void clear();
+    void add( quint64 hash, const QString & value );
+    quint32 estimate( quint64 hash ) const;
+
+    std::vector< std::pair< QString, quint32 > > topValues() const; // most frequent first
+private:
+    static constexpr int kDepth = 4;
+    static constexpr int kWidth = 1024;
+
+    struct SHeavyHitter
+    {
+        quint64 fHash{ 0 };
+        QString fValue;
+        quint32 fCount{ 0 };
+    };
+
+    std::array< quint32, kDepth * kWidth > fCounters{};
+    std::vector< SHeavyHitter > fTop;
+};
+
+// Fixed memory sketches of one column, filled in a single pass
+struct SColumnSketch
+{
+    void clear();
+    void add( const QString & value );
+
+    double emptyRate() const { return fNumValues ? ( static_cast< double >( fNumEmpty ) / fNumValues ) : 0.0; }
+    qint64 distinctEstimate() const;
+
+    qint64 fNumValues{ 0 };
+    qint64 fNumEmpty{ 0 };
+    CHyperLogLog fDistinct;
+    CCountMinSketch fCounts;
+};
+
+// Per column statistics of one file, either streamed a row at a time while it loads
+// or computed over a loaded SCSVTable with a thread per column
+class CColumnStatistics
+{
+public:
+    void clear();
+    void setColumns( const QStringList & columns );
+    void setSkippedColumns( const std::set< int > & cols ); // columns that were not parsed, they get no values
+    bool isSkipped( int col ) const { return fSkipped.find( col ) != fSkipped.end(); }
+    void addRow( const QStringList & rowData );
+    void compute( const SCSVTable & table );
+
+    int columnCount() const { return fColumns.count(); }
+    const QStringList & columns() const { return fColumns; }
+    const SColumnSketch & column( int col ) const { return fSketches[ col ]; }
+
+    QJsonArray toJson( const std::map< QString, qint64 > & changedValues = {} ) const;
+    static QString formatTopValues( const SColumnSketch & sketch, int maxValues = 5 );
+private:
+    QStringList fColumns;
+    std::vector< SColumnSketch > fSketches;
+    std::set< int > fSkipped;
+};
+
+#endif
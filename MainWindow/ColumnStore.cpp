@@ -0,0 +1,376 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ColumnStore.h"
+#include "MemoryAccounting.h"
+
+#include <QDataStream>
+#include <QTemporaryFile>
+
+CColumnStore::CColumnStore()
+{
+}
+
+CColumnStore::~CColumnStore()
+{
+}
+
+void CColumnStore::clear()
+{
+    fLRU.clear();
+    fColumns.clear();
+    fPinned.clear();
+    fLazy.clear();
+    fLazyLoader = {};
+    fTypes.clear();
+    fRowCount = 0;
+    fResidentBytes = 0;
+    fSpillFile.reset();
+    fSpillError.clear();
+}
+
+void CColumnStore::setColumnCount( int count )
+{
+    clear();
+    fColumns.resize( count );
+    fPinned.resize( count, false );
+    fLazy.resize( count, false );
+    fTypes.resize( count );
+}
+
+void CColumnStore::setColumnType( int col, const CColumnType & type )
+{
+    if ( ( col >= 0 ) && ( col < columnCount() ) )
+        fTypes[ col ] = type;
+}
+
+void CColumnStore::setLazyColumns( const std::set< int > & cols, const TLazyLoader & loader )
+{
+    for ( int ii = 0; ii < columnCount(); ++ii )
+        fLazy[ ii ] = cols.find( ii ) != cols.end();
+    fLazyLoader = loader;
+}
+
+qint64 CColumnStore::estimateBytes( const QString & str )
+{
+    // QString object plus the shared data header and the utf16 payload
+    return static_cast< qint64 >( sizeof( QString ) ) + ( str.isEmpty() ? 0 : ( 24 + ( str.length() + 1 ) * 2 ) );
+}
+
+void CColumnStore::addRow( const QStringList & rowData )
+{
+    auto inChunk = fRowCount % kChunkSize;
+    for ( int ii = 0; ii < columnCount(); ++ii )
+    {
+        if ( fLazy[ ii ] )
+            continue;
+
+        auto && column = fColumns[ ii ];
+        if ( inChunk == 0 )
+        {
+            auto newChunk = std::make_unique< SChunk >();
+            newChunk->fColumn = ii;
+            column.emplace_back( std::move( newChunk ) );
+        }
+
+        auto curr = column.back().get();
+        auto && value = ( ii < rowData.count() ) ? rowData[ ii ] : QString();
+        qint64 bytes = 0;
+        if ( fTypes[ ii ].isTyped() )
+        {
+            if ( inChunk == 0 )
+                curr->fValues.reserve( kChunkSize );
+            bool canonical = true;
+            curr->fValues.push_back( fTypes[ ii ].encode( value, &canonical ) );
+            bytes = static_cast< qint64 >( sizeof( qint64 ) );
+            if ( !canonical || ( curr->fValues.back() == CColumnType::kNotTyped ) )
+            {
+                curr->fText[ inChunk ] = value;
+                bytes += CMemoryAccounting::kNodeOverhead + estimateBytes( value );
+            }
+        }
+        else
+        {
+            if ( inChunk == 0 )
+                curr->fData.reserve( kChunkSize );
+            curr->fData.push_back( value );
+            bytes = estimateBytes( value );
+        }
+        curr->fBytes += bytes;
+        fResidentBytes += bytes;
+
+        if ( ( inChunk + 1 ) == kChunkSize )
+        {
+            curr->fFull = true;
+            touch( curr );
+        }
+    }
+    fRowCount++;
+
+    if ( ( fRowCount % kChunkSize ) == 0 )
+        enforceBudget();
+}
+
+CColumnStore::SChunk * CColumnStore::chunk( int row, int col ) const
+{
+    if ( ( row < 0 ) || ( row >= fRowCount ) || ( col < 0 ) || ( col >= columnCount() ) || fLazy[ col ] )
+        return nullptr;
+    return fColumns[ col ][ row / kChunkSize ].get();
+}
+
+QString CColumnStore::data( int row, int col ) const
+{
+    if ( isLazyColumn( col ) && ( row >= 0 ) && ( row < fRowCount ) )
+        return fLazyLoader ? fLazyLoader( row, col ) : QString();
+
+    bool pagedIn = false;
+    auto curr = residentChunk( row, col, pagedIn );
+    if ( !curr )
+        return {};
+
+    QString retVal;
+    auto inChunk = row % kChunkSize;
+    if ( fTypes[ col ].isTyped() )
+    {
+        auto pos = curr->fText.find( inChunk );
+        retVal = ( pos == curr->fText.end() ) ? fTypes[ col ].format( curr->fValues[ inChunk ] ) : ( *pos ).second;
+    }
+    else
+        retVal = curr->fData[ inChunk ];
+    if ( pagedIn )
+        enforceBudget();
+    return retVal;
+}
+
+qint64 CColumnStore::typedValue( int row, int col ) const
+{
+    if ( ( col < 0 ) || ( col >= columnCount() ) || !fTypes[ col ].isTyped() )
+        return CColumnType::kNotTyped;
+    bool pagedIn = false;
+    auto curr = residentChunk( row, col, pagedIn );
+    if ( !curr )
+        return CColumnType::kNotTyped;
+    auto retVal = curr->fValues[ row % kChunkSize ];
+    if ( pagedIn )
+        enforceBudget();
+    return retVal;
+}
+
+CColumnStore::SChunk * CColumnStore::residentChunk( int row, int col, bool & pagedIn ) const
+{
+    auto curr = chunk( row, col );
+    if ( !curr )
+        return nullptr;
+
+    pagedIn = !curr->fResident;
+    if ( pagedIn && !pageIn( curr ) )
+        return nullptr;
+    touch( curr );
+    return curr;
+}
+
+void CColumnStore::touch( SChunk * chunk ) const
+{
+    if ( !chunk->fFull || fPinned[ chunk->fColumn ] )
+        return;
+    if ( chunk->fInLRU )
+        fLRU.splice( fLRU.end(), fLRU, chunk->fLRUPos );
+    else
+    {
+        chunk->fLRUPos = fLRU.insert( fLRU.end(), chunk );
+        chunk->fInLRU = true;
+    }
+}
+
+void CColumnStore::setPinnedColumns( const std::set< int > & cols )
+{
+    for ( int ii = 0; ii < columnCount(); ++ii )
+    {
+        fPinned[ ii ] = cols.find( ii ) != cols.end();
+        for ( auto && jj : fColumns[ ii ] )
+        {
+            if ( fPinned[ ii ] )
+            {
+                if ( !jj->fResident )
+                    pageIn( jj.get() );
+                if ( jj->fInLRU )
+                {
+                    fLRU.erase( jj->fLRUPos );
+                    jj->fInLRU = false;
+                }
+            }
+            else
+                touch( jj.get() );
+        }
+    }
+    enforceBudget();
+}
+
+void CColumnStore::setMemoryBudget( qint64 bytes )
+{
+    fMemoryBudget = bytes;
+    enforceBudget();
+}
+
+int CColumnStore::numSpilledChunks() const
+{
+    int retVal = 0;
+    for ( auto && ii : fColumns )
+    {
+        for ( auto && jj : ii )
+        {
+            if ( !jj->fResident )
+                retVal++;
+        }
+    }
+    return retVal;
+}
+
+void CColumnStore::enforceBudget() const
+{
+    if ( fMemoryBudget <= 0 )
+        return;
+
+    // spill down to 90% so a scroll back and forth does not thrash on the boundary
+    auto target = fMemoryBudget - fMemoryBudget / 10;
+    while ( ( fResidentBytes > target ) && !fLRU.empty() )
+    {
+        auto victim = fLRU.front();
+        fLRU.pop_front();
+        victim->fInLRU = false;
+        if ( !spill( victim ) )
+            break;
+    }
+}
+
+bool CColumnStore::spill( SChunk * chunk ) const
+{
+    if ( chunk->fSpillPos == -1 )
+    {
+        if ( !fSpillFile )
+        {
+            fSpillFile = std::make_unique< QTemporaryFile >();
+            if ( !fSpillFile->open() )
+            {
+                fSpillFile.reset();
+                return false;
+            }
+        }
+
+        QByteArray buffer;
+        {
+            QDataStream ds( &buffer, QIODevice::WriteOnly );
+            if ( fTypes[ chunk->fColumn ].isTyped() )
+            {
+                ds << static_cast< quint32 >( chunk->fValues.size() );
+                for ( auto && ii : chunk->fValues )
+                    ds << ii;
+                ds << static_cast< quint32 >( chunk->fText.size() );
+                for ( auto && ii : chunk->fText )
+                    ds << static_cast< qint32 >( ii.first ) << ii.second;
+            }
+            else
+            {
+                ds << static_cast< quint32 >( chunk->fData.size() );
+                for ( auto && ii : chunk->fData )
+                    ds << ii;
+            }
+        }
+
+        // chunks are immutable once full, so a chunk is only written the first time it is spilled
+        auto pos = fSpillFile->size();
+        if ( !fSpillFile->seek( pos ) || ( fSpillFile->write( buffer ) != buffer.size() ) )
+            return false;
+        chunk->fSpillPos = pos;
+        chunk->fSpillSize = buffer.size();
+    }
+
+    std::vector< QString >().swap( chunk->fData );
+    std::vector< qint64 >().swap( chunk->fValues );
+    std::unordered_map< int, QString >().swap( chunk->fText );
+    chunk->fResident = false;
+    fResidentBytes -= chunk->fBytes;
+    return true;
+}
+
+bool CColumnStore::pageIn( SChunk * chunk ) const
+{
+    if ( chunk->fResident )
+        return true;
+
+    // read into locals, the chunk only changes once all of it came back
+    auto failed = [ this ]( const QString & msg )
+    {
+        fSpillError = QString( "Could not read back a spilled column chunk from '%1': %2" ).arg( fSpillFile ? fSpillFile->fileName() : QString() ).arg( msg );
+        return false;
+    };
+    if ( !fSpillFile )
+        return failed( "the spill file is gone" );
+    if ( !fSpillFile->seek( chunk->fSpillPos ) )
+        return failed( fSpillFile->errorString() );
+    auto buffer = fSpillFile->read( chunk->fSpillSize );
+    if ( buffer.size() != chunk->fSpillSize )
+        return failed( fSpillFile->errorString() );
+
+    // only full chunks are spilled
+    QDataStream ds( buffer );
+    quint32 count = 0;
+    ds >> count;
+    if ( ( ds.status() != QDataStream::Ok ) || ( count != static_cast< quint32 >( kChunkSize ) ) )
+        return failed( "bad chunk size" );
+
+    std::vector< QString > data;
+    std::vector< qint64 > values;
+    std::unordered_map< int, QString > text;
+    if ( fTypes[ chunk->fColumn ].isTyped() )
+    {
+        values.resize( count );
+        for ( auto && ii : values )
+            ds >> ii;
+        quint32 numText = 0;
+        ds >> numText;
+        for ( quint32 ii = 0; ( ii < numText ) && ( ds.status() == QDataStream::Ok ); ++ii )
+        {
+            qint32 pos = 0;
+            QString cellText;
+            ds >> pos >> cellText;
+            if ( ( pos < 0 ) || ( pos >= kChunkSize ) )
+                return failed( "bad cell position" );
+            text[ pos ] = cellText;
+        }
+    }
+    else
+    {
+        data.resize( count );
+        for ( auto && ii : data )
+            ds >> ii;
+    }
+    if ( ds.status() != QDataStream::Ok )
+        return failed( "truncated chunk" );
+
+    chunk->fData.swap( data );
+    chunk->fValues.swap( values );
+    chunk->fText.swap( text );
+    chunk->fResident = true;
+    fResidentBytes += chunk->fBytes;
+    return true;
+}
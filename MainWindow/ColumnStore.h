@@ -0,0 +1,113 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _COLUMNSTORE_H
+#define _COLUMNSTORE_H
+
+#include "ColumnType.h"
+
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include <list>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+class QTemporaryFile;
+
+// Cell storage for one file, kept as fixed size chunks per column.
+// When a memory budget is set, the least recently used chunks of unpinned columns
+// are written to a temporary file and read back when they are next accessed.
+// Lazy columns hold no cells at all, their values come from a loader when asked for.
+// Typed columns hold 8 byte values, plus the text of the few cells not in canonical form
+class CColumnStore
+{
+public:
+    static const int kChunkSize = 4096;
+
+    CColumnStore();
+    ~CColumnStore();
+
+    void clear();
+    void setColumnCount( int count );
+    int columnCount() const { return static_cast< int >( fColumns.size() ); }
+    int rowCount() const { return fRowCount; }
+
+    void addRow( const QStringList & rowData );
+    QString data( int row, int col ) const;
+
+    using TLazyLoader = std::function< QString( int row, int col ) >;
+    void setLazyColumns( const std::set< int > & cols, const TLazyLoader & loader ); // before any rows are added
+    bool isLazyColumn( int col ) const { return ( col >= 0 ) && ( col < columnCount() ) && fLazy[ col ]; }
+
+    void setColumnType( int col, const CColumnType & type ); // before any rows are added
+    const CColumnType & columnType( int col ) const { return fTypes[ col ]; }
+    qint64 typedValue( int row, int col ) const; // CColumnType::kNotTyped for a text column
+
+    void setPinnedColumns( const std::set< int > & cols ); // the key and extra columns, never spilled
+    void setMemoryBudget( qint64 bytes );                   // 0 for no limit
+    qint64 memoryBudget() const { return fMemoryBudget; }
+    qint64 residentBytes() const { return fResidentBytes; }
+    int numSpilledChunks() const;
+    const QString & spillError() const { return fSpillError; } // the last spilled chunk that could not be read back, its cells read as empty
+private:
+    struct SChunk;
+    using TLRUList = std::list< SChunk * >;
+    struct SChunk
+    {
+        int fColumn{ 0 };
+        std::vector< QString > fData;
+        std::vector< qint64 > fValues;                // typed columns only
+        std::unordered_map< int, QString > fText;     // typed cells whose text is not the value's canonical form
+        bool fResident{ true };
+        bool fFull{ false };
+        qint64 fBytes{ 0 };
+        qint64 fSpillPos{ -1 };
+        qint64 fSpillSize{ 0 };
+        TLRUList::iterator fLRUPos;
+        bool fInLRU{ false };
+    };
+
+    static qint64 estimateBytes( const QString & str );
+    SChunk * chunk( int row, int col ) const;
+    SChunk * residentChunk( int row, int col, bool & pagedIn ) const;
+    void touch( SChunk * chunk ) const;
+    bool pageIn( SChunk * chunk ) const; // false leaves the chunk spilled
+    bool spill( SChunk * chunk ) const;
+    void enforceBudget() const;
+
+    std::vector< std::vector< std::unique_ptr< SChunk > > > fColumns;
+    std::vector< bool > fPinned;
+    std::vector< bool > fLazy;
+    std::vector< CColumnType > fTypes;
+    TLazyLoader fLazyLoader;
+    int fRowCount{ 0 };
+    qint64 fMemoryBudget{ 0 };
+    mutable qint64 fResidentBytes{ 0 };
+    mutable TLRUList fLRU; // front is the least recently used, only full chunks of unpinned columns
+    mutable std::unique_ptr< QTemporaryFile > fSpillFile;
+    mutable QString fSpillError;
+};
+
+#endif
@@ -0,0 +1,429 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ColumnType.h"
+
+#include <QLocale>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    const int kMaxDigits = 18;
+    const qint64 kMSecsPerDay = 86400000;
+    const char * const kDateFormats[] = { "yyyy-MM-dd", "yyyy-MM-dd HH:mm:ss", "yyyy-MM-ddTHH:mm:ss", "yyyy/MM/dd", "MM/dd/yyyy", "MM/dd/yyyy HH:mm:ss" };
+    const int kNumDateFormats = static_cast< int >( sizeof( kDateFormats ) / sizeof( kDateFormats[ 0 ] ) );
+
+    qint64 pow10( int exp )
+    {
+        qint64 retVal = 1;
+        while ( exp-- > 0 )
+            retVal *= 10;
+        return retVal;
+    }
+
+    bool isDigit( QChar ch )
+    {
+        return ( ch >= '0' ) && ( ch <= '9' );
+    }
+
+    // days since 1970-01-01 in the proleptic Gregorian calendar
+    qint64 daysFromCivil( qint64 year, int month, int day )
+    {
+        year -= ( month <= 2 ) ? 1 : 0;
+        auto era = ( ( year >= 0 ) ? year : ( year - 399 ) ) / 400;
+        auto yearOfEra = year - era * 400;
+        auto dayOfYear = ( 153 * ( month + ( ( month > 2 ) ? -3 : 9 ) ) + 2 ) / 5 + day - 1;
+        auto dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + dayOfEra - 719468;
+    }
+
+    void civilFromDays( qint64 days, qint64 & year, int & month, int & day )
+    {
+        days += 719468;
+        auto era = ( ( days >= 0 ) ? days : ( days - 146096 ) ) / 146097;
+        auto dayOfEra = days - era * 146097;
+        auto yearOfEra = ( dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096 ) / 365;
+        auto dayOfYear = dayOfEra - ( 365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100 );
+        auto monthIndex = ( 5 * dayOfYear + 2 ) / 153;
+        day = static_cast< int >( dayOfYear - ( 153 * monthIndex + 2 ) / 5 + 1 );
+        month = static_cast< int >( monthIndex + ( ( monthIndex < 10 ) ? 3 : -9 ) );
+        year = yearOfEra + era * 400 + ( ( month <= 2 ) ? 1 : 0 );
+    }
+
+    int daysInMonth( qint64 year, int month )
+    {
+        static const int kDays[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+        auto leap = ( ( year % 4 ) == 0 ) && ( ( ( year % 100 ) != 0 ) || ( ( year % 400 ) == 0 ) );
+        return ( ( month == 2 ) && leap ) ? 29 : kDays[ month - 1 ];
+    }
+
+    // a double's bits, flipped so they sort as a signed integer
+    qint64 orderedBits( double value )
+    {
+        qint64 bits;
+        std::memcpy( &bits, &value, sizeof( bits ) );
+        return bits ^ ( ( bits >> 63 ) & std::numeric_limits< qint64 >::max() );
+    }
+
+    double fromOrderedBits( qint64 bits )
+    {
+        bits ^= ( bits >> 63 ) & std::numeric_limits< qint64 >::max();
+        double retVal;
+        std::memcpy( &retVal, &bits, sizeof( retVal ) );
+        return retVal;
+    }
+}
+
+CColumnType::CColumnType( EType type, int scale, int dateFormat, int width ) :
+    fType( type ),
+    fScale( ( type == EType::eDecimal ) ? scale : 0 ),
+    fDateFormat( ( type == EType::eDateTime ) ? dateFormat : -1 ),
+    fWidth( ( type == EType::eInt64 ) ? width : 0 )
+{
+}
+
+QString CColumnType::name() const
+{
+    switch ( fType )
+    {
+        case EType::eInt64:
+            return fWidth ? QString( "integer (%1 digits)" ).arg( fWidth ) : QString( "integer" );
+        case EType::eDecimal:
+            return QString( "decimal (%1 places)" ).arg( fScale );
+        case EType::eDouble:
+            return QString( "double" );
+        case EType::eDateTime:
+            return QString( "date/time (%1)" ).arg( kDateFormats[ fDateFormat ] );
+        case EType::eText:
+        default:
+            return QString( "text" );
+    }
+}
+
+CColumnType CColumnType::infer( const std::vector< QString > & sample )
+{
+    std::vector< const QString * > values;
+    int scale = 0;
+    int length = -1;
+    int numPadded = 0;
+    for ( auto && ii : sample )
+    {
+        if ( ii.isEmpty() )
+            continue;
+        values.push_back( &ii );
+
+        auto point = ii.indexOf( '.' );
+        if ( point >= 0 )
+            scale = std::max( scale, ii.length() - point - 1 );
+        numPadded += ( ( ii.length() > 1 ) && ( ii[ 0 ] == '0' ) && isDigit( ii[ 1 ] ) ) ? 1 : 0;
+        length = ( ( length == -1 ) || ( length == ii.length() ) ) ? ii.length() : -2;
+    }
+    if ( values.empty() )
+        return {};
+
+    // a few values that do not parse are kept as text, as are the ones not in the canonical
+    // form, but a column mostly not in that form is smaller as text to begin with
+    auto maxFailures = values.size() / 100;
+    auto maxNonCanonical = values.size() / 4;
+    auto fits = [ & ]( const CColumnType & type )
+    {
+        size_t failures = 0;
+        size_t nonCanonical = 0;
+        for ( auto && ii : values )
+        {
+            bool canonical = false;
+            if ( ( type.encode( *ii, &canonical ) == kNotTyped ) && ( ++failures > maxFailures ) )
+                return false;
+            if ( !canonical && ( ++nonCanonical > maxNonCanonical ) )
+                return false;
+        }
+        return true;
+    };
+
+    // zero padded ids keep their width, so they are stored without their text
+    if ( ( length > 0 ) && ( numPadded * 2 >= static_cast< int >( values.size() ) ) && fits( CColumnType( EType::eInt64, 0, -1, length ) ) )
+        return CColumnType( EType::eInt64, 0, -1, length );
+    if ( fits( CColumnType( EType::eInt64 ) ) )
+        return CColumnType( EType::eInt64 );
+    if ( ( scale > 0 ) && ( scale <= kMaxScale ) && fits( CColumnType( EType::eDecimal, scale ) ) )
+        return CColumnType( EType::eDecimal, scale );
+    for ( int ii = 0; ii < kNumDateFormats; ++ii )
+    {
+        if ( fits( CColumnType( EType::eDateTime, 0, ii ) ) )
+            return CColumnType( EType::eDateTime, 0, ii );
+    }
+    if ( fits( CColumnType( EType::eDouble ) ) )
+        return CColumnType( EType::eDouble );
+    return {};
+}
+
+CColumnType CColumnType::common( const CColumnType & lhs, const CColumnType & rhs )
+{
+    auto isNumber = []( const CColumnType & type ) { return ( type.fType == EType::eInt64 ) || ( type.fType == EType::eDecimal ); };
+    if ( isNumber( lhs ) && isNumber( rhs ) )
+    {
+        if ( ( lhs.fType == EType::eInt64 ) && ( rhs.fType == EType::eInt64 ) )
+            return CColumnType( EType::eInt64, 0, -1, ( lhs.fWidth == rhs.fWidth ) ? lhs.fWidth : 0 );
+        return CColumnType( EType::eDecimal, std::max( lhs.fScale, rhs.fScale ) );
+    }
+    // dates compare by their time whatever the format, the LHS format reads the merged values
+    if ( ( lhs.fType == rhs.fType ) && lhs.isTyped() )
+        return lhs;
+    return {};
+}
+
+qint64 CColumnType::encode( const QString & text, bool * canonical ) const
+{
+    if ( canonical )
+        *canonical = true;
+    if ( text.isEmpty() )
+        return kEmpty;
+
+    switch ( fType )
+    {
+        case EType::eInt64:
+        case EType::eDecimal:
+            return encodeInt( text, canonical );
+        case EType::eDouble:
+            return encodeDouble( text, canonical );
+        case EType::eDateTime:
+            return encodeDate( text );
+        case EType::eText:
+        default:
+            return kNotTyped;
+    }
+}
+
+qint64 CColumnType::encodeInt( const QString & text, bool * canonical ) const
+{
+    auto data = text.constData();
+    auto len = text.length();
+    int pos = 0;
+    bool negative = false;
+    bool isCanonical = true;
+    if ( ( data[ pos ] == '-' ) || ( data[ pos ] == '+' ) )
+    {
+        negative = data[ pos ] == '-';
+        isCanonical = negative;
+        ++pos;
+    }
+
+    qint64 value = 0;
+    auto intStart = pos;
+    for ( ; ( pos < len ) && isDigit( data[ pos ] ); ++pos )
+        value = value * 10 + ( data[ pos ].unicode() - '0' );
+    auto intDigits = pos - intStart;
+    if ( ( intDigits + fScale ) > kMaxDigits )
+        return kNotTyped;
+
+    int fracDigits = 0;
+    if ( ( pos < len ) && ( data[ pos ] == '.' ) && ( fScale > 0 ) )
+    {
+        for ( ++pos; ( pos < len ) && isDigit( data[ pos ] ); ++pos )
+        {
+            if ( ++fracDigits > fScale )
+                return kNotTyped;
+            value = value * 10 + ( data[ pos ].unicode() - '0' );
+        }
+        isCanonical = isCanonical && ( fracDigits == fScale );
+    }
+    else
+        isCanonical = isCanonical && ( fScale == 0 );
+    if ( ( pos != len ) || ( ( intDigits + fracDigits ) == 0 ) )
+        return kNotTyped;
+    value *= pow10( fScale - fracDigits );
+
+    if ( fWidth )
+        isCanonical = isCanonical && !negative && ( intDigits == fWidth );
+    else
+        isCanonical = isCanonical && ( intDigits >= 1 ) && ( ( intDigits == 1 ) || ( data[ intStart ] != '0' ) ) && !( negative && ( value == 0 ) );
+    if ( canonical )
+        *canonical = isCanonical;
+    return negative ? -value : value;
+}
+
+qint64 CColumnType::encodeDouble( const QString & text, bool * canonical ) const
+{
+    bool aOK = false;
+    auto value = text.toDouble( &aOK );
+    if ( !aOK || !std::isfinite( value ) )
+        return kNotTyped;
+    if ( value == 0 )
+        value = 0; // -0 is 0
+
+    auto retVal = orderedBits( value );
+    if ( canonical )
+        *canonical = format( retVal ) == text;
+    return retVal;
+}
+
+qint64 CColumnType::encodeDate( const QString & text ) const
+{
+    // every field is fixed width, so the text is canonical whenever it parses
+    const char * pattern = kDateFormats[ fDateFormat ];
+    auto len = static_cast< int >( std::strlen( pattern ) );
+    if ( text.length() != len )
+        return kNotTyped;
+
+    auto data = text.constData();
+    qint64 year = 1970;
+    int fields[ 5 ] = { 1, 1, 0, 0, 0 }; // month, day, hour, minute, second
+    for ( int pos = 0; pos < len; )
+    {
+        auto readDigits = [ & ]( int count, qint64 & out )
+        {
+            out = 0;
+            for ( int ii = 0; ii < count; ++ii )
+            {
+                if ( !isDigit( data[ pos + ii ] ) )
+                    return false;
+                out = out * 10 + ( data[ pos + ii ].unicode() - '0' );
+            }
+            pos += count;
+            return true;
+        };
+
+        qint64 value = 0;
+        if ( std::strncmp( pattern + pos, "yyyy", 4 ) == 0 )
+        {
+            if ( !readDigits( 4, year ) )
+                return kNotTyped;
+            continue;
+        }
+
+        static const char * const kFields[] = { "MM", "dd", "HH", "mm", "ss" };
+        int field = 0;
+        while ( ( field < 5 ) && ( std::strncmp( pattern + pos, kFields[ field ], 2 ) != 0 ) )
+            ++field;
+        if ( field < 5 )
+        {
+            if ( !readDigits( 2, value ) )
+                return kNotTyped;
+            fields[ field ] = static_cast< int >( value );
+            continue;
+        }
+        if ( data[ pos ] != pattern[ pos ] )
+            return kNotTyped;
+        ++pos;
+    }
+
+    auto month = fields[ 0 ];
+    auto day = fields[ 1 ];
+    if ( ( month < 1 ) || ( month > 12 ) || ( day < 1 ) || ( day > daysInMonth( year, month ) ) || ( fields[ 2 ] > 23 ) || ( fields[ 3 ] > 59 ) || ( fields[ 4 ] > 59 ) )
+        return kNotTyped;
+    return daysFromCivil( year, month, day ) * kMSecsPerDay + ( fields[ 2 ] * 3600 + fields[ 3 ] * 60 + fields[ 4 ] ) * 1000LL;
+}
+
+QString CColumnType::format( qint64 value ) const
+{
+    if ( value == kEmpty )
+        return {};
+    if ( !isTypedValue( value ) )
+        return {};
+
+    switch ( fType )
+    {
+        case EType::eInt64:
+            if ( fWidth && ( value >= 0 ) )
+                return QString::number( value ).rightJustified( fWidth, '0' );
+            return QString::number( value );
+        case EType::eDecimal:
+        {
+            auto divisor = pow10( fScale );
+            auto magnitude = ( value < 0 ) ? -value : value;
+            return QString( "%1%2.%3" ).arg( ( value < 0 ) ? QString( "-" ) : QString() ).arg( magnitude / divisor ).arg( magnitude % divisor, fScale, 10, QChar( '0' ) );
+        }
+        case EType::eDouble:
+            return QString::number( fromOrderedBits( value ), 'g', QLocale::FloatingPointShortest );
+        case EType::eDateTime:
+        {
+            auto days = value / kMSecsPerDay;
+            auto msecs = value % kMSecsPerDay;
+            if ( msecs < 0 )
+            {
+                days--;
+                msecs += kMSecsPerDay;
+            }
+            qint64 year = 0;
+            int month = 0;
+            int day = 0;
+            civilFromDays( days, year, month, day );
+            auto secs = static_cast< int >( msecs / 1000 );
+
+            QString retVal;
+            const char * pattern = kDateFormats[ fDateFormat ];
+            for ( auto pos = pattern; *pos; )
+            {
+                auto field = [ & ]( const char * name, qint64 fieldValue, int width )
+                {
+                    if ( std::strncmp( pos, name, width ) != 0 )
+                        return false;
+                    retVal += QString( "%1" ).arg( fieldValue, width, 10, QChar( '0' ) );
+                    pos += width;
+                    return true;
+                };
+                if ( field( "yyyy", year, 4 ) || field( "MM", month, 2 ) || field( "dd", day, 2 ) || field( "HH", secs / 3600, 2 ) || field( "mm", ( secs / 60 ) % 60, 2 ) || field( "ss", secs % 60, 2 ) )
+                    continue;
+                retVal += QChar( *pos++ );
+            }
+            return retVal;
+        }
+        case EType::eText:
+        default:
+            return {};
+    }
+}
+
+QString CColumnType::keyText( const QString & text ) const
+{
+    auto value = encode( text );
+    return ( value == kNotTyped ) ? text : keyText( value );
+}
+
+QString CColumnType::keyText( qint64 value ) const
+{
+    if ( !isTypedValue( value ) )
+        return format( value );
+
+    switch ( fType )
+    {
+        case EType::eInt64:
+            return QString::number( value );
+        case EType::eDecimal:
+        {
+            // the places differ between files, so the trailing zeros go
+            auto retVal = format( value );
+            while ( retVal.endsWith( '0' ) )
+                retVal.chop( 1 );
+            if ( retVal.endsWith( '.' ) )
+                retVal.chop( 1 );
+            return ( retVal == "-0" ) ? QString( "0" ) : retVal;
+        }
+        case EType::eDateTime:
+            return QString::number( value );
+        case EType::eDouble:
+        case EType::eText:
+        default:
+            return format( value );
+    }
+}
@@ -0,0 +1,81 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _COLUMNTYPE_H
+#define _COLUMNTYPE_H
+
+#include <QString>
+#include <limits>
+#include <vector>
+
+// The type of a column, inferred from a sample of its values. A typed value is kept as
+// 8 bytes that compare in the type's order as plain integers: integers as they are,
+// decimals scaled to the column's places, doubles as ordered bits and date/times as
+// msecs since the epoch. Text that is not in the canonical form of its value is kept
+// beside it by the caller, so nothing shown ever changes
+class CColumnType
+{
+public:
+    enum class EType
+    {
+        eText,
+        eInt64,
+        eDecimal,
+        eDouble,
+        eDateTime
+    };
+    static constexpr qint64 kEmpty = std::numeric_limits< qint64 >::min();
+    static constexpr qint64 kNotTyped = std::numeric_limits< qint64 >::min() + 1; // a value the type can not hold
+    static constexpr int kSampleRows = 1000;
+    static constexpr int kMaxScale = 9;
+
+    CColumnType() {}
+    CColumnType( EType type, int scale = 0, int dateFormat = -1, int width = 0 );
+
+    static CColumnType infer( const std::vector< QString > & sample ); // text unless nearly every non empty value parses
+    static CColumnType common( const CColumnType & lhs, const CColumnType & rhs ); // the type both can be compared in, text when there is none
+
+    EType type() const { return fType; }
+    bool isTyped() const { return fType != EType::eText; }
+    int scale() const { return fScale; }
+    int width() const { return fWidth; }
+    QString name() const;
+    bool operator==( const CColumnType & rhs ) const { return ( fType == rhs.fType ) && ( fScale == rhs.fScale ) && ( fDateFormat == rhs.fDateFormat ) && ( fWidth == rhs.fWidth ); }
+    bool operator!=( const CColumnType & rhs ) const { return !operator==( rhs ); }
+
+    qint64 encode( const QString & text, bool * canonical = nullptr ) const; // kEmpty, kNotTyped or the value; canonical when format gives the text back
+    QString format( qint64 value ) const;
+    QString keyText( qint64 value ) const; // equal for equal values of any two types common() finds
+    QString keyText( const QString & text ) const; // of the encoded text, the text itself when the type can not hold it
+private:
+    static bool isTypedValue( qint64 value ) { return ( value != kEmpty ) && ( value != kNotTyped ); }
+    qint64 encodeInt( const QString & text, bool * canonical ) const;
+    qint64 encodeDouble( const QString & text, bool * canonical ) const;
+    qint64 encodeDate( const QString & text ) const;
+
+    EType fType{ EType::eText };
+    int fScale{ 0 };
+    int fDateFormat{ -1 }; // into the supported date formats
+    int fWidth{ 0 };       // integers zero padded to this many digits, 0 for none
+};
+
+#endif
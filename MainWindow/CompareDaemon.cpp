@@ -0,0 +1,277 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "CompareDaemon.h"
+#include "WorkStealingPool.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QTemporaryFile>
+
+namespace
+{
+    QByteArray toLine( const QJsonObject & obj )
+    {
+        return QJsonDocument( obj ).toJson( QJsonDocument::Compact ) + "\n";
+    }
+
+    QJsonObject errorReply( const QJsonValue & id, const QString & msg )
+    {
+        QJsonObject retVal;
+        retVal[ "id" ] = id;
+        retVal[ "status" ] = "error";
+        retVal[ "error" ] = msg;
+        return retVal;
+    }
+}
+
+CCompareDaemon::CCompareDaemon()
+{
+}
+
+CCompareDaemon::~CCompareDaemon()
+{
+    fPool.reset();
+}
+
+QString CCompareDaemon::serverName() const
+{
+    return fServer ? fServer->fullServerName() : QString();
+}
+
+bool CCompareDaemon::start( const QString & referenceFile, const QString & serverName, QString * errorMsg )
+{
+    if ( !fReference.load( referenceFile, errorMsg ) )
+        return false;
+
+    QDir().mkpath( fOutputDir );
+    fPool = std::make_unique< CWorkStealingPool >( fNumThreads );
+
+    fServer = std::make_unique< QLocalServer >();
+    fServer->setSocketOptions( QLocalServer::UserAccessOption );
+    QLocalServer::removeServer( serverName ); // left behind by a daemon that did not shut down cleanly
+    if ( !fServer->listen( serverName ) )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Could not listen on '%1': %2" ).arg( serverName ).arg( fServer->errorString() );
+        return false;
+    }
+    QObject::connect( fServer.get(), &QLocalServer::newConnection, [ this ]() { newConnection(); } );
+    return true;
+}
+
+void CCompareDaemon::newConnection()
+{
+    while ( auto socket = fServer->nextPendingConnection() )
+    {
+        QObject::connect( socket, &QLocalSocket::readyRead, socket, [ this, socket ]() { readRequests( socket ); } );
+        QObject::connect( socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater );
+    }
+}
+
+void CCompareDaemon::readRequests( QLocalSocket * socket )
+{
+    while ( socket->canReadLine() )
+    {
+        auto line = socket->readLine().trimmed();
+        if ( line.isEmpty() )
+            continue;
+
+        QJsonParseError parseError;
+        auto doc = QJsonDocument::fromJson( line, &parseError );
+        if ( !doc.isObject() )
+        {
+            socket->write( toLine( errorReply( QJsonValue(), QString( "Invalid request: %1" ).arg( parseError.errorString() ) ) ) );
+            continue;
+        }
+
+        auto request = doc.object();
+        if ( request[ "command" ].toString() == "quit" )
+        {
+            QJsonObject reply;
+            reply[ "id" ] = request[ "id" ];
+            reply[ "status" ] = "ok";
+            socket->write( toLine( reply ) );
+            socket->flush();
+            QCoreApplication::quit();
+            return;
+        }
+
+        // the reply is written back on the socket's thread, the socket may be gone by then
+        QPointer< QLocalSocket > replyTo( socket );
+        fPool->submit( [ this, request, replyTo ]()
+                       {
+                           auto reply = process( request );
+                           QMetaObject::invokeMethod( qApp, [ replyTo, reply ]()
+                                                      {
+                                                          if ( replyTo )
+                                                              replyTo->write( toLine( reply ) );
+                                                      }, Qt::QueuedConnection );
+                       } );
+    }
+}
+
+std::shared_ptr< const CCompareDaemon::SReferenceIndex > CCompareDaemon::referenceIndex( const SCSVTable & rhs, QStringList & keyColumns )
+{
+    std::vector< int > keyCols;
+    std::vector< int > rhsKeyCols;
+    keyColumns = CTableCompare::findKeyColumns( fReference, rhs, &keyCols, &rhsKeyCols );
+    if ( keyColumns.isEmpty() )
+        return {};
+
+    // the reference keys typed columns by value only when the request holds them typed too
+    auto keyTypes = CTableCompare::keyTypes( fReference, keyCols, rhs, rhsKeyCols );
+    auto indexName = keyColumns.join( QChar( 0x1f ) ) + QChar( 0x1e );
+    for ( auto && ii : keyTypes )
+        indexName += QChar( ii.isTyped() ? '1' : '0' );
+
+    // requests for other key columns are not held up by the build, the ones for the same columns wait on its future
+    std::promise< std::shared_ptr< const SReferenceIndex > > built;
+    TIndexFuture retVal;
+    bool buildIt = false;
+    {
+        std::lock_guard< std::mutex > lock( fIndexMutex );
+        auto && pos = fIndexes[ indexName ];
+        if ( !pos.valid() )
+        {
+            pos = built.get_future().share();
+            buildIt = true;
+        }
+        retVal = pos;
+    }
+
+    if ( buildIt )
+    {
+        auto index = std::make_shared< SReferenceIndex >();
+        index->fKeyCols = keyCols;
+        CTableCompare::buildKeyIndex( fReference, keyCols, fNormalizer.columnOptions( keyColumns ), index->fIndex, nullptr, keyTypes );
+        built.set_value( index );
+    }
+    return retVal.get();
+}
+
+QJsonObject CCompareDaemon::process( const QJsonObject & request )
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    auto id = request[ "id" ];
+    auto requestNum = ++fNumRequests;
+
+    QString fileName;
+    QString name;
+    QTemporaryFile body;
+    if ( request.contains( "file" ) )
+    {
+        fileName = request[ "file" ].toString();
+        name = QFileInfo( fileName ).completeBaseName();
+        if ( name.isEmpty() )
+            name = QString( "request-%1" ).arg( requestNum );
+    }
+    else if ( request.contains( "csv" ) )
+    {
+        if ( !body.open() )
+            return errorReply( id, QString( "Could not create a temporary file: %1" ).arg( body.errorString() ) );
+        body.write( request[ "csv" ].toString().toUtf8() );
+        body.close();
+        fileName = body.fileName();
+        name = QFileInfo( request[ "name" ].toString() ).fileName();
+        if ( name.isEmpty() )
+            name = QString( "request-%1" ).arg( requestNum );
+    }
+    else
+        return errorReply( id, "The request needs a \"file\" or a \"csv\" body" );
+
+    SCSVTable rhs;
+    rhs.fRowFilter = fRowFilter;
+    QString msg;
+    if ( !rhs.load( fileName, &msg ) )
+        return errorReply( id, msg );
+
+    QStringList keyColumns;
+    auto index = referenceIndex( rhs, keyColumns );
+    if ( !index )
+        return errorReply( id, "The files do not share any columns" );
+
+    CTableCompare compare;
+    compare.setKeyNormalizer( fNormalizer );
+    if ( !compare.compare( fReference, index->fIndex, rhs ) )
+        return errorReply( id, "The files do not share any columns" );
+
+    // never outside the output directory, whatever the client sent
+    auto resultName = QFileInfo( request[ "output" ].toString() ).fileName();
+    if ( resultName.isEmpty() || ( resultName == "." ) || ( resultName == ".." ) )
+        resultName = QString( "%1.%2.merged.csv" ).arg( name ).arg( requestNum );
+    auto resultFile = QDir( fOutputDir ).absoluteFilePath( resultName );
+    if ( !compare.save( resultFile, &msg ) )
+        return errorReply( id, msg );
+
+    QJsonObject retVal;
+    retVal[ "id" ] = id;
+    retVal[ "status" ] = "ok";
+    retVal[ "name" ] = name;
+    retVal[ "lhsRows" ] = fReference.rowCount();
+    retVal[ "rhsRows" ] = rhs.rowCount();
+    retVal[ "matched" ] = compare.numMatched();
+    retVal[ "lhsOnly" ] = compare.numLHSOnly();
+    retVal[ "rhsOnly" ] = compare.numRHSOnly();
+    retVal[ "mergedRows" ] = compare.rowCount();
+    retVal[ "keyColumns" ] = QJsonArray::fromStringList( keyColumns );
+    retVal[ "timeMS" ] = timer.elapsed();
+    retVal[ "result" ] = resultFile;
+    return retVal;
+}
+
+bool CCompareDaemon::submit( const QString & serverName, const QJsonObject & request, QJsonObject & reply, QString * errorMsg, int timeoutMS )
+{
+    QLocalSocket socket;
+    socket.connectToServer( serverName );
+    if ( !socket.waitForConnected( 5000 ) )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Could not connect to '%1': %2" ).arg( serverName ).arg( socket.errorString() );
+        return false;
+    }
+
+    socket.write( toLine( request ) );
+    socket.flush();
+    while ( !socket.canReadLine() )
+    {
+        if ( !socket.waitForReadyRead( timeoutMS ) )
+        {
+            if ( errorMsg )
+                *errorMsg = QString( "No reply from '%1': %2" ).arg( serverName ).arg( socket.errorString() );
+            return false;
+        }
+    }
+
+    auto doc = QJsonDocument::fromJson( socket.readLine().trimmed() );
+    reply = doc.object();
+    return reply[ "status" ].toString() == "ok";
+}
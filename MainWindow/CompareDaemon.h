@@ -0,0 +1,94 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _COMPAREDAEMON_H
+#define _COMPAREDAEMON_H
+
+#include "CSVTable.h"
+#include "KeyNormalizer.h"
+#include "TableCompare.h"
+
+#include <QJsonObject>
+#include <QString>
+#include <atomic>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+
+class QLocalServer;
+class QLocalSocket;
+class CWorkStealingPool;
+
+// Keeps one reference file loaded and compares the files sent to it over a QLocalServer socket,
+// the reference is parsed once and its key index is built once per set of shared key columns.
+// Requests and replies are one JSON object per line:
+//     {"id":"1","file":"/data/new.csv","output":"new.merged.csv"}  output is optional
+//     {"id":"2","name":"feed","csv":"a,b\n1,2\n"}                   the CSV body inline
+//     {"command":"quit"}
+// Results are only written to the output directory, output and name are reduced to a file name
+// there and the request number is added to the default name so concurrent requests never share a file
+class CCompareDaemon
+{
+public:
+    CCompareDaemon();
+    ~CCompareDaemon();
+
+    void setOutputDir( const QString & dir ) { fOutputDir = dir; }
+    void setNumThreads( int numThreads ) { fNumThreads = numThreads; }
+    void setKeyNormalizer( const CKeyNormalizer & normalizer ) { fNormalizer = normalizer; }
+    void setRowFilter( const CRowFilter & filter ) { fReference.fRowFilter = filter; fRowFilter = filter; }
+
+    bool start( const QString & referenceFile, const QString & serverName, QString * errorMsg );
+    QString serverName() const;
+
+    QJsonObject process( const QJsonObject & request ); // thread safe, runs on the pool
+
+    // client side, sends one request and waits for its reply
+    static bool submit( const QString & serverName, const QJsonObject & request, QJsonObject & reply, QString * errorMsg, int timeoutMS = -1 );
+private:
+    struct SReferenceIndex
+    {
+        std::vector< int > fKeyCols;
+        SKeyIndex fIndex;
+    };
+
+    void newConnection();
+    void readRequests( QLocalSocket * socket );
+    std::shared_ptr< const SReferenceIndex > referenceIndex( const SCSVTable & rhs, QStringList & keyColumns );
+
+    SCSVTable fReference;
+    CKeyNormalizer fNormalizer;
+    CRowFilter fRowFilter; // copied into each request's table
+    QString fOutputDir{ "." };
+    int fNumThreads{ -1 };
+    std::atomic< int > fNumRequests{ 0 };
+
+    using TIndexFuture = std::shared_future< std::shared_ptr< const SReferenceIndex > >;
+    std::mutex fIndexMutex; // only guards the map, each index is built by the first request that needs it
+    std::map< QString, TIndexFuture > fIndexes; // by the key column names and which of them are typed
+
+    std::unique_ptr< QLocalServer > fServer;
+    std::unique_ptr< CWorkStealingPool > fPool; // last, so running requests finish before the rest goes away
+};
+
+#endif
@@ -0,0 +1,203 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "KeyAdvisor.h"
+#include "ColumnStatistics.h"
+#include "KeyHash.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace
+{
+    using TColumnHashes = std::vector< std::vector< quint64 > >; // [ column ][ row ]
+
+    TColumnHashes hashSample( const std::vector< QStringList > & sample, int numColumns )
+    {
+        TColumnHashes retVal( numColumns );
+        for ( auto && column : retVal )
+            column.reserve( sample.size() );
+        for ( auto && row : sample )
+        {
+            for ( int ii = 0; ii < numColumns; ++ii )
+            {
+                auto value = ( ii < row.count() ) ? row[ ii ] : QString();
+                retVal[ ii ].push_back( NKeyHash::hash64( reinterpret_cast< const char * >( value.constData() ), value.length() * static_cast< qint64 >( sizeof( QChar ) ) ) );
+            }
+        }
+        return retVal;
+    }
+
+    bool isUnique( const TColumnHashes & hashes, const std::vector< int > & columns )
+    {
+        if ( hashes.empty() || columns.empty() )
+            return false;
+
+        auto numRows = hashes[ columns.front() ].size();
+        std::unordered_set< quint64 > seen;
+        seen.reserve( numRows );
+        for ( size_t row = 0; row < numRows; ++row )
+        {
+            quint64 combined = 0;
+            for ( auto && col : columns )
+                combined = NKeyHash::mix64( combined * 31 + hashes[ col ][ row ] );
+            if ( !seen.insert( combined ).second )
+                return false;
+        }
+        return true;
+    }
+
+    // every subset of numColumns of the ranked columns, best ranked first
+    bool findUnique( const TColumnHashes & lhs, const TColumnHashes & rhs, const std::vector< int > & ranked, int numColumns, std::vector< int > & retVal )
+    {
+        std::vector< int > positions( numColumns );
+        for ( int ii = 0; ii < numColumns; ++ii )
+            positions[ ii ] = ii;
+
+        auto numRanked = static_cast< int >( ranked.size() );
+        while ( true )
+        {
+            retVal.clear();
+            for ( auto && ii : positions )
+                retVal.push_back( ranked[ ii ] );
+            if ( isUnique( lhs, retVal ) && isUnique( rhs, retVal ) )
+                return true;
+
+            int ii = numColumns - 1;
+            while ( ( ii >= 0 ) && ( positions[ ii ] == numRanked - numColumns + ii ) )
+                --ii;
+            if ( ii < 0 )
+                return false;
+            positions[ ii ]++;
+            for ( int jj = ii + 1; jj < numColumns; ++jj )
+                positions[ jj ] = positions[ jj - 1 ] + 1;
+        }
+    }
+}
+
+void CKeyAdvisor::clear()
+{
+    fCandidates.clear();
+    fProposed.clear();
+    fUnique = false;
+}
+
+void CKeyAdvisor::analyze( const CColumnStatistics & lhs, const CColumnStatistics & rhs )
+{
+    clear();
+    for ( int ii = 0; ii < lhs.columnCount(); ++ii )
+    {
+        auto rhsCol = rhs.columns().indexOf( lhs.columns()[ ii ] );
+        if ( rhsCol < 0 )
+            continue;
+
+        auto && lhsSketch = lhs.column( ii );
+        auto && rhsSketch = rhs.column( rhsCol );
+
+        SCandidate candidate;
+        candidate.fName = lhs.columns()[ ii ];
+        candidate.fLHSDistinct = lhsSketch.distinctEstimate();
+        candidate.fRHSDistinct = rhsSketch.distinctEstimate();
+
+        auto lhsUniqueness = lhsSketch.fNumValues ? ( static_cast< double >( candidate.fLHSDistinct ) / lhsSketch.fNumValues ) : 0.0;
+        auto rhsUniqueness = rhsSketch.fNumValues ? ( static_cast< double >( candidate.fRHSDistinct ) / rhsSketch.fNumValues ) : 0.0;
+        candidate.fUniqueness = std::min( lhsUniqueness, rhsUniqueness );
+
+        // |A n B| = |A| + |B| - |A u B|
+        auto both = lhsSketch.fDistinct;
+        both.merge( rhsSketch.fDistinct );
+        auto smaller = std::min( candidate.fLHSDistinct, candidate.fRHSDistinct );
+        auto common = static_cast< double >( candidate.fLHSDistinct + candidate.fRHSDistinct ) - both.estimate();
+        candidate.fOverlap = ( smaller > 0 ) ? std::clamp( common / smaller, 0.0, 1.0 ) : 0.0;
+        candidate.fEligible = ( candidate.fOverlap >= kMinOverlap ) && ( smaller > 1 );
+
+        fCandidates.push_back( candidate );
+    }
+}
+
+QStringList CKeyAdvisor::columnNames() const
+{
+    QStringList retVal;
+    for ( auto && ii : fCandidates )
+        retVal << ii.fName;
+    return retVal;
+}
+
+const CKeyAdvisor::SCandidate * CKeyAdvisor::candidate( const QString & name ) const
+{
+    for ( auto && ii : fCandidates )
+    {
+        if ( ii.fName == name )
+            return &ii;
+    }
+    return nullptr;
+}
+
+void CKeyAdvisor::propose( const std::vector< QStringList > & lhsSample, const std::vector< QStringList > & rhsSample )
+{
+    fProposed = columnNames();
+    fUnique = false;
+
+    std::vector< int > ranked;
+    for ( int ii = 0; ii < static_cast< int >( fCandidates.size() ); ++ii )
+    {
+        if ( fCandidates[ ii ].fEligible )
+            ranked.push_back( ii );
+    }
+    if ( ranked.empty() || lhsSample.empty() || rhsSample.empty() )
+        return;
+    std::stable_sort( ranked.begin(), ranked.end(), [ this ]( int lhs, int rhs ) { return fCandidates[ lhs ].fUniqueness > fCandidates[ rhs ].fUniqueness; } );
+
+    auto numColumns = static_cast< int >( fCandidates.size() );
+    auto lhsHashes = hashSample( lhsSample, numColumns );
+    auto rhsHashes = hashSample( rhsSample, numColumns );
+
+    std::vector< int > found;
+    std::vector< int > searched( ranked.begin(), ranked.begin() + std::min( static_cast< int >( ranked.size() ), kMaxSearchColumns ) );
+    bool aOK = false;
+    for ( int size = 1; !aOK && ( size <= std::min( kMaxSearchSize, static_cast< int >( searched.size() ) ) ); ++size )
+        aOK = findUnique( lhsHashes, rhsHashes, searched, size, found );
+
+    // past the searched sizes, keep adding the next best column
+    if ( !aOK )
+    {
+        found.clear();
+        for ( auto && ii : ranked )
+        {
+            found.push_back( ii );
+            if ( isUnique( lhsHashes, found ) && isUnique( rhsHashes, found ) )
+            {
+                aOK = true;
+                break;
+            }
+        }
+    }
+    if ( !aOK )
+        return;
+
+    // keep the file order of the columns
+    std::sort( found.begin(), found.end() );
+    fProposed.clear();
+    for ( auto && ii : found )
+        fProposed << fCandidates[ ii ].fName;
+    fUnique = true;
+}
@@ -0,0 +1,71 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _KEYADVISOR_H
+#define _KEYADVISOR_H
+
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+class CColumnStatistics;
+
+// Proposes the smallest set of shared columns that uniquely identifies the rows of both files.
+// The column sketches rank the candidates, shared columns whose values rarely appear on the
+// other side (timestamps and the like) are left out, then samples of the rows check which
+// combination is unique.
+class CKeyAdvisor
+{
+public:
+    struct SCandidate
+    {
+        QString fName;
+        qint64 fLHSDistinct{ 0 };
+        qint64 fRHSDistinct{ 0 };
+        double fUniqueness{ 0.0 }; // distinct values per row, the lower of the two files
+        double fOverlap{ 0.0 };    // share of the smaller value set also found in the other file
+        bool fEligible{ false };
+    };
+
+    static constexpr int kMaxSampleRows = 20000;
+    static constexpr int kMaxSearchColumns = 8; // subsets are only searched over the best ranked columns
+    static constexpr int kMaxSearchSize = 3;
+    static constexpr double kMinOverlap = 0.5;
+
+    void clear();
+    void analyze( const CColumnStatistics & lhs, const CColumnStatistics & rhs );
+    QStringList columnNames() const; // the shared columns, the order the samples must use
+
+    // the samples hold the columnNames() values of up to kMaxSampleRows rows of each file
+    void propose( const std::vector< QStringList > & lhsSample, const std::vector< QStringList > & rhsSample );
+
+    const QStringList & proposed() const { return fProposed; }
+    bool isUnique() const { return fUnique; } // false when no subset was unique, proposed() is then every shared column
+    const std::vector< SCandidate > & candidates() const { return fCandidates; }
+    const SCandidate * candidate( const QString & name ) const;
+private:
+    std::vector< SCandidate > fCandidates;
+    QStringList fProposed;
+    bool fUnique{ false };
+};
+
+#endif
@@ -0,0 +1,60 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "KeyHash.h"
+
+#include <cstring>
+
+namespace NKeyHash
+{
+    quint64 mix64( quint64 value )
+    {
+        // murmur3 finalizer
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ULL;
+        value ^= value >> 33;
+        return value;
+    }
+
+    quint64 hash64( const char * data, qint64 len, quint64 seed )
+    {
+        const quint64 kMultiplier = 0x9E3779B97F4A7C15ULL;
+        quint64 retVal = seed ^ ( static_cast< quint64 >( len ) * kMultiplier );
+
+        qint64 pos = 0;
+        for ( ; pos + 8 <= len; pos += 8 )
+        {
+            quint64 word;
+            std::memcpy( &word, data + pos, 8 );
+            retVal = ( retVal ^ mix64( word ) ) * kMultiplier;
+            retVal ^= retVal >> 29;
+        }
+
+        quint64 tail = 0;
+        for ( int ii = 0; pos < len; ++pos, ++ii )
+            tail |= static_cast< quint64 >( static_cast< unsigned char >( data[ pos ] ) ) << ( 8 * ii );
+        retVal = ( retVal ^ mix64( tail ) ) * kMultiplier;
+        return mix64( retVal );
+    }
+}
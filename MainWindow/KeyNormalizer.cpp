@@ -0,0 +1,434 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "KeyNormalizer.h"
+#include "CSVReader.h"
+
+#include <QCryptographicHash>
+#include <QSettings>
+#include <algorithm>
+#include <cstdio>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 2 ) )
+#include <emmintrin.h>
+#define KEY_HAS_SSE2
+#endif
+
+namespace
+{
+    const int kTruncateLength = 16;
+    const char kSeparator = '\x1f';
+
+    bool isSpace( char ch )
+    {
+        return ( ch == ' ' ) || ( ( ch >= '\t' ) && ( ch <= '\r' ) );
+    }
+
+    bool isDigit( char ch )
+    {
+        return ( ch >= '0' ) && ( ch <= '9' );
+    }
+
+    bool isPunct( char ch )
+    {
+        return ( ( ch >= '!' ) && ( ch <= '/' ) ) || ( ( ch >= ':' ) && ( ch <= '@' ) ) || ( ( ch >= '[' ) && ( ch <= '`' ) ) || ( ( ch >= '{' ) && ( ch <= '~' ) );
+    }
+
+    char toLower( char ch )
+    {
+        return ( ( ch >= 'A' ) && ( ch <= 'Z' ) ) ? static_cast< char >( ch | 0x20 ) : ch;
+    }
+
+    // ASCII only, 16 bytes at a time where SSE2 is available
+    void appendLower( const char * data, int len, QByteArray & out )
+    {
+        auto start = out.size();
+        out.resize( start + len );
+        auto dest = out.data() + start;
+
+        int pos = 0;
+#ifdef KEY_HAS_SSE2
+        const auto beforeA = _mm_set1_epi8( 'A' - 1 );
+        const auto afterZ = _mm_set1_epi8( 'Z' + 1 );
+        const auto caseBit = _mm_set1_epi8( 0x20 );
+        for ( ; pos + 16 <= len; pos += 16 )
+        {
+            auto chunk = _mm_loadu_si128( reinterpret_cast< const __m128i * >( data + pos ) );
+            auto upper = _mm_and_si128( _mm_cmpgt_epi8( chunk, beforeA ), _mm_cmplt_epi8( chunk, afterZ ) );
+            chunk = _mm_or_si128( chunk, _mm_and_si128( upper, caseBit ) );
+            _mm_storeu_si128( reinterpret_cast< __m128i * >( dest + pos ), chunk );
+        }
+#endif
+        for ( ; pos < len; ++pos )
+            dest[ pos ] = toLower( data[ pos ] );
+    }
+
+    bool readNumber( const char * data, int len, int & pos, int minDigits, int maxDigits, int & value )
+    {
+        value = 0;
+        int start = pos;
+        while ( ( pos < len ) && isDigit( data[ pos ] ) && ( ( pos - start ) < maxDigits ) )
+            value = value * 10 + ( data[ pos++ ] - '0' );
+        return ( pos - start ) >= minDigits;
+    }
+
+    bool appendDate( const char * data, int len, QByteArray & out )
+    {
+        int year = 0;
+        int month = 0;
+        int day = 0;
+        if ( ( len == 8 ) && std::all_of( data, data + len, isDigit ) )
+        {
+            int pos = 0;
+            readNumber( data, len, pos, 4, 4, year );
+            readNumber( data, len, pos, 2, 2, month );
+            readNumber( data, len, pos, 2, 2, day );
+        }
+        else
+        {
+            int first = 0;
+            int second = 0;
+            int third = 0;
+            int pos = 0;
+            if ( !readNumber( data, len, pos, 1, 4, first ) || ( pos >= len ) )
+                return false;
+            auto firstLen = pos;
+            auto sep = data[ pos++ ];
+            if ( ( sep != '-' ) && ( sep != '/' ) && ( sep != '.' ) )
+                return false;
+            if ( !readNumber( data, len, pos, 1, 2, second ) || ( pos >= len ) || ( data[ pos++ ] != sep ) )
+                return false;
+            auto thirdStart = pos;
+            if ( !readNumber( data, len, pos, 1, 4, third ) || ( pos != len ) )
+                return false;
+
+            if ( firstLen == 4 )
+            {
+                year = first;
+                month = second;
+                day = third;
+            }
+            else if ( ( pos - thirdStart ) == 4 )
+            {
+                month = first;
+                day = second;
+                year = third;
+            }
+            else
+                return false;
+        }
+
+        if ( ( year < 1000 ) || ( month < 1 ) || ( month > 12 ) || ( day < 1 ) || ( day > 31 ) )
+            return false;
+
+        char buffer[ 16 ];
+        auto numChars = std::snprintf( buffer, sizeof( buffer ), "%04d-%02d-%02d", year, month, day );
+        out.append( buffer, numChars );
+        return true;
+    }
+
+    bool appendNumber( const char * data, int len, QByteArray & out )
+    {
+        int pos = 0;
+        bool negative = false;
+        if ( ( pos < len ) && ( ( data[ pos ] == '+' ) || ( data[ pos ] == '-' ) ) )
+            negative = data[ pos++ ] == '-';
+
+        QByteArray intPart;
+        int groupLen = -1; // digits since the last thousands separator, -1 before the first one
+        for ( ; ( pos < len ) && ( data[ pos ] != '.' ); ++pos )
+        {
+            if ( isDigit( data[ pos ] ) )
+            {
+                intPart += data[ pos ];
+                if ( groupLen >= 0 )
+                    groupLen++;
+            }
+            else if ( ( data[ pos ] == ',' ) && !intPart.isEmpty() && ( ( groupLen < 0 ) || ( groupLen == 3 ) ) )
+                groupLen = 0;
+            else
+                return false;
+        }
+        if ( groupLen >= 0 && groupLen != 3 )
+            return false;
+
+        QByteArray fraction;
+        if ( pos < len )
+        {
+            for ( ++pos; pos < len; ++pos )
+            {
+                if ( !isDigit( data[ pos ] ) )
+                    return false;
+                fraction += data[ pos ];
+            }
+        }
+        if ( intPart.isEmpty() && fraction.isEmpty() )
+            return false;
+
+        auto firstDigit = std::find_if( intPart.begin(), intPart.end(), []( char ch ) { return ch != '0'; } ) - intPart.begin();
+        intPart = intPart.mid( static_cast< int >( firstDigit ) );
+        while ( fraction.endsWith( '0' ) )
+            fraction.chop( 1 );
+
+        if ( negative && ( !intPart.isEmpty() || !fraction.isEmpty() ) )
+            out += '-';
+        out += intPart.isEmpty() ? QByteArray( "0" ) : intPart;
+        if ( !fraction.isEmpty() )
+        {
+            out += '.';
+            out += fraction;
+        }
+        return true;
+    }
+}
+
+void CKeyNormalizer::clear()
+{
+    fDefaultOptions = kDefaultOptions;
+    fColumnOptions.clear();
+}
+
+void CKeyNormalizer::setColumnOptions( const QString & column, int options )
+{
+    if ( options == fDefaultOptions )
+        fColumnOptions.erase( column );
+    else
+        fColumnOptions[ column ] = options;
+}
+
+int CKeyNormalizer::columnOptions( const QString & column ) const
+{
+    auto pos = fColumnOptions.find( column );
+    if ( pos == fColumnOptions.end() )
+        return fDefaultOptions;
+    return ( *pos ).second;
+}
+
+std::vector< int > CKeyNormalizer::columnOptions( const QStringList & columns ) const
+{
+    std::vector< int > retVal;
+    for ( auto && ii : columns )
+        retVal.push_back( columnOptions( ii ) );
+    return retVal;
+}
+
+void CKeyNormalizer::load( QSettings & settings )
+{
+    clear();
+    if ( !parse( settings.value( "KeyNormalization", QString() ).toString() ) )
+        clear();
+}
+
+void CKeyNormalizer::save( QSettings & settings ) const
+{
+    settings.setValue( "KeyNormalization", toString() );
+}
+
+QString CKeyNormalizer::toString() const
+{
+    QStringList retVal;
+    for ( auto && ii : fColumnOptions )
+        retVal << QString( "%1=%2" ).arg( ii.first ).arg( optionsToString( ii.second ) );
+    retVal << QString( "*=%1" ).arg( optionsToString( fDefaultOptions ) );
+    return retVal.join( ";" );
+}
+
+bool CKeyNormalizer::parse( const QString & spec, QString * errorMsg )
+{
+    for ( auto && ii : spec.split( ";", Qt::SkipEmptyParts ) )
+    {
+        auto pos = ii.lastIndexOf( "=" );
+        bool aOK = pos > 0;
+        int options = aOK ? optionsFromString( ii.mid( pos + 1 ), &aOK ) : 0;
+        if ( !aOK )
+        {
+            if ( errorMsg )
+                *errorMsg = QString( "Invalid key normalization '%1'" ).arg( ii );
+            return false;
+        }
+
+        auto column = ii.left( pos ).trimmed();
+        if ( column == "*" )
+            fDefaultOptions = options;
+        else
+            fColumnOptions[ column ] = options;
+    }
+    return true;
+}
+
+const std::vector< std::pair< CKeyNormalizer::EOption, QString > > & CKeyNormalizer::optionNames()
+{
+    static std::vector< std::pair< EOption, QString > > sNames =
+    {
+        { eTrim, "trim" },
+        { eCollapseSpace, "collapse" },
+        { eCaseFold, "casefold" },
+        { eStripPunctuation, "nopunct" },
+        { eNumbers, "numbers" },
+        { eDates, "dates" },
+        { eTruncate, "truncate" }
+    };
+    return sNames;
+}
+
+QString CKeyNormalizer::optionsToString( int options )
+{
+    QStringList retVal;
+    for ( auto && ii : optionNames() )
+    {
+        if ( options & ii.first )
+            retVal << ii.second;
+    }
+    if ( retVal.isEmpty() )
+        return "none";
+    return retVal.join( "+" );
+}
+
+int CKeyNormalizer::optionsFromString( const QString & text, bool * aOK )
+{
+    if ( aOK )
+        *aOK = true;
+
+    int retVal = eNone;
+    for ( auto && ii : text.split( "+", Qt::SkipEmptyParts ) )
+    {
+        auto name = ii.trimmed().toLower();
+        if ( name == "none" )
+            continue;
+        auto pos = std::find_if( optionNames().begin(), optionNames().end(), [ name ]( const std::pair< EOption, QString > & option ) { return option.second == name; } );
+        if ( pos == optionNames().end() )
+        {
+            if ( aOK )
+                *aOK = false;
+            return eNone;
+        }
+        retVal |= ( *pos ).first;
+    }
+    return retVal;
+}
+
+void CKeyNormalizer::appendValue( const char * data, int len, int options, QByteArray & out )
+{
+    if ( !CCSVReader::isAscii( data, len ) )
+    {
+        appendValue( QString::fromUtf8( data, len ), options, out );
+        return;
+    }
+
+    int begin = 0;
+    int end = len;
+    if ( options & ( eTrim | eCollapseSpace ) )
+    {
+        while ( ( begin < end ) && isSpace( data[ begin ] ) )
+            ++begin;
+        while ( ( end > begin ) && isSpace( data[ end - 1 ] ) )
+            --end;
+    }
+
+    auto start = out.size();
+    if ( ( options & eDates ) && appendDate( data + begin, end - begin, out ) )
+        ;
+    else if ( ( options & eNumbers ) && appendNumber( data + begin, end - begin, out ) )
+        ;
+    else if ( !( options & ( eCollapseSpace | eStripPunctuation ) ) )
+    {
+        // a straight copy, so the truncation can happen up front
+        auto copyLen = ( options & eTruncate ) ? std::min( end - begin, kTruncateLength ) : ( end - begin );
+        if ( options & eCaseFold )
+            appendLower( data + begin, copyLen, out );
+        else
+            out.append( data + begin, copyLen );
+    }
+    else
+    {
+        bool pendingSpace = false;
+        for ( int ii = begin; ii < end; ++ii )
+        {
+            auto ch = data[ ii ];
+            if ( ( options & eCollapseSpace ) && isSpace( ch ) )
+            {
+                pendingSpace = out.size() > start;
+                continue;
+            }
+            if ( ( options & eStripPunctuation ) && isPunct( ch ) )
+                continue;
+            if ( pendingSpace )
+            {
+                out += ' ';
+                pendingSpace = false;
+            }
+            out += ( options & eCaseFold ) ? toLower( ch ) : ch;
+        }
+    }
+
+    if ( ( options & eTruncate ) && ( ( out.size() - start ) > kTruncateLength ) )
+        out.truncate( start + kTruncateLength );
+    if ( out.size() > start )
+        out += kSeparator;
+}
+
+void CKeyNormalizer::appendValue( const QString & value, int options, QByteArray & out )
+{
+    if ( value.isEmpty() )
+        return;
+
+    auto utf8 = value.toUtf8();
+    if ( CCSVReader::isAscii( utf8.constData(), utf8.length() ) )
+    {
+        appendValue( utf8.constData(), utf8.length(), options, out );
+        return;
+    }
+
+    // Unicode fallback, the steps match the byte level path for the ASCII characters
+    auto text = value;
+    if ( ( options & eTrim ) && !( options & eCollapseSpace ) )
+        text = text.trimmed();
+    if ( options & eStripPunctuation )
+    {
+        QString stripped;
+        for ( auto && ch : text )
+        {
+            if ( !ch.isPunct() && !ch.isSymbol() )
+                stripped += ch;
+        }
+        text = stripped;
+    }
+    if ( options & eCollapseSpace )
+        text = text.simplified();
+    if ( options & eCaseFold )
+        text = text.toCaseFolded();
+    if ( options & eTruncate )
+        text = text.left( kTruncateLength );
+    if ( text.isEmpty() )
+        return;
+    out += text.toUtf8();
+    out += kSeparator;
+}
+
+QByteArray CKeyNormalizer::computeKey( const QStringList & rowData, const std::vector< int > & keyCols, const std::vector< int > & options )
+{
+    thread_local QByteArray sScratch;
+    sScratch.clear();
+    for ( size_t ii = 0; ii < keyCols.size(); ++ii )
+        appendValue( rowData[ keyCols[ ii ] ], ( ii < options.size() ) ? options[ ii ] : kDefaultOptions, sScratch );
+    return QCryptographicHash::hash( sScratch, QCryptographicHash::Md5 ).toHex();
+}
@@ -0,0 +1,82 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _KEYNORMALIZER_H
+#define _KEYNORMALIZER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <map>
+#include <vector>
+
+class QSettings;
+
+// Canonical form of the key values, configured per key column by name.
+// Values are rewritten as UTF-8 bytes into a scratch buffer that is hashed directly,
+// pure ASCII values take a byte level path, anything else goes through QString
+class CKeyNormalizer
+{
+public:
+    enum EOption
+    {
+        eNone = 0x00,
+        eTrim = 0x01,
+        eCollapseSpace = 0x02, // runs of white space become one space, also trims
+        eCaseFold = 0x04,
+        eStripPunctuation = 0x08,
+        eNumbers = 0x10, // +007.50 and 7.5 compare equal, as do 1,000 and 1000
+        eDates = 0x20, // YYYY-MM-DD, YYYY/MM/DD, MM/DD/YYYY and YYYYMMDD all become YYYY-MM-DD
+        eTruncate = 0x40 // only the first 16 characters are compared
+    };
+    static constexpr int kDefaultOptions = eTruncate; // the original text.left( 16 ) rule
+
+    void clear();
+    bool isDefault() const { return ( fDefaultOptions == kDefaultOptions ) && fColumnOptions.empty(); }
+
+    void setDefaultOptions( int options ) { fDefaultOptions = options; }
+    int defaultOptions() const { return fDefaultOptions; }
+    void setColumnOptions( const QString & column, int options );
+    int columnOptions( const QString & column ) const;
+    std::vector< int > columnOptions( const QStringList & columns ) const;
+
+    void load( QSettings & settings );
+    void save( QSettings & settings ) const;
+    bool parse( const QString & spec, QString * errorMsg = nullptr ); // "Name=trim+casefold;*=trim", * sets the default
+    QString toString() const; // in the format parse reads
+
+    static const std::vector< std::pair< EOption, QString > > & optionNames();
+    static QString optionsToString( int options );
+    static int optionsFromString( const QString & text, bool * aOK = nullptr );
+
+    // appends the canonical value and a separator, values that normalize to empty add nothing
+    static void appendValue( const char * data, int len, int options, QByteArray & out );
+    static void appendValue( const QString & value, int options, QByteArray & out );
+
+    // MD5 of the canonical key, no options means kDefaultOptions for every column
+    static QByteArray computeKey( const QStringList & rowData, const std::vector< int > & keyCols, const std::vector< int > & options = {} );
+private:
+    int fDefaultOptions{ kDefaultOptions };
+    std::map< QString, int > fColumnOptions;
+};
+
+#endif
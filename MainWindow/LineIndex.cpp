@@ -0,0 +1,131 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "LineIndex.h"
+
+#include <QFileInfo>
+#include <cstring>
+
+bool CLineIndex::open( const QString & fileName, CCSVReader::EEncoding encoding, qint64 loadedSize, const QDateTime & loadedModified )
+{
+    close();
+    if ( ( encoding == CCSVReader::EEncoding::eUTF16LE ) || ( encoding == CCSVReader::EEncoding::eUTF16BE ) )
+        return false;
+
+    fFile.setFileName( fileName );
+    if ( !fFile.open( QFile::ReadOnly ) )
+        return false;
+
+    fEncoding = encoding;
+    fLoadedSize = loadedSize;
+    fLoadedModified = loadedModified;
+    auto sample = fFile.peek( 4 );
+    CCSVReader::detectEncoding( sample.constData(), sample.size(), &fBOMLength );
+    return true;
+}
+
+void CLineIndex::close()
+{
+    if ( fFile.isOpen() )
+        fFile.close();
+    fBOMLength = 0;
+    fLoadedSize = -1;
+    fLoadedModified = QDateTime();
+    fBuilt = false;
+    fOffsets.clear();
+    fCursorLine = -1;
+    fCursorPos = 0;
+}
+
+bool CLineIndex::isChanged() const
+{
+    QFileInfo info( fFile.fileName() );
+    return ( info.size() != fLoadedSize ) || ( info.lastModified() != fLoadedModified );
+}
+
+bool CLineIndex::build()
+{
+    // the line ends are found on the raw bytes, nothing needs decoding
+    fOffsets.clear();
+    fOffsets.push_back( fBOMLength );
+    if ( !fFile.seek( fBOMLength ) )
+        return false;
+
+    qint64 lineNum = 0;
+    QByteArray raw;
+    while ( !( raw = fFile.read( 1024 * 1024 ) ).isEmpty() )
+    {
+        auto blockPos = fFile.pos() - raw.size();
+        auto data = raw.constData();
+        auto end = data + raw.size();
+        while ( auto eol = static_cast< const char * >( std::memchr( data, '\n', end - data ) ) )
+        {
+            if ( ( ++lineNum % kStride ) == 0 )
+                fOffsets.push_back( blockPos + ( eol - raw.constData() ) + 1 );
+            data = eol + 1;
+        }
+    }
+    fBuilt = true;
+    return true;
+}
+
+bool CLineIndex::readLine( int lineNum, QByteArray & line )
+{
+    if ( !isOpen() || ( lineNum < 0 ) || isChanged() )
+        return false;
+    if ( !fBuilt && !build() )
+        return false;
+
+    auto stride = lineNum / kStride;
+    if ( stride >= static_cast< int >( fOffsets.size() ) )
+        return false;
+
+    auto currLine = stride * kStride;
+    auto pos = fOffsets[ stride ];
+    if ( ( fCursorLine >= currLine ) && ( fCursorLine <= lineNum ) )
+    {
+        currLine = fCursorLine;
+        pos = fCursorPos;
+    }
+    if ( !fFile.seek( pos ) )
+        return false;
+
+    QByteArray raw;
+    for ( ; currLine <= lineNum; ++currLine )
+    {
+        raw = fFile.readLine();
+        if ( raw.isEmpty() )
+        {
+            fCursorLine = -1;
+            return false;
+        }
+    }
+    fCursorLine = currLine;
+    fCursorPos = fFile.pos();
+
+    if ( raw.endsWith( '\n' ) )
+        raw.chop( 1 );
+    if ( raw.endsWith( '\r' ) )
+        raw.chop( 1 );
+    line = CCSVReader::decodeLine( raw, fEncoding );
+    return true;
+}
@@ -0,0 +1,64 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _LINEINDEX_H
+#define _LINEINDEX_H
+
+#include "CSVReader.h"
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+#include <vector>
+
+// Finds single lines of an ASCII compatible file again after it was read, for the cells
+// that were skipped at load time. Only every kStride'th line start is kept, the lines
+// in between are read over, and reading forward continues from the last line read.
+// The size and modification time the file had when it was loaded are checked before every
+// read, lines of a file changed since then are refused
+class CLineIndex
+{
+public:
+    static constexpr int kStride = 256;
+
+    bool open( const QString & fileName, CCSVReader::EEncoding encoding, qint64 loadedSize, const QDateTime & loadedModified ); // not for UTF-16 files
+    void close();
+    bool isOpen() const { return fFile.isOpen(); }
+    bool isChanged() const; // the file is no longer the one that was loaded
+
+    bool readLine( int lineNum, QByteArray & line ); // numbered and decoded as CCSVReader::readLine hands them out
+private:
+    bool build();
+
+    QFile fFile;
+    CCSVReader::EEncoding fEncoding{ CCSVReader::EEncoding::eUTF8 };
+    int fBOMLength{ 0 };
+    qint64 fLoadedSize{ -1 };
+    QDateTime fLoadedModified;
+    bool fBuilt{ false };
+    std::vector< qint64 > fOffsets; // start of line ii * kStride
+    int fCursorLine{ -1 };
+    qint64 fCursorPos{ 0 };
+};
+
+#endif
@@ -22,7 +22,12 @@
 
 #include "MainWindow.h"
 #include "SABUtils/AutoWaitCursor.h"
-#include "SABUtils/MD5.h"
+
+#include "CSVReader.h"
+#include "CSVTable.h"
+#include "KeyHash.h"
+#include "MemoryAccounting.h"
+#include "WorkStealingPool.h"
 
 #include "ui_MainWindow.h"
 
@@ -38,6 +43,159 @@
 #include <QTextStream>
 #include <QProgressDialog>
 #include <QHeaderView>
+#include <QInputDialog>
+#include <QStatusBar>
+#include <QMenu>
+#include <QThread>
+#include <QProgressBar>
+#include <QPushButton>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+
+namespace
+{
+    // parses the shards after the first of a sharded input on the pool, while the caller reads the first one
+    class CShardLoader
+    {
+    public:
+        CShardLoader( const QStringList & files, const CRowFilter & filter ) :
+            fFiles( files ),
+            fTables( files.count() ),
+            fErrors( files.count() )
+        {
+            // the filter keeps scratch space, so every shard gets its copy before any item starts
+            for ( auto && ii : fTables )
+                ii.fRowFilter = filter;
+            fLoop = CWorkStealingPool::shared().start( fFiles.count(),
+                                                       [ this ]( int shard )
+                                                       {
+                                                           auto aOK = fTables[ shard ].load( fFiles[ shard ], &fErrors[ shard ], &fCanceled );
+                                                           fLinesDone += fTables[ shard ].rowCount() + fTables[ shard ].numIgnoredRows();
+                                                           return aOK;
+                                                       } );
+        }
+        ~CShardLoader()
+        {
+            fCanceled = true;
+            fLoop->stop();
+            fLoop->wait();
+        }
+
+        int count() const { return fFiles.count(); }
+        int linesDone() const { return fLinesDone; } // of the shards loaded so far
+        std::vector< SCSVTable > & tables() { return fTables; }
+        QString error() const
+        {
+            for ( auto && ii : fErrors )
+            {
+                if ( !ii.isEmpty() )
+                    return ii;
+            }
+            return {};
+        }
+
+        bool isDone() // every shard is loaded or failed
+        {
+            if ( !fLoop->isDone() )
+                return false;
+            fLoop->wait();
+            return true;
+        }
+
+        bool wait( QProgressDialog * dlg, int linesBefore ) // false when canceled
+        {
+            while ( !fLoop->isDone() )
+            {
+                qApp->processEvents();
+                if ( dlg->wasCanceled() )
+                    return false;
+                dlg->setValue( std::min( linesBefore + linesDone(), dlg->maximum() ) );
+                QThread::msleep( 50 );
+            }
+            fLoop->wait();
+            return true;
+        }
+    private:
+        QStringList fFiles;
+        std::vector< SCSVTable > fTables;
+        std::vector< QString > fErrors;
+        std::atomic< bool > fCanceled{ false };
+        std::atomic< int > fLinesDone{ 0 };
+        std::shared_ptr< CWorkStealingPool::CLoop > fLoop;
+    };
+
+    // reads the rest of a file on the pool, the caller adds the batches to the store as they come in
+    class CRowLoader
+    {
+    public:
+        static const int kBatchRows = 4096;
+        static const size_t kMaxBatches = 8; // the reader waits when the caller falls this far behind
+
+        CRowLoader( SFileData & data, int numColumns )
+        {
+            fLoop = CWorkStealingPool::shared().start( 1, [ this, &data, numColumns ]( int ) { return readAll( data, numColumns ); } );
+        }
+        ~CRowLoader()
+        {
+            {
+                std::lock_guard< std::mutex > lock( fMutex );
+                fCanceled = true;
+            }
+            fSpace.notify_all();
+            fLoop->wait();
+        }
+
+        bool next( SFileData::SRowBatch & batch ) // false when no batch is ready yet
+        {
+            {
+                std::lock_guard< std::mutex > lock( fMutex );
+                if ( fBatches.empty() )
+                    return false;
+                batch = std::move( fBatches.front() );
+                fBatches.pop_front();
+            }
+            fSpace.notify_all();
+            return true;
+        }
+    private:
+        bool readAll( SFileData & data, int numColumns )
+        {
+            for ( ;; )
+            {
+                SFileData::SRowBatch batch;
+                data.readRows( kBatchRows, numColumns, batch );
+                auto last = batch.fAtEnd || !batch.fError.isEmpty();
+
+                std::unique_lock< std::mutex > lock( fMutex );
+                fSpace.wait( lock, [ this ]() { return fCanceled || ( fBatches.size() < kMaxBatches ); } );
+                if ( fCanceled )
+                    return false;
+                fBatches.push_back( std::move( batch ) );
+                if ( last )
+                    return true;
+            }
+        }
+
+        std::mutex fMutex;
+        std::condition_variable fSpace;
+        std::deque< SFileData::SRowBatch > fBatches;
+        bool fCanceled{ false };
+        std::shared_ptr< CWorkStealingPool::CLoop > fLoop;
+    };
+}
+
+// the loaders of a load without a dialog, the shards are read alongside the first file
+struct SFileData::SFullLoad
+{
+    std::unique_ptr< CShardLoader > fShards;
+    std::unique_ptr< CRowLoader > fRows; // reset once the first file is read
+    int fNumLines{ 0 };                  // estimated, of every shard
+};
 
 
 CMainWindow::CMainWindow(QWidget* parent)
@@ -45,21 +203,23 @@ CMainWindow::CMainWindow(QWidget* parent)
     fImpl(new Ui::CMainWindow)
 {
     fImpl->setupUi(this);
-    fLHS.setTable( fImpl->lhsData );
+    fLHS.setFileTable( fImpl->lhsData, Qt::red );
     fLHS.setTotalCount( fImpl->numLHSRows );
     fLHS.setSubCount( fImpl->numLHSOnly );
     fLHS.setMergedColumns( fImpl->mergedColumnsLHS );
     fLHS.setExtraColumns( fImpl->extraColumnsLHS );
     fLHS.setMatchedColumns( fImpl->matchedColumnsLHS );
     fLHS.setIgnoredRows( fImpl->ignoredRowsLHS );
+    fLHS.setKeyNormalizer( &fKeyNormalizer );
 
-    fRHS.setTable( fImpl->rhsData );
+    fRHS.setFileTable( fImpl->rhsData, Qt::yellow );
     fRHS.setTotalCount( fImpl->numRHSRows );
     fRHS.setSubCount( fImpl->numRHSOnly );
     fRHS.setMergedColumns( fImpl->mergedColumnsRHS );
     fRHS.setExtraColumns( fImpl->extraColumnsRHS );
     fRHS.setMatchedColumns( fImpl->matchedColumnsRHS );
     fRHS.setIgnoredRows( fImpl->ignoredRowsRHS );
+    fRHS.setKeyNormalizer( &fKeyNormalizer );
 
     fMerged.setTable( fImpl->mergeData );
     fMerged.setTotalCount( fImpl->numTotalRows );
@@ -74,6 +234,24 @@ CMainWindow::CMainWindow(QWidget* parent)
     connect(fImpl->btnSelectLHSFile, &QToolButton::clicked, this, &CMainWindow::slotSelectLHSFile);
     connect(fImpl->btnSelectRHSFile, &QToolButton::clicked, this, &CMainWindow::slotSelectRHSFile);
     connect(fImpl->saveBtn, &QPushButton::clicked, this, &CMainWindow::slotSave);
+    connect( fImpl->actionCompareMultiple, &QAction::triggered, this, &CMainWindow::slotCompareMultiple );
+    connect( fImpl->actionMemoryBudget, &QAction::triggered, this, &CMainWindow::slotSetMemoryBudget );
+    connect( fImpl->actionRowFilter, &QAction::triggered, this, &CMainWindow::slotSetRowFilter );
+    connect( fImpl->searchText, &QLineEdit::returnPressed, this, &CMainWindow::slotSearch );
+    connect( fImpl->viewMode, qOverload< int >( &QComboBox::currentIndexChanged ), this, &CMainWindow::slotViewModeChanged );
+    connect( fImpl->searchText, &QLineEdit::textChanged, this, [ this ]( const QString & text )
+             {
+                 if ( text.isEmpty() )
+                     slotSearch();
+             } );
+    for ( auto && list : { fImpl->matchedColumnsLHS, fImpl->matchedColumnsRHS } )
+    {
+        list->setContextMenuPolicy( Qt::CustomContextMenu );
+        connect( list, &QListWidget::customContextMenuRequested, this, [ this, list ]( const QPoint & pos ) { slotMatchedColumnsContextMenu( list, pos ); } );
+        connect( list, &QListWidget::itemChanged, this, [ this, list ]() { slotKeyColumnChanged( list ); } );
+    }
+    connect( fImpl->autoKeyColumns, &QCheckBox::toggled, this, &CMainWindow::slotAutoKeyColumnsChanged );
+    connect( fImpl->actionOrderedDiff, &QAction::toggled, this, &CMainWindow::slotOrderedDiffChanged );
 
     auto completer = new QCompleter(this);
     auto fsModel = new QFileSystemModel(completer);
@@ -100,6 +278,15 @@ void CMainWindow::loadSettings()
 
     fImpl->lhsFile->setText(settings.value("LHSFile", QString()).toString());
     fImpl->rhsFile->setText(settings.value("RHSFile", QString()).toString());
+    fMemoryBudgetMB = settings.value( "MemoryBudgetMB", 0 ).toInt();
+    fPreviewRows = settings.value( "PreviewRows", 100 ).toInt();
+    fKeyNormalizer.load( settings );
+    fRowFilter.load( settings );
+    fImpl->autoKeyColumns->setChecked( settings.value( "AutoKeyColumns", true ).toBool() );
+    fImpl->actionOrderedDiff->setChecked( settings.value( "OrderedDiff", false ).toBool() );
+    fImpl->actionParseComparedColumnsOnly->setChecked( settings.value( "ParseComparedColumnsOnly", true ).toBool() );
+    fImpl->actionCacheResults->setChecked( settings.value( "CacheResults", true ).toBool() );
+    updateMemoryBudget();
 }
 
 void CMainWindow::saveSettings()
@@ -108,18 +295,74 @@ void CMainWindow::saveSettings()
 
     settings.setValue("LHSFile", fImpl->lhsFile->text());
     settings.setValue("RHSFile", fImpl->rhsFile->text());
+    settings.setValue( "MemoryBudgetMB", fMemoryBudgetMB );
+    settings.setValue( "PreviewRows", fPreviewRows );
+    fKeyNormalizer.save( settings );
+    fRowFilter.save( settings );
+    settings.setValue( "AutoKeyColumns", fImpl->autoKeyColumns->isChecked() );
+    settings.setValue( "OrderedDiff", fImpl->actionOrderedDiff->isChecked() );
+    settings.setValue( "ParseComparedColumnsOnly", fImpl->actionParseComparedColumnsOnly->isChecked() );
+    settings.setValue( "CacheResults", fImpl->actionCacheResults->isChecked() );
 }
 
-void CMainWindow::slotFilesChanged()
+void CMainWindow::slotSetMemoryBudget()
+{
+    bool aOK = false;
+    auto budget = QInputDialog::getInt( this, tr( "Memory Budget" ), tr( "Memory budget for the loaded files in MB (0 for no limit):" ), fMemoryBudgetMB, 0, 1024 * 1024, 256, &aOK );
+    if ( !aOK )
+        return;
+    fMemoryBudgetMB = budget;
+    updateMemoryBudget();
+}
+
+void CMainWindow::slotSetRowFilter()
+{
+    auto expression = fRowFilter.expression();
+    while ( true )
+    {
+        bool aOK = false;
+        expression = QInputDialog::getText( this, tr( "Row Filter" ), tr( "Ignore the rows where (empty ignores none, e.g. %1):" ).arg( CRowFilter::defaultExpression() ), QLineEdit::Normal, expression, &aOK );
+        if ( !aOK )
+            return;
+
+        CRowFilter filter;
+        QString msg;
+        if ( filter.parse( expression, &msg ) )
+        {
+            fRowFilter = filter;
+            break;
+        }
+        QMessageBox::critical( this, tr( "Invalid Row Filter" ), msg );
+    }
+    statusBar()->showMessage( tr( "Row filter is now '%1', compare again to apply it" ).arg( fRowFilter.expression() ), 5000 );
+}
+
+void CMainWindow::updateMemoryBudget()
 {
-    QFileInfo lhs(fImpl->lhsFile->text());
-    bool aOK = !fImpl->lhsFile->text().isEmpty() && lhs.exists() && lhs.isFile();
+    // split evenly between the two sides
+    auto bytes = static_cast< qint64 >( fMemoryBudgetMB ) * 1024 * 1024 / 2;
+    fLHS.setMemoryBudget( bytes );
+    fRHS.setMemoryBudget( bytes );
+}
 
-    QFileInfo rhs(fImpl->rhsFile->text());
-    aOK = aOK && !fImpl->rhsFile->text().isEmpty() && rhs.exists() && rhs.isFile();
+bool CMainWindow::filesValid() const
+{
+    // each side is a file, or a glob or ';' separated list of the shards of one
+    auto isInput = []( const QString & fileName )
+    {
+        auto files = SCSVTable::shardFiles( fileName );
+        return !fileName.isEmpty() && !files.isEmpty() && std::all_of( files.begin(), files.end(), []( const QString & ii ) { return QFileInfo( ii ).isFile(); } );
+    };
+    return isInput( fImpl->lhsFile->text() ) && isInput( fImpl->rhsFile->text() );
+}
 
-    fImpl->compareBtn->setEnabled( aOK );
-    if ( aOK )
+void CMainWindow::slotFilesChanged()
+{
+    // the files named while a load runs are compared once it ends and compare is clicked
+    bool aOK = filesValid();
+    fImpl->compareBtn->setEnabled( aOK && !fLoading );
+    fKeyColumnsOverride.clear();
+    if ( aOK && !fLoading )
         QTimer::singleShot( 0, [this]()
                             {
                                 fImpl->compareBtn->animateClick();
@@ -129,16 +372,18 @@ void CMainWindow::slotFilesChanged()
 
 void CMainWindow::slotSelectLHSFile()
 {
-    auto file = QFileDialog::getOpenFileName( this, tr("Select LHS File:"), fImpl->lhsFile->text(), tr( "CSV File (*.csv);;Text Files(*.txt);;All Files(*.*)" ) );
-    if (!file.isEmpty())
-        fImpl->lhsFile->setText( file );
+    // several files are the shards of one side
+    auto files = QFileDialog::getOpenFileNames( this, tr( "Select LHS File or Shards:" ), SCSVTable::shardFiles( fImpl->lhsFile->text() ).value( 0 ), tr( "CSV File (*.csv);;Text Files(*.txt);;All Files(*.*)" ) );
+    if ( !files.isEmpty() )
+        fImpl->lhsFile->setText( files.join( ";" ) );
 }
 
 void CMainWindow::slotSelectRHSFile()
 {
-    auto file = QFileDialog::getOpenFileName( this, tr( "Select RHS File:" ), fImpl->rhsFile->text(), tr( "CSV File (*.csv);;Text Files(*.txt);;All Files(*.*)" ) );
-    if (!file.isEmpty())
-        fImpl->rhsFile->setText( file );
+    // several files are the shards of one side
+    auto files = QFileDialog::getOpenFileNames( this, tr( "Select RHS File or Shards:" ), SCSVTable::shardFiles( fImpl->rhsFile->text() ).value( 0 ), tr( "CSV File (*.csv);;Text Files(*.txt);;All Files(*.*)" ) );
+    if ( !files.isEmpty() )
+        fImpl->rhsFile->setText( files.join( ";" ) );
 }
 
 void CMainWindow::slotLoad()
@@ -146,43 +391,478 @@ void CMainWindow::slotLoad()
     loadFiles();
 }
 
-void CMainWindow::loadFiles()
+void CMainWindow::slotCompareMultiple()
 {
+    auto files = QFileDialog::getOpenFileNames( this, tr( "Select Files to Compare:" ), QFileInfo( fImpl->lhsFile->text() ).absolutePath(), tr( "CSV File (*.csv);;Text Files(*.txt);;All Files(*.*)" ) );
+    if ( files.isEmpty() )
+        return;
+    if ( files.count() < 2 )
+    {
+        QMessageBox::critical( this, tr( "Not enough files" ), tr( "Select at least two files to compare" ) );
+        return;
+    }
+
     NSABUtils::CAutoWaitCursor awc;
 
     clear();
-    if ( !fLHS.loadFile( fImpl->lhsFile->text(), this ) )
+    fNWay.setKeyNormalizer( fKeyNormalizer );
+    fNWay.setRowFilter( fRowFilter );
+    if ( !fNWay.loadFiles( files, this ) || !fNWay.compare( this ) )
+    {
+        clear();
+        return;
+    }
+    loadNWayResults();
+}
+
+void CMainWindow::loadNWayResults()
+{
+    auto mergedModel = fMerged.mergedModel();
+    Q_ASSERT( mergedModel );
+    if ( !mergedModel )
+        return;
+
+    auto header = fNWay.keyColumns();
+    auto firstSource = header.count();
+    QStringList sources;
+    for ( int ii = 0; ii < fNWay.numInputs(); ++ii )
+        sources << QFileInfo( fNWay.input( ii ).fFileName ).fileName();
+    header << sources << tr( "Num Sources" );
+    mergedModel->setHeader( header );
+    mergedModel->setSources( sources, firstSource );
+
+    for ( auto && ii : fNWay.rows() )
+    {
+        auto rowData = fNWay.getRowData( ii );
+        for ( int jj = 0; jj < fNWay.numInputs(); ++jj )
+            rowData << ( ii.fPresence.testBit( jj ) ? tr( "Yes" ) : QString() );
+        rowData << QString::number( ii.numPresent() );
+        mergedModel->addRow( rowData, ii.fPresence );
+    }
+    mergedModel->modelReset();
+
+    fMerged.setTotalCount( fMerged.rowCount() );
+    fMerged.setSubCount( fNWay.numInAll() );
+    fImpl->numMatchedColumns->setText( QString::number( fNWay.keyColumns().count() ) );
+    buildSearchIndex();
+}
+
+void CMainWindow::buildSearchIndex()
+{
+    updateStatusCounts();
+    updateColumnStatistics();
+    fSearchIndex.build( fMerged.mergedModel() );
+    if ( !fImpl->searchText->text().trimmed().isEmpty() )
+        slotSearch();
+    updateMemoryUsage();
+}
+
+void CMainWindow::updateColumnStatistics()
+{
+    fImpl->columnStats->clear();
+    auto && changedValues = fMerged.changedValues();
+    for ( auto && file : { std::make_pair( tr( "LHS" ), &fLHS ), std::make_pair( tr( "RHS" ), &fRHS ) } )
+    {
+        auto && stats = file.second->statistics();
+        for ( int ii = 0; ii < stats.columnCount(); ++ii )
+        {
+            if ( stats.isSkipped( ii ) )
+            {
+                new QTreeWidgetItem( fImpl->columnStats, QStringList() << stats.columns()[ ii ] << file.first << QString() << QString() << QString() << tr( "(not parsed)" ) );
+                continue;
+            }
+
+            auto && sketch = stats.column( ii );
+            auto pos = changedValues.find( stats.columns()[ ii ] );
+            auto changed = ( pos == changedValues.end() ) ? QString() : QString::number( ( *pos ).second );
+
+            auto item = new QTreeWidgetItem( fImpl->columnStats, QStringList() << stats.columns()[ ii ] << file.first << QString::number( sketch.fNumValues ) << QString::number( 100.0 * sketch.emptyRate(), 'f', 1 ) << QString::number( sketch.distinctEstimate() ) << CColumnStatistics::formatTopValues( sketch ) << changed );
+            item->setToolTip( 5, item->text( 5 ) );
+            item->setToolTip( 0, tr( "Type: %1" ).arg( file.second->columnType( ii ).name() ) );
+        }
+    }
+    for ( int ii = 0; ii < fImpl->columnStats->columnCount(); ++ii )
+        fImpl->columnStats->resizeColumnToContents( ii );
+}
+
+void CMainWindow::adviseKeyColumns()
+{
+    fKeyAdvisor.analyze( fLHS.statistics(), fRHS.statistics() );
+    auto columns = fKeyAdvisor.columnNames();
+    fKeyAdvisor.propose( fLHS.sampleRows( columns, CKeyAdvisor::kMaxSampleRows ), fRHS.sampleRows( columns, CKeyAdvisor::kMaxSampleRows ) );
+}
+
+QStringList CMainWindow::keyColumns() const
+{
+    if ( !fKeyColumnsOverride.isEmpty() )
+        return fKeyColumnsOverride;
+    if ( fImpl->autoKeyColumns->isChecked() && fKeyAdvisor.isUnique() )
+        return fKeyAdvisor.proposed();
+    return {};
+}
+
+void CMainWindow::updateMatchedColumns()
+{
+    QSignalBlocker lhsBlocker( fImpl->matchedColumnsLHS );
+    QSignalBlocker rhsBlocker( fImpl->matchedColumnsRHS );
+    fLHS.updateMatchedColumns();
+    fRHS.updateMatchedColumns();
+
+    for ( auto && list : { fImpl->matchedColumnsLHS, fImpl->matchedColumnsRHS } )
+    {
+        for ( int ii = 0; ii < list->count(); ++ii )
+        {
+            auto item = list->item( ii );
+            auto candidate = fKeyAdvisor.candidate( item->data( Qt::UserRole ).toString() );
+            if ( !candidate )
+                continue;
+            item->setToolTip( tr( "Distinct values (est.): LHS %1, RHS %2\nUnique per row: %3%\nFound in both files: %4%%5" )
+                                  .arg( candidate->fLHSDistinct )
+                                  .arg( candidate->fRHSDistinct )
+                                  .arg( 100.0 * candidate->fUniqueness, 0, 'f', 1 )
+                                  .arg( 100.0 * candidate->fOverlap, 0, 'f', 1 )
+                                  .arg( candidate->fEligible ? QString() : tr( "\nNot used as a key, too few of the values are in both files" ) ) );
+        }
+    }
+
+    if ( !fKeyColumnsOverride.isEmpty() )
+        fImpl->keyAdvice->setText( tr( "Key columns chosen by hand: %1" ).arg( fKeyColumnsOverride.join( ", " ) ) );
+    else if ( fKeyAdvisor.candidates().empty() )
+        fImpl->keyAdvice->clear();
+    else if ( !fKeyAdvisor.isUnique() )
+        fImpl->keyAdvice->setText( tr( "No subset of the shared columns is unique in the sampled rows, every shared column is a key" ) );
+    else
+        fImpl->keyAdvice->setText( tr( "Proposed key columns: %1%2" ).arg( fKeyAdvisor.proposed().join( ", " ) ).arg( fImpl->autoKeyColumns->isChecked() ? QString() : tr( " (not used)" ) ) );
+}
+
+void CMainWindow::slotKeyColumnChanged( QListWidget * list )
+{
+    QStringList keys;
+    for ( int ii = 0; ii < list->count(); ++ii )
+    {
+        if ( list->item( ii )->checkState() == Qt::Checked )
+            keys << list->item( ii )->data( Qt::UserRole ).toString();
+    }
+    if ( keys.isEmpty() )
+    {
+        statusBar()->showMessage( tr( "At least one key column is needed" ), 5000 );
+        updateMatchedColumns();
+        return;
+    }
+
+    fKeyColumnsOverride = keys;
+    SFileData::setKeyColumns( fLHS, fRHS, keys );
+    updateMatchedColumns();
+    statusBar()->showMessage( tr( "Key columns are now %1, compare again to apply them" ).arg( keys.join( ", " ) ), 5000 );
+}
+
+void CMainWindow::slotAutoKeyColumnsChanged()
+{
+    fKeyColumnsOverride.clear();
+    SFileData::setKeyColumns( fLHS, fRHS, keyColumns() );
+    updateMatchedColumns();
+    if ( fLHS.numImportantColumns() )
+        statusBar()->showMessage( tr( "Compare again to apply the key columns" ), 5000 );
+}
+
+void CMainWindow::slotOrderedDiffChanged()
+{
+    if ( fLHS.numImportantColumns() )
+        statusBar()->showMessage( fImpl->actionOrderedDiff->isChecked() ? tr( "Compare again to diff the rows in file order" ) : tr( "Compare again to match the rows by key" ), 5000 );
+}
+
+void CMainWindow::updateMemoryUsage()
+{
+    fLHS.reportMemory();
+    fRHS.reportMemory();
+    fMerged.reportMemory();
+    auto && accounting = CMemoryAccounting::instance();
+    accounting.setLive( CMemoryAccounting::eViewModels, &fSearchIndex, fSearchIndex.estimateBytes() );
+
+    fImpl->memoryUsage->clear();
+    for ( int ii = 0; ii < CMemoryAccounting::eNumSubsystems; ++ii )
+    {
+        auto subsystem = static_cast< CMemoryAccounting::ESubsystem >( ii );
+        new QTreeWidgetItem( fImpl->memoryUsage, QStringList() << CMemoryAccounting::name( subsystem ) << CMemoryAccounting::formatBytes( accounting.liveBytes( subsystem ) ) << CMemoryAccounting::formatBytes( accounting.peakBytes( subsystem ) ) );
+    }
+    new QTreeWidgetItem( fImpl->memoryUsage, QStringList() << tr( "Total" ) << CMemoryAccounting::formatBytes( accounting.totalLiveBytes() ) << CMemoryAccounting::formatBytes( accounting.totalPeakBytes() ) );
+
+    for ( auto && ii : { &fLHS, &fRHS } )
+    {
+        auto msg = ii->readBackError();
+        if ( !msg.isEmpty() )
+            statusBar()->showMessage( msg, 5000 );
+    }
+}
+
+void CMainWindow::slotViewModeChanged()
+{
+    if ( auto proxy = qobject_cast< CMergedProxyModel * >( fImpl->mergeData->model() ) )
+        proxy->setViewMode( static_cast< CMergedTableModel::EViewMode >( fImpl->viewMode->currentIndex() ) );
+}
+
+void CMainWindow::slotMatchedColumnsContextMenu( QListWidget * list, const QPoint & pos )
+{
+    auto item = list->itemAt( pos );
+    if ( !item )
+        return;
+
+    auto column = item->data( Qt::UserRole ).toString();
+    auto options = fKeyNormalizer.columnOptions( column );
+
+    QMenu menu( this );
+    for ( auto && ii : CKeyNormalizer::optionNames() )
+    {
+        auto action = menu.addAction( ii.second );
+        action->setCheckable( true );
+        action->setChecked( ( options & ii.first ) != 0 );
+        action->setData( static_cast< int >( ii.first ) );
+    }
+    menu.addSeparator();
+    auto resetAction = menu.addAction( tr( "Reset to Default" ) );
+
+    auto chosen = menu.exec( list->viewport()->mapToGlobal( pos ) );
+    if ( !chosen )
+        return;
+    if ( chosen == resetAction )
+        options = fKeyNormalizer.defaultOptions();
+    else
+        options ^= chosen->data().toInt();
+
+    fKeyNormalizer.setColumnOptions( column, options );
+    updateMatchedColumns();
+    statusBar()->showMessage( tr( "Key normalization for '%1' is now %2, compare again to apply it" ).arg( column ).arg( CKeyNormalizer::optionsToString( options ) ), 5000 );
+}
+
+void CMainWindow::updateStatusCounts()
+{
+    auto mergedModel = fMerged.mergedModel();
+    if ( !mergedModel )
+        return;
+    auto nway = mergedModel->isNWay();
+    fImpl->viewMode->setItemText( CMergedTableModel::eAllRows, tr( "All Rows (%1)" ).arg( mergedModel->numDataRows() ) );
+    fImpl->viewMode->setItemText( CMergedTableModel::eLeftOnlyRows, ( nway ? tr( "Missing From Some (%1)" ) : tr( "LHS Only (%1)" ) ).arg( mergedModel->leftOnlyCount() ) );
+    fImpl->viewMode->setItemText( CMergedTableModel::eRightOnlyRows, ( nway ? tr( "In One Only (%1)" ) : tr( "RHS Only (%1)" ) ).arg( mergedModel->rightOnlyCount() ) );
+    fImpl->viewMode->setItemText( CMergedTableModel::eBothRows, ( nway ? tr( "In All (%1)" ) : tr( "Matched (%1)" ) ).arg( mergedModel->bothCount() ) );
+}
+
+void CMainWindow::slotSearch()
+{
+    auto proxy = qobject_cast< CMergedProxyModel * >( fImpl->mergeData->model() );
+    if ( !proxy )
+        return;
+
+    auto queryText = fImpl->searchText->text().trimmed();
+    if ( queryText.isEmpty() || fSearchIndex.isEmpty() )
+    {
+        proxy->setRowFilter( QBitArray() );
+        return;
+    }
+
+    QString msg;
+    auto rows = fSearchIndex.query( queryText, &msg );
+    if ( !msg.isEmpty() )
+    {
+        statusBar()->showMessage( msg, 5000 );
+        return;
+    }
+    proxy->setRowFilter( rows );
+    statusBar()->showMessage( tr( "%1 matching rows" ).arg( rows.count( true ) ), 5000 );
+}
+
+void CMainWindow::loadFiles()
+{
+    // the files load with the window in use, a second load would start under the first
+    if ( fLoading )
+        return;
+    fLoading = true;
+    fImpl->compareBtn->setEnabled( false );
+    fImpl->actionCompareMultiple->setEnabled( false );
+    loadAndCompare();
+    fLoading = false;
+    fImpl->compareBtn->setEnabled( filesValid() );
+    fImpl->actionCompareMultiple->setEnabled( true );
+}
+
+void CMainWindow::loadAndCompare()
+{
+    std::optional< NSABUtils::CAutoWaitCursor > awc;
+    awc.emplace();
+
+    clear();
+    fLHS.setRowFilter( fRowFilter );
+    fRHS.setRowFilter( fRowFilter );
+    if ( !fLHS.startLoad( fImpl->lhsFile->text(), this ) || !fRHS.startLoad( fImpl->rhsFile->text(), this ) )
     {
         clear();
         return;
     }
+    if ( fImpl->actionParseComparedColumnsOnly->isChecked() )
+        SFileData::setProjection( fLHS, fRHS );
 
-    if ( !fRHS.loadFile( fImpl->rhsFile->text(), this ) )
+    // a pair compared before with the same settings shows its cached results before the files are read in full
+    auto ordered = fImpl->actionOrderedDiff->isChecked();
+    auto cached = !ordered && fImpl->actionCacheResults->isChecked() && showCachedResults();
+
+    // show the first rows and the column match right away, the full load continues from there
+    if ( fPreviewRows > 0 )
+    {
+        if ( ( fLHS.loadRows( fPreviewRows, this ) != SFileData::eLoaded ) || ( fRHS.loadRows( fPreviewRows, this ) != SFileData::eLoaded ) )
+        {
+            clear();
+            return;
+        }
+        SFileData::computeImportantColumns( fLHS, fRHS );
+        fImpl->numMatchedColumns->setText( QString::number( fLHS.numImportantColumns() ) );
+        updateMatchedColumns();
+        statusBar()->showMessage( cached ? tr( "Showing the cached results, loading the rest of the files..." ) : tr( "Showing a preview, loading the rest of the files..." ) );
+        qApp->processEvents();
+    }
+
+    awc.reset();
+    auto status = loadRest();
+    if ( status == SFileData::eFailed )
     {
         clear();
         return;
     }
+    if ( status == SFileData::eCanceled )
+    {
+        // the rows read so far stay in the views, a partial load is never compared or cached
+        fResultCache.close();
+        fMerged.clear();
+        fSearchIndex.clear();
+        statusBar()->showMessage( tr( "Loading canceled, showing the %1 LHS and %2 RHS rows read so far, they are not compared" ).arg( fLHS.rowCount() ).arg( fRHS.rowCount() ) );
+        return;
+    }
+    statusBar()->clearMessage();
+    awc.emplace();
 
-    if ( !SFileData::mergeData( fLHS, fRHS, fMerged, this ) )
+    adviseKeyColumns();
+    if ( cached )
+    {
+        auto confirmed = SFileData::confirmCached( fLHS, fRHS, keyColumns(), fResultCache );
+        fResultCache.close();
+        if ( confirmed )
+        {
+            statusBar()->showMessage( tr( "The files and settings match the last compare of them, the cached results were used" ), 5000 );
+            updateMatchedColumns();
+            return;
+        }
+        // the files changed where the fingerprint did not look, or the advised key columns did
+        statusBar()->showMessage( tr( "The cached results are out of date, comparing the files again" ), 5000 );
+        fMerged.clear();
+    }
+    auto aOK = ordered ? SFileData::mergeOrdered( fLHS, fRHS, fMerged, this, keyColumns() ) : mergeKeyed();
+    if ( !aOK )
     {
         clear();
         return;
     }
-    fImpl->mergeData->sortByColumn( 0, Qt::SortOrder::AscendingOrder );
+    // -1 keeps the diff order
+    fImpl->mergeData->sortByColumn( ordered ? -1 : 0, Qt::SortOrder::AscendingOrder );
 
     fImpl->numMatchedColumns->setText( QString::number( fLHS.numImportantColumns() ) );
-    fLHS.updateMatchedColumns();
-    fRHS.updateMatchedColumns();
+    updateMatchedColumns();
+    buildSearchIndex();
+}
+
+SFileData::ELoadStatus CMainWindow::loadRest()
+{
+    // both files load on the pool at once, the views fill in as the rows arrive and stay usable meanwhile
+    fLHS.beginLoad();
+    fRHS.beginLoad();
+
+    bool canceled = false;
+    auto progress = std::make_unique< QProgressBar >();
+    progress->setRange( 0, 100 );
+    progress->setMaximumWidth( 200 );
+    auto cancelBtn = std::make_unique< QPushButton >( tr( "Cancel" ) );
+    connect( cancelBtn.get(), &QPushButton::clicked, this, [ &canceled ]() { canceled = true; } );
+    statusBar()->addPermanentWidget( progress.get() );
+    statusBar()->addPermanentWidget( cancelBtn.get() );
+
+    QString msg;
+    auto lhsStatus = SFileData::eLoading;
+    auto rhsStatus = SFileData::eLoading;
+    while ( ( lhsStatus == SFileData::eLoading ) || ( rhsStatus == SFileData::eLoading ) )
+    {
+        qApp->processEvents();
+        if ( canceled || !isVisible() )
+        {
+            fLHS.cancelLoad();
+            fRHS.cancelLoad();
+            return SFileData::eCanceled;
+        }
+
+        if ( lhsStatus == SFileData::eLoading )
+            lhsStatus = fLHS.pollLoad( &msg );
+        if ( ( rhsStatus == SFileData::eLoading ) && ( lhsStatus != SFileData::eFailed ) )
+            rhsStatus = fRHS.pollLoad( &msg );
+        if ( ( lhsStatus == SFileData::eFailed ) || ( rhsStatus == SFileData::eFailed ) )
+        {
+            QMessageBox::critical( this, tr( "Could not open" ), msg );
+            return SFileData::eFailed;
+        }
+        progress->setValue( ( fLHS.loadPercent() + fRHS.loadPercent() ) / 2 );
+        QThread::msleep( 5 );
+    }
+    return SFileData::eLoaded;
+}
+
+CResultCache::SKey CMainWindow::cacheKey() const
+{
+    // the advised key columns are only known after the load, the entry records them and they are checked then
+    auto keySetting = !fKeyColumnsOverride.isEmpty() ? fKeyColumnsOverride.join( '\n' ) : QString( fImpl->autoKeyColumns->isChecked() ? "<auto>" : "" );
+    return CResultCache::makeKey( fLHS.fingerprint(), fRHS.fingerprint(), QStringList() << keySetting << fKeyNormalizer.toString() << fRowFilter.expression() );
+}
+
+bool CMainWindow::showCachedResults()
+{
+    if ( !fResultCache.open( cacheKey() ) )
+        return false;
+    if ( SFileData::loadCachedView( fLHS, fRHS, fMerged, this, fResultCache ) != SFileData::eLoaded )
+    {
+        fResultCache.close();
+        return false;
+    }
+    fImpl->mergeData->sortByColumn( 0, Qt::SortOrder::AscendingOrder );
+    fImpl->numMatchedColumns->setText( QString::number( fLHS.numImportantColumns() ) );
+    updateMatchedColumns();
+    buildSearchIndex();
+    return true;
+}
+
+bool CMainWindow::mergeKeyed()
+{
+    auto keyColumns = this->keyColumns();
+    if ( !fImpl->actionCacheResults->isChecked() )
+        return SFileData::mergeData( fLHS, fRHS, fMerged, this, keyColumns );
+
+    std::vector< CResultCache::SRowPair > rowPairs;
+    if ( !SFileData::mergeData( fLHS, fRHS, fMerged, this, keyColumns, &rowPairs ) )
+        return false;
+    QString msg;
+    auto mergedModel = fMerged.mergedModel();
+    if ( !fResultCache.store( cacheKey(), fLHS.contentHash(), fRHS.contentHash(), fLHS.rowCount(), fRHS.rowCount(), keyColumns, rowPairs, fMerged.changedValues(), [ mergedModel ]( int row ) { return mergedModel->rowData( row ); }, &msg ) )
+        statusBar()->showMessage( msg, 5000 );
+    return true;
+}
+
+SFileData::SFileData()
+{
+}
+
+SFileData::~SFileData()
+{
 }
 
 void SFileData::clear()
 {
+    // the loaders read into this, they stop before anything is cleared
+    fFullLoad.reset();
     if ( fTable.first )
-    {
         fTable.first->clear();
-        fTable.first->setRowCount( 0 );
-        fTable.first->setColumnCount( 0 );
-    }
     if ( fTable.second.second )
         fTable.second.second->clear();
 
@@ -198,11 +878,33 @@ void SFileData::clear()
         fMatchedColumns->clear();
     if ( fIgnoredRows )
         fIgnoredRows->clear();
+    fIgnoredRanges.clear();
+    fNumIgnoredRows = 0;
+    fContentHash = 0;
 
-    fRowToMD5.clear();
-    fMD5ToRow.clear();
+    fStatistics.clear();
+    fChangedValues.clear();
+    fKeyIndex.clear();
     fHeaderInfo.clear();
     fImportantCols.clear();
+    fKeyCols.clear();
+    fTypedCols.clear();
+    fReader.reset();
+    fDialect = CCSVDialect();
+    fMergedInfo.clear();
+    fRawColumnCount = 0;
+    fShards.clear();
+    fShardRows.clear();
+    fRowNum = 0;
+    fLineNum = 0;
+    fProjection.clear();
+    fRowLines.clear();
+    fLazyRows.clear();
+    fLazyLRU.clear();
+    fLazyError.clear();
+    fLineIndex.close();
+    fLoadedSize = -1;
+    fLoadedModified = QDateTime();
 }
 
 void CMainWindow::clear()
@@ -210,8 +912,16 @@ void CMainWindow::clear()
     fLHS.clear();
     fRHS.clear();
     fMerged.clear();
+    fNWay.clear();
+    fSearchIndex.clear();
+    fImpl->columnStats->clear();
+    fKeyAdvisor.clear();
+    fImpl->keyAdvice->clear();
+    if ( auto proxy = qobject_cast< CMergedProxyModel * >( fImpl->mergeData->model() ) )
+        proxy->setRowFilter( QBitArray() );
 
     fImpl->numMatchedColumns->setText( QString() );
+    updateMemoryUsage();
 }
 
 void CMainWindow::slotSave()
@@ -261,36 +971,52 @@ void SFileData::save( QWidget * parent )
 void SFileData::writeRow( QTextStream & ts, QStringList & rowData ) const
 {
     for ( auto && ii : rowData )
-        ii = QString( R"("%1")" ).arg( ii );
+        ii = QString( R"("%1")" ).arg( QString( ii ).replace( "\"", "\"\"" ) );
     ts << rowData.join( "," ) << Qt::endl;
 }
 
 bool SFileData::loadFile( const QString & fileName, QWidget * parent )
 {
-    QFile fi( fileName );
-    fi.open( QFile::Text | QFile::ReadOnly );
-    if ( !fi.isOpen() )
+    if ( !startLoad( fileName, parent ) )
+        return false;
+    return loadRows( -1, parent ) == eLoaded;
+}
+
+bool SFileData::startLoad( const QString & fileName, QWidget * parent )
+{
+    fFullLoad.reset();
+    fFileName = fileName;
+    fRowNum = 0;
+    fLineNum = 0;
+    fIgnoredRanges.clear();
+    fNumIgnoredRows = 0;
+    fContentHash = 0;
+    fShards = SCSVTable::shardFiles( fileName );
+    if ( fShards.isEmpty() )
+    {
+        QMessageBox::critical( parent, "Could not open", QString( "No files match '%1'" ).arg( fileName ) );
+        return false;
+    }
+    fReader = std::make_unique< CCSVReader >();
+    if ( !fReader->open( fShards.front() ) )
     {
         QMessageBox::critical( parent, "Could not open", QString( "Error opening file '%1'" ).arg( fileName ) );
         return false;
     }
-
-    QProgressDialog dlg( QObject::tr( "Loading File '%1'..." ).arg( fileName ), "Cancel", 0, 0, parent );
-    dlg.setMinimumDuration( 0 );
-    dlg.setValue( 1 );
-    int lineNums = computeNumberOfLines( fi, &dlg );
-
-    dlg.setRange( 0, lineNums );
-    dlg.setValue( 1 );
-
-    QTextStream ts( &fi );
+    QFileInfo loadedInfo( fShards.front() );
+    fLoadedSize = loadedInfo.size();
+    fLoadedModified = loadedInfo.lastModified();
+    fDialect = CCSVDialect::sniff( fReader->peek( CCSVDialect::kSampleBytes ) );
+    fReader->setLineEnd( fDialect.lineEnd() );
 
     QString firstLine;
-    while ( firstLine.isEmpty() )
+    QByteArray rawLine;
+    while ( firstLine.isEmpty() && fReader->readLine( rawLine ) )
     {
-        firstLine = ts.readLine().trimmed();
+        fContentHash = NKeyHash::hash64( rawLine.constData(), rawLine.size(), fContentHash );
+        firstLine = fDialect.trimmed( QString::fromUtf8( rawLine ) );
     }
-    auto header = getRow( firstLine );
+    auto header = getRow( firstLine, {}, fDialect );
     if ( !header.has_value() || !header.value().first || header.value().second.isEmpty() )
     {
         QMessageBox::critical( parent, "Could not open", QString( "Invalid format '%1' at Row: %2" ).arg( fileName ).arg( 1 ) );
@@ -298,218 +1024,644 @@ bool SFileData::loadFile( const QString & fileName, QWidget * parent )
     }
 
     auto headerRow = header.value().second;
-    TMergedType merged;
-    for ( int ii = 0; ii < headerRow.count(); ++ii )
+    fRawColumnCount = headerRow.count();
+    fRowFilter.bind( headerRow );
+    QStringList mergedColumnNames;
+    fMergedInfo = computeMergedColumns( headerRow, fExtraUnimportantCols, &mergedColumnNames );
+    if ( fMergedColumns )
     {
-        if ( headerRow[ ii ].toLower() == "first name" )
-        {
-            merged[ ii ] = { ii, 0 };
-            if ( fMergedColumns )
-                new QTreeWidgetItem( fMergedColumns, QStringList() << headerRow[ ii ] << "Name( 0 )" );
-            headerRow[ ii ] = "Name";
-        }
-        else if ( headerRow[ ii ].toLower() == "remarks" )
-        {
-            fExtraUnimportantCols[ ii ] = QString();
-        }
-        else if ( headerRow[ ii ].toLower() == "call type" )
+        for ( int ii = 0; ii < mergedColumnNames.count(); ++ii )
+            new QTreeWidgetItem( fMergedColumns, QStringList() << mergedColumnNames[ ii ] << QString( "Name( %1 )" ).arg( ii ) );
+    }
+    if ( fExtraColumns )
+    {
+        for ( auto && ii : fExtraUnimportantCols )
+            new QListWidgetItem( QString( "%1(%2)" ).arg( header.value().second[ ii.first ] ).arg( ii.first ), fExtraColumns );
+    }
+
+    if ( fTable.first )
+    {
+        fTable.first->setHeader( headerRow );
+        fTable.first->store().setPinnedColumns( pinnedColumns() );
+    }
+    computeHeaderInfo();
+    fStatistics.setColumns( headerRow );
+    inferColumnTypes();
+    return true;
+}
+
+void SFileData::inferColumnTypes()
+{
+    if ( !fTable.first )
+        return;
+
+    // the sample comes from readers of its own, so the load continues where the header ended.
+    // Sharded files are sampled across a stride of the shards, the first alone may not be typical of the rest
+    auto numColumns = columnCount();
+    std::vector< std::vector< QString > > samples( numColumns );
+    auto sampled = SCSVTable::sampledShards( fShards.count() );
+    auto perShard = std::max( 1, CColumnType::kSampleRows / static_cast< int >( sampled.size() ) );
+    for ( auto && shard : sampled )
+    {
+        CCSVReader reader;
+        if ( !reader.open( fShards[ shard ] ) )
+            continue;
+        reader.setLineEnd( fDialect.lineEnd() );
+
+        bool header = true;
+        int numRows = 0;
+        QByteArray rawLine;
+        while ( ( numRows < perShard ) && reader.readLine( rawLine ) )
         {
-            fExtraUnimportantCols[ ii ] = "Private Call";
+            auto currRow = getRow( QString::fromUtf8( rawLine ), fMergedInfo, fDialect );
+            if ( !currRow.has_value() || !currRow.value().first )
+                continue;
+            if ( header )
+            {
+                header = false;
+                continue;
+            }
+
+            auto && rowData = currRow.value().second;
+            if ( rowData.count() != numColumns )
+                continue;
+            for ( int ii = 0; ii < numColumns; ++ii )
+                samples[ ii ].push_back( rowData[ ii ] );
+            ++numRows;
         }
-        else if ( headerRow[ ii ].toLower() == "call alert" )
+    }
+
+    for ( int ii = 0; ii < numColumns; ++ii )
+        fTable.first->store().setColumnType( ii, CColumnType::infer( samples[ ii ] ) );
+}
+
+CColumnType SFileData::columnType( int col ) const
+{
+    if ( !fTable.first || ( col < 0 ) || ( col >= fTable.first->store().columnCount() ) )
+        return {};
+    return fTable.first->store().columnType( col );
+}
+
+QString SFileData::keyText( int row, int col ) const
+{
+    // typed columns match on the value, so 00123 and 123 are the same key
+    if ( fTable.first && ( fTypedCols.find( col ) != fTypedCols.end() ) )
+    {
+        auto value = fTable.first->store().typedValue( row, col );
+        if ( value != CColumnType::kNotTyped )
+            return fTable.first->store().columnType( col ).keyText( value );
+    }
+    return itemText( row, col );
+}
+
+SFileData::ELoadStatus SFileData::loadRows( int maxRows, QWidget * parent )
+{
+    if ( !fReader )
+        return eFailed;
+
+    auto numColumns = columnCount();
+    std::unique_ptr< QProgressDialog > dlg;
+    std::unique_ptr< CShardLoader > shardLoader;
+    if ( maxRows < 0 )
+    {
+        // the rows are parsed on the pool, the dialog keeps the windows from changing under the reader meanwhile
+        dlg = std::make_unique< QProgressDialog >( QObject::tr( "Loading File '%1'..." ).arg( fFileName ), "Cancel", 0, 0, parent );
+        dlg->setWindowModality( Qt::WindowModal );
+        dlg->setMinimumDuration( 0 );
+        dlg->setValue( 1 );
+        // the other shards load alongside the first, so the progress covers their estimated lines too
+        int lineNums = computeNumberOfLines( fShards.front(), dlg.get() );
+        if ( fShards.count() > 1 )
         {
-            fExtraUnimportantCols[ ii ] = "None";
+            lineNums += estimateNumberOfLines( fShards.mid( 1 ) );
+            shardLoader = std::make_unique< CShardLoader >( fShards.mid( 1 ), fRowFilter );
         }
+
+        dlg->setRange( 0, lineNums );
+        dlg->setValue( fRowNum );
     }
-    for ( auto && ii : fExtraUnimportantCols )
+
+    SRowBatch batch;
+    if ( !dlg )
     {
-        if ( fExtraColumns )
-            new QListWidgetItem( QString( "%1(%2)" ).arg( headerRow[ ii.first ] ).arg( ii.first ), fExtraColumns );
+        // a bounded preview is quick enough to read here, without the line count and progress dialog
+        readRows( maxRows, numColumns, batch );
+        addRows( batch );
     }
-    if ( !merged.empty() )
+    else
     {
-        for ( int ii = 0; ii < headerRow.count(); ++ii )
+        CRowLoader rowLoader( *this, numColumns );
+        while ( !batch.fAtEnd && batch.fError.isEmpty() )
         {
-            if ( headerRow[ ii ].toLower() == "last name" )
+            qApp->processEvents();
+            if ( dlg->wasCanceled() )
+                return eCanceled;
+            if ( !rowLoader.next( batch ) )
             {
-                if ( fMergedColumns )
-                    new QTreeWidgetItem( fMergedColumns, QStringList() << headerRow[ ii ] << "Name( 1 )" );
-
-                auto firstPos = ( *merged.begin() ).second.first;
-                merged[ ii ] = { firstPos, 1 };
-                headerRow.removeAt( ii );
-                break;
+                QThread::msleep( 10 );
+                continue;
             }
+            addRows( batch );
+            if ( fTable.first )
+                fTable.first->syncRowCount();
+            dlg->setValue( std::min( fRowNum + ( shardLoader ? shardLoader->linesDone() : 0 ), dlg->maximum() ) );
+        }
+    }
+    if ( !batch.fError.isEmpty() )
+    {
+        QMessageBox::critical( parent, "Could not open", batch.fError );
+        return eFailed;
+    }
+
+    if ( shardLoader )
+    {
+        dlg->setLabelText( QObject::tr( "Loading %1 Shards of '%2'..." ).arg( fShards.count() ).arg( fFileName ) );
+        if ( !shardLoader->wait( dlg.get(), fRowNum ) )
+            return eCanceled;
+        auto msg = shardLoader->error();
+        if ( msg.isEmpty() )
+            msg = appendShards( shardLoader->tables(), dlg.get() );
+        if ( !msg.isEmpty() )
+        {
+            QMessageBox::critical( parent, "Could not open", msg );
+            return eFailed;
         }
     }
-    
     if ( fTable.first )
+        fTable.first->syncRowCount();
+    setTotalCount( rowCount() );
+    updateIgnoredRows();
+
+    return eLoaded;
+}
+
+void SFileData::beginLoad()
+{
+    fFullLoad.reset();
+    if ( !fReader )
+        return;
+
+    // the line count is estimated, counting the lines first would read the file twice before the rows show
+    fFullLoad = std::make_unique< SFullLoad >();
+    fFullLoad->fNumLines = estimateNumberOfLines( fShards );
+    if ( fShards.count() > 1 )
+        fFullLoad->fShards = std::make_unique< CShardLoader >( fShards.mid( 1 ), fRowFilter );
+    fFullLoad->fRows = std::make_unique< CRowLoader >( *this, columnCount() );
+}
+
+SFileData::ELoadStatus SFileData::pollLoad( QString * errorMsg )
+{
+    if ( !fFullLoad )
+        return fReader ? eLoaded : eFailed;
+
+    // a few batches per poll, so the other side and the views get their turn
+    auto fail = [ this, errorMsg ]( const QString & msg )
+    {
+        fFullLoad.reset();
+        if ( errorMsg )
+            *errorMsg = msg;
+        return eFailed;
+    };
+    SRowBatch batch;
+    for ( int ii = 0; fFullLoad->fRows && ( ii < 4 ) && fFullLoad->fRows->next( batch ); ++ii )
+    {
+        addRows( batch );
+        if ( !batch.fError.isEmpty() )
+            return fail( batch.fError );
+        if ( batch.fAtEnd )
+            fFullLoad->fRows.reset();
+    }
+    if ( fTable.first )
+        fTable.first->syncRowCount();
+    setTotalCount( rowCount() );
+    if ( fFullLoad->fRows )
+        return eLoading;
+
+    if ( fFullLoad->fShards )
     {
-        fTable.first->setColumnCount( headerRow.count() );
-        fTable.first->setHorizontalHeaderLabels( headerRow );
-        fTable.first->setRowCount( lineNums - 1 );
+        if ( !fFullLoad->fShards->isDone() )
+            return eLoading;
+        auto msg = fFullLoad->fShards->error();
+        if ( msg.isEmpty() )
+            msg = appendShards( fFullLoad->fShards->tables(), nullptr );
+        if ( !msg.isEmpty() )
+            return fail( msg );
     }
+    fFullLoad.reset();
+    setTotalCount( rowCount() );
+    updateIgnoredRows();
+    return eLoaded;
+}
+
+void SFileData::cancelLoad()
+{
+    if ( !fFullLoad )
+        return;
+
+    // the batches still queued and the shards are dropped, the rows in the store stay
+    fFullLoad.reset();
+    if ( fTable.first )
+        fTable.first->syncRowCount();
+    if ( fTotalCount )
+        fTotalCount->setText( QObject::tr( "%1 (partial)" ).arg( rowCount() ) );
+    updateIgnoredRows();
+}
 
-    QString currLine;
+int SFileData::loadPercent() const
+{
+    if ( !fFullLoad )
+        return 100;
+    if ( fFullLoad->fNumLines <= 0 )
+        return 0;
+    qint64 linesDone = fRowNum + fNumIgnoredRows + ( fFullLoad->fShards ? fFullLoad->fShards->linesDone() : 0 );
+    return static_cast< int >( std::min< qint64 >( linesDone * 100 / fFullLoad->fNumLines, 99 ) );
+}
 
-    int rowNum = 0;
-    int lineNum = 0;
-    while ( ts.readLineInto( &currLine ) )
+void SFileData::readRows( int maxRows, int numColumns, SRowBatch & batch )
+{
+    batch = SRowBatch();
+    QByteArray rawLine;
+    while ( static_cast< int >( batch.fRows.size() ) < maxRows )
     {
-        if ( ( rowNum % 1000 ) == 0 )
-            qApp->processEvents();
-        if ( dlg.wasCanceled() )
-            return false;
+        if ( !fReader->readLine( rawLine ) )
+        {
+            batch.fAtEnd = true;
+            if ( fReader->hasError() )
+                batch.fError = QString( "Error reading file '%1': %2" ).arg( fFileName ).arg( fReader->errorString() );
+            return;
+        }
+        fContentHash = NKeyHash::hash64( rawLine.constData(), rawLine.size(), fContentHash );
 
-#ifdef _DEBUG
-        if ( rowNum >= 2000 )
-            break;
-#endif
+        // the row filter runs on the raw bytes, an ignored row is never parsed
+        auto rowType = fRowFilter.classify( rawLine, fDialect );
+        if ( rowType == CRowFilter::eBlank )
+            continue;
+        if ( rowType == CRowFilter::eIgnored )
+        {
+            batch.fIgnoredLines.push_back( ++fLineNum );
+            continue;
+        }
 
-        auto currRow = getRow( currLine, merged );
+        auto currRow = fProjection.empty() ? getRow( QString::fromUtf8( rawLine ), fMergedInfo, fDialect ) : getProjectedRow( rawLine, fProjection, fMergedInfo, fDialect );
         if ( !currRow.has_value() ) // empty line after comments removed
             continue;
         if ( !currRow.value().first )
         {
-            QMessageBox::critical( parent, "Could not open", QString( "Invalid format in file '%1' at Row: %2" ).arg( fileName ).arg( lineNum + 1) );
-            return false;
+            batch.fError = QString( "Invalid format in file '%1' at Row: %2" ).arg( fFileName ).arg( fLineNum + 1 );
+            return;
         }
 
-        lineNum++;
-        auto currRowData = currRow.value().second;
+        fLineNum++;
+        if ( currRow.value().second.count() != numColumns )
+        {
+            batch.fError = QString( "Invalid number of columns in file '%1' at Row: %2" ).arg( fFileName ).arg( fLineNum + 1 );
+            return;
+        }
+        batch.fRows.push_back( std::move( currRow.value().second ) );
+        if ( !fProjection.empty() )
+            batch.fRowLines.push_back( fReader->lineNumber() );
+    }
+}
+
+void SFileData::addRows( SRowBatch & batch )
+{
+    for ( auto && ii : batch.fIgnoredLines )
+        addIgnoredRow( ii );
+    for ( auto && ii : batch.fRows )
+    {
+        fStatistics.addRow( ii );
+        if ( fTable.first )
+            fTable.first->store().addRow( ii );
+        ++fRowNum;
+    }
+    fRowLines.insert( fRowLines.end(), batch.fRowLines.begin(), batch.fRowLines.end() );
+    batch.fRows.clear();
+}
+
+QString SFileData::appendShards( std::vector< SCSVTable > & shards, QProgressDialog * dlg )
+{
+    auto header = getHeader();
+    for ( size_t ii = 0; ii < shards.size(); ++ii )
+    {
+        if ( shards[ ii ].fHeader != header )
+            return QString( "The header of shard '%1' does not match the header of '%2'" ).arg( fShards[ static_cast< int >( ii ) + 1 ] ).arg( fShards.front() );
+    }
 
-        if ( isIgnoredRow( currRowData ) )
+    // global row ids follow the shard order, each shard's rows are freed once they are in the store
+    if ( dlg )
+    {
+        dlg->setLabelText( QObject::tr( "Adding %1 Shards of '%2'..." ).arg( fShards.count() ).arg( fFileName ) );
+        dlg->setRange( 0, static_cast< int >( shards.size() ) );
+    }
+    fShardRows = { 0 };
+    for ( size_t ii = 0; ii < shards.size(); ++ii )
+    {
+        qApp->processEvents();
+        if ( dlg )
+            dlg->setValue( static_cast< int >( ii ) );
+
+        auto && shard = shards[ ii ];
+        fShardRows.push_back( fRowNum );
+        for ( auto && jj : shard.fIgnoredLines )
+            addIgnoredRow( fLineNum + jj );
+        fLineNum += shard.rowCount() + shard.numIgnoredRows();
+        for ( auto && jj : shard.fRows )
         {
-            if ( fIgnoredRows )
-                new QListWidgetItem( QString( "%1 - %2" ).arg( lineNum ).arg( currLine ), fIgnoredRows );
-            continue;
+            fStatistics.addRow( jj );
+            if ( fTable.first )
+                fTable.first->store().addRow( jj );
+            ++fRowNum;
+        }
+        fContentHash = NKeyHash::hash64( reinterpret_cast< const char * >( &shard.fContentHash ), sizeof( shard.fContentHash ), fContentHash );
+        shard.clear();
+        if ( fTable.first )
+            fTable.first->syncRowCount();
+    }
+    return {};
+}
+
+SFileData::TMergedType SFileData::computeMergedColumns( QStringList & headerRow, std::map< int, QString > & extraCols, QStringList * mergedColumnNames )
+{
+    TMergedType merged;
+    for ( int ii = 0; ii < headerRow.count(); ++ii )
+    {
+        if ( headerRow[ ii ].toLower() == "first name" )
+        {
+            merged[ ii ] = { ii, 0 };
+            if ( mergedColumnNames )
+                mergedColumnNames->push_back( headerRow[ ii ] );
+            headerRow[ ii ] = "Name";
         }
-        if ( currRowData.count() != headerRow.count() )
+        else if ( headerRow[ ii ].toLower() == "remarks" )
         {
-            QMessageBox::critical( parent, "Could not open", QString( "Invalid number of columns in file '%1' at Row: %2" ).arg( fileName ).arg( lineNum + 1 ) );
-            return false;
+            extraCols[ ii ] = QString();
+        }
+        else if ( headerRow[ ii ].toLower() == "call type" )
+        {
+            extraCols[ ii ] = "Private Call";
         }
-        for ( int ii = 0; ii < currRowData.count(); ++ii )
+        else if ( headerRow[ ii ].toLower() == "call alert" )
         {
-            auto item = new QTableWidgetItem( currRowData[ ii ] );
-            if ( fTable.first )
-                fTable.first->setItem( rowNum, ii, item );
+            extraCols[ ii ] = "None";
         }
-        dlg.setValue( rowNum );
-        ++rowNum;
     }
-    if ( fTable.first )
-        fTable.first->setRowCount( rowNum );
-    computeHeaderInfo();
-    if ( fTable.first )
-        setTotalCount( fTable.first->rowCount() );
+    if ( !merged.empty() )
+    {
+        for ( int ii = 0; ii < headerRow.count(); ++ii )
+        {
+            if ( headerRow[ ii ].toLower() == "last name" )
+            {
+                if ( mergedColumnNames )
+                    mergedColumnNames->push_back( headerRow[ ii ] );
 
-    return true;
+                auto firstPos = ( *merged.begin() ).second.first;
+                merged[ ii ] = { firstPos, 1 };
+                headerRow.removeAt( ii );
+                break;
+            }
+        }
+    }
+    return merged;
 }
 
-bool SFileData::isIgnoredRow( const QStringList & currRowData ) const
+void SFileData::addIgnoredRow( int lineNum )
 {
-    for ( auto && ii : currRowData )
-    {
-        if ( ii == "0" || ii.isEmpty() )
-            continue;
-        return false;
-    }
-    return true;
+    fNumIgnoredRows++;
+    if ( !fIgnoredRanges.empty() && ( fIgnoredRanges.back().second + 1 == lineNum ) )
+        fIgnoredRanges.back().second = lineNum;
+    else
+        fIgnoredRanges.emplace_back( lineNum, lineNum );
 }
 
-int SFileData::computeNumberOfLines( QFile & fi, QProgressDialog * dlg ) const
+void SFileData::updateIgnoredRows()
 {
-    int retVal = 0;
-    QTextStream ts( &fi );
-    while ( ts.readLineInto( nullptr ) )
-    {
-        if ( ( retVal % 1000 ) == 0 )
-            qApp->processEvents();
-        if ( dlg->wasCanceled() )
-            return false;
-#ifdef _DEBUG
-        if ( retVal >= 2000 )
-            break;
-#endif
+    if ( !fIgnoredRows )
+        return;
 
-        retVal++;
+    fIgnoredRows->clear();
+    for ( auto && ii : fIgnoredRanges )
+    {
+        if ( ii.first == ii.second )
+            new QListWidgetItem( QString( "%1" ).arg( ii.first ), fIgnoredRows );
+        else
+            new QListWidgetItem( QString( "%1 - %2 (%3 rows)" ).arg( ii.first ).arg( ii.second ).arg( ii.second - ii.first + 1 ), fIgnoredRows );
     }
+    fIgnoredRows->setToolTip( QObject::tr( "%n row(s) ignored by the row filter '%1'", "", fNumIgnoredRows ).arg( fRowFilter.expression() ) );
+}
 
-    fi.seek( 0 );
+int SFileData::computeNumberOfLines( const QString & fileName, QProgressDialog * dlg ) const
+{
+    // counted on its own reader, so it does not disturb a load already in progress
+    CCSVReader reader;
+    if ( !reader.open( fileName ) )
+        return 0;
+    reader.setLineEnd( fDialect.lineEnd() );
+    int retVal = reader.countLines( [ dlg ]( int /*lineNum*/ )
+                                    {
+                                        qApp->processEvents();
+                                        return !dlg->wasCanceled();
+                                    } );
+    if ( retVal < 0 )
+        return 0;
     return retVal;
 }
 
-bool SFileData::mergeData( SFileData & lhs, SFileData & rhs, SFileData & retVal, QWidget * parent )
+int SFileData::estimateNumberOfLines( const QStringList & fileNames ) const
+{
+    // the line length is sampled from the start of a stride of the files, their sizes give the count
+    qint64 totalBytes = 0;
+    for ( auto && ii : fileNames )
+        totalBytes += QFileInfo( ii ).size();
+
+    qint64 sampledBytes = 0;
+    qint64 sampledLines = 0;
+    for ( auto && ii : SCSVTable::sampledShards( fileNames.count() ) )
+    {
+        QFile file( fileNames[ ii ] );
+        if ( !file.open( QFile::ReadOnly ) )
+            continue;
+        auto sample = file.read( CCSVDialect::kSampleBytes );
+        sampledBytes += sample.size();
+        sampledLines += sample.count( fDialect.lineEnd() );
+    }
+    if ( sampledLines == 0 )
+        return 0;
+    return static_cast< int >( std::min< qint64 >( totalBytes * sampledLines / sampledBytes, std::numeric_limits< int >::max() / 2 ) );
+}
+
+bool SFileData::mergeData( SFileData & lhs, SFileData & rhs, SFileData & retVal, QWidget * parent, const QStringList & keyColumns, std::vector< CResultCache::SRowPair > * rowPairs )
 {
     auto mergedModel = retVal.fTable.second.second;
     Q_ASSERT( mergedModel );
     if ( !mergedModel )
         return false;
 
-    if ( !computeMD5s( lhs, rhs, parent ) )
+    if ( !computeMD5s( lhs, rhs, keyColumns, parent ) )
     {
         return false;
     }
 
     QProgressDialog dlg( QObject::tr( "Merging Data..." ), "Cancel", 0, 0, parent );
-    dlg.setRange( 0, lhs.rowCount() + rhs.rowCount() );
+    dlg.setRange( 0, std::max( lhs.rowCount(), rhs.rowCount() ) );
     dlg.setValue( 0 );
     dlg.setMinimumDuration( 0 );
 
-    std::multimap< int, std::pair< int, int > > mergedData;
-    // new row -> lhsrow, rhsRow
+    // the same join the headless compares run, LHS row N then RHS only row N
+    std::vector< std::pair< int, int > > mergedData;
+    auto progress = [ &dlg ]( int done )
+    {
+        qApp->processEvents();
+        dlg.setValue( done );
+        return !dlg.wasCanceled();
+    };
+    if ( !SKeyIndex::join( lhs.fKeyIndex, rhs.fKeyIndex, mergedData, progress ) )
+        return false;
+
+    std::vector< CResultCache::SRowPair > pairs;
+    pairs.reserve( mergedData.size() );
+    for ( auto && ii : mergedData )
+        pairs.push_back( { ii.first, ii.second } );
+    mergedData = {};
 
-    int cnt = 0;
-    for ( auto && ii : lhs.fRowToMD5 )
+    if ( !loadMerged( lhs, rhs, retVal, pairs.data(), static_cast< int >( pairs.size() ), dlg ) )
+        return false;
+    if ( rowPairs )
+        *rowPairs = std::move( pairs );
+    return true;
+}
+
+SFileData::ELoadStatus SFileData::loadCachedView( SFileData & lhs, SFileData & rhs, SFileData & retVal, QWidget * parent, const CResultCache & cache )
+{
+    auto mergedModel = retVal.fTable.second.second;
+    Q_ASSERT( mergedModel );
+    if ( !mergedModel )
+        return eFailed;
+
+    // the column matching only needs the headers, and has to agree with the entry
+    computeImportantColumns( lhs, rhs );
+    setKeyColumns( lhs, rhs, cache.keyColumns() );
+    std::map< QString, qint64 > sharedColumns;
+    for ( auto && ii : lhs.fHeaderInfo )
     {
-        if ( ( cnt % 1000 ) == 0 )
-            qApp->processEvents();
-        if ( dlg.wasCanceled() )
-            return false;
-        dlg.setValue( cnt++ );
+        if ( rhs.fHeaderInfo.find( ii.first ) != rhs.fHeaderInfo.end() )
+            sharedColumns[ ii.first ] = 0;
+    }
+    auto && changedValues = cache.changedValues();
+    if ( ( sharedColumns.size() != changedValues.size() ) || !std::equal( sharedColumns.begin(), sharedColumns.end(), changedValues.begin(), []( auto && lhsCol, auto && rhsCol ) { return lhsCol.first == rhsCol.first; } ) )
+        return eFailed;
 
-        auto && md5 = ii.second;
-        auto pos = rhs.fMD5ToRow.find( md5 );
-        if ( pos == rhs.fMD5ToRow.end() )
-        {
-            mergedData.insert( std::make_pair( ii.first, std::make_pair( ii.first, -1 ) ) );
-        }
-        else
+    QProgressDialog dlg( QObject::tr( "Loading Cached Results..." ), "Cancel", 0, cache.numRowPairs(), parent );
+    dlg.setMinimumDuration( 0 );
+    setMergedHeader( lhs, rhs, retVal );
+    auto numColumns = mergedModel->columnCount();
+    auto rowPairs = cache.rowPairs();
+    bool canceled = false;
+    auto aOK = cache.readView(
+        [ & ]( int row, const QStringList & rowData )
         {
-            mergedData.insert( std::make_pair( ii.first, std::make_pair( ii.first, ( *pos ).second ) ) );
-        }
+            if ( ( row % 1000 ) == 0 )
+            {
+                qApp->processEvents();
+                dlg.setValue( row );
+                canceled = dlg.wasCanceled();
+            }
+            auto && currMergeInfo = rowPairs[ row ];
+            if ( canceled || ( rowData.count() != numColumns ) || ( ( currMergeInfo.fLHSRow == -1 ) && ( currMergeInfo.fRHSRow == -1 ) ) )
+                return false;
+            mergedModel->addRow( rowData, currMergeInfo.fRHSRow == -1, currMergeInfo.fLHSRow == -1, false );
+            return true;
+        } );
+    if ( !aOK )
+    {
+        mergedModel->clear();
+        return canceled ? eCanceled : eFailed;
     }
-    for ( auto && ii : rhs.fRowToMD5 )
+    retVal.fChangedValues = changedValues;
+    mergedModel->modelReset();
+    showMergedCounts( lhs, rhs, retVal );
+    return eLoaded;
+}
+
+bool SFileData::confirmCached( SFileData & lhs, SFileData & rhs, const QStringList & keyColumns, const CResultCache & cache )
+{
+    // the fingerprint the entry was found by samples the files, the content hashes cover every line
+    if ( ( cache.lhsContentHash() != lhs.contentHash() ) || ( cache.rhsContentHash() != rhs.contentHash() ) || ( cache.numLHSRows() != lhs.rowCount() ) || ( cache.numRHSRows() != rhs.rowCount() ) || ( cache.keyColumns() != keyColumns ) )
+        return false;
+    auto rowPairs = cache.rowPairs();
+    for ( int ii = 0; ii < cache.numRowPairs(); ++ii )
     {
-        if ( ( cnt % 1000 ) == 0 )
-            qApp->processEvents();
-        if ( dlg.wasCanceled() )
+        auto && curr = rowPairs[ ii ];
+        if ( ( curr.fLHSRow < -1 ) || ( curr.fLHSRow >= lhs.rowCount() ) || ( curr.fRHSRow < -1 ) || ( curr.fRHSRow >= rhs.rowCount() ) )
             return false;
-        dlg.setValue( cnt++ );
+    }
 
-        auto && md5 = ii.second;
-        auto pos = lhs.fMD5ToRow.find( md5 );
-        if ( pos == lhs.fMD5ToRow.end() )
-        {
-            mergedData.insert( std::make_pair( ii.first, std::make_pair( -1, ii.first ) ) );
-        }
+    for ( int ii = 0; ii < cache.numRowPairs(); ++ii )
+    {
+        auto && curr = rowPairs[ ii ];
+        if ( curr.fRHSRow == -1 )
+            lhs.setOnlyRow( curr.fLHSRow );
+        else if ( curr.fLHSRow == -1 )
+            rhs.setOnlyRow( curr.fRHSRow );
+    }
+    if ( lhs.fTable.first )
+        lhs.fTable.first->rowStatusChanged();
+    if ( rhs.fTable.first )
+        rhs.fTable.first->rowStatusChanged();
+    return true;
+}
+
+void SFileData::setMergedHeader( SFileData & lhs, SFileData & rhs, SFileData & retVal )
+{
+    if ( !retVal.fTable.second.second )
+        return;
+    retVal.fTable.second.second->setHeader( lhs.getColumns() + lhs.getExtraColumns() + rhs.getExtraColumns() );
+
+    // the shared columns hold values of both files
+    std::vector< CColumnType > types;
+    for ( auto && ii : lhs.fImportantCols )
+    {
+        auto pos = rhs.fHeaderInfo.find( lhs.getHeader( ii ) );
+        types.push_back( ( pos == rhs.fHeaderInfo.end() ) ? CColumnType() : CColumnType::common( lhs.columnType( ii ), rhs.columnType( ( *pos ).second ) ) );
+    }
+    for ( auto && ii : { &lhs, &rhs } )
+    {
+        for ( auto && jj : ii->fExtraUnimportantCols )
+            types.push_back( ii->columnType( jj.first ) );
     }
+    retVal.fTable.second.second->setColumnTypes( types );
+}
 
-    auto mergedDataCount = static_cast<int>( mergedData.size() );
+void SFileData::showMergedCounts( SFileData & lhs, SFileData & rhs, SFileData & retVal )
+{
+    // the counts come straight from the status partitions the view switches between
+    auto mergedModel = retVal.fTable.second.second;
+    lhs.setSubCount( mergedModel->leftOnlyCount() );
+    rhs.setSubCount( mergedModel->rightOnlyCount() );
+    retVal.setSubCount( mergedModel->bothCount() );
+    retVal.setTotalCount( mergedModel->numDataRows() );
+}
+
+bool SFileData::loadMerged( SFileData & lhs, SFileData & rhs, SFileData & retVal, const CResultCache::SRowPair * rowPairs, int numRowPairs, QProgressDialog & dlg )
+{
+    auto mergedModel = retVal.fTable.second.second;
     dlg.setLabelText( QObject::tr( "Loading Merged Data..." ) );
-    dlg.setRange( 0, mergedDataCount );
+    dlg.setRange( 0, numRowPairs );
     dlg.setValue( 0 );
-    auto header = lhs.getColumns() + lhs.getExtraColumns() + rhs.getExtraColumns();
-    if ( retVal.fTable.second.second )
+
+    // raw values of the same named columns can still differ on a match, from key normalization
+    // or from shared columns left out of the key
+    std::vector< std::pair< QString, std::pair< int, int > > > sharedColumns;
+    retVal.fChangedValues.clear();
+    for ( auto && ii : lhs.fHeaderInfo )
     {
-        retVal.fTable.second.second->setHeader( header );
+        auto pos = rhs.fHeaderInfo.find( ii.first );
+        if ( pos == rhs.fHeaderInfo.end() )
+            continue;
+        sharedColumns.push_back( { ii.first, { ii.second, ( *pos ).second } } );
+        retVal.fChangedValues[ ii.first ] = 0;
     }
-    int currRow = 0;
-    int lhsOnlyCount = 0;
-    int rhsOnlyCount = 0;
-    int bothCount = 0;
-    for ( auto && ii : mergedData )
+    setMergedHeader( lhs, rhs, retVal );
+    for ( int currRow = 0; currRow < numRowPairs; ++currRow )
     {
         if ( ( currRow % 1000 ) == 0 )
             qApp->processEvents();
@@ -517,16 +1669,16 @@ bool SFileData::mergeData( SFileData & lhs, SFileData & rhs, SFileData & retVal,
             return false;
         dlg.setValue( currRow );
 
-        auto && currMergeInfo = ii.second;
+        auto && currMergeInfo = rowPairs[ currRow ];
         QStringList baseData;
         QStringList extraData;
-        bool leftOnly = currMergeInfo.first != -1 && currMergeInfo.second == -1;
-        bool rightOnly = currMergeInfo.first == -1 && currMergeInfo.second != -1;
-        bool both = currMergeInfo.first != -1 && currMergeInfo.second != -1;
+        bool leftOnly = currMergeInfo.fLHSRow != -1 && currMergeInfo.fRHSRow == -1;
+        bool rightOnly = currMergeInfo.fLHSRow == -1 && currMergeInfo.fRHSRow != -1;
+        bool both = currMergeInfo.fLHSRow != -1 && currMergeInfo.fRHSRow != -1;
         if ( leftOnly || both )
         {
-            baseData << lhs.getRowData( currMergeInfo.first );
-            extraData << lhs.getExtraData( currMergeInfo.first );
+            baseData << lhs.getRowData( currMergeInfo.fLHSRow );
+            extraData << lhs.getExtraData( currMergeInfo.fLHSRow );
         }
         else
         {
@@ -535,52 +1687,179 @@ bool SFileData::mergeData( SFileData & lhs, SFileData & rhs, SFileData & retVal,
         if ( rightOnly || both )
         {
             if ( rightOnly )
-                baseData << rhs.getRowData( currMergeInfo.second );
-            extraData << rhs.getExtraData( currMergeInfo.second );
+                baseData << rhs.getRowData( currMergeInfo.fRHSRow );
+            extraData << rhs.getExtraData( currMergeInfo.fRHSRow );
         }
         else
             extraData << rhs.getEmptyExtraData();
 
-        if ( leftOnly )
-            lhsOnlyCount++;
-        if ( rightOnly )
-            rhsOnlyCount++;
         if ( both )
-            bothCount++;
-        
-        auto rowData = baseData + extraData;
-        for ( int jj = 0; jj < rowData.count(); ++jj )
         {
-            if ( leftOnly )
-            {
-                lhs.setBackground( currMergeInfo.first, Qt::red );
-            }
-            else if ( rightOnly )
+            for ( auto && jj : sharedColumns )
             {
-                rhs.setBackground( currMergeInfo.second, Qt::yellow );
+                auto typed = lhs.fTypedCols.find( jj.second.first ) != lhs.fTypedCols.end();
+                auto changed = typed ? ( lhs.keyText( currMergeInfo.fLHSRow, jj.second.first ) != rhs.keyText( currMergeInfo.fRHSRow, jj.second.second ) ) : ( lhs.getData( currMergeInfo.fLHSRow, jj.second.first ) != rhs.getData( currMergeInfo.fRHSRow, jj.second.second ) );
+                if ( changed )
+                    retVal.fChangedValues[ jj.first ]++;
             }
         }
+
+        auto rowData = baseData + extraData;
+        if ( leftOnly )
+            lhs.setOnlyRow( currMergeInfo.fLHSRow );
+        else if ( rightOnly )
+            rhs.setOnlyRow( currMergeInfo.fRHSRow );
         mergedModel->addRow( rowData, leftOnly, rightOnly, false );
-        currRow++;
     }
     mergedModel->modelReset();
-    lhs.setSubCount( lhsOnlyCount );
-    rhs.setSubCount( lhsOnlyCount );
-    retVal.setSubCount( bothCount );
-    retVal.setTotalCount( retVal.rowCount() );
-
+    if ( lhs.fTable.first )
+        lhs.fTable.first->rowStatusChanged();
+    if ( rhs.fTable.first )
+        rhs.fTable.first->rowStatusChanged();
+    showMergedCounts( lhs, rhs, retVal );
     return true;
 }
 
-QString SFileData::getHeader( int pos ) const
+bool SFileData::mergeOrdered( SFileData & lhs, SFileData & rhs, SFileData & retVal, QWidget * parent, const QStringList & keyColumns )
 {
-    QString retVal;
-    if ( fTable.first )
-    {
-        auto item = fTable.first->horizontalHeaderItem( pos );
-        if ( !item )
+    auto mergedModel = retVal.fTable.second.second;
+    Q_ASSERT( mergedModel );
+    if ( !mergedModel )
+        return false;
+
+    if ( !computeMD5s( lhs, rhs, keyColumns, parent ) )
+        return false;
+
+    COrderedDiff diff;
+    if ( !diff.diff( lhs.rowHashes(), rhs.rowHashes() ) )
+        return false;
+
+    QProgressDialog dlg( QObject::tr( "Loading Ordered Diff..." ), "Cancel", 0, 0, parent );
+    dlg.setRange( 0, lhs.rowCount() + rhs.rowCount() );
+    dlg.setValue( 0 );
+    dlg.setMinimumDuration( 0 );
+
+    auto lhsHeader = QStringList() << QObject::tr( "LHS Row" ) << lhs.getColumns() << lhs.getExtraColumns();
+    auto rhsHeader = QStringList() << QObject::tr( "RHS Row" ) << rhs.getColumns() << rhs.getExtraColumns();
+    mergedModel->setHeader( lhsHeader + rhsHeader, lhsHeader.count() );
+    std::vector< CColumnType > types;
+    for ( auto && ii : { &lhs, &rhs } )
+    {
+        types.push_back( CColumnType() ); // the row numbers carry the move notes
+        for ( auto && jj : ii->fImportantCols )
+            types.push_back( ii->columnType( jj ) );
+        for ( auto && jj : ii->fExtraUnimportantCols )
+            types.push_back( ii->columnType( jj.first ) );
+    }
+    mergedModel->setColumnTypes( types );
+    retVal.fChangedValues.clear();
+
+    int currRow = 0;
+    int cnt = 0;
+    auto addRow = [ & ]( int lhsRow, int rhsRow, bool equal )
+    {
+        auto rowData = lhs.getOrderedRowData( lhsRow, diff, true );
+        while ( rowData.count() < lhsHeader.count() )
+            rowData << QString();
+        rowData << rhs.getOrderedRowData( rhsRow, diff, false );
+        while ( rowData.count() < lhsHeader.count() + rhsHeader.count() )
+            rowData << QString();
+
+        bool leftOnly = ( lhsRow != -1 ) && ( rhsRow == -1 );
+        bool rightOnly = ( lhsRow == -1 ) && ( rhsRow != -1 );
+        bool changed = !equal && ( lhsRow != -1 ) && ( rhsRow != -1 );
+        if ( leftOnly || changed )
+            lhs.setOnlyRow( lhsRow );
+        if ( rightOnly || changed )
+            rhs.setOnlyRow( rhsRow );
+        mergedModel->addRow( rowData, leftOnly || changed, rightOnly || changed, false );
+
+        if ( ( currRow++ % 1000 ) == 0 )
+            qApp->processEvents();
+        cnt += ( ( lhsRow != -1 ) ? 1 : 0 ) + ( ( rhsRow != -1 ) ? 1 : 0 );
+        dlg.setValue( cnt );
+        return !dlg.wasCanceled();
+    };
+
+    auto && runs = diff.runs();
+    for ( size_t ii = 0; ii < runs.size(); ++ii )
+    {
+        auto && run = runs[ ii ];
+        if ( run.fOp == COrderedDiff::eEqual )
+        {
+            for ( int jj = 0; jj < run.fLength; ++jj )
+            {
+                if ( !addRow( run.fLHSStart + jj, run.fRHSStart + jj, true ) )
+                    return false;
+            }
+        }
+        else if ( run.fOp == COrderedDiff::eDelete )
+        {
+            // a delete followed by an insert is a changed hunk, its rows are paired up side by side
+            auto inserted = ( ( ii + 1 ) < runs.size() && ( runs[ ii + 1 ].fOp == COrderedDiff::eInsert ) ) ? &runs[ ii + 1 ] : nullptr;
+            auto numRows = inserted ? std::max( run.fLength, inserted->fLength ) : run.fLength;
+            for ( int jj = 0; jj < numRows; ++jj )
+            {
+                auto lhsRow = ( jj < run.fLength ) ? ( run.fLHSStart + jj ) : -1;
+                auto rhsRow = ( inserted && ( jj < inserted->fLength ) ) ? ( inserted->fRHSStart + jj ) : -1;
+                if ( !addRow( lhsRow, rhsRow, false ) )
+                    return false;
+            }
+            if ( inserted )
+                ++ii;
+        }
+        else
+        {
+            for ( int jj = 0; jj < run.fLength; ++jj )
+            {
+                if ( !addRow( -1, run.fRHSStart + jj, false ) )
+                    return false;
+            }
+        }
+    }
+
+    mergedModel->modelReset();
+    if ( lhs.fTable.first )
+        lhs.fTable.first->rowStatusChanged();
+    if ( rhs.fTable.first )
+        rhs.fTable.first->rowStatusChanged();
+    lhs.setSubCount( diff.numDeleted() );
+    rhs.setSubCount( diff.numInserted() );
+    retVal.setSubCount( diff.numEqual() );
+    retVal.setTotalCount( mergedModel->numDataRows() );
+
+    return true;
+}
+
+std::vector< quint64 > SFileData::rowHashes() const
+{
+    std::vector< quint64 > retVal;
+    retVal.reserve( fKeyIndex.fMD5s.size() );
+    for ( auto && ii : fKeyIndex.fMD5s )
+        retVal.push_back( NKeyHash::hash64( ii.constData(), ii.size() ) );
+    return retVal;
+}
+
+QStringList SFileData::getOrderedRowData( int row, const COrderedDiff & diff, bool isLHS ) const
+{
+    if ( row == -1 )
+        return {};
+
+    auto rowNum = QString::number( row + 1 );
+    auto moved = isLHS ? diff.movedTo( row ) : diff.movedFrom( row );
+    if ( moved != -1 )
+        rowNum = ( isLHS ? QObject::tr( "%1 (moved to %2)" ) : QObject::tr( "%1 (moved from %2)" ) ).arg( row + 1 ).arg( moved + 1 );
+    return QStringList() << rowNum << getRowData( row ) << getExtraData( row );
+}
+
+QString SFileData::getHeader( int pos ) const
+{
+    QString retVal;
+    if ( fTable.first )
+    {
+        if ( pos >= fTable.first->columnCount() )
             return {};
-        retVal = item->text();
+        retVal = fTable.first->headerText( pos );
     }
     else if ( fTable.second.second )
     {
@@ -617,9 +1896,7 @@ QString SFileData::itemText( int row, int col ) const
 {
     if ( fTable.first )
     {
-        auto item = fTable.first->item( row, col );
-        if ( item )
-            return item->text();
+        return fTable.first->store().data( row, col );
     }
     else if ( fTable.second.second )
     {
@@ -635,7 +1912,7 @@ int SFileData::rowCount() const
     if ( fTable.first )
         numRows = fTable.first->rowCount();
     else if( fTable.second.second )
-        numRows = fTable.second.second->rowCount();
+        numRows = fTable.second.second->numDataRows();
     return numRows;
 }
 
@@ -704,19 +1981,12 @@ QString SFileData::getData( int row, int col ) const
     return retVal;
 }
 
-void SFileData::setBackground( int row, Qt::GlobalColor clr )
+void SFileData::setOnlyRow( int row )
 {
     if ( row >= rowCount() )
         return;
-    for ( int ii = 0; ii < columnCount(); ++ii )
-    {
-        if ( fTable.first )
-        {
-            auto item = fTable.first->item( row, ii );
-            if ( item )
-                item->setBackground( clr );
-        }
-    }
+    if ( fTable.first )
+        fTable.first->setOnlyRow( row );
 }
 
 QStringList SFileData::getExtraColumns() const
@@ -735,29 +2005,112 @@ bool SFileData::computeMD5s( const QString & label, QWidget * parent )
     dlg.setRange( 0, rowCount() );
     dlg.setMinimumDuration( 0 );
 
-    int rowCount = this->rowCount();
-    for ( int ii = 0; ii < rowCount; ++ii )
+    // the key values in keyColumns() order
+    auto && keyCols = keyColumns();
+    std::vector< int > keyOptions;
+    for ( auto && jj : keyCols )
     {
-        if ( ( ii % 1000 ) == 0 )
+        if ( fTypedCols.find( jj ) != fTypedCols.end() )
+            keyOptions.push_back( CKeyNormalizer::eNone ); // already in canonical form
+        else
+            keyOptions.push_back( fKeyNormalizer ? fKeyNormalizer->columnOptions( getHeader( jj ) ) : CKeyNormalizer::kDefaultOptions );
+    }
+
+    // the store pages its chunks in and out and is not thread safe, so the key values are read here and only hashed on the pool
+    auto numRows = rowCount();
+    std::vector< QStringList > keyValues( numRows );
+    for ( int ii = 0; ii < numRows; ++ii )
+    {
+        if ( ( ii % SKeyIndex::kProgressRows ) == 0 )
+        {
             qApp->processEvents();
-        if ( dlg.wasCanceled() )
-            return false;
-        dlg.setValue( ii );
+            dlg.setValue( ii );
+            if ( dlg.wasCanceled() )
+                return false;
+        }
+        for ( auto && jj : keyCols )
+            keyValues[ ii ] << keyText( ii, jj );
+    }
+
+    // each shard, or each block of rows of a single file, is hashed into its own map
+    auto shardRows = fShardRows;
+    if ( shardRows.empty() )
+    {
+        for ( int ii = 0; ii < numRows; ii += SKeyIndex::kBlockRows )
+            shardRows.push_back( ii );
+    }
 
-        QStringList importantData;
-        for ( auto && jj : fImportantCols )
+    dlg.setLabelText( QObject::tr( "Hashing %1 Values..." ).arg( label ) );
+    dlg.setRange( 0, 0 );
+    std::atomic< bool > canceled{ false };
+    SKeyIndex keyIndex;
+    auto loop = CWorkStealingPool::shared().start( 1, [ & ]( int ) { return keyIndex.buildSharded( numRows, shardRows, [ &keyValues ]( int row, QStringList & values ) { values << keyValues[ row ]; }, keyOptions, &canceled ); } );
+    while ( !loop->isDone() )
+    {
+        qApp->processEvents();
+        if ( dlg.wasCanceled() )
         {
-            auto text = itemText( ii, jj );
-            if ( !text.isEmpty() )
-                importantData << text.left( 16 );
+            canceled = true;
+            break;
         }
-        auto md5 = NSABUtils::getMd5( importantData );
-        fMD5ToRow[ md5 ] = ii;
-        fRowToMD5[ ii ] = md5; 
+        QThread::msleep( 10 );
     }
+    if ( !loop->wait() || canceled )
+        return false;
+    fKeyIndex = std::move( keyIndex );
     return true;
 }
 
+std::vector< QStringList > SFileData::sampleRows( const QStringList & columns, int maxRows ) const
+{
+    std::vector< int > positions;
+    for ( auto && ii : columns )
+    {
+        auto pos = fHeaderInfo.find( ii );
+        positions.push_back( ( pos == fHeaderInfo.end() ) ? -1 : ( *pos ).second );
+    }
+
+    std::vector< QStringList > retVal;
+    auto numRows = rowCount();
+    auto step = std::max( 1, ( maxRows > 0 ) ? ( numRows + maxRows - 1 ) / maxRows : 1 );
+    retVal.reserve( ( numRows + step - 1 ) / step );
+    for ( int row = 0; row < numRows; row += step )
+    {
+        QStringList rowData;
+        for ( auto && col : positions )
+            rowData << ( ( col < 0 ) ? QString() : itemText( row, col ) );
+        retVal.push_back( rowData );
+    }
+    return retVal;
+}
+
+void SFileData::setFileTable( QTableView * view, Qt::GlobalColor onlyColor )
+{
+    fTable.first = new CFileTableModel( onlyColor, view );
+    view->setModel( fTable.first );
+}
+
+void SFileData::setMemoryBudget( qint64 bytes )
+{
+    if ( fTable.first )
+        fTable.first->store().setMemoryBudget( bytes );
+}
+
+std::set< int > SFileData::pinnedColumns() const
+{
+    // the columns used by the merge stay resident, everything else may be spilled
+    std::set< int > retVal = fImportantCols;
+    for ( auto && ii : fExtraUnimportantCols )
+        retVal.insert( ii.first );
+    return retVal;
+}
+
+void SFileData::updatePinnedColumns()
+{
+    if ( fTable.first )
+        fTable.first->store().setPinnedColumns( pinnedColumns() );
+}
+
 void SFileData::setTable( QTableView * view )
 {
     fTable.second.first = view;
@@ -779,151 +2132,355 @@ void SFileData::setSubCount( int count )
         fSubCount->setText( QString::number( count ) );
 }
 
+QString SFileData::readBackError() const
+{
+    if ( !fLazyError.isEmpty() )
+        return fLazyError;
+    return fTable.first ? fTable.first->store().spillError() : QString();
+}
+
+void SFileData::reportMemory() const
+{
+    auto && accounting = CMemoryAccounting::instance();
+    accounting.setLive( CMemoryAccounting::eRawInput, this, ( fReader && !fFullLoad ) ? fReader->bufferBytes() : 0 ); // the pool reads into it while a load runs
+    accounting.setLive( CMemoryAccounting::eCellStore, this, ( fTable.first ? fTable.first->store().residentBytes() : 0 ) + static_cast< qint64 >( fRowLines.capacity() * sizeof( int ) ) );
+
+    qint64 keyBytes = fKeyIndex.estimateBytes();
+    for ( auto && ii : fHeaderInfo )
+        keyBytes += CMemoryAccounting::kNodeOverhead + CMemoryAccounting::estimateBytes( ii.first ) + static_cast< qint64 >( sizeof( int ) );
+    accounting.setLive( CMemoryAccounting::eKeyIndex, this, keyBytes );
+
+    accounting.setLive( CMemoryAccounting::eMergeResult, this, fTable.second.second ? fTable.second.second->estimateBytes() : 0 );
+
+    qint64 viewBytes = fTable.first ? fTable.first->estimateBytes() : 0;
+    if ( fTable.second.first )
+    {
+        if ( auto proxy = qobject_cast< CMergedProxyModel * >( fTable.second.first->model() ) )
+            viewBytes += proxy->estimateBytes();
+    }
+    accounting.setLive( CMemoryAccounting::eViewModels, this, viewBytes );
+}
+
 void SFileData::updateMatchedColumns()
 {
     if ( !fMatchedColumns )
         return;
+    fMatchedColumns->clear();
     for ( auto && ii : fImportantCols )
     {
-        new QListWidgetItem( QString( "%1(%2)" ).arg( getHeader( ii ) ).arg( ii ), fMatchedColumns );
+        auto text = QString( "%1(%2)" ).arg( getHeader( ii ) ).arg( ii );
+        if ( fKeyNormalizer && ( fKeyNormalizer->columnOptions( getHeader( ii ) ) != CKeyNormalizer::kDefaultOptions ) )
+            text += QString( " [%1]" ).arg( CKeyNormalizer::optionsToString( fKeyNormalizer->columnOptions( getHeader( ii ) ) ) );
+        auto item = new QListWidgetItem( text, fMatchedColumns );
+        item->setData( Qt::UserRole, getHeader( ii ) );
+        item->setFlags( item->flags() | Qt::ItemIsUserCheckable );
+        item->setCheckState( keyColumns().count( ii ) ? Qt::Checked : Qt::Unchecked );
     }
 }
 
-std::optional< std::pair< bool, QStringList > > SFileData::getRow( QString currLine, const TMergedType & mergedData ) const
+std::optional< std::pair< bool, QStringList > > SFileData::getRow( QString currLine, const TMergedType & mergedData, const CCSVDialect & dialect )
 {
-    currLine = currLine.trimmed();
+    currLine = dialect.trimmed( currLine );
     if ( currLine.isEmpty() )
         return {};
 
-    auto regExpStr = QString( R"((?:^|,)(?=[^"]|(")?)\"?((?(1).*?(?=\",)|[^,]*))(?=|$))" );
-    auto regExp = QRegularExpression( regExpStr );
+    auto retVal = dialect.split( currLine );
+    if ( !mergedData.empty() )
+        retVal = mergeColumns( retVal, mergedData );
+    return { { true, retVal } };
+}
 
-    QStringList retVal;
-    QString currColumn;
-    bool inQuote = false;
-    for ( int ii = 0; ii < currLine.length(); ++ii )
+QStringList SFileData::mergeColumns( const QStringList & rowData, const TMergedType & mergedData )
+{
+    std::map< int, QStringList > realRetVal;
+    for ( int ii = 0; ii < rowData.count(); ++ii )
     {
-        auto curr = currLine[ ii ];
-        if ( inQuote )
+        auto pos = mergedData.find( ii );
+        if ( pos == mergedData.end() )
         {
-            if ( curr == '"' )
-            {
-                for ( int jj = ii + 1; jj < currLine.length(); ++jj )
-                {
-                    if ( currLine[ jj ].isSpace() )
-                        continue;
-                    if ( currLine[ jj ] == ',' )
-                    {
-                        inQuote = false;
-                        break;
-                    }
-                    break;
-                }
-            }
-            else
-                currColumn += curr;
+            realRetVal[ ii ] = QStringList( { rowData[ ii ] } );
         }
         else
         {
-            if ( curr == ',' )
+            auto newCol = ( *pos ).second.first;
+            auto posInList = ( *pos ).second.second;
+            auto pos2 = realRetVal.find( newCol );
+            QStringList tmp;
+            if ( pos2 != realRetVal.end() )
             {
-                retVal << currColumn;
-                currColumn.clear();
+                tmp = ( *pos2 ).second;
             }
-            else if ( curr == '"' )
+
+            while ( tmp.count() <= posInList )
             {
-                inQuote = true;
+                tmp << QString();
             }
-            else
-                currColumn += curr;
+
+            tmp[ posInList ] = rowData[ ii ];
+            realRetVal[ newCol ] = tmp;
         }
     }
-    retVal << currColumn;
-    //auto ii = regExp.globalMatch( currLine );
-    //if ( !ii.hasNext() )
-    //    return { { false, QStringList() } };
+    QStringList retVal;
+    for ( auto && ii : realRetVal )
+    {
+        retVal.push_back( ii.second.join( " " ).trimmed() );
+    }
+    return retVal;
+}
 
-    //QStringList retVal;
-    //while ( ii.hasNext() )
-    //{
-    //    auto match = ii.next();
-    //    auto text = match.captured( 2 );
-    //    retVal << text;
-    //}
 
-    if ( !mergedData.empty() )
+std::optional< std::pair< bool, QStringList > > SFileData::getProjectedRow( const QByteArray & rawLine, const std::vector< bool > & projection, const TMergedType & mergedData, const CCSVDialect & dialect )
+{
+    // same rules as getRow, but the bytes of a skipped field are only scanned for quotes and delimiters, never copied
+    auto delimiter = dialect.delimiter();
+    auto quote = dialect.quote();
+    auto isSpace = [ delimiter ]( char ch ) { return ( ch != delimiter ) && ( ( ch == ' ' ) || ( ( ch >= '\t' ) && ( ch <= '\r' ) ) ); };
+    auto isAscii = []( char ch ) { return static_cast< unsigned char >( ch ) < 0x80; };
+    auto fullParse = [ & ]() { return getRow( QString::fromUtf8( rawLine ), mergedData, dialect ); };
+
+    auto data = rawLine.constData();
+    int begin = 0;
+    int end = rawLine.size();
+    while ( ( begin < end ) && isSpace( data[ begin ] ) )
+        ++begin;
+    while ( ( end > begin ) && isSpace( data[ end - 1 ] ) )
+        --end;
+    if ( begin == end )
+        return {};
+    if ( dialect.escape() )
+        return fullParse();
+    // a non ASCII character where getRow trims may be a unicode space
+    if ( !isAscii( data[ begin ] ) || !isAscii( data[ end - 1 ] ) )
+        return fullParse();
+
+    QStringList retVal;
+    QByteArray currColumn;
+    int field = 0;
+    auto keep = [ & ]() { return ( field >= static_cast< int >( projection.size() ) ) || projection[ field ]; };
+    auto finishField = [ & ]()
+    {
+        if ( keep() )
+        {
+            retVal << QString::fromUtf8( currColumn );
+            currColumn.clear();
+        }
+        else
+            retVal << QString();
+        ++field;
+    };
+
+    bool inQuote = false;
+    for ( int ii = begin; ii < end; )
     {
-        std::map< int, QStringList > realRetVal;
-        for ( int ii = 0; ii < retVal.count(); ++ii )
+        auto curr = data[ ii ];
+        if ( curr == quote )
         {
-            auto pos = mergedData.find( ii );
-            if ( pos == mergedData.end() )
+            if ( inQuote && ( ii + 1 < end ) && ( data[ ii + 1 ] == quote ) )
             {
-                realRetVal[ ii ] = QStringList( { retVal[ ii ] } );
+                if ( keep() )
+                    currColumn.append( quote );
+                ii += 2;
+                continue;
             }
-            else
+            if ( inQuote )
             {
-                auto newCol = ( *pos ).second.first;
-                auto posInList = ( *pos ).second.second;
-                auto pos2 = realRetVal.find( newCol );
-                QStringList tmp;
-                if ( pos2 != realRetVal.end() )
-                {
-                    tmp = ( *pos2 ).second;
-                }
-
-                while ( tmp.count() <= posInList )
+                for ( int jj = ii + 1; jj < end; ++jj )
                 {
-                    tmp << QString();
+                    if ( !isAscii( data[ jj ] ) )
+                        return fullParse();
+                    if ( isSpace( data[ jj ] ) )
+                        continue;
+                    if ( data[ jj ] == delimiter )
+                        inQuote = false;
+                    break;
                 }
-
-                tmp[ posInList ] = retVal[ ii ];
-                realRetVal[ newCol ] = tmp;
             }
+            else
+                inQuote = true;
+            ++ii;
+            continue;
         }
-        retVal.clear();
-        for ( auto && ii : realRetVal )
+        if ( !inQuote && ( curr == delimiter ) )
         {
-            retVal.push_back( ii.second.join( " " ).trimmed() );
+            finishField();
+            ++ii;
+            continue;
         }
+
+        // the run of field text up to the next quote, or delimiter outside of quotes
+        auto runEnd = ii + 1;
+        while ( ( runEnd < end ) && ( data[ runEnd ] != quote ) && ( inQuote || ( data[ runEnd ] != delimiter ) ) )
+            ++runEnd;
+        if ( keep() )
+            currColumn.append( data + ii, runEnd - ii );
+        ii = runEnd;
     }
+    finishField();
 
+    if ( !mergedData.empty() )
+        retVal = mergeColumns( retVal, mergedData );
     return { { true, retVal } };
 }
 
-void SFileData::computeHeaderInfo()
+void SFileData::setProjection( SFileData & lhs, SFileData & rhs )
 {
-    for ( int ii = 0; ii < columnCount(); ++ii )
+    for ( auto && ii : { std::make_pair( &lhs, &rhs ), std::make_pair( &rhs, &lhs ) } )
     {
-        QTableWidgetItem * item = nullptr;
-        if ( fTable.first )
+        std::set< int > neededCols;
+        for ( auto && jj : ii.first->fHeaderInfo )
         {
-            item = fTable.first->horizontalHeaderItem( ii );
+            if ( ii.second->fHeaderInfo.find( jj.first ) != ii.second->fHeaderInfo.end() )
+                neededCols.insert( jj.second );
         }
-        fHeaderInfo[ getHeader( ii ) ] = { item, ii };
+        for ( auto && jj : ii.first->fExtraUnimportantCols )
+            neededCols.insert( jj.first );
+        ii.first->setProjection( neededCols );
+    }
+}
+
+void SFileData::setProjection( const std::set< int > & neededCols )
+{
+    fProjection.clear();
+    fRowLines.clear();
+    fLazyRows.clear();
+    fLazyLRU.clear();
+    fLazyError.clear();
+    fLineIndex.close();
+
+    // the skipped cells are read back from the file by line, which needs newline line ends in the raw bytes
+    // and a single file
+    if ( !fReader || !fTable.first || ( fShards.count() > 1 ) || ( fReader->encoding() == CCSVReader::EEncoding::eUTF16LE ) || ( fReader->encoding() == CCSVReader::EEncoding::eUTF16BE ) || ( fDialect.lineEnd() != '\n' ) )
+        return;
+
+    // raw field ii lands in the column of its slot among the merged slots, the name fields are always parsed
+    std::set< int > slots;
+    for ( int ii = 0; ii < fRawColumnCount; ++ii )
+    {
+        auto pos = fMergedInfo.find( ii );
+        slots.insert( ( pos == fMergedInfo.end() ) ? ii : ( *pos ).second.first );
+    }
+
+    std::vector< bool > projection( fRawColumnCount, false );
+    std::set< int > lazyCols;
+    for ( int ii = 0; ii < columnCount(); ++ii )
+        lazyCols.insert( ii );
+    for ( int ii = 0; ii < fRawColumnCount; ++ii )
+    {
+        auto pos = fMergedInfo.find( ii );
+        auto col = static_cast< int >( std::distance( slots.begin(), slots.find( ( pos == fMergedInfo.end() ) ? ii : ( *pos ).second.first ) ) );
+        projection[ ii ] = ( pos != fMergedInfo.end() ) || ( neededCols.find( col ) != neededCols.end() );
+        if ( projection[ ii ] )
+            lazyCols.erase( col );
+    }
+    if ( lazyCols.empty() )
+        return;
+
+    fProjection = projection;
+    fTable.first->store().setLazyColumns( lazyCols, [ this ]( int row, int col ) { return lazyData( row, col ); } );
+    fStatistics.setSkippedColumns( lazyCols );
+}
+
+QString SFileData::lazyData( int row, int col ) const
+{
+    auto pos = fLazyRows.find( row );
+    if ( pos != fLazyRows.end() )
+    {
+        fLazyLRU.splice( fLazyLRU.end(), fLazyLRU, ( *pos ).second );
+        return ( *pos ).second->second.value( col );
+    }
+
+    if ( !fLineIndex.isOpen() && fReader )
+        fLineIndex.open( fShards.front(), fReader->encoding(), fLoadedSize, fLoadedModified );
+    if ( fLineIndex.isOpen() && fLineIndex.isChanged() )
+    {
+        // the cells already read stay, the rest of the file is not the one the rows came from
+        fLazyError = QString( "The file '%1' changed since it was loaded, load it again to see the skipped columns" ).arg( fFileName );
+        return {};
+    }
+
+    QStringList rowData;
+    QByteArray rawLine;
+    if ( ( row < static_cast< int >( fRowLines.size() ) ) && fLineIndex.readLine( fRowLines[ row ], rawLine ) )
+    {
+        auto currRow = getRow( QString::fromUtf8( rawLine ), fMergedInfo, fDialect );
+        if ( currRow.has_value() && currRow.value().first )
+            rowData = currRow.value().second;
+    }
+
+    if ( fLazyRows.size() >= kMaxLazyRows )
+    {
+        fLazyRows.erase( fLazyLRU.front().first );
+        fLazyLRU.pop_front();
+    }
+    auto retVal = rowData.value( col );
+    fLazyRows[ row ] = fLazyLRU.insert( fLazyLRU.end(), { row, std::move( rowData ) } );
+    return retVal;
+}
+
+void SFileData::computeHeaderInfo()
+{
+    for ( int ii = 0; ii < columnCount(); ++ii )
+    {
+        fHeaderInfo[ getHeader( ii ) ] = ii;
     }
 }
 
-bool SFileData::computeMD5s( SFileData & lhs, SFileData & rhs, QWidget * parent )
+bool SFileData::computeMD5s( SFileData & lhs, SFileData & rhs, const QStringList & keyColumns, QWidget * parent )
 {
+    computeImportantColumns( lhs, rhs );
+    setKeyColumns( lhs, rhs, keyColumns );
+
+    auto aOK = lhs.computeMD5s( "LHS", parent );
+    aOK = aOK && rhs.computeMD5s( "RHS", parent );
+    return aOK;
+}
+
+void SFileData::setKeyColumns( SFileData & lhs, SFileData & rhs, const QStringList & keyColumns )
+{
+    lhs.fKeyCols.clear();
+    rhs.fKeyCols.clear();
+    for ( auto && ii : keyColumns )
+    {
+        auto lhsPos = lhs.fHeaderInfo.find( ii );
+        auto rhsPos = rhs.fHeaderInfo.find( ii );
+        if ( ( lhsPos == lhs.fHeaderInfo.end() ) || ( rhsPos == rhs.fHeaderInfo.end() ) )
+            continue;
+        lhs.fKeyCols.insert( ( *lhsPos ).second );
+        rhs.fKeyCols.insert( ( *rhsPos ).second );
+    }
+}
+
+void SFileData::computeImportantColumns( SFileData & lhs, SFileData & rhs )
+{
+    lhs.fImportantCols.clear();
+    rhs.fImportantCols.clear();
+    lhs.fKeyCols.clear();
+    rhs.fKeyCols.clear();
+    lhs.fTypedCols.clear();
+    rhs.fTypedCols.clear();
     for ( auto && ii : lhs.fHeaderInfo )
     {
         auto pos = rhs.fHeaderInfo.find( ii.first );
         if ( pos != rhs.fHeaderInfo.end() )
         {
-            auto newName = ( ii.second.first->text() + "*" );
+            auto newName = ( ii.first + "*" );
 
-            lhs.fImportantCols.insert( ii.second.second );
-            rhs.fImportantCols.insert( ( *pos ).second.second );
+            lhs.fImportantCols.insert( ii.second );
+            rhs.fImportantCols.insert( ( *pos ).second );
+            if ( CColumnType::common( lhs.columnType( ii.second ), rhs.columnType( ( *pos ).second ) ).isTyped() )
+            {
+                lhs.fTypedCols.insert( ii.second );
+                rhs.fTypedCols.insert( ( *pos ).second );
+            }
 
-            ii.second.first->setText( newName );
-            ( *pos ).second.first->setText( newName );
+            if ( lhs.fTable.first )
+                lhs.fTable.first->setHeaderText( ii.second, newName );
+            if ( rhs.fTable.first )
+                rhs.fTable.first->setHeaderText( ( *pos ).second, newName );
         }
     }
-
-    auto aOK = lhs.computeMD5s( "LHS", parent );
-    aOK = aOK && rhs.computeMD5s( "RHS", parent );
-    return aOK;
+    lhs.updatePinnedColumns();
+    rhs.updatePinnedColumns();
 }
 
 void CMainWindow::slotResultsItemChanged( QTreeWidgetItem * curr, QTreeWidgetItem * /*prev*/ )
@@ -940,6 +2497,107 @@ void CMainWindow::slotResultsItemChanged( QTreeWidgetItem * curr, QTreeWidgetIte
         fImpl->resultsPages->setCurrentIndex( 3 );
     else if ( curr->text( 0 ) == "Matched Columns" )
         fImpl->resultsPages->setCurrentIndex( 4 );
+    else if ( curr->text( 0 ) == "Column Statistics" )
+        fImpl->resultsPages->setCurrentIndex( 5 );
+}
+
+qint64 CFileTableModel::estimateBytes() const
+{
+    return CMemoryAccounting::estimateBytes( fHeaderInfo ) + static_cast< qint64 >( ( fOnlyRows.capacity() + 7 ) / 8 );
+}
+
+CFileTableModel::CFileTableModel( Qt::GlobalColor onlyColor, QObject * parent ) :
+    QAbstractTableModel( parent ),
+    fOnlyColor( onlyColor )
+{
+
+}
+
+void CFileTableModel::clear()
+{
+    beginResetModel();
+    fHeaderInfo.clear();
+    fStore.setColumnCount( 0 );
+    fNumRows = 0;
+    fOnlyRows.clear();
+    endResetModel();
+}
+
+void CFileTableModel::setHeader( const QStringList & headerInfo )
+{
+    beginResetModel();
+    fHeaderInfo = headerInfo;
+    fStore.setColumnCount( headerInfo.count() );
+    fNumRows = 0;
+    fOnlyRows.clear();
+    endResetModel();
+}
+
+void CFileTableModel::syncRowCount()
+{
+    if ( fStore.rowCount() <= fNumRows )
+        return;
+    beginInsertRows( QModelIndex(), fNumRows, fStore.rowCount() - 1 );
+    fNumRows = fStore.rowCount();
+    endInsertRows();
+}
+
+void CFileTableModel::setHeaderText( int section, const QString & text )
+{
+    if ( ( section < 0 ) || ( section >= fHeaderInfo.count() ) )
+        return;
+    fHeaderInfo[ section ] = text;
+    emit headerDataChanged( Qt::Horizontal, section, section );
+}
+
+void CFileTableModel::setOnlyRow( int row )
+{
+    if ( static_cast< int >( fOnlyRows.size() ) < fStore.rowCount() )
+        fOnlyRows.resize( fStore.rowCount(), false );
+    fOnlyRows[ row ] = true;
+}
+
+void CFileTableModel::rowStatusChanged()
+{
+    if ( ( rowCount() == 0 ) || ( columnCount() == 0 ) )
+        return;
+    emit dataChanged( index( 0, 0 ), index( rowCount() - 1, columnCount() - 1 ), { Qt::BackgroundRole } );
+}
+
+QVariant CFileTableModel::data( const QModelIndex & index, int role ) const
+{
+    if ( !index.isValid() )
+        return {};
+    if ( index.row() >= rowCount() )
+        return {};
+    if ( index.column() >= columnCount() )
+        return {};
+    if ( role == Qt::DisplayRole )
+        return fStore.data( index.row(), index.column() );
+    else if ( role == Qt::BackgroundRole )
+    {
+        if ( ( index.row() < static_cast< int >( fOnlyRows.size() ) ) && fOnlyRows[ index.row() ] )
+            return QBrush( fOnlyColor );
+    }
+    return QVariant();
+}
+
+bool CMergedTableModel::sortKey( int row, int col, qint64 & key ) const
+{
+    if ( !isTypedColumn( col ) || ( row < 0 ) || ( row >= rowCount() ) )
+        return false;
+
+    if ( fSortKeys.size() != fColumnTypes.size() )
+        fSortKeys.resize( fColumnTypes.size() );
+    auto && keys = fSortKeys[ col ];
+    if ( keys.size() != fData.size() )
+    {
+        keys.resize( fData.size() );
+        for ( size_t ii = 0; ii < fData.size(); ++ii )
+            keys[ ii ] = fColumnTypes[ col ].encode( cellText( static_cast< int >( ii ), col ) );
+    }
+    key = keys[ row ];
+    return ( key != CColumnType::kEmpty ) && ( key != CColumnType::kNotTyped );
 }
 
 CMergedTableModel::CMergedTableModel( QObject * parent ) :
@@ -948,19 +2606,309 @@ CMergedTableModel::CMergedTableModel( QObject * parent ) :
 
 }
 
+qint64 CMergedTableModel::estimateBytes() const
+{
+    auto retVal = CMemoryAccounting::estimateBytes( fHeaderInfo ) + CMemoryAccounting::estimateBytes( fData );
+    for ( auto && ii : fData )
+        retVal += CMemoryAccounting::estimateBytes( std::get< 0 >( ii ) ) - static_cast< qint64 >( sizeof( QStringList ) );
+    retVal += CMemoryAccounting::estimateBytes( fLeftOnlyRows ) + CMemoryAccounting::estimateBytes( fRightOnlyRows ) + CMemoryAccounting::estimateBytes( fBothRows );
+    for ( auto && ii : fSortKeys )
+        retVal += static_cast< qint64 >( ii.capacity() * sizeof( qint64 ) );
+    return retVal;
+}
+
 void CMergedTableModel::clear()
 {
     beginResetModel();
     fHeaderInfo.clear();
     fData.clear();
+    fLeftOnlyRows.clear();
+    fRightOnlyRows.clear();
+    fBothRows.clear();
+    fSources.clear();
+    fFirstSourceColumn = -1;
+    fPresence.clear();
+    fSplitColumn = -1;
+    fColumnTypes.clear();
+    fSortKeys.clear();
+    endResetModel();
+}
+
+void CMergedTableModel::setSources( const QStringList & names, int firstColumn )
+{
+    fSources = names;
+    fFirstSourceColumn = firstColumn;
+    fPresence.clear();
+}
+
+void CMergedTableModel::addRow( const QStringList & rowData, const QBitArray & presence )
+{
+    auto numPresent = presence.count( true );
+    fPresence.push_back( presence );
+    addRow( rowData, numPresent < presence.size(), numPresent == 1, false );
+}
+
+bool CMergedTableModel::isInMode( int row, EViewMode mode ) const
+{
+    auto && curr = fData[ row ];
+    switch ( mode )
+    {
+        case eLeftOnlyRows:
+            return std::get< 1 >( curr );
+        case eRightOnlyRows:
+            return std::get< 2 >( curr );
+        case eBothRows:
+            return !std::get< 1 >( curr ) && !std::get< 2 >( curr );
+        case eAllRows:
+        default:
+            return true;
+    }
+}
+
+const std::vector< int > & CMergedTableModel::partition( EViewMode mode ) const
+{
+    static const std::vector< int > sNoPartition;
+    switch ( mode )
+    {
+        case eLeftOnlyRows:
+            return fLeftOnlyRows;
+        case eRightOnlyRows:
+            return fRightOnlyRows;
+        case eBothRows:
+            return fBothRows;
+        case eAllRows:
+        default:
+            Q_ASSERT( mode != eAllRows );
+            return sNoPartition;
+    }
+}
+
+qint64 CMergedProxyModel::estimateBytes() const
+{
+    // the sort order, the row maps of each mode shown so far, plus the filter bits
+    auto retVal = static_cast< qint64 >( fSorted.capacity() * sizeof( int ) );
+    for ( auto && ii : fModeRows )
+        retVal += static_cast< qint64 >( ( ii.fRows.capacity() + ii.fSourceToProxy.capacity() ) * sizeof( int ) );
+    retVal += ( fRowFilter.size() + 7 ) / 8;
+    return retVal;
+}
+
+void CMergedProxyModel::setSourceModel( QAbstractItemModel * model )
+{
+    beginResetModel();
+    if ( sourceModel() )
+        sourceModel()->disconnect( this );
+    QAbstractProxyModel::setSourceModel( model );
+    if ( model )
+    {
+        // the merged model only appends rows or resets, anything else is rebuilt from scratch
+        connect( model, &QAbstractItemModel::modelReset, this, &CMergedProxyModel::resetFromSource );
+        connect( model, &QAbstractItemModel::layoutChanged, this, &CMergedProxyModel::resetFromSource );
+        connect( model, &QAbstractItemModel::rowsInserted, this, &CMergedProxyModel::resetFromSource );
+        connect( model, &QAbstractItemModel::rowsRemoved, this, &CMergedProxyModel::resetFromSource );
+        connect( model, &QAbstractItemModel::headerDataChanged, this, &QAbstractItemModel::headerDataChanged );
+        connect( model, &QAbstractItemModel::dataChanged, this,
+                 [ this ]( const QModelIndex & topLeft, const QModelIndex & bottomRight, const QVector< int > & roles )
+                 {
+                     if ( rowCount() > 0 )
+                         emit dataChanged( index( 0, topLeft.column() ), index( rowCount() - 1, bottomRight.column() ), roles );
+                 } );
+    }
+    sortRows();
+    invalidateRows();
     endResetModel();
 }
 
-bool CMergedProxyModel::lessThan( const QModelIndex & lhs, const QModelIndex & rhs ) const
+void CMergedProxyModel::resetFromSource()
+{
+    beginResetModel();
+    sortRows();
+    invalidateRows();
+    endResetModel();
+}
+
+void CMergedProxyModel::setRowFilter( const QBitArray & rows )
+{
+    beginResetModel();
+    fRowFilter = rows;
+    invalidateRows();
+    endResetModel();
+}
+
+void CMergedProxyModel::invalidateRows()
+{
+    for ( auto && ii : fModeRows )
+        ii = SRows();
+}
+
+const CMergedProxyModel::SRows & CMergedProxyModel::rows() const
+{
+    auto && retVal = fModeRows[ fViewMode ];
+    if ( !retVal.fBuilt )
+        buildRows( fViewMode, retVal );
+    return retVal;
+}
+
+void CMergedProxyModel::buildRows( CMergedTableModel::EViewMode mode, SRows & modeRows ) const
+{
+    modeRows = SRows();
+    modeRows.fBuilt = true;
+    auto model = mergedModel();
+    if ( !model )
+        return;
+
+    auto numRows = model->rowCount();
+    auto inFilter = [ this ]( int row ) { return fRowFilter.isNull() || ( ( row < fRowFilter.size() ) && fRowFilter.testBit( row ) ); };
+    if ( !fSorted.empty() )
+    {
+        // one pass over the sorted rows, nothing is compared
+        for ( auto && ii : fSorted )
+        {
+            if ( inFilter( ii ) && model->isInMode( ii, mode ) )
+                modeRows.fRows.push_back( ii );
+        }
+    }
+    else if ( !fRowFilter.isNull() )
+    {
+        // only the set bits are visited, whole zero bytes are skipped
+        auto bits = reinterpret_cast< const uchar * >( fRowFilter.bits() );
+        auto numBits = std::min( fRowFilter.size(), numRows );
+        for ( int byte = 0; byte * 8 < numBits; ++byte )
+        {
+            if ( !bits[ byte ] )
+                continue;
+            for ( int ii = byte * 8; ( ii < byte * 8 + 8 ) && ( ii < numBits ); ++ii )
+            {
+                if ( ( bits[ byte ] & ( 1 << ( ii & 7 ) ) ) && model->isInMode( ii, mode ) )
+                    modeRows.fRows.push_back( ii );
+            }
+        }
+    }
+    else if ( mode == CMergedTableModel::eAllRows )
+    {
+        modeRows.fRows.resize( numRows );
+        for ( int ii = 0; ii < numRows; ++ii )
+            modeRows.fRows[ ii ] = ii;
+    }
+    else
+        modeRows.fRows = model->partition( mode );
+}
+
+void CMergedProxyModel::sortRows()
+{
+    fSorted.clear();
+    auto model = mergedModel();
+    if ( ( fSortColumn < 0 ) || !model )
+        return;
+    fSorted.resize( model->rowCount() );
+    for ( int ii = 0; ii < static_cast< int >( fSorted.size() ); ++ii )
+        fSorted[ ii ] = ii;
+    std::stable_sort( fSorted.begin(), fSorted.end(), [ this ]( int lhs, int rhs ) { return ( fSortOrder == Qt::AscendingOrder ) ? lessThan( lhs, rhs ) : lessThan( rhs, lhs ); } );
+}
+
+void CMergedProxyModel::setViewMode( CMergedTableModel::EViewMode mode )
+{
+    if ( mode == fViewMode )
+        return;
+
+    emit layoutAboutToBeChanged();
+    auto persistent = persistentIndexList();
+    std::vector< QModelIndex > sourceIndexes;
+    for ( auto && ii : persistent )
+        sourceIndexes.push_back( mapToSource( ii ) );
+
+    fViewMode = mode;
+
+    // rows outside the new partition lose their persistent indexes
+    QModelIndexList moved;
+    for ( auto && ii : sourceIndexes )
+        moved << mapFromSource( ii );
+    changePersistentIndexList( persistent, moved );
+    emit layoutChanged();
+}
+
+void CMergedProxyModel::sort( int column, Qt::SortOrder order )
 {
-    if ( lhs.column() == 0 )
+    if ( ( column == fSortColumn ) && ( order == fSortOrder ) )
+        return;
+
+    emit layoutAboutToBeChanged( {}, QAbstractItemModel::VerticalSortHint );
+    auto persistent = persistentIndexList();
+    std::vector< QModelIndex > sourceIndexes;
+    for ( auto && ii : persistent )
+        sourceIndexes.push_back( mapToSource( ii ) );
+
+    // -1 goes back to the source order
+    fSortColumn = column;
+    fSortOrder = order;
+    sortRows();
+    invalidateRows();
+
+    QModelIndexList moved;
+    for ( auto && ii : sourceIndexes )
+        moved << mapFromSource( ii );
+    changePersistentIndexList( persistent, moved );
+    emit layoutChanged( {}, QAbstractItemModel::VerticalSortHint );
+}
+
+bool CMergedProxyModel::lessThan( int lhsRow, int rhsRow ) const
+{
+    // typed columns compare their 8 byte keys, the cells that are not values sort after them.
+    // Every other column is text, only the column types decide on a numeric order
+    auto model = mergedModel();
+    if ( model->isTypedColumn( fSortColumn ) )
     {
-        return lhs.data().toInt() < rhs.data().toInt();
+        qint64 lhsKey = 0;
+        qint64 rhsKey = 0;
+        auto lhsTyped = model->sortKey( lhsRow, fSortColumn, lhsKey );
+        auto rhsTyped = model->sortKey( rhsRow, fSortColumn, rhsKey );
+        if ( lhsTyped && rhsTyped )
+            return lhsKey < rhsKey;
+        if ( lhsTyped != rhsTyped )
+            return lhsTyped;
     }
-    return QSortFilterProxyModel::lessThan( lhs, rhs );
+    return QString::compare( model->cellText( lhsRow, fSortColumn ), model->cellText( rhsRow, fSortColumn ) ) < 0;
+}
+
+QModelIndex CMergedProxyModel::index( int row, int column, const QModelIndex & parent ) const
+{
+    if ( parent.isValid() || ( row < 0 ) || ( row >= rowCount() ) || ( column < 0 ) || ( column >= columnCount() ) )
+        return {};
+    return createIndex( row, column );
+}
+
+int CMergedProxyModel::rowCount( const QModelIndex & parent ) const
+{
+    return parent.isValid() ? 0 : static_cast< int >( rows().fRows.size() );
+}
+
+int CMergedProxyModel::columnCount( const QModelIndex & parent ) const
+{
+    return ( parent.isValid() || !sourceModel() ) ? 0 : sourceModel()->columnCount();
+}
+
+QModelIndex CMergedProxyModel::mapToSource( const QModelIndex & proxyIndex ) const
+{
+    if ( !proxyIndex.isValid() || !sourceModel() || ( proxyIndex.row() >= rowCount() ) )
+        return {};
+    return sourceModel()->index( rows().fRows[ proxyIndex.row() ], proxyIndex.column() );
+}
+
+QModelIndex CMergedProxyModel::mapFromSource( const QModelIndex & sourceIndex ) const
+{
+    if ( !sourceIndex.isValid() )
+        return {};
+    auto && modeRows = fModeRows[ fViewMode ];
+    if ( !modeRows.fBuilt )
+        buildRows( fViewMode, modeRows );
+    if ( modeRows.fSourceToProxy.empty() && !modeRows.fRows.empty() )
+    {
+        modeRows.fSourceToProxy.assign( sourceModel()->rowCount(), -1 );
+        for ( size_t ii = 0; ii < modeRows.fRows.size(); ++ii )
+            modeRows.fSourceToProxy[ modeRows.fRows[ ii ] ] = static_cast< int >( ii );
+    }
+    auto row = sourceIndex.row();
+    if ( ( row < 0 ) || ( row >= static_cast< int >( modeRows.fSourceToProxy.size() ) ) || ( modeRows.fSourceToProxy[ row ] == -1 ) )
+        return {};
+    return index( modeRows.fSourceToProxy[ row ], sourceIndex.column() );
 }
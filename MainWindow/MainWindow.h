@@ -23,16 +23,33 @@
 #ifndef _MAINWINDOW_H
 #define _MAINWINDOW_H
 
+#include "ColumnStore.h"
+#include "ColumnType.h"
+#include "CSVDialect.h"
+#include "CSVReader.h"
+#include "KeyNormalizer.h"
+#include "MergedSearchIndex.h"
+#include "NWayCompare.h"
+#include "ColumnStatistics.h"
+#include "KeyAdvisor.h"
+#include "OrderedDiff.h"
+#include "LineIndex.h"
+#include "ResultCache.h"
+#include "RowFilter.h"
+#include "TableCompare.h"
+
 #include <QMainWindow>
-#include <QSortFilterProxyModel>
+#include <QAbstractProxyModel>
 #include <QAbstractTableModel>
+#include <QBitArray>
+#include <QDateTime>
+#include <array>
 #include <unordered_map>
+#include <list>
 #include <optional>
 #include <set>
 
-class QTableWidget;
 class QTableView;
-class QTableWidgetItem;
 class QTextStream;
 class QProgressDialog;
 class QFile;
@@ -42,37 +59,96 @@ class QTreeWidget;
 class QListWidget;
 
 class CMergedTableModel;
+class CFileTableModel;
+struct SCSVTable;
 namespace Ui {class CMainWindow;};
 struct SFileData
 {
+    enum ELoadStatus
+    {
+        eLoaded,
+        eLoading,
+        eCanceled,
+        eFailed
+    };
+
+    SFileData();
+    ~SFileData(); // a load still running is canceled
     void clear();
     bool loadFile( const QString & fileName, QWidget * parent );
+    bool startLoad( const QString & fileName, QWidget * parent ); // reads the header
+    ELoadStatus loadRows( int maxRows, QWidget * parent );       // continues from the last row read, -1 for the rest of the file
+    void beginLoad();                                            // the rest of the file on the pool, without a dialog
+    ELoadStatus pollLoad( QString * errorMsg );                  // adds the rows read since the last poll, eLoading until the file is in
+    void cancelLoad();                                           // the rows read so far are kept, their count is marked partial
+    int loadPercent() const;                                     // of the estimated lines, 100 when no load runs
 
     void save( QWidget * parent );
 
-    static bool mergeData( SFileData & lhs, SFileData & rhs, SFileData & retVal, QWidget * parent );
+    static bool mergeData( SFileData & lhs, SFileData & rhs, SFileData & retVal, QWidget * parent, const QStringList & keyColumns = {}, std::vector< CResultCache::SRowPair > * rowPairs = nullptr ); // empty keys hash every shared column
+    static ELoadStatus loadCachedView( SFileData & lhs, SFileData & rhs, SFileData & retVal, QWidget * parent, const CResultCache & cache ); // from the headers alone, eFailed when the open entry does not fit them
+    static bool confirmCached( SFileData & lhs, SFileData & rhs, const QStringList & keyColumns, const CResultCache & cache ); // once the rows are loaded, false when the entry is not of them
+    static void setProjection( SFileData & lhs, SFileData & rhs ); // after both headers are read, only the shared and extra columns get parsed
+    static bool mergeOrdered( SFileData & lhs, SFileData & rhs, SFileData & retVal, QWidget * parent, const QStringList & keyColumns = {} ); // rows in file order, the LHS and RHS columns side by side
 
-    void setTable( QTableWidget * table ) { fTable.first = table; }
+    void setFileTable( QTableView * view, Qt::GlobalColor onlyColor );
     void setTable( QTableView * view );
+    void setMemoryBudget( qint64 bytes );
     void setTotalCount( QLineEdit * le ) { fTotalCount = le; }
     void setSubCount( QLineEdit * le ) { fSubCount = le; }
     void setMergedColumns( QTreeWidget * tree ) { fMergedColumns = tree; }
     void setExtraColumns( QListWidget * list ) { fExtraColumns = list; }
     void setMatchedColumns( QListWidget * list ) { fMatchedColumns = list; }
     void setIgnoredRows( QListWidget * list ) { fIgnoredRows = list; }
+    void setKeyNormalizer( const CKeyNormalizer * normalizer ) { fKeyNormalizer = normalizer; }
+    void setRowFilter( const CRowFilter & filter ) { fRowFilter = filter; } // used by the next load
 
     int rowCount() const;
     int columnCount() const;
     QString itemText( int row, int col ) const;
+    CColumnType columnType( int col ) const; // text for the merged data
 
     int numImportantColumns() const { return static_cast< int >( fImportantCols.size() ); }
+    int numKeyColumns() const { return static_cast< int >( keyColumns().size() ); }
+    int numIgnoredRows() const { return fNumIgnoredRows; }
+    quint64 contentHash() const { return fContentHash; } // of every line read so far, the header included
+    quint64 fingerprint() const { return CResultCache::fingerprint( fShards ); } // of the files, without reading them
+    const std::vector< std::pair< int, int > > & ignoredRanges() const { return fIgnoredRanges; } // first and last line, by data line
+    std::vector< QStringList > sampleRows( const QStringList & columns, int maxRows ) const; // evenly spread over the file
     void setTotalCount( int count );
     void setSubCount( int count );
 
     void updateMatchedColumns();
+    void reportMemory() const; // to CMemoryAccounting
+    QString readBackError() const; // of a spilled chunk or a skipped cell that could not be read back, empty when none
+
+    const CColumnStatistics & statistics() const { return fStatistics; } // collected while the rows load
+    const std::map< QString, qint64 > & changedValues() const { return fChangedValues; } // merged only, per shared column name
+
+    CMergedTableModel * mergedModel() const { return fTable.second.second; }
+
+    using TMergedType = std::unordered_map< int, std::pair< int, int > >;
+    static std::optional< std::pair< bool, QStringList > > getRow( QString currLine, const TMergedType & mergedInfo = {}, const CCSVDialect & dialect = CCSVDialect() );
+    static std::optional< std::pair< bool, QStringList > > getProjectedRow( const QByteArray & rawLine, const std::vector< bool > & projection, const TMergedType & mergedInfo, const CCSVDialect & dialect = CCSVDialect() ); // skipped fields come back empty
+    static QStringList mergeColumns( const QStringList & rowData, const TMergedType & mergedInfo );
+    static TMergedType computeMergedColumns( QStringList & headerRow, std::map< int, QString > & extraCols, QStringList * mergedColumnNames = nullptr );
+    static void computeImportantColumns( SFileData & lhs, SFileData & rhs );
+    static void setKeyColumns( SFileData & lhs, SFileData & rhs, const QStringList & keyColumns );
+
+    // parsed rows on their way from the reader to the store, the full load reads them on the pool
+    struct SRowBatch
+    {
+        std::vector< QStringList > fRows;
+        std::vector< int > fRowLines;     // reader line of each row while projected
+        std::vector< int > fIgnoredLines; // data line of each row the filter ignored
+        QString fError;
+        bool fAtEnd{ false };
+    };
+    void readRows( int maxRows, int numColumns, SRowBatch & batch ); // only touches the reader, the filter and the line and hash counts
+    void addRows( SRowBatch & batch );                              // into the store and statistics, on the GUI thread
 private:
-    bool isIgnoredRow( const QStringList & currRowData ) const;
-    int computeNumberOfLines( QFile & fi, QProgressDialog * dlg ) const;
+    int computeNumberOfLines( const QString & fileName, QProgressDialog * dlg ) const;
+    int estimateNumberOfLines( const QStringList & fileNames ) const; // from their sizes and a sample of their lines, without reading them
     void writeRow( QTextStream & ts, QStringList & rowData ) const;
     QStringList getRowData( int row ) const
     {
@@ -91,7 +167,9 @@ private:
     QStringList getAllRowData( int row ) const;
     QString getData( int row, int col ) const;
 
-    void setBackground( int row, Qt::GlobalColor clr );
+    void setOnlyRow( int row );
+    std::set< int > pinnedColumns() const;
+    void updatePinnedColumns();
 
     QStringList getExtraColumns() const;
     QStringList getColumns() const;
@@ -99,32 +177,162 @@ private:
     QString getHeader( int headerCol ) const;
     QStringList getHeader() const;
 
-    static bool computeMD5s( SFileData & lhs, SFileData & rhs, QWidget * parent );
+    static bool computeMD5s( SFileData & lhs, SFileData & rhs, const QStringList & keyColumns, QWidget * parent );
+    static bool loadMerged( SFileData & lhs, SFileData & rhs, SFileData & retVal, const CResultCache::SRowPair * rowPairs, int numRowPairs, QProgressDialog & dlg );
+    static void setMergedHeader( SFileData & lhs, SFileData & rhs, SFileData & retVal );
+    static void showMergedCounts( SFileData & lhs, SFileData & rhs, SFileData & retVal );
+    const std::set< int > & keyColumns() const { return fKeyCols.empty() ? fImportantCols : fKeyCols; }
+    std::vector< quint64 > rowHashes() const; // of the MD5 keys, in row order
+    QStringList getOrderedRowData( int row, const COrderedDiff & diff, bool isLHS ) const;
     bool computeMD5s( const QString & label, QWidget * parent );
-    using TMergedType = std::unordered_map< int, std::pair< int, int > >;
-    std::optional< std::pair< bool, QStringList > > getRow( QString currLine, const TMergedType & mergedInfo = {} ) const;
 
+    void addIgnoredRow( int lineNum );
+    void updateIgnoredRows();
+    QString appendShards( std::vector< SCSVTable > & shards, QProgressDialog * dlg ); // after the first shard, the error when a header differs, dlg may be null
     void computeHeaderInfo();
-    std::pair< QTableWidget *, std::pair< QTableView *, CMergedTableModel * > > fTable{ nullptr, { nullptr, nullptr} };
+    void inferColumnTypes();
+    struct SFullLoad;
+    QString keyText( int row, int col ) const;
+    void setProjection( const std::set< int > & neededCols );
+    QString lazyData( int row, int col ) const;
+
+    std::pair< CFileTableModel *, std::pair< QTableView *, CMergedTableModel * > > fTable{ nullptr, { nullptr, nullptr} };
     QLineEdit * fTotalCount{ nullptr };
     QLineEdit * fSubCount{ nullptr };
     QTreeWidget * fMergedColumns{ nullptr };
     QListWidget * fExtraColumns{ nullptr };
     QListWidget * fMatchedColumns{ nullptr };
     QListWidget * fIgnoredRows{ nullptr };
-    std::map< int, QByteArray > fRowToMD5;
-    std::unordered_map< QByteArray, int > fMD5ToRow;
-    std::map< QString, std::pair< QTableWidgetItem *, int > > fHeaderInfo;
+    const CKeyNormalizer * fKeyNormalizer{ nullptr };
+    CRowFilter fRowFilter;
+    std::vector< std::pair< int, int > > fIgnoredRanges;
+    int fNumIgnoredRows{ 0 };
+    quint64 fContentHash{ 0 };
+    SKeyIndex fKeyIndex;
+    std::map< QString, int > fHeaderInfo;
     std::map< int, QString > fExtraUnimportantCols;
     std::set< int > fImportantCols;
+    std::set< int > fKeyCols; // subset of fImportantCols hashed for the match, empty for all of them
+    std::set< int > fTypedCols; // shared columns both files hold as comparable typed values
+    CColumnStatistics fStatistics;
+    std::map< QString, qint64 > fChangedValues;
+
+    QString fFileName;
+    QStringList fShards; // the files fFileName names, more than one for the shards of one logical table
+    std::vector< int > fShardRows; // first row of each shard, empty for a single file
+    std::unique_ptr< CCSVReader > fReader;
+    CCSVDialect fDialect; // sniffed when the load starts
+    TMergedType fMergedInfo;
+    int fRawColumnCount{ 0 }; // before the name columns are merged
+    int fRowNum{ 0 };
+    int fLineNum{ 0 };
+    std::unique_ptr< SFullLoad > fFullLoad; // while beginLoad's load runs
+
+    static const int kMaxLazyRows = 4096;
+    using TLazyRows = std::list< std::pair< int, QStringList > >;
+    std::vector< bool > fProjection; // per raw field, empty when every field is parsed
+    std::vector< int > fRowLines;    // reader line of each row while projected
+    qint64 fLoadedSize{ -1 };        // of the file when the load started, the skipped cells are only read back from that file
+    QDateTime fLoadedModified;
+    mutable CLineIndex fLineIndex;
+    mutable TLazyRows fLazyLRU; // front is the least recently used
+    mutable std::unordered_map< int, TLazyRows::iterator > fLazyRows;
+    mutable QString fLazyError;
+};
+
+class CFileTableModel : public QAbstractTableModel
+{
+    Q_OBJECT;
+public:
+    CFileTableModel( Qt::GlobalColor onlyColor, QObject * parent );
+
+    void clear();
+    void modelReset()
+    {
+        beginResetModel();
+        endResetModel();
+    }
+
+    CColumnStore & store() { return fStore; }
+    const CColumnStore & store() const { return fStore; }
+
+    void setHeader( const QStringList & headerInfo );
+    void setHeaderText( int section, const QString & text );
+    QString headerText( int section ) const
+    {
+        if ( ( section < 0 ) || ( section >= fHeaderInfo.count() ) )
+            return {};
+        return fHeaderInfo[ section ];
+    }
+
+    qint64 estimateBytes() const; // header and row status, the cells are counted by the store
+
+    // rows only in this file, drawn in the only color through Qt::BackgroundRole
+    void setOnlyRow( int row );
+    void rowStatusChanged();
+    void syncRowCount(); // shows the rows added to the store since the last call
+
+    virtual QVariant headerData( int section, Qt::Orientation orientation, int role = Qt::DisplayRole ) const override
+    {
+        if ( ( orientation != Qt::Orientation::Horizontal ) || ( role != Qt::DisplayRole ) )
+            return QAbstractTableModel::headerData( section, orientation, role );
+        if ( section >= fHeaderInfo.count() )
+            return section;
+        return fHeaderInfo[ section ];
+    }
+
+    virtual int columnCount( const QModelIndex & /*idx*/ = QModelIndex() ) const override
+    {
+        return fHeaderInfo.count();
+    }
+
+    virtual int rowCount( const QModelIndex & /*idx*/ = QModelIndex() ) const override
+    {
+        return fNumRows;
+    }
+
+    virtual QVariant data( const QModelIndex & index, int role = Qt::DisplayRole ) const override;
+private:
+    QStringList fHeaderInfo;
+    CColumnStore fStore;
+    int fNumRows{ 0 };
+    Qt::GlobalColor fOnlyColor;
+    std::vector< bool > fOnlyRows;
 };
 
 class CMergedTableModel : public QAbstractTableModel
 {
     Q_OBJECT;
 public:
+    enum EViewMode
+    {
+        eAllRows,
+        eLeftOnlyRows,
+        eRightOnlyRows,
+        eBothRows
+    };
+
     CMergedTableModel( QObject * parent );
 
+    int numDataRows() const { return static_cast< int >( fData.size() ); }
+    bool isInMode( int row, EViewMode mode ) const;
+
+    // an N-way compare's inputs, their presence columns start at firstColumn. Its rows are
+    // partitioned on the presence bits: eLeftOnlyRows holds the rows missing from some input,
+    // eRightOnlyRows those in a single input and eBothRows those in every input
+    void setSources( const QStringList & names, int firstColumn );
+    bool isNWay() const { return !fSources.isEmpty(); }
+    const QStringList & sources() const { return fSources; }
+    const QBitArray & presence( int row ) const { return fPresence[ row ]; } // N-way only
+    void addRow( const QStringList & rowData, const QBitArray & presence );
+
+    // the rows of one status, built in addRow. eAllRows is every row and has no partition, asking for it is an error
+    const std::vector< int > & partition( EViewMode mode ) const;
+    int leftOnlyCount() const { return static_cast< int >( fLeftOnlyRows.size() ); }
+    int rightOnlyCount() const { return static_cast< int >( fRightOnlyRows.size() ); }
+    int bothCount() const { return static_cast< int >( fBothRows.size() ); }
+    qint64 estimateBytes() const;
+
     void clear();
     void modelReset()
     {
@@ -132,12 +340,22 @@ public:
         endResetModel();
     }
 
-    void setHeader( const QStringList & headerInfo )
+    void setHeader( const QStringList & headerInfo, int splitColumn = -1 ) // columns from splitColumn on are the RHS side, -1 when the columns are shared
     {
         beginResetModel();
         fHeaderInfo = headerInfo;
+        fSplitColumn = splitColumn;
+        fColumnTypes.clear();
+        fSortKeys.clear();
         endResetModel();
     }
+    void setColumnTypes( const std::vector< CColumnType > & types )
+    {
+        fColumnTypes = types;
+        fSortKeys.clear();
+    }
+    bool isTypedColumn( int col ) const { return ( col >= 0 ) && ( col < static_cast< int >( fColumnTypes.size() ) ) && fColumnTypes[ col ].isTyped(); }
+    bool sortKey( int row, int col, qint64 & key ) const; // false when the cell is not a value of its column's type
     virtual QVariant headerData( int section, Qt::Orientation orientation, int role = Qt::DisplayRole ) const override
     {
         if ( ( orientation != Qt::Orientation::Horizontal ) || ( role != Qt::DisplayRole ) )
@@ -154,17 +372,36 @@ public:
 
     virtual int rowCount( const QModelIndex & /*idx*/ = QModelIndex() ) const override
     {
-        return static_cast< int >( fData.size() );;
+        return static_cast< int >( fData.size() );
     }
 
+    // leftOnly and rightOnly together are a changed pair of the ordered diff, an LHS only row
+    // beside an RHS only row, it is in both of those partitions
     virtual void addRow( const QStringList & rowData, bool leftOnly, bool rightOnly, bool emitSignal )
     {
+        auto both = !leftOnly && !rightOnly;
         if ( emitSignal )
-            beginInsertRows( QModelIndex(), static_cast<int>( fData.size() ), static_cast<int>( fData.size() ) );
+            beginInsertRows( QModelIndex(), rowCount(), rowCount() );
+        auto row = static_cast< int >( fData.size() );
+        if ( leftOnly )
+            fLeftOnlyRows.push_back( row );
+        if ( rightOnly )
+            fRightOnlyRows.push_back( row );
+        if ( both )
+            fBothRows.push_back( row );
         fData.emplace_back( std::make_tuple( rowData, leftOnly, rightOnly ) );
         if ( emitSignal )
             endInsertRows();
     }
+
+    const QStringList & rowData( int row ) const { return std::get< 0 >( fData[ row ] ); }
+    QString cellText( int row, int col ) const
+    {
+        auto && rowData = std::get< 0 >( fData[ row ] );
+        if ( col >= rowData.count() )
+            return {};
+        return rowData[ col ];
+    }
     virtual QVariant data( const QModelIndex & index, int role = Qt::DisplayRole ) const override
     {
         if ( !index.isValid() )
@@ -173,13 +410,23 @@ public:
             return {};
         if ( index.column() >= columnCount() )
             return {};
+        auto row = index.row();
         if ( role == Qt::DisplayRole )
-            return std::get< 0 >( fData[ index.row() ] )[ index.column() ];
+            return std::get< 0 >( fData[ row ] )[ index.column() ];
+        else if ( ( role == Qt::BackgroundRole ) && isNWay() )
+        {
+            // the inputs the row is missing from
+            auto source = index.column() - fFirstSourceColumn;
+            if ( ( source >= 0 ) && ( source < fSources.count() ) && !fPresence[ row ].testBit( source ) )
+                return QBrush( Qt::red );
+        }
         else if ( role == Qt::BackgroundRole )
         {
-            if ( std::get< 1 >( fData[ index.row() ] ) )
+            if ( std::get< 1 >( fData[ row ] ) && std::get< 2 >( fData[ row ] ) && ( fSplitColumn >= 0 ) )
+                return QBrush( ( index.column() < fSplitColumn ) ? Qt::red : Qt::yellow );
+            if ( std::get< 1 >( fData[ row ] ) )
                 return QBrush( Qt::red );
-            if ( std::get< 2 >( fData[ index.row() ] ) )
+            if ( std::get< 2 >( fData[ row ] ) )
                 return QBrush( Qt::yellow );
         }
         return QVariant();
@@ -187,19 +434,67 @@ public:
 private:
     QStringList fHeaderInfo;
     std::vector< std::tuple< QStringList, bool, bool > > fData;
+    std::vector< int > fLeftOnlyRows;
+    std::vector< int > fRightOnlyRows;
+    std::vector< int > fBothRows;
+    QStringList fSources;
+    int fFirstSourceColumn{ -1 };
+    std::vector< QBitArray > fPresence; // per row of an N-way compare
+    int fSplitColumn{ -1 };
+    std::vector< CColumnType > fColumnTypes;
+    mutable std::vector< std::vector< qint64 > > fSortKeys; // per column, parsed on the first sort by it
 };
 
-class CMergedProxyModel : public QSortFilterProxyModel
+// Sorts and filters the merged rows and shows one status partition of them. Every row is sorted
+// once per sort, each view mode's rows are picked out of that order the first time the mode is
+// shown and kept until the sort, the filter or the source changes, so switching modes never sorts
+class CMergedProxyModel : public QAbstractProxyModel
 {
     Q_OBJECT
 
 public:
     CMergedProxyModel( QObject * parent ) :
-        QSortFilterProxyModel( parent )
+        QAbstractProxyModel( parent )
     {
     }
-protected:
-    bool lessThan( const QModelIndex & lhs, const QModelIndex & rhs ) const override;
+
+    void setSourceModel( QAbstractItemModel * sourceModel ) override;
+    void setRowFilter( const QBitArray & rows ); // over the merged rows, null for all rows
+    // swaps in the rows of the partition behind a single layout change, the source model is not reset
+    // and the rows are not sorted again
+    void setViewMode( CMergedTableModel::EViewMode mode );
+    CMergedTableModel::EViewMode viewMode() const { return fViewMode; }
+    qint64 estimateBytes() const;
+
+    QModelIndex index( int row, int column, const QModelIndex & parent = QModelIndex() ) const override;
+    QModelIndex parent( const QModelIndex & /*child*/ ) const override { return {}; }
+    int rowCount( const QModelIndex & parent = QModelIndex() ) const override;
+    int columnCount( const QModelIndex & parent = QModelIndex() ) const override;
+    QModelIndex mapToSource( const QModelIndex & proxyIndex ) const override;
+    QModelIndex mapFromSource( const QModelIndex & sourceIndex ) const override;
+    void sort( int column, Qt::SortOrder order = Qt::AscendingOrder ) override;
+private:
+    struct SRows
+    {
+        bool fBuilt{ false };
+        std::vector< int > fRows;          // proxy row to source row
+        std::vector< int > fSourceToProxy; // built on the first mapFromSource after fRows was built
+    };
+
+    CMergedTableModel * mergedModel() const { return qobject_cast< CMergedTableModel * >( sourceModel() ); }
+    bool lessThan( int lhsRow, int rhsRow ) const; // source rows, in the sort column
+    void sortRows(); // every source row, into fSorted
+    const SRows & rows() const; // of the view mode, built on first use
+    void buildRows( CMergedTableModel::EViewMode mode, SRows & modeRows ) const;
+    void invalidateRows();
+    void resetFromSource();
+
+    CMergedTableModel::EViewMode fViewMode{ CMergedTableModel::eAllRows };
+    QBitArray fRowFilter;
+    int fSortColumn{ -1 }; // -1 keeps the source order
+    Qt::SortOrder fSortOrder{ Qt::AscendingOrder };
+    std::vector< int > fSorted; // every source row in the sort order, empty while unsorted
+    mutable std::array< SRows, 4 > fModeRows; // by EViewMode
 };
 
 class CMainWindow : public QMainWindow
@@ -223,18 +518,52 @@ public Q_SLOTS:
     void slotFilesChanged();
     void slotLoad();
     void slotSave();
+    void slotCompareMultiple();
+    void slotSetMemoryBudget();
+    void slotSetRowFilter();
+    void slotSearch();
+    void slotViewModeChanged();
+    void slotMatchedColumnsContextMenu( QListWidget * list, const QPoint & pos );
+    void slotKeyColumnChanged( QListWidget * list );
+    void slotAutoKeyColumnsChanged();
+    void slotOrderedDiffChanged();
 
     void slotResultsItemChanged( QTreeWidgetItem * curr, QTreeWidgetItem * prev );
 private:
     void loadSettings();
     void saveSettings();
+    bool filesValid() const;
     void loadFiles();
+    void loadAndCompare();
+    SFileData::ELoadStatus loadRest(); // both files at once, without a dialog
+    void loadNWayResults();
+    void updateMemoryBudget();
+    void buildSearchIndex();
+    void updateStatusCounts();
+    void updateMemoryUsage();
+    void updateColumnStatistics();
+    void adviseKeyColumns();
+    void updateMatchedColumns();
+    QStringList keyColumns() const;
+    bool mergeKeyed();
+    CResultCache::SKey cacheKey() const; // of the files and the settings the keyed join depends on
+    bool showCachedResults(); // before the full load, the entry is left open to be confirmed
 
     void clear();
 
     SFileData fLHS;
     SFileData fRHS;
     SFileData fMerged;
+    CNWayCompare fNWay;
+    CMergedSearchIndex fSearchIndex;
+    CKeyNormalizer fKeyNormalizer;
+    CRowFilter fRowFilter;
+    CKeyAdvisor fKeyAdvisor;
+    CResultCache fResultCache;
+    QStringList fKeyColumnsOverride; // chosen on the Matched Columns page, until the files change
+    int fMemoryBudgetMB{ 0 };
+    int fPreviewRows{ 100 };
+    bool fLoading{ false }; // the window stays in use while the files load
 
     std::unique_ptr< Ui::CMainWindow > fImpl;
 };
@@ -0,0 +1,174 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "MemoryAccounting.h"
+
+#include <QLocale>
+#include <algorithm>
+
+CMemoryAccounting & CMemoryAccounting::instance()
+{
+    static CMemoryAccounting sInstance;
+    return sInstance;
+}
+
+void CMemoryAccounting::setLive( ESubsystem subsystem, const void * owner, qint64 bytes )
+{
+    std::lock_guard< std::mutex > lock( fMutex );
+    auto && owners = fOwners[ subsystem ];
+    auto pos = owners.find( owner );
+    if ( pos != owners.end() )
+    {
+        fLive[ subsystem ] -= ( *pos ).second;
+        owners.erase( pos );
+    }
+    if ( bytes > 0 )
+    {
+        owners[ owner ] = bytes;
+        fLive[ subsystem ] += bytes;
+    }
+    updatePeaks( subsystem );
+}
+
+void CMemoryAccounting::release( const void * owner )
+{
+    std::lock_guard< std::mutex > lock( fMutex );
+    for ( int ii = 0; ii < eNumSubsystems; ++ii )
+    {
+        auto pos = fOwners[ ii ].find( owner );
+        if ( pos == fOwners[ ii ].end() )
+            continue;
+        fLive[ ii ] -= ( *pos ).second;
+        fOwners[ ii ].erase( pos );
+    }
+}
+
+void CMemoryAccounting::resetPeaks()
+{
+    std::lock_guard< std::mutex > lock( fMutex );
+    fTotalPeak = 0;
+    for ( int ii = 0; ii < eNumSubsystems; ++ii )
+    {
+        fPeak[ ii ] = fLive[ ii ];
+        fTotalPeak += fLive[ ii ];
+    }
+}
+
+void CMemoryAccounting::updatePeaks( ESubsystem subsystem )
+{
+    fPeak[ subsystem ] = std::max( fPeak[ subsystem ], fLive[ subsystem ] );
+
+    qint64 total = 0;
+    for ( int ii = 0; ii < eNumSubsystems; ++ii )
+        total += fLive[ ii ];
+    fTotalPeak = std::max( fTotalPeak, total );
+}
+
+qint64 CMemoryAccounting::liveBytes( ESubsystem subsystem ) const
+{
+    std::lock_guard< std::mutex > lock( fMutex );
+    return fLive[ subsystem ];
+}
+
+qint64 CMemoryAccounting::peakBytes( ESubsystem subsystem ) const
+{
+    std::lock_guard< std::mutex > lock( fMutex );
+    return fPeak[ subsystem ];
+}
+
+qint64 CMemoryAccounting::totalLiveBytes() const
+{
+    std::lock_guard< std::mutex > lock( fMutex );
+    qint64 retVal = 0;
+    for ( int ii = 0; ii < eNumSubsystems; ++ii )
+        retVal += fLive[ ii ];
+    return retVal;
+}
+
+qint64 CMemoryAccounting::totalPeakBytes() const
+{
+    std::lock_guard< std::mutex > lock( fMutex );
+    return fTotalPeak;
+}
+
+QJsonObject CMemoryAccounting::toJson() const
+{
+    QJsonObject retVal;
+    for ( int ii = 0; ii < eNumSubsystems; ++ii )
+    {
+        auto subsystem = static_cast< ESubsystem >( ii );
+        QJsonObject curr;
+        curr[ "liveBytes" ] = liveBytes( subsystem );
+        curr[ "peakBytes" ] = peakBytes( subsystem );
+        retVal[ name( subsystem ) ] = curr;
+    }
+    QJsonObject total;
+    total[ "liveBytes" ] = totalLiveBytes();
+    total[ "peakBytes" ] = totalPeakBytes();
+    retVal[ "Total" ] = total;
+    return retVal;
+}
+
+QString CMemoryAccounting::name( ESubsystem subsystem )
+{
+    switch ( subsystem )
+    {
+        case eRawInput:
+            return "Raw Input";
+        case eCellStore:
+            return "Cell Store";
+        case eKeyIndex:
+            return "Key Index";
+        case eMergeResult:
+            return "Merge Result";
+        case eViewModels:
+            return "View Models";
+        case eNumSubsystems:
+            break;
+    }
+    return {};
+}
+
+QString CMemoryAccounting::formatBytes( qint64 bytes )
+{
+    return QLocale().formattedDataSize( bytes );
+}
+
+qint64 CMemoryAccounting::estimateBytes( const QString & str )
+{
+    // QString object plus the shared data header and the utf16 payload, same as CColumnStore
+    return static_cast< qint64 >( sizeof( QString ) ) + ( str.isEmpty() ? 0 : ( 24 + ( str.capacity() + 1 ) * 2 ) );
+}
+
+qint64 CMemoryAccounting::estimateBytes( const QStringList & list )
+{
+    // the list data block holds a pointer per entry
+    qint64 retVal = static_cast< qint64 >( sizeof( QStringList ) ) + ( list.isEmpty() ? 0 : ( 24 + list.count() * sizeof( void * ) ) );
+    for ( auto && ii : list )
+        retVal += estimateBytes( ii ) - static_cast< qint64 >( sizeof( QString ) );
+    return retVal;
+}
+
+qint64 CMemoryAccounting::estimateBytes( const QByteArray & data )
+{
+    return static_cast< qint64 >( sizeof( QByteArray ) ) + ( data.isEmpty() ? 0 : ( 24 + data.capacity() + 1 ) );
+}
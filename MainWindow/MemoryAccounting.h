@@ -0,0 +1,87 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _MEMORYACCOUNTING_H
+#define _MEMORYACCOUNTING_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Live and peak bytes per subsystem for the whole process.
+// Each owner (a file, a table, a compare) reports a size estimate of what it currently holds,
+// the live value of a subsystem is the sum over its owners and the peak is the largest live value reported
+class CMemoryAccounting
+{
+public:
+    enum ESubsystem
+    {
+        eRawInput,    // read buffers
+        eCellStore,   // parsed cell values
+        eKeyIndex,    // row keys and key lookups
+        eMergeResult, // merged rows
+        eViewModels,  // models, proxies and indexes that only exist for the views
+        eNumSubsystems
+    };
+
+    static CMemoryAccounting & instance();
+
+    void setLive( ESubsystem subsystem, const void * owner, qint64 bytes ); // 0 drops the owner
+    void release( const void * owner );                                     // from every subsystem
+    void resetPeaks();
+
+    qint64 liveBytes( ESubsystem subsystem ) const;
+    qint64 peakBytes( ESubsystem subsystem ) const;
+    qint64 totalLiveBytes() const;
+    qint64 totalPeakBytes() const;
+
+    QJsonObject toJson() const;
+
+    static QString name( ESubsystem subsystem );
+    static QString formatBytes( qint64 bytes );
+
+    // estimates of the object plus its heap payload
+    static qint64 estimateBytes( const QString & str );
+    static qint64 estimateBytes( const QStringList & list );
+    static qint64 estimateBytes( const QByteArray & data );
+    template< typename T >
+    static qint64 estimateBytes( const std::vector< T > & vec )
+    {
+        return static_cast< qint64 >( sizeof( vec ) + vec.capacity() * sizeof( T ) );
+    }
+    static constexpr qint64 kNodeOverhead = 32; // per node of a std::map / std::unordered_map, pointers and allocator header
+private:
+    CMemoryAccounting() = default;
+    void updatePeaks( ESubsystem subsystem );
+
+    mutable std::mutex fMutex;
+    std::map< const void *, qint64 > fOwners[ eNumSubsystems ];
+    qint64 fLive[ eNumSubsystems ]{};
+    qint64 fPeak[ eNumSubsystems ]{};
+    qint64 fTotalPeak{ 0 };
+};
+
+#endif
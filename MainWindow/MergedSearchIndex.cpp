@@ -0,0 +1,286 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "MergedSearchIndex.h"
+#include "MainWindow.h"
+#include "MemoryAccounting.h"
+#include "WorkStealingPool.h"
+
+#include <QRegularExpression>
+#include <algorithm>
+
+void CMergedSearchIndex::clear()
+{
+    fModel = nullptr;
+    fColumns.clear();
+    fIndex.clear();
+}
+
+qint64 CMergedSearchIndex::estimateBytes() const
+{
+    auto retVal = CMemoryAccounting::estimateBytes( fColumns ) + CMemoryAccounting::estimateBytes( fIndex );
+    for ( auto && column : fIndex )
+    {
+        retVal += static_cast< qint64 >( column.size() * ( CMemoryAccounting::kNodeOverhead + sizeof( TPostings::value_type ) ) + column.bucket_count() * sizeof( void * ) );
+        for ( auto && ii : column )
+            retVal += static_cast< qint64 >( ii.second.capacity() * sizeof( int ) );
+    }
+    return retVal;
+}
+
+CMergedSearchIndex::TTrigram CMergedSearchIndex::trigram( const QChar * data )
+{
+    return ( static_cast< TTrigram >( data[ 0 ].unicode() ) << 32 ) | ( static_cast< TTrigram >( data[ 1 ].unicode() ) << 16 ) | data[ 2 ].unicode();
+}
+
+void CMergedSearchIndex::build( const CMergedTableModel * model )
+{
+    clear();
+    if ( !model )
+        return;
+
+    fModel = model;
+    for ( int ii = 0; ii < model->columnCount(); ++ii )
+    {
+        auto name = model->headerData( ii, Qt::Horizontal ).toString();
+        if ( name.endsWith( "*" ) )
+            name = name.left( name.length() - 1 );
+        fColumns << name.toCaseFolded();
+    }
+    fIndex.resize( fColumns.count() );
+
+    // columns are independent, so each item indexes a whole column
+    auto numRows = model->numDataRows();
+    CWorkStealingPool::shared().parallelFor( fColumns.count(),
+                                             [ & ]( int col )
+                                             {
+                                                 auto && postings = fIndex[ col ];
+                                                 for ( int row = 0; row < numRows; ++row )
+                                                 {
+                                                     auto text = model->cellText( row, col ).toCaseFolded();
+                                                     auto data = text.constData();
+                                                     for ( int pos = 0; pos + 3 <= text.length(); ++pos )
+                                                     {
+                                                         auto && rows = postings[ trigram( data + pos ) ];
+                                                         if ( rows.empty() || ( rows.back() != row ) )
+                                                             rows.push_back( row );
+                                                     }
+                                                 }
+                                                 return true;
+                                             } );
+}
+
+int CMergedSearchIndex::findColumn( const QString & name ) const
+{
+    return fColumns.indexOf( name.trimmed().toCaseFolded() );
+}
+
+std::vector< int > CMergedSearchIndex::candidates( int column, const QString & foldedText ) const
+{
+    // intersect the posting lists of every trigram in the text, smallest first
+    std::vector< const std::vector< int > * > lists;
+    auto && postings = fIndex[ column ];
+    for ( int pos = 0; pos + 3 <= foldedText.length(); ++pos )
+    {
+        auto ii = postings.find( trigram( foldedText.constData() + pos ) );
+        if ( ii == postings.end() )
+            return {};
+        lists.push_back( &( *ii ).second );
+    }
+    std::sort( lists.begin(), lists.end(), []( const std::vector< int > * lhs, const std::vector< int > * rhs ) { return lhs->size() < rhs->size(); } );
+
+    std::vector< int > retVal = *lists.front();
+    for ( size_t ii = 1; ( ii < lists.size() ) && !retVal.empty(); ++ii )
+    {
+        std::vector< int > tmp;
+        std::set_intersection( retVal.begin(), retVal.end(), lists[ ii ]->begin(), lists[ ii ]->end(), std::back_inserter( tmp ) );
+        retVal.swap( tmp );
+    }
+    return retVal;
+}
+
+QBitArray CMergedSearchIndex::contains( int column, const QString & text ) const
+{
+    auto numRows = fModel->numDataRows();
+    QBitArray retVal( numRows );
+    auto folded = text.toCaseFolded();
+    if ( folded.length() < 3 )
+    {
+        // too short for the index
+        for ( int ii = 0; ii < numRows; ++ii )
+        {
+            if ( fModel->cellText( ii, column ).toCaseFolded().contains( folded ) )
+                retVal.setBit( ii );
+        }
+        return retVal;
+    }
+
+    // the trigrams only say the row might match, check the candidates
+    for ( auto && ii : candidates( column, folded ) )
+    {
+        if ( fModel->cellText( ii, column ).toCaseFolded().contains( folded ) )
+            retVal.setBit( ii );
+    }
+    return retVal;
+}
+
+QBitArray CMergedSearchIndex::equals( int column, const QString & text ) const
+{
+    auto numRows = fModel->numDataRows();
+    QBitArray retVal( numRows );
+    auto folded = text.toCaseFolded();
+    if ( folded.length() < 3 )
+    {
+        for ( int ii = 0; ii < numRows; ++ii )
+        {
+            if ( fModel->cellText( ii, column ).toCaseFolded() == folded )
+                retVal.setBit( ii );
+        }
+        return retVal;
+    }
+
+    for ( auto && ii : candidates( column, folded ) )
+    {
+        if ( fModel->cellText( ii, column ).toCaseFolded() == folded )
+            retVal.setBit( ii );
+    }
+    return retVal;
+}
+
+QBitArray CMergedSearchIndex::status( const QString & text, QString * errorMsg ) const
+{
+    auto numRows = fModel->numDataRows();
+    QBitArray retVal( numRows );
+    auto value = text.trimmed().toLower();
+
+    // an N-way compare partitions on the inputs each row is in
+    auto nway = fModel->isNWay();
+    QStringList names = nway ? QStringList( { "missing", "one-only", "in-all" } ) : QStringList( { "left-only", "right-only", "both" } );
+    auto pos = names.indexOf( value );
+    if ( pos == -1 )
+    {
+        if ( errorMsg )
+            *errorMsg = QObject::tr( "Unknown status '%1', use %2, %3 or %4" ).arg( text ).arg( names[ 0 ] ).arg( names[ 1 ] ).arg( names[ 2 ] );
+        return {};
+    }
+
+    auto mode = CMergedTableModel::eBothRows;
+    if ( pos == 0 )
+        mode = CMergedTableModel::eLeftOnlyRows;
+    else if ( pos == 1 )
+        mode = CMergedTableModel::eRightOnlyRows;
+    for ( auto && ii : fModel->partition( mode ) )
+        retVal.setBit( ii );
+    return retVal;
+}
+
+QBitArray CMergedSearchIndex::presence( const QString & source, bool present, QString * errorMsg ) const
+{
+    // by file name or by 1 based position
+    auto && sources = fModel->sources();
+    auto pos = -1;
+    for ( int ii = 0; ( pos == -1 ) && ( ii < sources.count() ); ++ii )
+    {
+        if ( sources[ ii ].compare( source.trimmed(), Qt::CaseInsensitive ) == 0 )
+            pos = ii;
+    }
+    bool aOK = false;
+    auto num = source.trimmed().toInt( &aOK );
+    if ( ( pos == -1 ) && aOK && ( num >= 1 ) && ( num <= sources.count() ) )
+        pos = num - 1;
+    if ( pos == -1 )
+    {
+        if ( errorMsg )
+            *errorMsg = QObject::tr( "Unknown input '%1', use its file name or number" ).arg( source );
+        return {};
+    }
+
+    auto numRows = fModel->numDataRows();
+    QBitArray retVal( numRows );
+    for ( int ii = 0; ii < numRows; ++ii )
+    {
+        if ( fModel->presence( ii ).testBit( pos ) == present )
+            retVal.setBit( ii );
+    }
+    return retVal;
+}
+
+QBitArray CMergedSearchIndex::query( const QString & queryText, QString * errorMsg ) const
+{
+    if ( !fModel )
+        return {};
+
+    QBitArray retVal;
+    auto clauses = queryText.split( QRegularExpression( R"(\s+and\s+)", QRegularExpression::CaseInsensitiveOption ), Qt::SkipEmptyParts );
+    for ( auto && clause : clauses )
+    {
+        QBitArray curr;
+        auto containsPos = clause.indexOf( QRegularExpression( R"(\s+contains\s+)", QRegularExpression::CaseInsensitiveOption ) );
+        auto equalsPos = clause.indexOf( '=' );
+        if ( containsPos > 0 )
+        {
+            auto match = QRegularExpression( R"(^(.*?)\s+contains\s+(.*)$)", QRegularExpression::CaseInsensitiveOption ).match( clause );
+            auto column = findColumn( match.captured( 1 ) );
+            if ( column == -1 )
+            {
+                if ( errorMsg )
+                    *errorMsg = QObject::tr( "Unknown column '%1'" ).arg( match.captured( 1 ).trimmed() );
+                return {};
+            }
+            curr = contains( column, match.captured( 2 ).trimmed() );
+        }
+        else if ( equalsPos > 0 )
+        {
+            auto name = clause.left( equalsPos ).trimmed();
+            auto value = clause.mid( equalsPos + 1 ).trimmed();
+            if ( ( name.toLower() == "status" ) && ( findColumn( name ) == -1 ) )
+                curr = status( value, errorMsg );
+            else if ( fModel->isNWay() && ( ( name.toLower() == "in" ) || ( name.toLower() == "missing" ) ) && ( findColumn( name ) == -1 ) )
+                curr = presence( value, name.toLower() == "in", errorMsg );
+            else
+            {
+                auto column = findColumn( name );
+                if ( column == -1 )
+                {
+                    if ( errorMsg )
+                        *errorMsg = QObject::tr( "Unknown column '%1'" ).arg( name );
+                    return {};
+                }
+                curr = equals( column, value );
+            }
+            if ( curr.isNull() )
+                return {};
+        }
+        else
+        {
+            curr = QBitArray( fModel->numDataRows() );
+            for ( int ii = 0; ii < fColumns.count(); ++ii )
+                curr |= contains( ii, clause.trimmed() );
+        }
+
+        if ( retVal.isNull() )
+            retVal = curr;
+        else
+            retVal &= curr;
+    }
+    return retVal;
+}
@@ -0,0 +1,70 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _MERGEDSEARCHINDEX_H
+#define _MERGEDSEARCHINDEX_H
+
+#include <QBitArray>
+#include <QString>
+#include <QStringList>
+#include <unordered_map>
+#include <vector>
+
+class CMergedTableModel;
+
+// Trigram index over every column of the merged model, built once after the merge.
+// Queries are answered as a bitmap of the model rows that match
+//    <column> contains <text>
+//    <column> = <text>
+//    status = left-only|right-only|both
+//    status = missing|one-only|in-all    - N-way, missing from some, in a single input or in every input
+//    in = <input>, missing = <input>     - N-way, by the input's file name or number
+//    <text>                              - contains, in any column
+// clauses can be combined with " and "
+class CMergedSearchIndex
+{
+public:
+    void clear();
+    void build( const CMergedTableModel * model );
+    bool isEmpty() const { return fModel == nullptr; }
+    qint64 estimateBytes() const;
+
+    QBitArray query( const QString & queryText, QString * errorMsg = nullptr ) const;
+private:
+    using TTrigram = quint64;
+    using TPostings = std::unordered_map< TTrigram, std::vector< int > >;
+
+    static TTrigram trigram( const QChar * data );
+    int findColumn( const QString & name ) const;
+
+    QBitArray contains( int column, const QString & text ) const;
+    QBitArray equals( int column, const QString & text ) const;
+    QBitArray status( const QString & text, QString * errorMsg ) const;
+    QBitArray presence( const QString & source, bool present, QString * errorMsg ) const;
+    std::vector< int > candidates( int column, const QString & foldedText ) const;
+
+    const CMergedTableModel * fModel{ nullptr };
+    QStringList fColumns;
+    std::vector< TPostings > fIndex; // per column
+};
+
+#endif
@@ -0,0 +1,237 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "NWayCompare.h"
+#include "CSVTable.h"
+#include "MemoryAccounting.h"
+#include "WorkStealingPool.h"
+
+#include <QApplication>
+#include <QMessageBox>
+#include <QProgressDialog>
+#include <QThread>
+
+CNWayCompare::CNWayCompare()
+{
+}
+
+CNWayCompare::~CNWayCompare()
+{
+    CMemoryAccounting::instance().release( this );
+}
+
+void CNWayCompare::clear()
+{
+    fInputs.clear();
+    fKeyColumns.clear();
+    fKeyColumnPos.clear();
+    fKeyIndex.clear();
+    fRows.clear();
+    CMemoryAccounting::instance().release( this );
+}
+
+bool CNWayCompare::runParallel( int count, const std::function< bool( int ii, const std::atomic< bool > & canceled ) > & func, QProgressDialog * dlg )
+{
+    // the items run on the shared pool, this thread only keeps the dialog alive
+    std::atomic< bool > canceled{ false };
+    auto loop = CWorkStealingPool::shared().start( count,
+                                                   [ & ]( int ii )
+                                                   {
+                                                       if ( func( ii, canceled ) )
+                                                           return true;
+                                                       canceled = true;
+                                                       return false;
+                                                   } );
+    while ( !loop->isDone() && !canceled )
+    {
+        qApp->processEvents();
+        if ( dlg )
+        {
+            if ( dlg->wasCanceled() )
+            {
+                canceled = true;
+                loop->stop();
+            }
+            dlg->setValue( loop->numDone() );
+        }
+        QThread::msleep( 50 );
+    }
+    return loop->wait() && !canceled;
+}
+
+bool CNWayCompare::loadFiles( const QStringList & fileNames, QWidget * parent )
+{
+    clear();
+    for ( int ii = 0; ii < fileNames.count(); ++ii )
+    {
+        fInputs.push_back( std::make_unique< SCSVTable >() );
+        fInputs.back()->fRowFilter = fRowFilter;
+    }
+
+    QProgressDialog dlg( QObject::tr( "Loading %1 Files..." ).arg( fileNames.count() ), "Cancel", 0, fileNames.count(), parent );
+    dlg.setMinimumDuration( 0 );
+    dlg.setValue( 0 );
+
+    std::vector< QString > errors( fileNames.count() );
+    auto aOK = runParallel( fileNames.count(),
+                            [ & ]( int ii, const std::atomic< bool > & canceled )
+                            {
+                                return fInputs[ ii ]->load( fileNames[ ii ], &errors[ ii ], &canceled );
+                            }, &dlg );
+    if ( !aOK )
+    {
+        for ( auto && ii : errors )
+        {
+            if ( ii.isEmpty() )
+                continue;
+            QMessageBox::critical( parent, "Could not open", ii );
+            break;
+        }
+        clear();
+    }
+    return aOK;
+}
+
+bool CNWayCompare::compare( QWidget * parent )
+{
+    fKeyColumns.clear();
+    fKeyColumnPos.clear();
+    fKeyIndex.clear();
+    fRows.clear();
+    if ( fInputs.empty() )
+        return false;
+
+    fKeyColumnPos.resize( fInputs.size() );
+    for ( auto && ii : fInputs.front()->fHeader )
+    {
+        std::vector< int > positions;
+        for ( auto && jj : fInputs )
+        {
+            auto pos = jj->findColumn( ii );
+            if ( pos == -1 )
+                break;
+            positions.push_back( pos );
+        }
+        if ( positions.size() != fInputs.size() )
+            continue;
+
+        fKeyColumns << ii;
+        for ( size_t jj = 0; jj < positions.size(); ++jj )
+            fKeyColumnPos[ jj ].push_back( positions[ jj ] );
+    }
+    if ( fKeyColumns.isEmpty() )
+    {
+        QMessageBox::critical( parent, "No matching columns", QObject::tr( "The files do not share any columns" ) );
+        return false;
+    }
+
+    auto keyOptions = fNormalizer.columnOptions( fKeyColumns );
+    QProgressDialog dlg( QObject::tr( "Computing Key Values..." ), "Cancel", 0, numInputs(), parent );
+    dlg.setMinimumDuration( 0 );
+    dlg.setValue( 0 );
+
+    std::vector< std::vector< QByteArray > > md5s( fInputs.size() );
+    auto aOK = runParallel( numInputs(),
+                            [ & ]( int ii, const std::atomic< bool > & canceled )
+                            {
+                                auto && input = *fInputs[ ii ];
+                                md5s[ ii ].reserve( input.rowCount() );
+                                for ( int row = 0; row < input.rowCount(); ++row )
+                                {
+                                    if ( canceled )
+                                        return false;
+                                    md5s[ ii ].push_back( input.computeKey( row, fKeyColumnPos[ ii ], keyOptions ) );
+                                }
+                                return true;
+                            }, &dlg );
+    if ( !aOK )
+        return false;
+
+    dlg.setLabelText( QObject::tr( "Merging Data..." ) );
+    dlg.setRange( 0, numInputs() );
+    for ( int ii = 0; ii < numInputs(); ++ii )
+    {
+        qApp->processEvents();
+        if ( dlg.wasCanceled() )
+            return false;
+        dlg.setValue( ii );
+
+        // how often each key was seen so far in this input, the N'th time goes to the key's N'th row
+        std::unordered_map< QByteArray, int > occurrences;
+        occurrences.reserve( md5s[ ii ].size() );
+        for ( int row = 0; row < static_cast< int >( md5s[ ii ].size() ); ++row )
+        {
+            auto && md5 = md5s[ ii ][ row ];
+            auto && keyRows = fKeyIndex[ md5 ];
+            auto occurrence = occurrences[ md5 ]++;
+            if ( occurrence == static_cast< int >( keyRows.size() ) )
+            {
+                keyRows.push_back( static_cast< int >( fRows.size() ) );
+
+                SNWayRow newRow;
+                newRow.fKey = md5;
+                newRow.fPresence.resize( numInputs() );
+                newRow.fRowIDs.resize( numInputs(), -1 );
+                fRows.emplace_back( std::move( newRow ) );
+            }
+            auto && currRow = fRows[ keyRows[ occurrence ] ];
+            currRow.fPresence.setBit( ii );
+            currRow.fRowIDs[ ii ] = row;
+        }
+    }
+
+    qint64 indexBytes = static_cast< qint64 >( fKeyIndex.size() * ( CMemoryAccounting::kNodeOverhead + sizeof( std::pair< const QByteArray, std::vector< int > > ) ) + fKeyIndex.bucket_count() * sizeof( void * ) );
+    for ( auto && ii : fKeyIndex )
+        indexBytes += static_cast< qint64 >( ii.second.capacity() * sizeof( int ) );
+    qint64 rowBytes = CMemoryAccounting::estimateBytes( fRows );
+    for ( auto && ii : fRows )
+        rowBytes += CMemoryAccounting::estimateBytes( ii.fKey ) + ( numInputs() + 7 ) / 8 + static_cast< qint64 >( ii.fRowIDs.capacity() * sizeof( int ) );
+    CMemoryAccounting::instance().setLive( CMemoryAccounting::eKeyIndex, this, indexBytes );
+    CMemoryAccounting::instance().setLive( CMemoryAccounting::eMergeResult, this, rowBytes );
+    return true;
+}
+
+int CNWayCompare::numInAll() const
+{
+    int retVal = 0;
+    for ( auto && ii : fRows )
+    {
+        if ( ii.numPresent() == numInputs() )
+            retVal++;
+    }
+    return retVal;
+}
+
+QStringList CNWayCompare::getRowData( const SNWayRow & row ) const
+{
+    for ( int ii = 0; ii < numInputs(); ++ii )
+    {
+        if ( row.fRowIDs[ ii ] == -1 )
+            continue;
+
+        QStringList retVal;
+        for ( auto && col : fKeyColumnPos[ ii ] )
+            retVal << fInputs[ ii ]->data( row.fRowIDs[ ii ], col );
+        return retVal;
+    }
+    return {};
+}
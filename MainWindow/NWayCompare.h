@@ -0,0 +1,85 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _NWAYCOMPARE_H
+#define _NWAYCOMPARE_H
+
+#include "KeyNormalizer.h"
+#include "RowFilter.h"
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QStringList>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+struct SCSVTable;
+class QWidget;
+class QProgressDialog;
+
+// A key repeated in an input gets one row per occurrence, the N'th row of the key in each input
+// are lined up, so no input row is dropped
+struct SNWayRow
+{
+    int numPresent() const { return fPresence.count( true ); }
+
+    QByteArray fKey;
+    QBitArray fPresence;        // bit ii set when input ii contains this occurrence of the key
+    std::vector< int > fRowIDs; // row in input ii, -1 when not present
+};
+
+// Compares any number of CSV files at once, using a single key index shared by all the inputs
+class CNWayCompare
+{
+public:
+    CNWayCompare();
+    ~CNWayCompare();
+
+    void clear();
+    bool loadFiles( const QStringList & fileNames, QWidget * parent );
+    bool compare( QWidget * parent );
+    void setKeyNormalizer( const CKeyNormalizer & normalizer ) { fNormalizer = normalizer; }
+    void setRowFilter( const CRowFilter & filter ) { fRowFilter = filter; }
+
+    int numInputs() const { return static_cast< int >( fInputs.size() ); }
+    const SCSVTable & input( int ii ) const { return *fInputs[ ii ]; }
+    const QStringList & keyColumns() const { return fKeyColumns; }
+    const std::vector< SNWayRow > & rows() const { return fRows; }
+    int numInAll() const;
+
+    QStringList getRowData( const SNWayRow & row ) const;
+private:
+    static bool runParallel( int count, const std::function< bool( int ii, const std::atomic< bool > & canceled ) > & func, QProgressDialog * dlg );
+
+    std::vector< std::unique_ptr< SCSVTable > > fInputs;
+    CKeyNormalizer fNormalizer;
+    CRowFilter fRowFilter;
+    QStringList fKeyColumns;
+    std::vector< std::vector< int > > fKeyColumnPos; // per input, the position of each key column
+    std::unordered_map< QByteArray, std::vector< int > > fKeyIndex; // the rows of each key, one per occurrence
+    std::vector< SNWayRow > fRows;
+};
+
+#endif
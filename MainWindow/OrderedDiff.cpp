@@ -0,0 +1,345 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "OrderedDiff.h"
+
+#include <algorithm>
+
+void COrderedDiff::clear()
+{
+    fRuns.clear();
+    fNumEqual = 0;
+    fNumDeleted = 0;
+    fNumInserted = 0;
+    fMovedLHS.clear();
+    fMovedRHS.clear();
+}
+
+bool COrderedDiff::diff( const std::vector< quint64 > & lhs, const std::vector< quint64 > & rhs, const std::atomic< bool > * canceled )
+{
+    clear();
+    fLHS = &lhs;
+    fRHS = &rhs;
+    fCanceled = canceled;
+
+    diffRange( 0, static_cast< int >( lhs.size() ), 0, static_cast< int >( rhs.size() ), 0 );
+    if ( isCanceled() )
+    {
+        clear();
+        return false;
+    }
+    findMoves();
+
+    fLHS = nullptr;
+    fRHS = nullptr;
+    fCanceled = nullptr;
+    return true;
+}
+
+int COrderedDiff::movedTo( int lhsRow ) const
+{
+    auto pos = fMovedLHS.find( lhsRow );
+    return ( pos == fMovedLHS.end() ) ? -1 : ( *pos ).second;
+}
+
+int COrderedDiff::movedFrom( int rhsRow ) const
+{
+    auto pos = fMovedRHS.find( rhsRow );
+    return ( pos == fMovedRHS.end() ) ? -1 : ( *pos ).second;
+}
+
+void COrderedDiff::addRun( EOp op, int lhsStart, int rhsStart, int length )
+{
+    if ( length <= 0 )
+        return;
+
+    if ( op == eEqual )
+        fNumEqual += length;
+    else if ( op == eDelete )
+        fNumDeleted += length;
+    else
+        fNumInserted += length;
+
+    if ( !fRuns.empty() )
+    {
+        auto && last = fRuns.back();
+        auto lhsNext = last.fLHSStart + ( ( last.fOp == eInsert ) ? 0 : last.fLength );
+        auto rhsNext = last.fRHSStart + ( ( last.fOp == eDelete ) ? 0 : last.fLength );
+        if ( ( last.fOp == op ) && ( lhsNext == lhsStart ) && ( rhsNext == rhsStart ) )
+        {
+            last.fLength += length;
+            return;
+        }
+    }
+    fRuns.push_back( { op, lhsStart, rhsStart, length } );
+}
+
+void COrderedDiff::diffRange( int lhsBegin, int lhsEnd, int rhsBegin, int rhsEnd, int depth )
+{
+    if ( isCanceled() )
+        return;
+
+    auto && lhs = *fLHS;
+    auto && rhs = *fRHS;
+
+    int prefix = 0;
+    while ( ( lhsBegin + prefix < lhsEnd ) && ( rhsBegin + prefix < rhsEnd ) && ( lhs[ lhsBegin + prefix ] == rhs[ rhsBegin + prefix ] ) )
+        ++prefix;
+    addRun( eEqual, lhsBegin, rhsBegin, prefix );
+    lhsBegin += prefix;
+    rhsBegin += prefix;
+
+    int suffix = 0;
+    while ( ( lhsEnd - suffix > lhsBegin ) && ( rhsEnd - suffix > rhsBegin ) && ( lhs[ lhsEnd - suffix - 1 ] == rhs[ rhsEnd - suffix - 1 ] ) )
+        ++suffix;
+    lhsEnd -= suffix;
+    rhsEnd -= suffix;
+
+    if ( lhsBegin == lhsEnd )
+        addRun( eInsert, lhsBegin, rhsBegin, rhsEnd - rhsBegin );
+    else if ( rhsBegin == rhsEnd )
+        addRun( eDelete, lhsBegin, rhsBegin, lhsEnd - lhsBegin );
+    else
+    {
+        std::vector< std::pair< int, int > > anchors;
+        int lhsSplit = 0;
+        int rhsSplit = 0;
+        if ( ( depth < kMaxPatienceDepth ) && findAnchors( lhsBegin, lhsEnd, rhsBegin, rhsEnd, anchors ) )
+        {
+            auto lhsPos = lhsBegin;
+            auto rhsPos = rhsBegin;
+            for ( auto && ii : anchors )
+            {
+                diffRange( lhsPos, ii.first, rhsPos, ii.second, depth + 1 );
+                addRun( eEqual, ii.first, ii.second, 1 );
+                lhsPos = ii.first + 1;
+                rhsPos = ii.second + 1;
+            }
+            diffRange( lhsPos, lhsEnd, rhsPos, rhsEnd, depth + 1 );
+        }
+        else if ( bisect( lhsBegin, lhsEnd, rhsBegin, rhsEnd, lhsSplit, rhsSplit ) )
+        {
+            // no more anchors below a bisection, the halves only get smaller
+            diffRange( lhsBegin, lhsSplit, rhsBegin, rhsSplit, kMaxPatienceDepth );
+            diffRange( lhsSplit, lhsEnd, rhsSplit, rhsEnd, kMaxPatienceDepth );
+        }
+        else
+        {
+            addRun( eDelete, lhsBegin, rhsBegin, lhsEnd - lhsBegin );
+            addRun( eInsert, lhsEnd, rhsBegin, rhsEnd - rhsBegin );
+        }
+    }
+
+    addRun( eEqual, lhsEnd, rhsEnd, suffix );
+}
+
+bool COrderedDiff::findAnchors( int lhsBegin, int lhsEnd, int rhsBegin, int rhsEnd, std::vector< std::pair< int, int > > & anchors ) const
+{
+    // sorted ( hash, row ) lists instead of hash maps, half the memory on 10M rows
+    auto sorted = []( const std::vector< quint64 > & hashes, int begin, int end )
+    {
+        std::vector< std::pair< quint64, int > > retVal;
+        retVal.reserve( end - begin );
+        for ( int ii = begin; ii < end; ++ii )
+            retVal.emplace_back( hashes[ ii ], ii );
+        std::sort( retVal.begin(), retVal.end() );
+        return retVal;
+    };
+    auto lhs = sorted( *fLHS, lhsBegin, lhsEnd );
+    auto rhs = sorted( *fRHS, rhsBegin, rhsEnd );
+
+    std::vector< std::pair< int, int > > unique;
+    size_t ii = 0;
+    size_t jj = 0;
+    while ( ( ii < lhs.size() ) && ( jj < rhs.size() ) )
+    {
+        auto hash = lhs[ ii ].first;
+        if ( hash < rhs[ jj ].first )
+        {
+            ++ii;
+            continue;
+        }
+        if ( rhs[ jj ].first < hash )
+        {
+            ++jj;
+            continue;
+        }
+
+        auto lhsEndOfHash = ii;
+        while ( ( lhsEndOfHash < lhs.size() ) && ( lhs[ lhsEndOfHash ].first == hash ) )
+            ++lhsEndOfHash;
+        auto rhsEndOfHash = jj;
+        while ( ( rhsEndOfHash < rhs.size() ) && ( rhs[ rhsEndOfHash ].first == hash ) )
+            ++rhsEndOfHash;
+        if ( ( lhsEndOfHash - ii == 1 ) && ( rhsEndOfHash - jj == 1 ) )
+            unique.emplace_back( lhs[ ii ].second, rhs[ jj ].second );
+        ii = lhsEndOfHash;
+        jj = rhsEndOfHash;
+    }
+    lhs = {};
+    rhs = {};
+    if ( unique.empty() )
+        return false;
+
+    // longest increasing run of RHS rows, in LHS order, by patience sorting
+    std::sort( unique.begin(), unique.end() );
+    std::vector< int > pileTops; // index into unique of the top of each pile
+    std::vector< int > previous( unique.size(), -1 );
+    for ( int kk = 0; kk < static_cast< int >( unique.size() ); ++kk )
+    {
+        auto pos = std::lower_bound( pileTops.begin(), pileTops.end(), unique[ kk ].second, [ &unique ]( int top, int rhsRow ) { return unique[ top ].second < rhsRow; } );
+        if ( pos != pileTops.begin() )
+            previous[ kk ] = *( pos - 1 );
+        if ( pos == pileTops.end() )
+            pileTops.push_back( kk );
+        else
+            *pos = kk;
+    }
+
+    anchors.clear();
+    for ( auto kk = pileTops.back(); kk != -1; kk = previous[ kk ] )
+        anchors.push_back( unique[ kk ] );
+    std::reverse( anchors.begin(), anchors.end() );
+    return true;
+}
+
+// Myers' middle snake, walked from both ends at once so only two diagonal vectors are kept
+bool COrderedDiff::bisect( int lhsBegin, int lhsEnd, int rhsBegin, int rhsEnd, int & lhsSplit, int & rhsSplit )
+{
+    auto && lhs = *fLHS;
+    auto && rhs = *fRHS;
+    const int lhsLen = lhsEnd - lhsBegin;
+    const int rhsLen = rhsEnd - rhsBegin;
+
+    const int maxD = ( lhsLen + rhsLen + 1 ) / 2;
+    const int offset = maxD;
+    const int vLength = 2 * maxD + 2;
+    std::vector< int > forward( vLength, -1 );
+    std::vector< int > reverse( vLength, -1 );
+    forward[ offset + 1 ] = 0;
+    reverse[ offset + 1 ] = 0;
+
+    const int delta = lhsLen - rhsLen;
+    const bool front = ( delta % 2 ) != 0; // the forward walk checks for the overlap when delta is odd
+    const auto limit = static_cast< int >( std::min< qint64 >( maxD, std::max< qint64 >( 64, kMaxWork / ( lhsLen + rhsLen ) ) ) );
+
+    int k1Start = 0;
+    int k1End = 0;
+    int k2Start = 0;
+    int k2End = 0;
+    for ( int d = 0; d < limit; ++d )
+    {
+        if ( ( ( d % 64 ) == 0 ) && isCanceled() )
+            return false;
+
+        for ( int k1 = -d + k1Start; k1 <= d - k1End; k1 += 2 )
+        {
+            auto k1Offset = offset + k1;
+            int x1 = ( ( k1 == -d ) || ( ( k1 != d ) && ( forward[ k1Offset - 1 ] < forward[ k1Offset + 1 ] ) ) ) ? forward[ k1Offset + 1 ] : ( forward[ k1Offset - 1 ] + 1 );
+            int y1 = x1 - k1;
+            while ( ( x1 < lhsLen ) && ( y1 < rhsLen ) && ( lhs[ lhsBegin + x1 ] == rhs[ rhsBegin + y1 ] ) )
+            {
+                ++x1;
+                ++y1;
+            }
+            forward[ k1Offset ] = x1;
+            if ( x1 > lhsLen )
+                k1End += 2; // ran off the right
+            else if ( y1 > rhsLen )
+                k1Start += 2; // ran off the bottom
+            else if ( front )
+            {
+                auto k2Offset = offset + delta - k1;
+                if ( ( k2Offset >= 0 ) && ( k2Offset < vLength ) && ( reverse[ k2Offset ] != -1 ) && ( x1 >= lhsLen - reverse[ k2Offset ] ) )
+                {
+                    lhsSplit = lhsBegin + x1;
+                    rhsSplit = rhsBegin + y1;
+                    return true;
+                }
+            }
+        }
+
+        for ( int k2 = -d + k2Start; k2 <= d - k2End; k2 += 2 )
+        {
+            auto k2Offset = offset + k2;
+            int x2 = ( ( k2 == -d ) || ( ( k2 != d ) && ( reverse[ k2Offset - 1 ] < reverse[ k2Offset + 1 ] ) ) ) ? reverse[ k2Offset + 1 ] : ( reverse[ k2Offset - 1 ] + 1 );
+            int y2 = x2 - k2;
+            while ( ( x2 < lhsLen ) && ( y2 < rhsLen ) && ( lhs[ lhsEnd - x2 - 1 ] == rhs[ rhsEnd - y2 - 1 ] ) )
+            {
+                ++x2;
+                ++y2;
+            }
+            reverse[ k2Offset ] = x2;
+            if ( x2 > lhsLen )
+                k2End += 2;
+            else if ( y2 > rhsLen )
+                k2Start += 2;
+            else if ( !front )
+            {
+                auto k1Offset = offset + delta - k2;
+                if ( ( k1Offset >= 0 ) && ( k1Offset < vLength ) && ( forward[ k1Offset ] != -1 ) )
+                {
+                    auto x1 = forward[ k1Offset ];
+                    auto y1 = offset + x1 - k1Offset;
+                    if ( x1 >= lhsLen - x2 )
+                    {
+                        lhsSplit = lhsBegin + x1;
+                        rhsSplit = rhsBegin + y1;
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false; // too expensive, or nothing in common
+}
+
+void COrderedDiff::findMoves()
+{
+    // only the changed rows are indexed
+    std::unordered_multimap< quint64, int > deleted;
+    for ( auto && ii : fRuns )
+    {
+        if ( ii.fOp != eDelete )
+            continue;
+        for ( int jj = 0; jj < ii.fLength; ++jj )
+            deleted.emplace( ( *fLHS )[ ii.fLHSStart + jj ], ii.fLHSStart + jj );
+    }
+    if ( deleted.empty() )
+        return;
+
+    for ( auto && ii : fRuns )
+    {
+        if ( ii.fOp != eInsert )
+            continue;
+        for ( int jj = 0; jj < ii.fLength; ++jj )
+        {
+            auto rhsRow = ii.fRHSStart + jj;
+            auto pos = deleted.find( ( *fRHS )[ rhsRow ] );
+            if ( pos == deleted.end() )
+                continue;
+            fMovedLHS[ ( *pos ).second ] = rhsRow;
+            fMovedRHS[ rhsRow ] = ( *pos ).second;
+            deleted.erase( pos );
+        }
+    }
+}
@@ -0,0 +1,87 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _ORDEREDDIFF_H
+#define _ORDEREDDIFF_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+// Sequence diff of two files' row hashes, for sorted exports where the order matters.
+// Rows whose hash is unique in both files anchor the diff (patience style), the gaps
+// between anchors use Myers' linear space bisection, so memory stays O(N+M).
+class COrderedDiff
+{
+public:
+    enum EOp
+    {
+        eEqual,
+        eDelete, // LHS rows missing from the RHS
+        eInsert  // RHS rows missing from the LHS
+    };
+
+    struct SRun
+    {
+        EOp fOp{ eEqual };
+        int fLHSStart{ 0 };
+        int fRHSStart{ 0 };
+        int fLength{ 0 };
+    };
+
+    static constexpr qint64 kMaxWork = 500000000; // snake steps per bisection before a gap is reported as a replace
+    static constexpr int kMaxPatienceDepth = 8;
+
+    bool diff( const std::vector< quint64 > & lhs, const std::vector< quint64 > & rhs, const std::atomic< bool > * canceled = nullptr ); // false when canceled
+    void clear();
+
+    const std::vector< SRun > & runs() const { return fRuns; }
+    int numEqual() const { return fNumEqual; }
+    int numDeleted() const { return fNumDeleted; }
+    int numInserted() const { return fNumInserted; }
+    int numMoved() const { return static_cast< int >( fMovedLHS.size() ); }
+
+    // a deleted row and an inserted row with the same hash, -1 when the row did not move
+    int movedTo( int lhsRow ) const;
+    int movedFrom( int rhsRow ) const;
+private:
+    void diffRange( int lhsBegin, int lhsEnd, int rhsBegin, int rhsEnd, int depth );
+    bool findAnchors( int lhsBegin, int lhsEnd, int rhsBegin, int rhsEnd, std::vector< std::pair< int, int > > & anchors ) const;
+    bool bisect( int lhsBegin, int lhsEnd, int rhsBegin, int rhsEnd, int & lhsSplit, int & rhsSplit );
+    void addRun( EOp op, int lhsStart, int rhsStart, int length );
+    void findMoves();
+    bool isCanceled() const { return fCanceled && *fCanceled; }
+
+    const std::vector< quint64 > * fLHS{ nullptr };
+    const std::vector< quint64 > * fRHS{ nullptr };
+    const std::atomic< bool > * fCanceled{ nullptr };
+
+    std::vector< SRun > fRuns;
+    int fNumEqual{ 0 };
+    int fNumDeleted{ 0 };
+    int fNumInserted{ 0 };
+    std::unordered_map< int, int > fMovedLHS;
+    std::unordered_map< int, int > fMovedRHS;
+};
+
+#endif
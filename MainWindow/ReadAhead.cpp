@@ -0,0 +1,198 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ReadAhead.h"
+
+#include <QFile>
+#include <algorithm>
+#include <cerrno>
+#include <new>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+CReadAhead::CReadAhead( qint64 blockSize ) :
+    fBlockSize( ( blockSize + kAlignment - 1 ) / kAlignment * kAlignment )
+{
+    for ( auto && ii : fBuffers )
+        ii.fData = static_cast< char * >( ::operator new( static_cast< size_t >( fBlockSize ), std::align_val_t( kAlignment ) ) );
+}
+
+CReadAhead::~CReadAhead()
+{
+    stop();
+    for ( auto && ii : fBuffers )
+        ::operator delete( ii.fData, std::align_val_t( kAlignment ) );
+}
+
+bool CReadAhead::start( const QString & fileName, qint64 begin, qint64 end )
+{
+    stop();
+
+#ifdef Q_OS_WIN
+    fFD = ::_wopen( reinterpret_cast< const wchar_t * >( fileName.utf16() ), _O_RDONLY | _O_BINARY | _O_SEQUENTIAL );
+#else
+    fFD = ::open( QFile::encodeName( fileName ).constData(), O_RDONLY );
+#endif
+    if ( fFD < 0 )
+        return false;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise( fFD, begin, ( end < 0 ) ? 0 : ( end - begin ), POSIX_FADV_SEQUENTIAL );
+#endif
+
+    fBegin = begin;
+    fEnd = end;
+    fHead = 0;
+    fTail = 0;
+    fDone = false;
+    fStop = false;
+    fError = false;
+    fErrorString.clear();
+    fHolding = false;
+    fThread = std::thread( [ this ]() { run(); } );
+    return true;
+}
+
+void CReadAhead::stop()
+{
+    if ( fThread.joinable() )
+    {
+        fStop = true;
+        wake();
+        fThread.join();
+    }
+    if ( fFD >= 0 )
+    {
+#ifdef Q_OS_WIN
+        ::_close( fFD );
+#else
+        ::close( fFD );
+#endif
+        fFD = -1;
+    }
+    fHolding = false;
+}
+
+void CReadAhead::wake()
+{
+    // taking the lock orders the index update before a waiter's check of it, so no wake up is lost
+    {
+        std::lock_guard< std::mutex > lock( fMutex );
+    }
+    fCondition.notify_all();
+}
+
+qint64 CReadAhead::readAt( char * data, qint64 len, qint64 pos )
+{
+    qint64 retVal = 0;
+    while ( retVal < len )
+    {
+#ifdef Q_OS_WIN
+        if ( ::_lseeki64( fFD, pos + retVal, SEEK_SET ) < 0 )
+            return -1;
+        auto curr = static_cast< qint64 >( ::_read( fFD, data + retVal, static_cast< unsigned int >( len - retVal ) ) );
+#else
+        auto curr = static_cast< qint64 >( ::pread( fFD, data + retVal, static_cast< size_t >( len - retVal ), static_cast< off_t >( pos + retVal ) ) );
+        if ( ( curr < 0 ) && ( errno == EINTR ) )
+            continue;
+#endif
+        if ( curr < 0 )
+            return -1;
+        if ( curr == 0 )
+            break;
+        retVal += curr;
+    }
+    return retVal;
+}
+
+void CReadAhead::run()
+{
+    auto pos = fBegin;
+    while ( !fStop && ( ( fEnd < 0 ) || ( pos < fEnd ) ) )
+    {
+        auto tail = fTail.load( std::memory_order_relaxed );
+        if ( ( tail - fHead.load( std::memory_order_acquire ) ) >= kNumBuffers )
+        {
+            std::unique_lock< std::mutex > lock( fMutex );
+            fCondition.wait( lock, [ this, tail ]() { return fStop || ( ( tail - fHead.load( std::memory_order_acquire ) ) < kNumBuffers ); } );
+            continue;
+        }
+
+        auto && buffer = fBuffers[ tail % kNumBuffers ];
+        auto toRead = ( fEnd < 0 ) ? fBlockSize : std::min( fBlockSize, fEnd - pos );
+        auto len = readAt( buffer.fData, toRead, pos );
+        if ( len < 0 )
+        {
+            fErrorString = qt_error_string( errno );
+            fError = true;
+        }
+        if ( len <= 0 )
+            break;
+
+        buffer.fLength = len;
+        pos += len;
+        fTail.store( tail + 1, std::memory_order_release );
+        wake();
+        if ( len < toRead )
+            break;
+    }
+    fDone.store( true, std::memory_order_release );
+    wake();
+}
+
+QByteArray CReadAhead::next()
+{
+    if ( fHolding )
+    {
+        fHead.fetch_add( 1, std::memory_order_release );
+        fHolding = false;
+        wake();
+    }
+    if ( !fThread.joinable() )
+        return {};
+
+    auto head = fHead.load( std::memory_order_relaxed );
+    if ( fTail.load( std::memory_order_acquire ) == head )
+    {
+        std::unique_lock< std::mutex > lock( fMutex );
+        fCondition.wait( lock, [ this, head ]() { return ( fTail.load( std::memory_order_acquire ) != head ) || fDone.load( std::memory_order_acquire ); } );
+    }
+    if ( fTail.load( std::memory_order_acquire ) == head )
+        return {};
+
+    fHolding = true;
+    auto && buffer = fBuffers[ head % kNumBuffers ];
+    return QByteArray::fromRawData( buffer.fData, static_cast< int >( buffer.fLength ) );
+}
+
+bool CReadAhead::atEnd() const
+{
+    if ( !fDone.load( std::memory_order_acquire ) )
+        return false;
+    return ( fTail.load( std::memory_order_acquire ) - fHead.load( std::memory_order_acquire ) ) <= ( fHolding ? 1U : 0U );
+}
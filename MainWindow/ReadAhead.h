@@ -0,0 +1,85 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _READAHEAD_H
+#define _READAHEAD_H
+
+#include <QByteArray>
+#include <QString>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Reads a byte range of a file on a thread of its own, a few large blocks ahead of the
+// parser, so the disk and the parser work at the same time. Filled blocks go through a
+// single producer, single consumer ring of aligned buffers, the indexes are atomics and
+// the mutex is only there to sleep on when the ring is full or empty
+class CReadAhead
+{
+public:
+    static constexpr int kNumBuffers = 4;
+    static constexpr qint64 kAlignment = 4096;
+
+    explicit CReadAhead( qint64 blockSize );
+    ~CReadAhead();
+
+    bool start( const QString & fileName, qint64 begin, qint64 end = -1 ); // end -1 for the end of the file
+    void stop();
+
+    QByteArray next();     // the next block, empty at the end; it is only valid until the next call
+    bool atEnd() const;    // nothing follows the block last handed out
+    bool hasError() const { return fError; }
+    QString errorString() const { return fErrorString; } // of the failed read, once hasError
+    qint64 bufferBytes() const { return kNumBuffers * fBlockSize; }
+private:
+    void run();
+    qint64 readAt( char * data, qint64 len, qint64 pos ); // fills as much of len as the file has, -1 on error
+    void wake();
+
+    struct SBuffer
+    {
+        char * fData{ nullptr };
+        qint64 fLength{ 0 };
+    };
+
+    qint64 fBlockSize{ 0 };
+    std::array< SBuffer, kNumBuffers > fBuffers;
+    std::atomic< quint64 > fHead{ 0 }; // blocks the parser is done with
+    std::atomic< quint64 > fTail{ 0 }; // blocks filled
+    std::atomic< bool > fDone{ false };
+    std::atomic< bool > fStop{ false };
+    std::atomic< bool > fError{ false };
+    QString fErrorString; // set by the thread before fError
+    bool fHolding{ false }; // the parser has the block at fHead
+
+    std::mutex fMutex;
+    std::condition_variable fCondition;
+    std::thread fThread;
+
+    int fFD{ -1 };
+    qint64 fBegin{ 0 };
+    qint64 fEnd{ -1 };
+};
+
+#endif
@@ -0,0 +1,257 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ResultCache.h"
+#include "KeyHash.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <cstring>
+
+static_assert( sizeof( CResultCache::SRowPair ) == 8, "row pairs are read in place from the file" );
+
+QString CResultCache::SKey::toString() const
+{
+    return QString( "%1%2" ).arg( fHigh, 16, 16, QChar( '0' ) ).arg( fLow, 16, 16, QChar( '0' ) );
+}
+
+CResultCache::SKey CResultCache::makeKey( quint64 lhsHash, quint64 rhsHash, const QStringList & settings )
+{
+    QByteArray data( reinterpret_cast< const char * >( &lhsHash ), sizeof( lhsHash ) );
+    data.append( reinterpret_cast< const char * >( &rhsHash ), sizeof( rhsHash ) );
+    for ( auto && ii : settings )
+    {
+        data.append( ii.toUtf8() );
+        data.append( '\0' );
+    }
+
+    SKey retVal;
+    retVal.fHigh = NKeyHash::hash64( data.constData(), data.size(), 0 );
+    retVal.fLow = NKeyHash::hash64( data.constData(), data.size(), 0x9E3779B97F4A7C15ULL );
+    return retVal;
+}
+
+quint64 CResultCache::fingerprint( const QStringList & fileNames )
+{
+    // cheap enough to take before a load, the content hash checked after the load catches an edit it misses
+    quint64 retVal = 0;
+    for ( auto && ii : fileNames )
+    {
+        QFileInfo fi( ii );
+        qint64 stamp[ 2 ] = { fi.size(), fi.lastModified().toMSecsSinceEpoch() };
+        retVal = NKeyHash::hash64( reinterpret_cast< const char * >( stamp ), sizeof( stamp ), retVal );
+
+        QFile file( ii );
+        if ( !file.open( QIODevice::ReadOnly ) )
+            continue;
+        auto lastBlock = std::max< qint64 >( 0, fi.size() - kFingerprintBlockBytes );
+        for ( int jj = 0; jj < kFingerprintBlocks; ++jj )
+        {
+            if ( !file.seek( lastBlock * jj / ( kFingerprintBlocks - 1 ) ) )
+                break;
+            auto block = file.read( kFingerprintBlockBytes );
+            retVal = NKeyHash::hash64( block.constData(), block.size(), retVal );
+        }
+    }
+    return retVal;
+}
+
+CResultCache::CResultCache() :
+    fDir( QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + "/results" )
+{
+}
+
+CResultCache::~CResultCache()
+{
+    close();
+}
+
+QString CResultCache::fileName( const SKey & key ) const
+{
+    return QDir( fDir ).absoluteFilePath( key.toString() + ".csvr" );
+}
+
+bool CResultCache::open( const SKey & key )
+{
+    close();
+    fFile = std::make_unique< QFile >( fileName( key ) );
+    if ( !fFile->open( QIODevice::ReadOnly ) )
+    {
+        close();
+        return false;
+    }
+
+    auto size = fFile->size();
+    const char * data = ( size > 0 ) ? reinterpret_cast< const char * >( fFile->map( 0, size ) ) : nullptr;
+    if ( !data )
+    {
+        fContents = fFile->readAll();
+        data = fContents.constData();
+        size = fContents.size();
+    }
+
+    SHeader header;
+    if ( size < static_cast< qint64 >( sizeof( header ) ) )
+    {
+        close();
+        return false;
+    }
+    std::memcpy( &header, data, sizeof( header ) );
+    auto pairsBytes = static_cast< qint64 >( header.fNumRowPairs ) * static_cast< qint64 >( sizeof( SRowPair ) );
+    if ( ( std::memcmp( header.fMagic, kMagic, 4 ) != 0 ) || ( header.fVersion != kVersion ) || ( header.fKeyHigh != key.fHigh ) || ( header.fKeyLow != key.fLow )
+         || ( header.fNumRowPairs < 0 ) || ( static_cast< qint64 >( sizeof( header ) ) + pairsBytes > size ) )
+    {
+        close();
+        return false;
+    }
+
+    auto columnsPos = static_cast< qint64 >( sizeof( header ) ) + pairsBytes;
+    auto columns = QByteArray::fromRawData( data + columnsPos, static_cast< int >( size - columnsPos ) );
+    QDataStream ds( columns );
+    ds.setVersion( QDataStream::Qt_5_0 );
+    quint32 numColumns = 0;
+    ds >> numColumns;
+    for ( quint32 ii = 0; ( ii < numColumns ) && ( ds.status() == QDataStream::Ok ); ++ii )
+    {
+        QString name;
+        qint64 count = 0;
+        ds >> name >> count;
+        fChangedValues[ name ] = count;
+    }
+    ds >> fKeyColumns;
+    if ( ds.status() != QDataStream::Ok )
+    {
+        close();
+        return false;
+    }
+    // the view is only decoded by readView
+    auto viewPos = columnsPos + ds.device()->pos();
+    fView = QByteArray::fromRawData( data + viewPos, static_cast< int >( size - viewPos ) );
+
+    // the header is a multiple of 8 bytes and the mapping is page aligned
+    fLHSContentHash = header.fLHSContentHash;
+    fRHSContentHash = header.fRHSContentHash;
+    fNumLHSRows = header.fNumLHSRows;
+    fNumRHSRows = header.fNumRHSRows;
+    fRowPairs = reinterpret_cast< const SRowPair * >( data + sizeof( header ) );
+    fNumRowPairs = header.fNumRowPairs;
+    return true;
+}
+
+bool CResultCache::readView( const TReadViewRow & func ) const
+{
+    QDataStream ds( fView );
+    ds.setVersion( QDataStream::Qt_5_0 );
+    QStringList rowData;
+    for ( int ii = 0; ii < fNumRowPairs; ++ii )
+    {
+        ds >> rowData;
+        if ( ( ds.status() != QDataStream::Ok ) || !func( ii, rowData ) )
+            return false;
+    }
+    return true;
+}
+
+void CResultCache::close()
+{
+    fRowPairs = nullptr;
+    fNumRowPairs = 0;
+    fLHSContentHash = 0;
+    fRHSContentHash = 0;
+    fNumLHSRows = 0;
+    fNumRHSRows = 0;
+    fChangedValues.clear();
+    fKeyColumns.clear();
+    fView.clear();
+    fContents.clear();
+    fFile.reset(); // unmaps
+}
+
+bool CResultCache::store( const SKey & key, quint64 lhsContentHash, quint64 rhsContentHash, int numLHSRows, int numRHSRows, const QStringList & keyColumns, const std::vector< SRowPair > & rowPairs, const std::map< QString, qint64 > & changedValues, const TViewRow & viewRow, QString * errorMsg )
+{
+    if ( !QDir().mkpath( fDir ) )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Could not create the result cache directory '%1'" ).arg( fDir );
+        return false;
+    }
+
+    SHeader header;
+    std::memset( &header, 0, sizeof( header ) );
+    std::memcpy( header.fMagic, kMagic, 4 );
+    header.fVersion = kVersion;
+    header.fKeyHigh = key.fHigh;
+    header.fKeyLow = key.fLow;
+    header.fLHSContentHash = lhsContentHash;
+    header.fRHSContentHash = rhsContentHash;
+    header.fNumLHSRows = numLHSRows;
+    header.fNumRHSRows = numRHSRows;
+    header.fNumRowPairs = static_cast< qint32 >( rowPairs.size() );
+
+    QByteArray columns;
+    QDataStream ds( &columns, QIODevice::WriteOnly );
+    ds.setVersion( QDataStream::Qt_5_0 );
+    ds << static_cast< quint32 >( changedValues.size() );
+    for ( auto && ii : changedValues )
+        ds << ii.first << ii.second;
+    ds << keyColumns;
+
+    // written to a temporary file and renamed, a reader never sees half an entry
+    QSaveFile file( fileName( key ) );
+    auto pairsBytes = static_cast< qint64 >( rowPairs.size() * sizeof( SRowPair ) );
+    auto aOK = file.open( QIODevice::WriteOnly );
+    aOK = aOK && ( file.write( reinterpret_cast< const char * >( &header ), sizeof( header ) ) == static_cast< qint64 >( sizeof( header ) ) );
+    aOK = aOK && ( file.write( reinterpret_cast< const char * >( rowPairs.data() ), pairsBytes ) == pairsBytes );
+    aOK = aOK && ( file.write( columns ) == columns.size() );
+    if ( aOK )
+    {
+        QDataStream view( &file );
+        view.setVersion( QDataStream::Qt_5_0 );
+        for ( int ii = 0; ii < static_cast< int >( rowPairs.size() ); ++ii )
+            view << viewRow( ii );
+        aOK = view.status() == QDataStream::Ok;
+    }
+    aOK = aOK && file.commit();
+    if ( !aOK )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error writing the result cache file '%1': %2" ).arg( file.fileName() ).arg( file.errorString() );
+        return false;
+    }
+
+    prune();
+    return true;
+}
+
+void CResultCache::prune() const
+{
+    auto entries = QDir( fDir ).entryInfoList( QStringList() << "*.csvr", QDir::Files, QDir::Time ); // newest first
+    for ( int ii = kMaxEntries; ii < entries.count(); ++ii )
+        QFile::remove( entries[ ii ].absoluteFilePath() );
+}
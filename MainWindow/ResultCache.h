@@ -0,0 +1,130 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _RESULTCACHE_H
+#define _RESULTCACHE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+class QFile;
+
+// Results of the keyed compare, one file per key under the cache directory, so reopening the same
+// files with the same settings shows the merged view before the files are read in full.
+// The key covers a fingerprint of both inputs, taken without parsing them, and the settings that change
+// the join: the key columns, the key normalization and the row filter. The fingerprint can miss an edit,
+// so the entry also holds the content hashes, checked once the files are loaded. Layout, in native byte order:
+//   header      magic, version, the key, the content hashes and row counts of both files, the number of row pairs
+//   row pairs   qint32 LHS row, qint32 RHS row, in merged row order, -1 for the side the row is not on
+//   columns     QDataStream of the shared column names and the changed value count of each, then the key columns used
+//   view        QDataStream of the merged row of each row pair
+// An entry is mapped and its row pairs are read in place.
+class CResultCache
+{
+public:
+    struct SKey
+    {
+        quint64 fHigh{ 0 };
+        quint64 fLow{ 0 };
+
+        bool operator==( const SKey & rhs ) const { return ( fHigh == rhs.fHigh ) && ( fLow == rhs.fLow ); }
+        bool operator!=( const SKey & rhs ) const { return !operator==( rhs ); }
+        QString toString() const;
+    };
+    struct SRowPair
+    {
+        qint32 fLHSRow;
+        qint32 fRHSRow;
+    };
+
+    static constexpr char kMagic[] = "CSVR";
+    static constexpr int kVersion = 2;
+    static constexpr int kMaxEntries = 16; // the oldest entries past this are removed on store
+    static constexpr int kFingerprintBlocks = 16;
+    static constexpr qint64 kFingerprintBlockBytes = 4096;
+
+    using TViewRow = std::function< QStringList( int row ) >;
+    using TReadViewRow = std::function< bool( int row, const QStringList & rowData ) >; // false stops the read
+
+    static SKey makeKey( quint64 lhsHash, quint64 rhsHash, const QStringList & settings );
+    static quint64 fingerprint( const QStringList & fileNames ); // size, modification time and evenly spaced blocks of each file
+
+    CResultCache(); // in the results directory of the application cache location
+    ~CResultCache();
+
+    void setDir( const QString & dir ) { fDir = dir; }
+    const QString & dir() const { return fDir; }
+
+    bool open( const SKey & key ); // false on a miss or an entry that can not be read
+    void close();
+
+    // the open entry
+    quint64 lhsContentHash() const { return fLHSContentHash; }
+    quint64 rhsContentHash() const { return fRHSContentHash; }
+    int numLHSRows() const { return fNumLHSRows; }
+    int numRHSRows() const { return fNumRHSRows; }
+    const QStringList & keyColumns() const { return fKeyColumns; }
+    const SRowPair * rowPairs() const { return fRowPairs; }
+    int numRowPairs() const { return fNumRowPairs; }
+    const std::map< QString, qint64 > & changedValues() const { return fChangedValues; }
+    bool readView( const TReadViewRow & func ) const; // a merged row per row pair, false when the view is damaged or func stops
+
+    // viewRow gives the merged row of each row pair
+    bool store( const SKey & key, quint64 lhsContentHash, quint64 rhsContentHash, int numLHSRows, int numRHSRows, const QStringList & keyColumns, const std::vector< SRowPair > & rowPairs, const std::map< QString, qint64 > & changedValues, const TViewRow & viewRow, QString * errorMsg = nullptr );
+private:
+    struct SHeader
+    {
+        char fMagic[ 4 ];
+        quint32 fVersion;
+        quint64 fKeyHigh;
+        quint64 fKeyLow;
+        quint64 fLHSContentHash;
+        quint64 fRHSContentHash;
+        qint32 fNumLHSRows;
+        qint32 fNumRHSRows;
+        qint32 fNumRowPairs;
+        quint32 fReserved;
+    };
+
+    QString fileName( const SKey & key ) const;
+    void prune() const;
+
+    QString fDir;
+    std::unique_ptr< QFile > fFile;
+    QByteArray fContents; // when the entry can not be mapped
+    quint64 fLHSContentHash{ 0 };
+    quint64 fRHSContentHash{ 0 };
+    int fNumLHSRows{ 0 };
+    int fNumRHSRows{ 0 };
+    const SRowPair * fRowPairs{ nullptr };
+    int fNumRowPairs{ 0 };
+    std::map< QString, qint64 > fChangedValues;
+    QStringList fKeyColumns;
+    QByteArray fView; // raw data of the mapped view section
+};
+
+#endif
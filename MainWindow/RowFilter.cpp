@@ -0,0 +1,646 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "RowFilter.h"
+#include "CSVDialect.h"
+
+#include <QSettings>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // QChar::isSpace for ASCII
+    bool isSpace( char ch )
+    {
+        return ( ch == ' ' ) || ( ( ch >= '\t' ) && ( ch <= '\r' ) );
+    }
+
+    bool isAscii( char ch )
+    {
+        return static_cast< unsigned char >( ch ) < 0x80;
+    }
+}
+
+class CRowFilter::CParser
+{
+public:
+    CParser( const QString & text, CRowFilter & filter ) :
+        fText( text ),
+        fFilter( filter )
+    {
+    }
+
+    bool parse( QString * errorMsg )
+    {
+        if ( !tokenize() || !expression() )
+            return error( errorMsg );
+        if ( fTokens[ fPos ].fType != eEnd )
+        {
+            fError = QString( "unexpected '%1'" ).arg( fTokens[ fPos ].fText );
+            return error( errorMsg );
+        }
+        return true;
+    }
+private:
+    enum ETokenType
+    {
+        eEnd,
+        eWord,
+        eBracketName,
+        eString,
+        eNumber,
+        eSymbol
+    };
+    struct SToken
+    {
+        ETokenType fType{ eEnd };
+        QString fText;
+        int fPos{ 0 };
+    };
+
+    bool error( QString * errorMsg ) const
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Invalid row filter '%1': %2 at position %3" ).arg( fText ).arg( fError ).arg( ( fTokenized ? fTokens[ fPos ].fPos : fErrorPos ) + 1 );
+        return false;
+    }
+
+    bool tokenize()
+    {
+        static const QStringList kSymbols = { "==", "!=", "<>", "<=", ">=", "!~", "&&", "||", "=", "<", ">", "~", "!", "(", ")", ",", "*" };
+        auto isWordChar = []( QChar ch ) { return ch.isLetterOrNumber() || ( ch == '_' ) || ( ch == '.' ); };
+
+        int ii = 0;
+        auto len = fText.length();
+        while ( ii < len )
+        {
+            auto ch = fText[ ii ];
+            if ( ch.isSpace() )
+            {
+                ++ii;
+                continue;
+            }
+
+            SToken token;
+            token.fPos = ii;
+            if ( ch == '"' )
+            {
+                token.fType = eString;
+                for ( ++ii; ( ii < len ) && ( fText[ ii ] != '"' ); ++ii )
+                {
+                    if ( ( fText[ ii ] == '\\' ) && ( ii + 1 < len ) )
+                        ++ii;
+                    token.fText += fText[ ii ];
+                }
+                if ( ii == len )
+                {
+                    fErrorPos = token.fPos;
+                    fError = "unterminated string";
+                    return false;
+                }
+                ++ii;
+            }
+            else if ( ch == '[' )
+            {
+                token.fType = eBracketName;
+                auto end = fText.indexOf( ']', ii + 1 );
+                if ( end < 0 )
+                {
+                    fErrorPos = token.fPos;
+                    fError = "unterminated column name";
+                    return false;
+                }
+                token.fText = fText.mid( ii + 1, end - ii - 1 );
+                ii = end + 1;
+            }
+            else if ( isWordChar( ch ) || ( ( ( ch == '-' ) || ( ch == '+' ) ) && ( ii + 1 < len ) && ( fText[ ii + 1 ].isDigit() || ( fText[ ii + 1 ] == '.' ) ) ) )
+            {
+                auto end = ii + 1;
+                while ( ( end < len ) && isWordChar( fText[ end ] ) )
+                    ++end;
+                token.fText = fText.mid( ii, end - ii );
+                bool aOK = false;
+                token.fText.toDouble( &aOK );
+                token.fType = ( aOK && !ch.isLetter() ) ? eNumber : eWord;
+                ii = end;
+            }
+            else
+            {
+                for ( auto && symbol : kSymbols )
+                {
+                    if ( fText.mid( ii, symbol.length() ) == symbol )
+                    {
+                        token.fType = eSymbol;
+                        token.fText = symbol;
+                        break;
+                    }
+                }
+                if ( token.fType != eSymbol )
+                {
+                    fErrorPos = ii;
+                    fError = QString( "unexpected '%1'" ).arg( ch );
+                    return false;
+                }
+                ii += token.fText.length();
+            }
+            fTokens.push_back( token );
+        }
+
+        SToken end;
+        end.fPos = len;
+        fTokens.push_back( end );
+        fTokenized = true;
+        return true;
+    }
+
+    const SToken & current() const { return fTokens[ fPos ]; }
+    bool isSymbol( const char * symbol ) const { return ( current().fType == eSymbol ) && ( current().fText == symbol ); }
+    bool isKeyword( const char * keyword ) const { return ( current().fType == eWord ) && ( current().fText.compare( QLatin1String( keyword ), Qt::CaseInsensitive ) == 0 ); }
+    bool expect( const char * symbol )
+    {
+        if ( isSymbol( symbol ) )
+        {
+            ++fPos;
+            return true;
+        }
+        fError = QString( "'%1' expected" ).arg( symbol );
+        return false;
+    }
+
+    void addInstr( EOp op, int column = -1, int value = -1, int numValues = 0 )
+    {
+        SInstr instr;
+        instr.fOp = op;
+        instr.fColumn = column;
+        instr.fValue = value;
+        instr.fNumValues = numValues;
+        fFilter.fProgram.push_back( instr );
+    }
+
+    // expression := and { ( or | || ) and }
+    bool expression()
+    {
+        if ( !andExpression() )
+            return false;
+        while ( isKeyword( "or" ) || isSymbol( "||" ) )
+        {
+            ++fPos;
+            if ( !andExpression() )
+                return false;
+            addInstr( eOr );
+        }
+        return true;
+    }
+
+    // and := unary { ( and | && ) unary }
+    bool andExpression()
+    {
+        if ( !unary() )
+            return false;
+        while ( isKeyword( "and" ) || isSymbol( "&&" ) )
+        {
+            ++fPos;
+            if ( !unary() )
+                return false;
+            addInstr( eAnd );
+        }
+        return true;
+    }
+
+    // unary := ( not | ! ) unary | ( expression ) | empty( column ) | column test
+    bool unary()
+    {
+        if ( isKeyword( "not" ) || isSymbol( "!" ) )
+        {
+            ++fPos;
+            if ( !unary() )
+                return false;
+            addInstr( eNot );
+            return true;
+        }
+        if ( isSymbol( "(" ) )
+        {
+            ++fPos;
+            return expression() && expect( ")" );
+        }
+        if ( isKeyword( "empty" ) && ( fTokens[ fPos + 1 ].fType == eSymbol ) && ( fTokens[ fPos + 1 ].fText == "(" ) )
+        {
+            fPos += 2;
+            int column = -1;
+            if ( !columnName( column ) || !expect( ")" ) )
+                return false;
+            addInstr( eEmpty, column );
+            return true;
+        }
+
+        int column = -1;
+        if ( !columnName( column ) )
+            return false;
+        return test( column );
+    }
+
+    bool columnName( int & column )
+    {
+        auto && token = current();
+        if ( isSymbol( "*" ) )
+        {
+            fFilter.fAllFields = true;
+            column = -1;
+        }
+        else if ( ( token.fType == eBracketName ) || ( ( token.fType == eWord ) && !isKeyword( "and" ) && !isKeyword( "or" ) && !isKeyword( "not" ) && !isKeyword( "in" ) ) )
+        {
+            column = fFilter.fColumnNames.indexOf( token.fText );
+            if ( column < 0 )
+            {
+                column = fFilter.fColumnNames.count();
+                fFilter.fColumnNames << token.fText;
+            }
+        }
+        else
+        {
+            fError = "column name expected";
+            return false;
+        }
+        ++fPos;
+        return true;
+    }
+
+    // test := op value | in ( value { , value } ) | ( ~ | !~ ) string
+    bool test( int column )
+    {
+        if ( isKeyword( "in" ) )
+        {
+            ++fPos;
+            if ( !expect( "(" ) )
+                return false;
+            auto first = static_cast< int >( fFilter.fValues.size() );
+            while ( true )
+            {
+                if ( !value() )
+                    return false;
+                if ( !isSymbol( "," ) )
+                    break;
+                ++fPos;
+            }
+            if ( !expect( ")" ) )
+                return false;
+            addInstr( eIn, column, first, static_cast< int >( fFilter.fValues.size() ) - first );
+            return true;
+        }
+
+        if ( isSymbol( "~" ) || isSymbol( "!~" ) )
+        {
+            auto op = isSymbol( "~" ) ? eMatch : eNoMatch;
+            ++fPos;
+            if ( current().fType != eString )
+            {
+                fError = "regular expression expected";
+                return false;
+            }
+            QRegularExpression regex( current().fText );
+            if ( !regex.isValid() )
+            {
+                fError = regex.errorString();
+                return false;
+            }
+            regex.optimize();
+            ++fPos;
+            addInstr( op, column, static_cast< int >( fFilter.fRegexes.size() ) );
+            fFilter.fRegexes.push_back( regex );
+            return true;
+        }
+
+        static const std::vector< std::pair< QString, EOp > > kOps = { { "=", eEqual }, { "==", eEqual }, { "!=", eNotEqual }, { "<>", eNotEqual }, { "<", eLess }, { "<=", eLessEqual }, { ">", eGreater }, { ">=", eGreaterEqual } };
+        for ( auto && ii : kOps )
+        {
+            if ( ( current().fType != eSymbol ) || ( current().fText != ii.first ) )
+                continue;
+            ++fPos;
+            auto first = static_cast< int >( fFilter.fValues.size() );
+            if ( !value() )
+                return false;
+            addInstr( ii.second, column, first, 1 );
+            return true;
+        }
+        fError = "comparison expected";
+        return false;
+    }
+
+    bool value()
+    {
+        auto && token = current();
+        if ( ( token.fType != eString ) && ( token.fType != eNumber ) )
+        {
+            fError = "string or number expected";
+            return false;
+        }
+        SValue literal;
+        literal.fText = token.fText.toUtf8();
+        if ( token.fType == eNumber )
+        {
+            literal.fIsNumber = true;
+            literal.fNumber = token.fText.toDouble();
+        }
+        fFilter.fValues.push_back( literal );
+        ++fPos;
+        return true;
+    }
+
+    QString fText;
+    CRowFilter & fFilter;
+    std::vector< SToken > fTokens;
+    int fPos{ 0 };
+    bool fTokenized{ false };
+    QString fError;
+    int fErrorPos{ 0 }; // while tokenizing
+};
+
+QString CRowFilter::defaultExpression()
+{
+    // the rule ran on the rows after the name columns were merged, "0" and "0" became "0 0" and kept the row
+    return R"(* in ( "", "0" ) and not ( [First Name] = "0" and [Last Name] = "0" ))";
+}
+
+CRowFilter::CRowFilter()
+{
+    parse( defaultExpression() );
+}
+
+void CRowFilter::clear()
+{
+    fExpression.clear();
+    fProgram.clear();
+    fColumnNames.clear();
+    fColumns.clear();
+    fValues.clear();
+    fRegexes.clear();
+    fAllFields = false;
+    fNumFieldsNeeded = -1;
+}
+
+bool CRowFilter::parse( const QString & expression, QString * errorMsg )
+{
+    clear();
+    fExpression = expression.trimmed();
+    if ( !fExpression.isEmpty() && !CParser( fExpression, *this ).parse( errorMsg ) )
+    {
+        clear();
+        return false;
+    }
+    fColumns.assign( fColumnNames.count(), -1 );
+    fNumFieldsNeeded = fAllFields ? -1 : 0;
+    return true;
+}
+
+void CRowFilter::load( QSettings & settings )
+{
+    // the first default missed the merged name columns, it is read as the default it stood for
+    auto expression = settings.value( "RowFilter", defaultExpression() ).toString();
+    if ( expression.trimmed() == R"(* in ( "", "0" ))" )
+        expression = defaultExpression();
+    if ( !parse( expression ) )
+        parse( defaultExpression() );
+}
+
+void CRowFilter::save( QSettings & settings ) const
+{
+    settings.setValue( "RowFilter", fExpression );
+}
+
+void CRowFilter::bind( const QStringList & header )
+{
+    int lastField = -1;
+    for ( int ii = 0; ii < fColumnNames.count(); ++ii )
+    {
+        fColumns[ ii ] = header.indexOf( fColumnNames[ ii ] );
+        for ( int jj = 0; ( fColumns[ ii ] == -1 ) && ( jj < header.count() ); ++jj )
+        {
+            if ( header[ jj ].compare( fColumnNames[ ii ], Qt::CaseInsensitive ) == 0 )
+                fColumns[ ii ] = jj;
+        }
+        lastField = std::max( lastField, fColumns[ ii ] );
+    }
+    fNumFieldsNeeded = fAllFields ? -1 : ( lastField + 1 );
+}
+
+// the same fields getRow splits out, views into the line where a field has no quotes
+bool CRowFilter::split( const char * data, int len, const CCSVDialect & dialect ) const
+{
+    fFields.clear();
+    if ( fNumFieldsNeeded == 0 )
+        return true;
+
+    auto delimiter = dialect.delimiter();
+    auto quote = dialect.quote();
+    if ( fUnquoted.size() < len )
+        fUnquoted.resize( len );
+    auto out = fUnquoted.data();
+    int outLen = 0;
+
+    int fieldStart = 0;
+    int copyStart = -1; // where the field went in fUnquoted, once it held a quote
+    bool inQuote = false;
+    auto finishField = [ & ]( int fieldEnd )
+    {
+        if ( copyStart < 0 )
+            fFields.push_back( { data + fieldStart, fieldEnd - fieldStart } );
+        else
+            fFields.push_back( { out + copyStart, outLen - copyStart } );
+        copyStart = -1;
+    };
+
+    for ( int ii = 0; ii < len; ++ii )
+    {
+        auto curr = data[ ii ];
+        if ( curr == quote )
+        {
+            if ( copyStart < 0 )
+            {
+                copyStart = outLen;
+                std::memcpy( out + outLen, data + fieldStart, ii - fieldStart );
+                outLen += ii - fieldStart;
+            }
+            if ( inQuote && ( ii + 1 < len ) && ( data[ ii + 1 ] == quote ) )
+            {
+                out[ outLen++ ] = quote;
+                ++ii;
+                continue;
+            }
+            if ( inQuote )
+            {
+                for ( int jj = ii + 1; jj < len; ++jj )
+                {
+                    if ( !isAscii( data[ jj ] ) )
+                        return false;
+                    if ( ( data[ jj ] != delimiter ) && isSpace( data[ jj ] ) )
+                        continue;
+                    if ( data[ jj ] == delimiter )
+                        inQuote = false;
+                    break;
+                }
+            }
+            else
+                inQuote = true;
+            continue;
+        }
+        if ( !inQuote && ( curr == delimiter ) )
+        {
+            finishField( ii );
+            if ( ( fNumFieldsNeeded > 0 ) && ( static_cast< int >( fFields.size() ) >= fNumFieldsNeeded ) )
+                return true;
+            fieldStart = ii + 1;
+            continue;
+        }
+        if ( copyStart >= 0 )
+            out[ outLen++ ] = curr;
+    }
+    finishField( len );
+    return true;
+}
+
+CRowFilter::ERow CRowFilter::classify( const char * data, int len, const CCSVDialect & dialect ) const
+{
+    // trimmed as CCSVDialect::trimmed does, a white space delimiter stays
+    auto delimiter = dialect.delimiter();
+    int begin = 0;
+    int end = len;
+    while ( ( begin < end ) && ( data[ begin ] != delimiter ) && isSpace( data[ begin ] ) )
+        ++begin;
+    while ( ( end > begin ) && ( data[ end - 1 ] != delimiter ) && isSpace( data[ end - 1 ] ) )
+        --end;
+    if ( begin == end )
+        return eBlank;
+    if ( fProgram.empty() )
+        return eKept;
+
+    // escapes, and non ASCII characters where getRow trims, are left to the full parse
+    if ( !dialect.escape() && isAscii( data[ begin ] ) && isAscii( data[ end - 1 ] ) && split( data + begin, end - begin, dialect ) )
+        return isIgnored( fFields ) ? eIgnored : eKept;
+
+    auto line = dialect.trimmed( QString::fromUtf8( data, len ) );
+    if ( line.isEmpty() )
+        return eBlank;
+    return isIgnored( dialect.split( line ) ) ? eIgnored : eKept;
+}
+
+bool CRowFilter::isIgnored( const QStringList & rowData ) const
+{
+    fDecoded.resize( rowData.count() );
+    for ( int ii = 0; ii < rowData.count(); ++ii )
+        fDecoded[ ii ] = rowData[ ii ].toUtf8();
+
+    fFields.clear();
+    for ( auto && ii : fDecoded )
+        fFields.push_back( { ii.constData(), ii.size() } );
+    return isIgnored( fFields );
+}
+
+bool CRowFilter::isIgnored( const TFields & fields ) const
+{
+    if ( fProgram.empty() )
+        return false;
+
+    fStack.clear();
+    for ( auto && instr : fProgram )
+    {
+        if ( ( instr.fOp == eAnd ) || ( instr.fOp == eOr ) )
+        {
+            auto rhs = fStack.back();
+            fStack.pop_back();
+            fStack.back() = ( instr.fOp == eAnd ) ? ( fStack.back() && rhs ) : ( fStack.back() || rhs );
+            continue;
+        }
+        if ( instr.fOp == eNot )
+        {
+            fStack.back() = !fStack.back();
+            continue;
+        }
+
+        bool result = true;
+        if ( instr.fColumn < 0 )
+        {
+            for ( auto ii = fields.begin(); result && ( ii != fields.end() ); ++ii )
+                result = test( instr, *ii );
+        }
+        else
+        {
+            auto field = fColumns[ instr.fColumn ];
+            result = test( instr, ( ( field >= 0 ) && ( field < static_cast< int >( fields.size() ) ) ) ? fields[ field ] : SField() );
+        }
+        fStack.push_back( result );
+    }
+    return fStack.back() != 0;
+}
+
+bool CRowFilter::test( const SInstr & instr, const SField & field ) const
+{
+    if ( instr.fOp == eEmpty )
+        return field.fLength == 0;
+    if ( ( instr.fOp == eMatch ) || ( instr.fOp == eNoMatch ) )
+        return fRegexes[ instr.fValue ].match( QString::fromUtf8( field.fData, field.fLength ) ).hasMatch() == ( instr.fOp == eMatch );
+
+    // numerically when both sides are numbers, by the UTF-8 bytes otherwise
+    auto compare = [ &field ]( const SValue & value )
+    {
+        if ( value.fIsNumber )
+        {
+            bool aOK = false;
+            auto number = QByteArray::fromRawData( field.fData, field.fLength ).toDouble( &aOK );
+            if ( aOK )
+                return ( number < value.fNumber ) ? -1 : ( ( number > value.fNumber ) ? 1 : 0 );
+        }
+        auto cmp = std::memcmp( field.fData ? field.fData : "", value.fText.constData(), std::min( field.fLength, value.fText.size() ) );
+        if ( cmp == 0 )
+            cmp = field.fLength - value.fText.size();
+        return cmp;
+    };
+
+    if ( instr.fOp == eIn )
+    {
+        for ( int ii = 0; ii < instr.fNumValues; ++ii )
+        {
+            if ( compare( fValues[ instr.fValue + ii ] ) == 0 )
+                return true;
+        }
+        return false;
+    }
+
+    auto cmp = compare( fValues[ instr.fValue ] );
+    switch ( instr.fOp )
+    {
+        case eEqual:
+            return cmp == 0;
+        case eNotEqual:
+            return cmp != 0;
+        case eLess:
+            return cmp < 0;
+        case eLessEqual:
+            return cmp <= 0;
+        case eGreater:
+            return cmp > 0;
+        case eGreaterEqual:
+            return cmp >= 0;
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,132 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _ROWFILTER_H
+#define _ROWFILTER_H
+
+#include <QByteArray>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+class CCSVDialect;
+class QSettings;
+
+// Which data rows are ignored, as an expression over the raw fields of a row:
+//   * in ( "", "0" ) and not ( [First Name] = "0" and [Last Name] = "0" )
+//                                                      the default, every field empty or "0" once the name
+//                                                      columns are merged, so "0" "0" names are "0 0" and kept
+//   Status = "deleted" or ( Amount < 0 and not empty( [Account Id] ) )
+//   Name ~ "^test" and Region != "EU"
+// Column names with spaces go in brackets and match the header ignoring case when no name matches exactly, * runs the test on every field and holds when all of them pass.
+// A number compares numerically with the fields that read as numbers, anything else compares the text.
+// The expression is compiled once into a postfix program, bound to the field positions of each header,
+// and run on byte views of the fields, so an ignored row is never turned into a QStringList
+class CRowFilter
+{
+public:
+    enum ERow
+    {
+        eBlank, // white space only, not a row at all
+        eIgnored,
+        eKept
+    };
+    struct SField
+    {
+        const char * fData{ nullptr };
+        int fLength{ 0 };
+    };
+    using TFields = std::vector< SField >;
+
+    static QString defaultExpression();
+
+    CRowFilter(); // the default expression
+    bool parse( const QString & expression, QString * errorMsg = nullptr ); // an empty expression ignores nothing
+    const QString & expression() const { return fExpression; }
+    bool isDefault() const { return fExpression == defaultExpression(); }
+    bool isActive() const { return !fProgram.empty(); }
+
+    void load( QSettings & settings );
+    void save( QSettings & settings ) const;
+
+    void bind( const QStringList & header ); // the raw header, before the name columns are merged; a column it lacks reads as empty
+    int numFieldsNeeded() const { return fNumFieldsNeeded; } // -1 for all of them
+
+    // a raw line, only split as far as the program looks
+    ERow classify( const char * data, int len, const CCSVDialect & dialect ) const;
+    ERow classify( const QByteArray & line, const CCSVDialect & dialect ) const { return classify( line.constData(), line.size(), dialect ); }
+    bool isIgnored( const TFields & fields ) const;
+    bool isIgnored( const QStringList & rowData ) const; // raw fields
+private:
+    enum EOp
+    {
+        eAnd,
+        eOr,
+        eNot,
+        eEmpty,
+        eEqual,
+        eNotEqual,
+        eLess,
+        eLessEqual,
+        eGreater,
+        eGreaterEqual,
+        eIn,
+        eMatch,
+        eNoMatch
+    };
+    struct SInstr
+    {
+        EOp fOp{ eAnd };
+        int fColumn{ -1 };   // index into fColumnNames, -1 for every field
+        int fValue{ -1 };    // first index into fValues, or into fRegexes for the matches
+        int fNumValues{ 0 };
+    };
+    struct SValue
+    {
+        QByteArray fText; // UTF-8
+        bool fIsNumber{ false };
+        double fNumber{ 0.0 };
+    };
+    class CParser;
+
+    void clear();
+    bool split( const char * data, int len, const CCSVDialect & dialect ) const; // into fFields, false when only getRow can tell
+    bool test( const SInstr & instr, const SField & field ) const;
+
+    QString fExpression;
+    std::vector< SInstr > fProgram;
+    QStringList fColumnNames;
+    std::vector< int > fColumns; // bound field of each name, -1 when the header lacks it
+    std::vector< SValue > fValues;
+    std::vector< QRegularExpression > fRegexes;
+    bool fAllFields{ false };
+    int fNumFieldsNeeded{ -1 };
+
+    // scratch space, a filter is only used by one thread at a time
+    mutable TFields fFields;
+    mutable QByteArray fUnquoted;
+    mutable std::vector< QByteArray > fDecoded;
+    mutable std::vector< char > fStack;
+};
+
+#endif
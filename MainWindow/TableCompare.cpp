@@ -0,0 +1,363 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "TableCompare.h"
+#include "CSVTable.h"
+#include "MemoryAccounting.h"
+#include "WorkStealingPool.h"
+
+#include <QSaveFile>
+#include <QTextStream>
+#include <algorithm>
+#include <unordered_set>
+
+void SKeyIndex::clear()
+{
+    fMD5s.clear();
+    fMD5ToRow.clear();
+}
+
+QByteArray SKeyIndex::computeKey( int row, const TKeyValues & keyValues, const std::vector< int > & options )
+{
+    thread_local QStringList sKeyValues;
+    thread_local std::vector< int > sPositions;
+    sKeyValues.clear();
+    keyValues( row, sKeyValues );
+    while ( static_cast< int >( sPositions.size() ) < sKeyValues.count() )
+        sPositions.push_back( static_cast< int >( sPositions.size() ) );
+    sPositions.resize( sKeyValues.count() );
+    return CKeyNormalizer::computeKey( sKeyValues, sPositions, options );
+}
+
+bool SKeyIndex::build( int numRows, const TKeyValues & keyValues, const std::vector< int > & options, const TProgress & progress )
+{
+    clear();
+    fMD5s.reserve( numRows );
+    fMD5ToRow.reserve( numRows );
+    for ( int ii = 0; ii < numRows; ++ii )
+    {
+        if ( ( ( ii % kProgressRows ) == 0 ) && progress && !progress( ii ) )
+            return false;
+        fMD5s.push_back( computeKey( ii, keyValues, options ) );
+        fMD5ToRow[ fMD5s.back() ] = ii;
+    }
+    return true;
+}
+
+bool SKeyIndex::buildSharded( int numRows, const std::vector< int > & shardRows, const TKeyValues & keyValues, const std::vector< int > & options, const std::atomic< bool > * canceled )
+{
+    // each shard hashes its own rows into its own map, concurrently
+    clear();
+    if ( shardRows.empty() )
+        return true;
+    fMD5s.resize( numRows );
+    auto numShards = static_cast< int >( shardRows.size() );
+    auto shardEnd = [ & ]( int shard ) { return ( shard + 1 < numShards ) ? shardRows[ shard + 1 ] : numRows; };
+    std::vector< std::unordered_map< QByteArray, int > > shardIndexes( numShards );
+    auto aOK = CWorkStealingPool::shared().parallelFor( numShards,
+                                                        [ & ]( int shard )
+                                                        {
+                                                            auto && shardIndex = shardIndexes[ shard ];
+                                                            shardIndex.reserve( shardEnd( shard ) - shardRows[ shard ] );
+                                                            for ( int ii = shardRows[ shard ]; ii < shardEnd( shard ); ++ii )
+                                                            {
+                                                                if ( canceled && *canceled )
+                                                                    return false;
+                                                                fMD5s[ ii ] = computeKey( ii, keyValues, options );
+                                                                shardIndex[ fMD5s[ ii ] ] = ii;
+                                                            }
+                                                            return true;
+                                                        } );
+    if ( !aOK )
+        return false;
+
+    // merged in shard order, so a key in several shards keeps its last row as in the unsharded index
+    fMD5ToRow = std::move( shardIndexes.front() );
+    fMD5ToRow.reserve( numRows );
+    for ( size_t ii = 1; ii < shardIndexes.size(); ++ii )
+    {
+        for ( auto && jj : shardIndexes[ ii ] )
+            fMD5ToRow[ jj.first ] = jj.second;
+        shardIndexes[ ii ].clear();
+    }
+    return true;
+}
+
+bool SKeyIndex::join( const SKeyIndex & lhs, const SKeyIndex & rhs, std::vector< std::pair< int, int > > & merged, const TProgress & progress )
+{
+    merged.clear();
+    auto numLHSRows = static_cast< int >( lhs.fMD5s.size() );
+    auto numRHSRows = static_cast< int >( rhs.fMD5s.size() );
+    auto maxRows = std::max( numLHSRows, numRHSRows );
+    merged.reserve( maxRows );
+    for ( int ii = 0; ii < maxRows; ++ii )
+    {
+        if ( ( ( ii % kProgressRows ) == 0 ) && progress && !progress( ii ) )
+            return false;
+
+        if ( ii < numLHSRows )
+        {
+            auto pos = rhs.fMD5ToRow.find( lhs.fMD5s[ ii ] );
+            merged.emplace_back( ii, ( pos == rhs.fMD5ToRow.end() ) ? -1 : ( *pos ).second );
+        }
+        if ( ( ii < numRHSRows ) && ( lhs.fMD5ToRow.find( rhs.fMD5s[ ii ] ) == lhs.fMD5ToRow.end() ) )
+            merged.emplace_back( -1, ii );
+    }
+    return true;
+}
+
+qint64 SKeyIndex::estimateBytes() const
+{
+    auto retVal = CMemoryAccounting::estimateBytes( fMD5s );
+    for ( auto && ii : fMD5s )
+        retVal += CMemoryAccounting::estimateBytes( ii ) - static_cast< qint64 >( sizeof( QByteArray ) );
+    // the map shares the key data with fMD5s, so only the nodes and buckets count
+    retVal += static_cast< qint64 >( fMD5ToRow.size() * ( CMemoryAccounting::kNodeOverhead + sizeof( std::pair< const QByteArray, int > ) ) + fMD5ToRow.bucket_count() * sizeof( void * ) );
+    return retVal;
+}
+
+CTableCompare::~CTableCompare()
+{
+    CMemoryAccounting::instance().release( this );
+}
+
+void CTableCompare::clear()
+{
+    fLHS = nullptr;
+    fRHS = nullptr;
+    fKeyColumns.clear();
+    fLHSKeyCols.clear();
+    fRHSKeyCols.clear();
+    fMerged.clear();
+    fNumLHSOnly = fNumRHSOnly = fNumMatched = 0;
+    CMemoryAccounting::instance().release( this );
+}
+
+QStringList CTableCompare::findKeyColumns( const SCSVTable & lhs, const SCSVTable & rhs, std::vector< int > * lhsCols, std::vector< int > * rhsCols )
+{
+    QStringList retVal;
+    for ( int ii = 0; ii < lhs.columnCount(); ++ii )
+    {
+        auto pos = rhs.findColumn( lhs.fHeader[ ii ] );
+        if ( pos == -1 )
+            continue;
+        retVal << lhs.fHeader[ ii ];
+        if ( lhsCols )
+            lhsCols->push_back( ii );
+        if ( rhsCols )
+            rhsCols->push_back( pos );
+    }
+    return retVal;
+}
+
+std::vector< CColumnType > CTableCompare::keyTypes( const SCSVTable & table, const std::vector< int > & keyCols, const SCSVTable & other, const std::vector< int > & otherKeyCols )
+{
+    std::vector< CColumnType > retVal;
+    for ( size_t ii = 0; ii < keyCols.size(); ++ii )
+    {
+        auto type = table.columnType( keyCols[ ii ] );
+        auto typed = ( ii < otherKeyCols.size() ) && CColumnType::common( type, other.columnType( otherKeyCols[ ii ] ) ).isTyped();
+        retVal.push_back( typed ? type : CColumnType() );
+    }
+    return retVal;
+}
+
+bool CTableCompare::buildKeyIndex( const SCSVTable & table, const std::vector< int > & keyCols, const std::vector< int > & options, SKeyIndex & index, const std::atomic< bool > * canceled, const std::vector< CColumnType > & keyTypes )
+{
+    auto keyValues = [ &table, &keyCols, &keyTypes ]( int row, QStringList & values ) { SCSVTable::appendKeyValues( table.fRows[ row ], keyCols, keyTypes, values ); };
+    auto keyOptions = SCSVTable::keyOptions( options, keyTypes );
+    if ( table.numShards() > 1 )
+        return index.buildSharded( table.rowCount(), table.fShardRows, keyValues, keyOptions, canceled );
+    return index.build( table.rowCount(), keyValues, keyOptions, [ canceled ]( int ) { return !canceled || !*canceled; } );
+}
+
+bool CTableCompare::sharedRowsIsolated( const SCSVTable & lhs, const SCSVTable & rhs, const std::vector< std::pair< qint64, qint64 > > & sharedRanges, bool & isolated, QString * errorMsg, const std::atomic< bool > * canceled ) const
+{
+    isolated = false;
+    std::vector< int > lhsKeyCols;
+    std::vector< int > rhsKeyCols;
+    auto keyColumns = findKeyColumns( lhs, rhs, &lhsKeyCols, &rhsKeyCols );
+    if ( keyColumns.isEmpty() )
+        return true;
+
+    // the keys are made as the join makes them, so a key here is a key there
+    auto options = fNormalizer.columnOptions( keyColumns );
+    auto lhsTypes = keyTypes( lhs, lhsKeyCols, rhs, rhsKeyCols );
+    std::unordered_set< QByteArray > sharedKeys;
+    if ( !lhs.rangeKeys( sharedRanges, lhsKeyCols, options, lhsTypes, sharedKeys, errorMsg, canceled ) )
+        return false;
+
+    for ( int ii = 0; ii < lhs.rowCount(); ++ii )
+    {
+        if ( canceled && *canceled )
+            return false;
+        if ( sharedKeys.count( lhs.computeKey( ii, lhsKeyCols, options, lhsTypes ) ) )
+            return true;
+    }
+    auto rhsTypes = keyTypes( rhs, rhsKeyCols, lhs, lhsKeyCols );
+    for ( int ii = 0; ii < rhs.rowCount(); ++ii )
+    {
+        if ( canceled && *canceled )
+            return false;
+        if ( sharedKeys.count( rhs.computeKey( ii, rhsKeyCols, options, rhsTypes ) ) )
+            return true;
+    }
+    isolated = true;
+    return true;
+}
+
+bool CTableCompare::compare( const SCSVTable & lhs, const SCSVTable & rhs, const std::atomic< bool > * canceled )
+{
+    clear();
+    fLHS = &lhs;
+    fRHS = &rhs;
+
+    fKeyColumns = findKeyColumns( lhs, rhs, &fLHSKeyCols, &fRHSKeyCols );
+    if ( fKeyColumns.isEmpty() )
+        return false;
+
+    SKeyIndex lhsIndex;
+    if ( !buildKeyIndex( lhs, fLHSKeyCols, fNormalizer.columnOptions( fKeyColumns ), lhsIndex, canceled, keyTypes( lhs, fLHSKeyCols, rhs, fRHSKeyCols ) ) )
+        return false;
+    return join( lhsIndex, canceled );
+}
+
+bool CTableCompare::compare( const SCSVTable & lhs, const SKeyIndex & lhsIndex, const SCSVTable & rhs, const std::atomic< bool > * canceled )
+{
+    clear();
+    fLHS = &lhs;
+    fRHS = &rhs;
+
+    fKeyColumns = findKeyColumns( lhs, rhs, &fLHSKeyCols, &fRHSKeyCols );
+    if ( fKeyColumns.isEmpty() || ( static_cast< int >( lhsIndex.fMD5s.size() ) != lhs.rowCount() ) )
+        return false;
+    return join( lhsIndex, canceled );
+}
+
+bool CTableCompare::join( const SKeyIndex & lhsIndex, const std::atomic< bool > * canceled )
+{
+    auto && accounting = CMemoryAccounting::instance();
+    {
+        SKeyIndex rhsIndex;
+        if ( !buildKeyIndex( *fRHS, fRHSKeyCols, fNormalizer.columnOptions( fKeyColumns ), rhsIndex, canceled, keyTypes( *fRHS, fRHSKeyCols, *fLHS, fLHSKeyCols ) ) )
+            return false;
+        // both indexes are live for the whole join, the LHS one may be shared but is counted here too
+        accounting.setLive( CMemoryAccounting::eKeyIndex, this, lhsIndex.estimateBytes() + rhsIndex.estimateBytes() );
+
+        if ( !SKeyIndex::join( lhsIndex, rhsIndex, fMerged, [ canceled ]( int ) { return !canceled || !*canceled; } ) )
+        {
+            accounting.setLive( CMemoryAccounting::eKeyIndex, this, 0 );
+            return false;
+        }
+        accounting.setLive( CMemoryAccounting::eMergeResult, this, CMemoryAccounting::estimateBytes( fMerged ) );
+    }
+    accounting.setLive( CMemoryAccounting::eKeyIndex, this, 0 ); // the RHS index is gone
+
+    for ( auto && ii : fMerged )
+    {
+        if ( ii.first == -1 )
+            fNumRHSOnly++;
+        else if ( ii.second == -1 )
+            fNumLHSOnly++;
+        else
+            fNumMatched++;
+    }
+    return true;
+}
+
+QStringList CTableCompare::getHeader() const
+{
+    if ( !fLHS || !fRHS )
+        return {};
+
+    QStringList retVal;
+    retVal << "Status" << fKeyColumns;
+    for ( auto && ii : fLHS->fExtraUnimportantCols )
+        retVal << fLHS->fHeader[ ii.first ];
+    for ( auto && ii : fRHS->fExtraUnimportantCols )
+        retVal << fRHS->fHeader[ ii.first ];
+    return retVal;
+}
+
+QString CTableCompare::getStatus( int row ) const
+{
+    auto && currMergeInfo = fMerged[ row ];
+    if ( currMergeInfo.second == -1 )
+        return "LHS Only";
+    if ( currMergeInfo.first == -1 )
+        return "RHS Only";
+    return "Both";
+}
+
+QStringList CTableCompare::getRowData( int row ) const
+{
+    auto && currMergeInfo = fMerged[ row ];
+
+    QStringList retVal;
+    retVal << getStatus( row );
+    if ( currMergeInfo.first != -1 )
+    {
+        for ( auto && ii : fLHSKeyCols )
+            retVal << fLHS->data( currMergeInfo.first, ii );
+    }
+    else
+    {
+        for ( auto && ii : fRHSKeyCols )
+            retVal << fRHS->data( currMergeInfo.second, ii );
+    }
+    retVal << fLHS->data( currMergeInfo.first, fLHS->fExtraUnimportantCols );
+    retVal << fRHS->data( currMergeInfo.second, fRHS->fExtraUnimportantCols );
+    return retVal;
+}
+
+bool CTableCompare::save( const QString & fileName, QString * errorMsg ) const
+{
+    // written to a temporary file and renamed, a reader never sees half a result
+    QSaveFile file( fileName );
+    file.open( QIODevice::Text | QIODevice::WriteOnly );
+    if ( !file.isOpen() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Could not open file '%1' for write" ).arg( fileName );
+        return false;
+    }
+
+    QTextStream ts( &file );
+    auto writeRow = [ &ts ]( QStringList rowData )
+    {
+        for ( auto && ii : rowData )
+            ii = QString( R"("%1")" ).arg( QString( ii ).replace( "\"", "\"\"" ) );
+        ts << rowData.join( "," ) << "\n";
+    };
+
+    writeRow( QStringList() << "No." << getHeader() );
+    for ( int ii = 0; ii < rowCount(); ++ii )
+        writeRow( QStringList() << QString::number( ii + 1 ) << getRowData( ii ) );
+    ts.flush();
+    if ( ( ts.status() != QTextStream::Ok ) || !file.commit() )
+    {
+        if ( errorMsg )
+            *errorMsg = QString( "Error writing file '%1': %2" ).arg( fileName ).arg( file.errorString() );
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,107 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _TABLECOMPARE_H
+#define _TABLECOMPARE_H
+
+#include "ColumnType.h"
+#include "KeyNormalizer.h"
+
+#include <QByteArray>
+#include <QStringList>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+struct SCSVTable;
+
+// Keys of one side, built once and reusable for any compare on the same key columns.
+// The window and the headless compares both hash and join through here, so they always agree
+struct SKeyIndex
+{
+    using TKeyValues = std::function< void( int row, QStringList & keyValues ) >; // appends the key values of the row, in key column order
+    using TProgress = std::function< bool( int done ) >; // called every kProgressRows rows, false cancels
+    static constexpr int kProgressRows = 1000;
+    static constexpr int kBlockRows = 64 * 1024; // a single file is hashed in blocks of this many rows, as the shards of a sharded one
+
+    void clear();
+    bool build( int numRows, const TKeyValues & keyValues, const std::vector< int > & options, const TProgress & progress = {} );
+    // shardRows holds the first row of each shard, each shard is hashed into its own map on the pool and the maps merged in shard order.
+    // keyValues is called from the pool threads
+    bool buildSharded( int numRows, const std::vector< int > & shardRows, const TKeyValues & keyValues, const std::vector< int > & options, const std::atomic< bool > * canceled = nullptr );
+    static QByteArray computeKey( int row, const TKeyValues & keyValues, const std::vector< int > & options );
+    qint64 estimateBytes() const;
+
+    // LHS row N, then the RHS only row N. Each pair is lhsRow, rhsRow; -1 when missing
+    static bool join( const SKeyIndex & lhs, const SKeyIndex & rhs, std::vector< std::pair< int, int > > & merged, const TProgress & progress = {} );
+
+    std::vector< QByteArray > fMD5s; // per row
+    std::unordered_map< QByteArray, int > fMD5ToRow; // last row with the key
+};
+
+// Headless version of SFileData::mergeData, joins two SCSVTables on the columns they share
+class CTableCompare
+{
+public:
+    ~CTableCompare();
+
+    bool compare( const SCSVTable & lhs, const SCSVTable & rhs, const std::atomic< bool > * canceled = nullptr );
+    bool compare( const SCSVTable & lhs, const SKeyIndex & lhsIndex, const SCSVTable & rhs, const std::atomic< bool > * canceled = nullptr ); // lhsIndex built by buildKeyIndex on the shared columns, with keyTypes( lhs, .., rhs, .. )
+
+    static QStringList findKeyColumns( const SCSVTable & lhs, const SCSVTable & rhs, std::vector< int > * lhsCols = nullptr, std::vector< int > * rhsCols = nullptr );
+    static std::vector< CColumnType > keyTypes( const SCSVTable & table, const std::vector< int > & keyCols, const SCSVTable & other, const std::vector< int > & otherKeyCols ); // the table's own type where both hold the column typed
+    static bool buildKeyIndex( const SCSVTable & table, const std::vector< int > & keyCols, const std::vector< int > & options, SKeyIndex & index, const std::atomic< bool > * canceled = nullptr, const std::vector< CColumnType > & keyTypes = {} );
+    // lhs and rhs were loaded without the same rows, found at sharedRanges of the LHS file. Those rows only match each other,
+    // and compare leaves the counts of a full compare, when none of their keys is also on a loaded row; isolated says if so
+    bool sharedRowsIsolated( const SCSVTable & lhs, const SCSVTable & rhs, const std::vector< std::pair< qint64, qint64 > > & sharedRanges, bool & isolated, QString * errorMsg = nullptr, const std::atomic< bool > * canceled = nullptr ) const;
+    bool save( const QString & fileName, QString * errorMsg = nullptr ) const;
+    void clear();
+    void setKeyNormalizer( const CKeyNormalizer & normalizer ) { fNormalizer = normalizer; }
+
+    const QStringList & keyColumns() const { return fKeyColumns; }
+    QStringList getHeader() const;
+
+    int rowCount() const { return static_cast< int >( fMerged.size() ); }
+    QStringList getRowData( int row ) const;
+    QString getStatus( int row ) const;
+    const std::pair< int, int > & mergeInfo( int row ) const { return fMerged[ row ]; } // lhsRow, rhsRow; -1 when missing
+
+    int numLHSOnly() const { return fNumLHSOnly; }
+    int numRHSOnly() const { return fNumRHSOnly; }
+    int numMatched() const { return fNumMatched; }
+private:
+    bool join( const SKeyIndex & lhsIndex, const std::atomic< bool > * canceled );
+
+    const SCSVTable * fLHS{ nullptr };
+    const SCSVTable * fRHS{ nullptr };
+    CKeyNormalizer fNormalizer;
+    QStringList fKeyColumns;
+    std::vector< int > fLHSKeyCols;
+    std::vector< int > fRHSKeyCols;
+    std::vector< std::pair< int, int > > fMerged;
+    int fNumLHSOnly{ 0 };
+    int fNumRHSOnly{ 0 };
+    int fNumMatched{ 0 };
+};
+
+#endif
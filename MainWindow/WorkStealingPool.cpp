@@ -0,0 +1,171 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+
+namespace
+{
+    thread_local CWorkStealingPool * sCurrentPool = nullptr;
+    thread_local int sWorkerIndex = -1;
+}
+
+CWorkStealingPool::CWorkStealingPool( int numThreads )
+{
+    if ( numThreads <= 0 )
+        numThreads = std::max( 1, static_cast< int >( std::thread::hardware_concurrency() ) );
+
+    for ( int ii = 0; ii < numThreads; ++ii )
+        fWorkers.push_back( std::make_unique< SWorker >() );
+    for ( int ii = 0; ii < numThreads; ++ii )
+        fThreads.emplace_back( [ this, ii ]() { workerMain( ii ); } );
+}
+
+CWorkStealingPool & CWorkStealingPool::shared()
+{
+    static CWorkStealingPool sPool;
+    return sPool;
+}
+
+std::shared_ptr< CWorkStealingPool::CLoop > CWorkStealingPool::start( int count, TItemFunc func )
+{
+    auto retVal = std::make_shared< CLoop >();
+    retVal->fCount = std::max( 0, count );
+    retVal->fFunc = std::move( func );
+
+    // the loop is kept alive by every task, one that starts after the items are gone just returns
+    auto numTasks = std::min( retVal->fCount, numThreads() );
+    for ( int ii = 0; ii < numTasks; ++ii )
+        submit( [ retVal ]() { retVal->runItems(); } );
+    return retVal;
+}
+
+void CWorkStealingPool::CLoop::runItems()
+{
+    for ( int curr = fNextItem++; curr < fCount; curr = fNextItem++ )
+    {
+        if ( !fStopped && !fFunc( curr ) )
+            fStopped = true;
+        if ( ++fNumDone == fCount )
+        {
+            std::lock_guard< std::mutex > lock( fMutex );
+            fAllDone.notify_all();
+        }
+    }
+}
+
+bool CWorkStealingPool::CLoop::wait()
+{
+    // the items the pool has not claimed yet are run here, so a worker waiting on a nested loop never blocks it
+    runItems();
+    std::unique_lock< std::mutex > lock( fMutex );
+    fAllDone.wait( lock, [ this ]() { return isDone(); } );
+    return !fStopped;
+}
+
+CWorkStealingPool::~CWorkStealingPool()
+{
+    wait();
+    {
+        std::lock_guard< std::mutex > lock( fWaitMutex );
+        fStopping = true;
+    }
+    fWorkAvailable.notify_all();
+    for ( auto && ii : fThreads )
+        ii.join();
+}
+
+void CWorkStealingPool::submit( TTask task )
+{
+    fPending++;
+
+    int worker = ( sCurrentPool == this ) ? sWorkerIndex : static_cast< int >( fNextWorker++ % fWorkers.size() );
+    {
+        std::lock_guard< std::mutex > lock( fWorkers[ worker ]->fMutex );
+        fWorkers[ worker ]->fTasks.emplace_back( std::move( task ) );
+    }
+    {
+        std::lock_guard< std::mutex > lock( fWaitMutex );
+        fQueued++;
+    }
+    fWorkAvailable.notify_one();
+}
+
+void CWorkStealingPool::wait()
+{
+    std::unique_lock< std::mutex > lock( fWaitMutex );
+    fAllDone.wait( lock, [ this ]() { return fPending == 0; } );
+}
+
+bool CWorkStealingPool::popTask( int worker, TTask & task )
+{
+    auto && curr = *fWorkers[ worker ];
+    std::lock_guard< std::mutex > lock( curr.fMutex );
+    if ( curr.fTasks.empty() )
+        return false;
+    task = std::move( curr.fTasks.back() );
+    curr.fTasks.pop_back();
+    return true;
+}
+
+bool CWorkStealingPool::stealTask( int worker, TTask & task )
+{
+    auto numWorkers = static_cast< int >( fWorkers.size() );
+    for ( int ii = 1; ii < numWorkers; ++ii )
+    {
+        auto && victim = *fWorkers[ ( worker + ii ) % numWorkers ];
+        std::lock_guard< std::mutex > lock( victim.fMutex );
+        if ( victim.fTasks.empty() )
+            continue;
+        task = std::move( victim.fTasks.front() );
+        victim.fTasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void CWorkStealingPool::workerMain( int worker )
+{
+    sCurrentPool = this;
+    sWorkerIndex = worker;
+    while ( true )
+    {
+        TTask task;
+        if ( popTask( worker, task ) || stealTask( worker, task ) )
+        {
+            fQueued--;
+            task();
+            if ( --fPending == 0 )
+            {
+                std::lock_guard< std::mutex > lock( fWaitMutex );
+                fAllDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock< std::mutex > lock( fWaitMutex );
+        fWorkAvailable.wait( lock, [ this ]() { return fStopping || ( fQueued > 0 ); } );
+        if ( fStopping && ( fQueued == 0 ) )
+            return;
+    }
+}
@@ -0,0 +1,101 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _WORKSTEALINGPOOL_H
+#define _WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Each worker owns a deque, tasks submitted from a worker go onto its own deque (run LIFO),
+// idle workers steal the oldest task from the other workers
+class CWorkStealingPool
+{
+public:
+    using TTask = std::function< void() >;
+    using TItemFunc = std::function< bool( int item ) >; // false fails the loop
+
+    // A loop over count items, the threads running it claim one item at a time.
+    // After an item fails or stop is called the remaining items are skipped
+    class CLoop
+    {
+    public:
+        bool wait(); // works on the items on the calling thread too, false when an item failed or the loop was stopped
+        bool isDone() const { return fNumDone == fCount; }
+        int numDone() const { return fNumDone; }
+        void stop() { fStopped = true; }
+        const std::atomic< bool > & stopped() const { return fStopped; } // for long items to give up early
+    private:
+        friend class CWorkStealingPool;
+        void runItems();
+
+        int fCount{ 0 };
+        TItemFunc fFunc;
+        std::atomic< int > fNextItem{ 0 };
+        std::atomic< int > fNumDone{ 0 };
+        std::atomic< bool > fStopped{ false };
+        std::mutex fMutex;
+        std::condition_variable fAllDone;
+    };
+
+    explicit CWorkStealingPool( int numThreads = -1 );
+    ~CWorkStealingPool();
+
+    static CWorkStealingPool & shared(); // one thread per core, for the parallel loops of the loads and compares
+
+    void submit( TTask task );
+    void wait();
+
+    std::shared_ptr< CLoop > start( int count, TItemFunc func ); // returns at once, poll or wait on the loop
+    bool parallelFor( int count, TItemFunc func ) { return start( count, std::move( func ) )->wait(); } // safe to nest, the caller runs items as well
+
+    int numThreads() const { return static_cast< int >( fThreads.size() ); }
+private:
+    struct SWorker
+    {
+        std::mutex fMutex;
+        std::deque< TTask > fTasks;
+    };
+
+    bool popTask( int worker, TTask & task );
+    bool stealTask( int worker, TTask & task );
+    void workerMain( int worker );
+
+    std::vector< std::unique_ptr< SWorker > > fWorkers;
+    std::vector< std::thread > fThreads;
+
+    std::mutex fWaitMutex;
+    std::condition_variable fWorkAvailable;
+    std::condition_variable fAllDone;
+    std::atomic< int > fQueued{ 0 };
+    std::atomic< int > fPending{ 0 };
+    std::atomic< unsigned int > fNextWorker{ 0 };
+    bool fStopping{ false };
+};
+
+#endif
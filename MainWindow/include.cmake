@@ -28,7 +28,62 @@ set(qtproject_H
     MainWindow.h
 )
 
+set(project_SRCS
+    AsymmetricCompare.cpp
+    BatchCompare.cpp
+    Benchmark.cpp
+    BloomFilter.cpp
+    CSVDialect.cpp
+    CSVPatch.cpp
+    CSVReader.cpp
+    CSVTable.cpp
+    ChunkFingerprints.cpp
+    ColumnStatistics.cpp
+    ColumnStore.cpp
+    ColumnType.cpp
+    CompareDaemon.cpp
+    KeyAdvisor.cpp
+    KeyHash.cpp
+    KeyNormalizer.cpp
+    LineIndex.cpp
+    MemoryAccounting.cpp
+    MergedSearchIndex.cpp
+    NWayCompare.cpp
+    ReadAhead.cpp
+    ResultCache.cpp
+    RowFilter.cpp
+    OrderedDiff.cpp
+    TableCompare.cpp
+    WorkStealingPool.cpp
+)
+
 set(project_H
+    AsymmetricCompare.h
+    BatchCompare.h
+    Benchmark.h
+    BloomFilter.h
+    CSVDialect.h
+    CSVPatch.h
+    CSVReader.h
+    CSVTable.h
+    ChunkFingerprints.h
+    ColumnStatistics.h
+    ColumnStore.h
+    ColumnType.h
+    CompareDaemon.h
+    KeyAdvisor.h
+    KeyHash.h
+    KeyNormalizer.h
+    LineIndex.h
+    MemoryAccounting.h
+    MergedSearchIndex.h
+    NWayCompare.h
+    ReadAhead.h
+    ResultCache.h
+    RowFilter.h
+    OrderedDiff.h
+    TableCompare.h
+    WorkStealingPool.h
 )
 
 set(qtproject_UIS
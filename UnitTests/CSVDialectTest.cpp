@@ -0,0 +1,122 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "MainWindow/CSVDialect.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+    struct SDelimiterCase
+    {
+        char fDelimiter;
+        const char * fSample;
+        const char * fLine;
+    };
+
+    const SDelimiterCase kSpecialized[] = {
+        { ',', "Id,Name,Note\n1,Ann,\"x, y\"\n2,Bob,\n", R"(3,"Cy, Jr",say "hi" now)" },
+        { '\t', "Id\tName\tNote\n1\tAnn\t\"x\ty\"\n2\tBob\t\n", "3\t\"Cy\t Jr\"\tsay \"hi\" now" },
+        { ';', "Id;Name;Note\n1;Ann;\"x; y\"\n2;Bob;\n", R"(3;"Cy; Jr";say "hi" now)" },
+        { '|', "Id|Name|Note\n1|Ann|\"x| y\"\n2|Bob|\n", R"(3|"Cy| Jr"|say "hi" now)" },
+    };
+}
+
+TEST( CSVDialect, SniffsEachSpecializedDelimiter )
+{
+    for ( auto && ii : kSpecialized )
+    {
+        auto dialect = CCSVDialect::sniff( ii.fSample );
+        EXPECT_EQ( dialect.delimiter(), ii.fDelimiter ) << ii.fSample;
+        EXPECT_EQ( dialect.quote(), '"' );
+        EXPECT_EQ( dialect.escape(), 0 );
+        EXPECT_TRUE( dialect.isSpecialized() );
+        EXPECT_EQ( dialect, CCSVDialect( ii.fDelimiter, '"', 0 ) );
+    }
+}
+
+TEST( CSVDialect, SplitsEachSpecializedDelimiter )
+{
+    for ( auto && ii : kSpecialized )
+    {
+        CCSVDialect dialect( ii.fDelimiter, '"', 0 );
+        ASSERT_TRUE( dialect.isSpecialized() );
+
+        auto cells = dialect.split( ii.fLine );
+        ASSERT_EQ( cells.count(), 3 ) << ii.fLine;
+        EXPECT_EQ( cells[ 0 ], "3" );
+        EXPECT_EQ( cells[ 1 ], QString( "Cy%1 Jr" ).arg( QLatin1Char( ii.fDelimiter ) ) );
+        EXPECT_EQ( cells[ 2 ], "say hi now" ); // stray quotes are dropped
+
+        // the generic splitter follows the same rules
+        CCSVDialect generic( ii.fDelimiter, '"', '\\' );
+        EXPECT_FALSE( generic.isSpecialized() );
+        EXPECT_EQ( generic.split( ii.fLine ), cells );
+    }
+}
+
+TEST( CSVDialect, SplitsDoubledQuotes )
+{
+    CCSVDialect dialect;
+    EXPECT_EQ( dialect.split( R"("a ""b""",c)" ), QStringList( { R"(a "b")", "c" } ) );
+    EXPECT_EQ( dialect.split( R"("",x)" ), QStringList( { "", "x" } ) );
+    EXPECT_EQ( dialect.split( R"("""")" ), QStringList( { R"(")" } ) );
+}
+
+TEST( CSVDialect, SniffsTheDelimiterTie )
+{
+    // both are on every line, the one found more times per line wins
+    auto dialect = CCSVDialect::sniff( "a;b,c;d\n1;2,3;4\n" );
+    EXPECT_EQ( dialect.delimiter(), ';' );
+}
+
+TEST( CSVDialect, SniffsSingleQuotes )
+{
+    auto dialect = CCSVDialect::sniff( "'a','b'\n'1','2'\n" );
+    EXPECT_EQ( dialect.delimiter(), ',' );
+    EXPECT_EQ( dialect.quote(), '\'' );
+    EXPECT_FALSE( dialect.isSpecialized() );
+    EXPECT_EQ( dialect.split( "'x, y',z" ), QStringList( { "x, y", "z" } ) );
+}
+
+TEST( CSVDialect, SniffsConsistentEscapes )
+{
+    auto dialect = CCSVDialect::sniff( "a,b\n\"x \\\"y\\\"\",z\n1,2\n" );
+    EXPECT_EQ( dialect.escape(), '\\' );
+    EXPECT_FALSE( dialect.isSpecialized() );
+    EXPECT_EQ( dialect.split( R"("x \"y\"",z)" ), QStringList( { R"(x "y")", "z" } ) );
+}
+
+TEST( CSVDialect, IgnoresInconsistentEscapes )
+{
+    // a path ending in a backslash, the escape would swallow the closing quote and the delimiter
+    EXPECT_EQ( CCSVDialect::sniff( "a,b\n\"C:\\\",z\n1,2\n" ).escape(), 0 );
+
+    // the file doubles its quotes elsewhere
+    EXPECT_EQ( CCSVDialect::sniff( "a,b\n\"a \\\"b\\\"\",1\n\"c \"\"d\"\"\",2\n" ).escape(), 0 );
+}
+
+TEST( CSVDialect, SniffsLineEnds )
+{
+    EXPECT_EQ( CCSVDialect::sniff( "a,b\r\n1,2\r\n" ).lineEnd(), '\n' );
+    EXPECT_EQ( CCSVDialect::sniff( "a,b\r1,2\r" ).lineEnd(), '\r' );
+}
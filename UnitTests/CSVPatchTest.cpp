@@ -0,0 +1,130 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "MainWindow/CSVPatch.h"
+#include "MainWindow/CSVTable.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <gtest/gtest.h>
+
+namespace
+{
+    SCSVTable makeTable( const std::vector< QStringList > & rows )
+    {
+        SCSVTable retVal;
+        retVal.fFileName = "memory.csv";
+        retVal.fHeader = QStringList( { "id", "name", "note" } );
+        retVal.fRows = rows;
+        return retVal;
+    }
+
+    QByteArray readFile( const QString & fileName )
+    {
+        QFile file( fileName );
+        if ( !file.open( QFile::ReadOnly | QFile::Text ) )
+            return QByteArray();
+        return file.readAll();
+    }
+
+    bool writeFile( const QString & fileName, const QByteArray & data )
+    {
+        QFile file( fileName );
+        return file.open( QFile::Truncate | QFile::WriteOnly ) && ( file.write( data ) == data.size() );
+    }
+
+    const std::vector< QStringList > kLHSRows = { { "1", "plain", "" }, { "2", R"(say "hi")", "a, b" }, { "3", "two\nlines", "x" }, { "4", "gone", "" } };
+}
+
+TEST( CSVPatch, RoundTripQuotedCells )
+{
+    auto lhs = makeTable( kLHSRows );
+    auto rhs = makeTable( { { "1", "plain", R"("quoted")" }, { "2", R"(say "hi")", "a, b" }, { "5", "new\nrow", R"("")" }, { "3", "two\nlines", "y" } } );
+
+    QTemporaryDir dir;
+    ASSERT_TRUE( dir.isValid() );
+    auto patchFile = dir.filePath( "rhs.patch" );
+    auto outFile = dir.filePath( "rhs.csv" );
+
+    QString msg;
+    ASSERT_TRUE( CCSVPatch::write( lhs, rhs, patchFile, &msg ) ) << qPrintable( msg );
+    ASSERT_TRUE( CCSVPatch::apply( lhs, patchFile, outFile, &msg ) ) << qPrintable( msg );
+
+    // embedded quotes are doubled, embedded newlines are kept inside the quotes
+    QByteArray expected = "\"id\",\"name\",\"note\"\n"
+                          "\"1\",\"plain\",\"\"\"quoted\"\"\"\n"
+                          "\"2\",\"say \"\"hi\"\"\",\"a, b\"\n"
+                          "\"5\",\"new\nrow\",\"\"\"\"\"\"\n"
+                          "\"3\",\"two\nlines\",\"y\"\n";
+    EXPECT_EQ( readFile( outFile ), expected );
+}
+
+TEST( CSVPatch, RoundTripUnchanged )
+{
+    auto lhs = makeTable( kLHSRows );
+
+    QTemporaryDir dir;
+    ASSERT_TRUE( dir.isValid() );
+    auto patchFile = dir.filePath( "same.patch" );
+    auto outFile = dir.filePath( "same.csv" );
+
+    QString msg;
+    CCSVPatch::SStats stats;
+    ASSERT_TRUE( CCSVPatch::write( lhs, lhs, patchFile, &msg ) ) << qPrintable( msg );
+    ASSERT_TRUE( CCSVPatch::apply( lhs, patchFile, outFile, &msg, &stats ) ) << qPrintable( msg );
+    EXPECT_EQ( stats.fCopied, lhs.rowCount() );
+    EXPECT_EQ( stats.fUpdated + stats.fInserted, 0 );
+    EXPECT_EQ( readFile( outFile ),
+               QByteArray( "\"id\",\"name\",\"note\"\n"
+                           "\"1\",\"plain\",\"\"\n"
+                           "\"2\",\"say \"\"hi\"\"\",\"a, b\"\n"
+                           "\"3\",\"two\nlines\",\"x\"\n"
+                           "\"4\",\"gone\",\"\"\n" ) );
+}
+
+TEST( CSVPatch, RejectsRowPastTheEnd )
+{
+    auto lhs = makeTable( kLHSRows );
+
+    QTemporaryDir dir;
+    ASSERT_TRUE( dir.isValid() );
+    auto patchFile = dir.filePath( "bad.patch" );
+
+    QString msg;
+    ASSERT_TRUE( CCSVPatch::write( lhs, lhs, patchFile, &msg ) ) << qPrintable( msg );
+
+    // an unchanged table is a single copy record: eCopy, row delta 0, count, eEnd
+    QFile file( patchFile );
+    ASSERT_TRUE( file.open( QFile::ReadOnly ) );
+    auto data = file.readAll();
+    file.close();
+    ASSERT_GE( data.size(), 4 );
+    ASSERT_EQ( data[ data.size() - 4 ], static_cast< char >( CCSVPatch::eCopy ) );
+    ASSERT_EQ( data[ data.size() - 3 ], 0 );
+
+    // the copy now starts past the last LHS row
+    data[ data.size() - 3 ] = static_cast< char >( CCSVPatch::zigzag( lhs.rowCount() + 1 ) );
+    ASSERT_TRUE( writeFile( patchFile, data ) );
+    EXPECT_FALSE( CCSVPatch::apply( lhs, patchFile, dir.filePath( "bad.csv" ), &msg ) );
+    EXPECT_TRUE( msg.contains( "row out of range" ) ) << qPrintable( msg );
+    EXPECT_FALSE( QFile::exists( dir.filePath( "bad.csv" ) ) );
+}
@@ -0,0 +1,156 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "MainWindow/BatchCompare.h"
+#include "MainWindow/ChunkFingerprints.h"
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <gtest/gtest.h>
+#include <random>
+
+namespace
+{
+    // rows of random text, so the chunk cuts land all through the block
+    QByteArray makeBlock( int firstId, int numRows )
+    {
+        std::mt19937 gen( firstId );
+        std::uniform_int_distribution< int > letter( 'a', 'z' );
+        QByteArray retVal;
+        for ( int ii = 0; ii < numRows; ++ii )
+        {
+            QByteArray name;
+            for ( int jj = 0; jj < 12; ++jj )
+                name += static_cast< char >( letter( gen ) );
+            retVal += QByteArray::number( firstId + ii ) + "," + name + "," + QByteArray::number( static_cast< int >( gen() % 100000 ) ) + "\n";
+        }
+        return retVal;
+    }
+
+    bool writeFile( const QString & fileName, const QByteArray & data )
+    {
+        QFile file( fileName );
+        return file.open( QFile::Truncate | QFile::WriteOnly ) && ( file.write( data ) == data.size() );
+    }
+
+    const QByteArray kHeader = "id,name,value\n";
+
+    // the report of one batch run over the pair
+    QJsonObject runPair( const QTemporaryDir & dir, const QString & name, bool skipIdentical )
+    {
+        QString output;
+        QTextStream summary( &output );
+        CBatchCompare batch;
+        QString msg;
+        EXPECT_TRUE( batch.addDirectories( dir.filePath( "lhs" ), dir.filePath( "rhs" ), &msg ) ) << qPrintable( msg );
+        batch.setOutputDir( dir.filePath( name ) );
+        batch.setReportFile( dir.filePath( name + ".json" ) );
+        batch.setSkipIdentical( skipIdentical );
+        EXPECT_TRUE( batch.run( summary ) ) << qPrintable( output );
+
+        QFile file( dir.filePath( name + ".json" ) );
+        if ( !file.open( QFile::ReadOnly ) )
+            return {};
+        return QJsonDocument::fromJson( file.readAll() ).object()[ "pairs" ].toArray().first().toObject();
+    }
+
+    QJsonObject compareFiles( const QByteArray & lhs, const QByteArray & rhs, QJsonObject & full )
+    {
+        QTemporaryDir dir;
+        EXPECT_TRUE( dir.isValid() );
+        QDir().mkpath( dir.filePath( "lhs" ) );
+        QDir().mkpath( dir.filePath( "rhs" ) );
+        EXPECT_TRUE( writeFile( dir.filePath( "lhs/data.csv" ), lhs ) );
+        EXPECT_TRUE( writeFile( dir.filePath( "rhs/data.csv" ), rhs ) );
+
+        full = runPair( dir, "full", false );
+        return runPair( dir, "skipped", true );
+    }
+
+    void expectSameCounts( const QJsonObject & skipped, const QJsonObject & full )
+    {
+        EXPECT_EQ( skipped[ "status" ].toString(), "ok" );
+        for ( auto && ii : { "lhsRows", "rhsRows", "matched", "lhsOnly", "rhsOnly" } )
+            EXPECT_EQ( skipped[ ii ].toInt(), full[ ii ].toInt() ) << ii;
+    }
+}
+
+TEST( ChunkFingerprints, MovedBlockKeepsFullCompareCounts )
+{
+    auto blockA = makeBlock( 0, 20000 );
+    auto blockB = makeBlock( 100000, 20000 );
+    auto blockC = makeBlock( 200000, 20000 );
+    auto blockD = makeBlock( 300000, 20000 );
+
+    // B moves past C, and a row of D changes
+    auto changedD = blockD;
+    changedD.replace( changedD.indexOf( '\n', 1000 ) + 1, 5, "99999" );
+    QJsonObject full;
+    auto skipped = compareFiles( kHeader + blockA + blockB + blockC + blockD, kHeader + blockA + blockC + blockB + changedD, full );
+    expectSameCounts( skipped, full );
+    EXPECT_GT( skipped[ "identicalRows" ].toInt(), 0 );
+    EXPECT_LT( skipped[ "identicalRows" ].toInt(), full[ "matched" ].toInt() );
+}
+
+TEST( ChunkFingerprints, DuplicatedBlockFallsBackToFullCompare )
+{
+    auto blockA = makeBlock( 0, 20000 );
+    auto blockB = makeBlock( 100000, 20000 );
+    auto blockC = makeBlock( 200000, 20000 );
+
+    // the second copy of B repeats keys of rows in aligned chunks
+    QJsonObject full;
+    auto skipped = compareFiles( kHeader + blockA + blockB + blockC, kHeader + blockA + blockB + blockC + blockB, full );
+    expectSameCounts( skipped, full );
+    EXPECT_EQ( skipped[ "identicalRows" ].toInt(), 0 );
+}
+
+TEST( ChunkFingerprints, OnlyAlignedChunksPair )
+{
+    auto blockA = makeBlock( 0, 20000 );
+    auto blockB = makeBlock( 100000, 20000 );
+
+    QTemporaryDir dir;
+    ASSERT_TRUE( dir.isValid() );
+    ASSERT_TRUE( writeFile( dir.filePath( "lhs.csv" ), kHeader + blockA + blockB ) );
+    ASSERT_TRUE( writeFile( dir.filePath( "rhs.csv" ), kHeader + blockB + blockA ) );
+
+    CChunkFingerprints lhs;
+    CChunkFingerprints rhs;
+    ASSERT_TRUE( lhs.compute( dir.filePath( "lhs.csv" ) ) );
+    ASSERT_TRUE( rhs.compute( dir.filePath( "rhs.csv" ) ) );
+    ASSERT_TRUE( lhs.isValid() && rhs.isValid() );
+
+    // swapped halves, only one of them can stay in order
+    CChunkFingerprints::TRanges lhsRanges;
+    CChunkFingerprints::TRanges rhsRanges;
+    auto numRows = CChunkFingerprints::match( lhs, rhs, lhsRanges, rhsRanges );
+    EXPECT_GT( numRows, 0 );
+    EXPECT_LT( numRows, 20000 );
+    EXPECT_FALSE( lhsRanges.empty() );
+    EXPECT_FALSE( rhsRanges.empty() );
+}
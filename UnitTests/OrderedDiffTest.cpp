@@ -0,0 +1,153 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "MainWindow/OrderedDiff.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+    // the runs must walk both sequences in order, equal runs only over equal rows
+    void checkRuns( const COrderedDiff & diff, const std::vector< quint64 > & lhs, const std::vector< quint64 > & rhs )
+    {
+        int lhsPos = 0;
+        int rhsPos = 0;
+        int numEqual = 0;
+        int numDeleted = 0;
+        int numInserted = 0;
+        for ( auto && ii : diff.runs() )
+        {
+            ASSERT_GT( ii.fLength, 0 );
+            switch ( ii.fOp )
+            {
+                case COrderedDiff::eEqual:
+                    ASSERT_EQ( ii.fLHSStart, lhsPos );
+                    ASSERT_EQ( ii.fRHSStart, rhsPos );
+                    for ( int jj = 0; jj < ii.fLength; ++jj )
+                        ASSERT_EQ( lhs[ lhsPos + jj ], rhs[ rhsPos + jj ] );
+                    lhsPos += ii.fLength;
+                    rhsPos += ii.fLength;
+                    numEqual += ii.fLength;
+                    break;
+                case COrderedDiff::eDelete:
+                    ASSERT_EQ( ii.fLHSStart, lhsPos );
+                    lhsPos += ii.fLength;
+                    numDeleted += ii.fLength;
+                    break;
+                case COrderedDiff::eInsert:
+                    ASSERT_EQ( ii.fRHSStart, rhsPos );
+                    rhsPos += ii.fLength;
+                    numInserted += ii.fLength;
+                    break;
+            }
+        }
+        EXPECT_EQ( lhsPos, static_cast< int >( lhs.size() ) );
+        EXPECT_EQ( rhsPos, static_cast< int >( rhs.size() ) );
+        EXPECT_EQ( diff.numEqual(), numEqual );
+        EXPECT_EQ( diff.numDeleted(), numDeleted );
+        EXPECT_EQ( diff.numInserted(), numInserted );
+    }
+}
+
+TEST( OrderedDiff, EmptyInputs )
+{
+    COrderedDiff diff;
+    ASSERT_TRUE( diff.diff( {}, {} ) );
+    EXPECT_TRUE( diff.runs().empty() );
+    EXPECT_EQ( diff.numEqual(), 0 );
+    EXPECT_EQ( diff.numDeleted(), 0 );
+    EXPECT_EQ( diff.numInserted(), 0 );
+    EXPECT_EQ( diff.numMoved(), 0 );
+}
+
+TEST( OrderedDiff, AllInsert )
+{
+    std::vector< quint64 > rhs = { 1, 2, 3, 2 };
+    COrderedDiff diff;
+    ASSERT_TRUE( diff.diff( {}, rhs ) );
+    checkRuns( diff, {}, rhs );
+    EXPECT_EQ( diff.numInserted(), 4 );
+    EXPECT_EQ( diff.numDeleted(), 0 );
+    EXPECT_EQ( diff.numMoved(), 0 );
+}
+
+TEST( OrderedDiff, AllDelete )
+{
+    std::vector< quint64 > lhs = { 1, 2, 3, 2 };
+    COrderedDiff diff;
+    ASSERT_TRUE( diff.diff( lhs, {} ) );
+    checkRuns( diff, lhs, {} );
+    EXPECT_EQ( diff.numDeleted(), 4 );
+    EXPECT_EQ( diff.numInserted(), 0 );
+    EXPECT_EQ( diff.numMoved(), 0 );
+}
+
+TEST( OrderedDiff, Identical )
+{
+    std::vector< quint64 > lhs = { 5, 1, 5, 2, 5 };
+    COrderedDiff diff;
+    ASSERT_TRUE( diff.diff( lhs, lhs ) );
+    checkRuns( diff, lhs, lhs );
+    ASSERT_EQ( diff.runs().size(), 1U );
+    EXPECT_EQ( diff.numEqual(), 5 );
+}
+
+TEST( OrderedDiff, MovedBlock )
+{
+    // 10..12 moved from the front to the back
+    std::vector< quint64 > lhs = { 10, 11, 12, 1, 2, 3, 4, 5, 6 };
+    std::vector< quint64 > rhs = { 1, 2, 3, 4, 5, 6, 10, 11, 12 };
+    COrderedDiff diff;
+    ASSERT_TRUE( diff.diff( lhs, rhs ) );
+    checkRuns( diff, lhs, rhs );
+    EXPECT_EQ( diff.numEqual(), 6 );
+    EXPECT_EQ( diff.numDeleted(), 3 );
+    EXPECT_EQ( diff.numInserted(), 3 );
+    EXPECT_EQ( diff.numMoved(), 3 );
+    for ( int ii = 0; ii < 3; ++ii )
+    {
+        EXPECT_EQ( diff.movedTo( ii ), 6 + ii );
+        EXPECT_EQ( diff.movedFrom( 6 + ii ), ii );
+    }
+    EXPECT_EQ( diff.movedTo( 3 ), -1 );
+    EXPECT_EQ( diff.movedFrom( 0 ), -1 );
+}
+
+TEST( OrderedDiff, RepeatedLines )
+{
+    // no hash is unique, so there are no anchors and the whole range is bisected
+    std::vector< quint64 > lhs = { 7, 7, 8, 7, 8, 8, 7 };
+    std::vector< quint64 > rhs = { 8, 7, 7, 8, 7, 7, 8 };
+    COrderedDiff diff;
+    ASSERT_TRUE( diff.diff( lhs, rhs ) );
+    checkRuns( diff, lhs, rhs );
+    EXPECT_EQ( diff.numEqual(), 5 ); // the longest common subsequence
+    EXPECT_EQ( diff.numDeleted(), 2 );
+    EXPECT_EQ( diff.numInserted(), 2 );
+}
+
+TEST( OrderedDiff, Canceled )
+{
+    std::atomic< bool > canceled{ true };
+    COrderedDiff diff;
+    EXPECT_FALSE( diff.diff( { 1, 2, 3 }, { 3, 2, 1 }, &canceled ) );
+}
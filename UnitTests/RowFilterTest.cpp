@@ -0,0 +1,150 @@
+// The MIT License( MIT )
+//
+// Copyright( c ) 2020 Scott Aron Bloom
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sub-license, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "MainWindow/RowFilter.h"
+#include "MainWindow/CSVDialect.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+    bool isIgnored( const QString & expression, const QStringList & header, const QStringList & row )
+    {
+        CRowFilter filter;
+        QString msg;
+        EXPECT_TRUE( filter.parse( expression, &msg ) ) << qPrintable( msg );
+        filter.bind( header );
+        return filter.isIgnored( row );
+    }
+}
+
+TEST( RowFilter, DefaultExpression )
+{
+    CRowFilter filter;
+    EXPECT_TRUE( filter.isDefault() );
+    EXPECT_TRUE( filter.isActive() );
+    filter.bind( { "a", "b" } );
+    EXPECT_TRUE( filter.isIgnored( QStringList( { "", "0" } ) ) );
+    EXPECT_FALSE( filter.isIgnored( QStringList( { "", "1" } ) ) );
+}
+
+TEST( RowFilter, DefaultMatchesMergedNameRule )
+{
+    // the old rule saw "First Name" and "Last Name" merged into one "First Last" field
+    CRowFilter filter;
+    filter.bind( { "first name", "Last Name", "Amount" } );
+    EXPECT_FALSE( filter.isIgnored( QStringList( { "0", "0", "0" } ) ) ); // "0 0"
+    EXPECT_FALSE( filter.isIgnored( QStringList( { "0", "0", "" } ) ) );
+    EXPECT_TRUE( filter.isIgnored( QStringList( { "0", "", "0" } ) ) );   // "0"
+    EXPECT_TRUE( filter.isIgnored( QStringList( { "", "0", "" } ) ) );    // "0"
+    EXPECT_TRUE( filter.isIgnored( QStringList( { "", "", "" } ) ) );
+    EXPECT_FALSE( filter.isIgnored( QStringList( { "", "", "1" } ) ) );
+
+    // without the first name column nothing is merged
+    filter.bind( { "Last Name", "Amount" } );
+    EXPECT_TRUE( filter.isIgnored( QStringList( { "0", "0" } ) ) );
+}
+
+TEST( RowFilter, EmptyExpressionIgnoresNothing )
+{
+    CRowFilter filter;
+    ASSERT_TRUE( filter.parse( "" ) );
+    EXPECT_FALSE( filter.isActive() );
+    EXPECT_EQ( filter.classify( QByteArray( "0,0" ), CCSVDialect() ), CRowFilter::eKept );
+    EXPECT_EQ( filter.classify( QByteArray( "  " ), CCSVDialect() ), CRowFilter::eBlank );
+}
+
+TEST( RowFilter, Precedence )
+{
+    QStringList header( { "a", "b", "c" } );
+    // and binds tighter than or
+    EXPECT_TRUE( isIgnored( "a = 1 or b = 2 and c = 3", header, { "1", "0", "0" } ) );
+    EXPECT_FALSE( isIgnored( "( a = 1 or b = 2 ) and c = 3", header, { "1", "0", "0" } ) );
+    // not binds tighter than and
+    EXPECT_TRUE( isIgnored( "not a = 0 and b = 0", header, { "1", "0", "0" } ) );
+    EXPECT_FALSE( isIgnored( "not ( a = 1 and b = 0 )", header, { "1", "0", "0" } ) );
+    // the symbol spellings
+    EXPECT_TRUE( isIgnored( R"(c != "" || !( a == "b" ))", header, { "x", "0", "" } ) );
+}
+
+TEST( RowFilter, Quoting )
+{
+    EXPECT_TRUE( isIgnored( R"([Account Id] = "x")", { "Account Id" }, { "x" } ) );
+    EXPECT_TRUE( isIgnored( R"(Name = "a, b")", { "Name" }, { "a, b" } ) );
+    EXPECT_TRUE( isIgnored( R"(Name ~ "^te" and not Region != "EU")", { "Name", "Region" }, { "test", "EU" } ) );
+    EXPECT_TRUE( isIgnored( R"(EMPTY( x ) AND y !~ "z")", { "x", "y" }, { "", "q" } ) );
+    // a column the header lacks reads as empty
+    EXPECT_TRUE( isIgnored( R"(Missing = "")", { "a" }, { "x" } ) );
+}
+
+TEST( RowFilter, Comparisons )
+{
+    // a number compares numerically, a string compares the text
+    EXPECT_TRUE( isIgnored( "Amount < 0", { "Amount" }, { "-5" } ) );
+    EXPECT_FALSE( isIgnored( "Amount < 0", { "Amount" }, { "5" } ) );
+    EXPECT_TRUE( isIgnored( "Amount < 10", { "Amount" }, { "9" } ) );
+    EXPECT_FALSE( isIgnored( R"(Amount < "10")", { "Amount" }, { "9" } ) );
+    EXPECT_TRUE( isIgnored( "x in ( 1, 2.5 )", { "x" }, { "2.50" } ) );
+    EXPECT_TRUE( isIgnored( "x >= 1 and x <= 2 and x > 0.5", { "x" }, { "1.5" } ) );
+
+    // * holds when every field passes
+    EXPECT_TRUE( isIgnored( "* >= 1", { "a", "b" }, { "1", "2" } ) );
+    EXPECT_FALSE( isIgnored( "* >= 1", { "a", "b" }, { "1", "0" } ) );
+}
+
+TEST( RowFilter, ClassifiesRawLines )
+{
+    CRowFilter filter;
+    ASSERT_TRUE( filter.parse( "b = 1" ) );
+    filter.bind( { "a", "b", "c" } );
+    EXPECT_EQ( filter.numFieldsNeeded(), 2 );
+
+    CCSVDialect dialect;
+    EXPECT_EQ( filter.classify( QByteArray( "x,1,y" ), dialect ), CRowFilter::eIgnored );
+    EXPECT_EQ( filter.classify( QByteArray( R"("x, z","1",y)" ), dialect ), CRowFilter::eIgnored );
+    EXPECT_EQ( filter.classify( QByteArray( "x,2,y" ), dialect ), CRowFilter::eKept );
+    EXPECT_EQ( filter.classify( QByteArray( " \t " ), dialect ), CRowFilter::eBlank );
+
+    // a doubled quote in a quoted field is a literal quote
+    ASSERT_TRUE( filter.parse( R"(a ~ "^say .hi.$")" ) );
+    filter.bind( { "a" } );
+    EXPECT_EQ( filter.classify( QByteArray( R"("say ""hi""",2)" ), dialect ), CRowFilter::eIgnored );
+    EXPECT_EQ( filter.classify( QByteArray( R"("say hi",2)" ), dialect ), CRowFilter::eKept );
+}
+
+TEST( RowFilter, Errors )
+{
+    const char * kInvalid[] = { "a =", R"(a = "x)", "( a = 1", "a ~ 5", "a 1", "and = 1", "a = 1 b", "[a = 1", R"(a ~ "(")", "a # 1" };
+    for ( auto && ii : kInvalid )
+    {
+        CRowFilter filter;
+        QString msg;
+        EXPECT_FALSE( filter.parse( ii, &msg ) ) << ii;
+        EXPECT_TRUE( msg.startsWith( "Invalid row filter" ) ) << qPrintable( msg );
+        EXPECT_FALSE( filter.isActive() ) << ii;
+    }
+
+    CRowFilter filter;
+    QString msg;
+    EXPECT_FALSE( filter.parse( "a 1", &msg ) );
+    EXPECT_TRUE( msg.contains( "comparison expected at position 3" ) ) << qPrintable( msg );
+}
@@ -21,19 +21,32 @@
 // SOFTWARE.
 
 #include "MainWindow/MainWindow.h"
+#include "MainWindow/BatchCompare.h"
 #include "SABUtils/SABUtilsResources.h"
 
 #include <QApplication>
 
-int main( int argc, char ** argv )
+static void setApplicationInfo( QCoreApplication & appl )
 {
-    NSABUtils::initResources();
-
-    QApplication appl( argc, argv );
     appl.setApplicationName( "CompareCSV" );
     appl.setApplicationVersion( "0.0" );
     appl.setOrganizationName( "Scott Aron Bloom" );
     appl.setOrganizationDomain( "www.towel42.com" );
+}
+
+int main( int argc, char ** argv )
+{
+    NSABUtils::initResources();
+
+    if ( CBatchCompare::isBatchMode( argc, argv ) )
+    {
+        QCoreApplication appl( argc, argv );
+        setApplicationInfo( appl );
+        return CBatchCompare::exec( appl.arguments() );
+    }
+
+    QApplication appl( argc, argv );
+    setApplicationInfo( appl );
 
     CMainWindow mainWindow;
     mainWindow.show();